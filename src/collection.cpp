@@ -31,11 +31,13 @@
 #include "utils/string_utils.h"
 #include "utils/stringset.h"
 #include "entrycomparison.h"
+#include "entrytextindex.h"
 #include "tellico_debug.h"
 
 #include <KLocalizedString>
 
 #include <QRegExp>
+#include <QAtomicInt>
 
 using namespace Tellico;
 using Tellico::Data::Collection;
@@ -43,12 +45,12 @@ using Tellico::Data::Collection;
 const QString Collection::s_peopleGroupName = QLatin1String("_people");
 
 Collection::Collection(const QString& title_)
-    : QObject(), QSharedData(), m_nextEntryId(1), m_title(title_), m_trackGroups(false) {
+    : QObject(), QSharedData(), m_nextEntryId(1), m_title(title_), m_derivedDependencyRevision(-1), m_derivedFieldsRevision(-1), m_derivedTemplateRevision(0), m_derivedRevision(0), m_fieldRevision(0), m_textIndex(nullptr), m_trackGroups(false) {
   m_id = getID();
 }
 
 Collection::Collection(bool addDefaultFields_, const QString& title_)
-    : QObject(), QSharedData(), m_nextEntryId(1), m_title(title_), m_trackGroups(false) {
+    : QObject(), QSharedData(), m_nextEntryId(1), m_title(title_), m_derivedDependencyRevision(-1), m_derivedFieldsRevision(-1), m_derivedTemplateRevision(0), m_derivedRevision(0), m_fieldRevision(0), m_textIndex(nullptr), m_trackGroups(false) {
   if(m_title.isEmpty()) {
     m_title = i18n("My Collection");
   }
@@ -62,6 +64,7 @@ Collection::Collection(bool addDefaultFields_, const QString& title_)
 }
 
 Collection::~Collection() {
+  delete m_textIndex;
   // maybe we should just call clear() ?
   foreach(EntryGroupDict* dict, m_entryGroupDicts) {
     qDeleteAll(*dict);
@@ -93,6 +96,9 @@ bool Collection::addField(Tellico::Data::FieldPtr field_) {
   m_fields.append(field_);
   m_fieldByName.insert(field_->name(), field_.data());
   m_fieldByTitle.insert(field_->title(), field_.data());
+  const int slot = ensureFieldSlot(field_->name());
+  field_->setSlot(slot);
+  m_fieldBySlot[slot] = field_.data();
 
   if(field_->formatType() == FieldFormat::FormatName) {
     m_peopleFields.append(field_); // list of people attributes
@@ -127,12 +133,13 @@ bool Collection::addField(Tellico::Data::FieldPtr field_) {
   }
 
   if(field_->hasFlag(Field::Derived)) {
-    DerivedValue dv(field_);
-    if(dv.isRecursive(this)) {
+    if(DerivedValue::derivedValue(field_)->isRecursive(this)) {
       field_->setProperty(QLatin1String("template"), QString());
     }
   }
 
+  // the new field might be referenced by title in a derived value, so the entries' cached values are stale
+  ++m_fieldRevision;
   // refresh all dependent fields, in case one references this new one
   foreach(FieldPtr existingField, m_fields) {
     if(existingField->hasFlag(Field::Derived)) {
@@ -214,8 +221,7 @@ bool Collection::mergeField(Tellico::Data::FieldPtr newField_) {
       }
     }
     if(propName == QLatin1String("template") && currField->hasFlag(Field::Derived)) {
-      DerivedValue dv(currField);
-      if(dv.isRecursive(this)) {
+      if(DerivedValue::derivedValue(currField)->isRecursive(this)) {
         currField->setProperty(QLatin1String("template"), QString());
       }
     }
@@ -223,6 +229,8 @@ bool Collection::mergeField(Tellico::Data::FieldPtr newField_) {
 
   // combine flags
   currField->setFlags(currField->flags() | newField_->flags());
+  // the field was changed in place, maybe its template too
+  ++m_fieldRevision;
   return true;
 }
 
@@ -244,6 +252,10 @@ bool Collection::modifyField(Tellico::Data::FieldPtr newField_) {
 
   // update name dict
   m_fieldByName.insert(fieldName, newField_.data());
+  // the new field keeps the same value slot
+  const int slot = ensureFieldSlot(fieldName);
+  newField_->setSlot(slot);
+  m_fieldBySlot[slot] = newField_.data();
 
   // update titles
   const QString oldTitle = oldField->title();
@@ -275,9 +287,11 @@ bool Collection::modifyField(Tellico::Data::FieldPtr newField_) {
     }
   }
 
+  // the compiled template is rebuilt with the new field, and all cached derived values are stale
+  newField_->setDerivedValue(QSharedPointer<const DerivedValue>());
+  ++m_fieldRevision;
   if(newField_->hasFlag(Field::Derived)) {
-    DerivedValue dv(newField_);
-    if(dv.isRecursive(this)) {
+    if(DerivedValue::derivedValue(newField_)->isRecursive(this)) {
       newField_->setProperty(QLatin1String("template"), QString());
     }
   }
@@ -291,6 +305,7 @@ bool Collection::modifyField(Tellico::Data::FieldPtr newField_) {
     foreach(EntryPtr entry, m_entries) {
       entry->invalidateFormattedFieldValue(fieldName);
     }
+    resetTextIndex();
     resetGroups = true;
   }
 
@@ -318,15 +333,20 @@ bool Collection::modifyField(Tellico::Data::FieldPtr newField_) {
     }
   }
 
+  bool removedDict = false;
   bool wasGrouped = oldField->hasFlag(Field::AllowGrouped);
   bool isGrouped = newField_->hasFlag(Field::AllowGrouped);
   if(wasGrouped) {
     if(!isGrouped) {
       // in order to keep list in the same order, don't remove unless new field is not groupable
       m_entryGroups.removeAll(fieldName);
-      delete m_entryGroupDicts.take(fieldName); // no auto-delete here
+      EntryGroupDict* dict = m_entryGroupDicts.take(fieldName); // no auto-delete here
+      if(dict) {
+        qDeleteAll(*dict);
+        delete dict;
+      }
       myDebug() << "no longer grouped: " << fieldName;
-      resetGroups = true;
+      removedDict = true;
     } else {
       // don't do this, it wipes out the old groups!
 //      m_entryGroupDicts.replace(fieldName, new EntryGroupDict());
@@ -348,9 +368,17 @@ bool Collection::modifyField(Tellico::Data::FieldPtr newField_) {
     m_imageFields.append(newField_);
   }
 
-  if(resetGroups) {
-//    myLog() << "invalidating groups";
-    invalidateGroups();
+  if(removedDict) {
+    // the entries still refer to groups of the removed dict, so start over
+    clearGroups();
+  } else if(resetGroups) {
+    // only the groups of the modified field, and the ones built from it, can have different names
+    QStringList dictNames = dictNamesForFields(QStringList() << fieldName);
+    if((wasPeople || isPeople) && m_entryGroupDicts.contains(s_peopleGroupName) &&
+       !dictNames.contains(s_peopleGroupName)) {
+      dictNames << s_peopleGroupName;
+    }
+    regroupDicts(dictNames);
   }
 
   // now to update all entries if the field is a derived value and the template changed
@@ -385,6 +413,7 @@ bool Collection::removeField(Tellico::Data::FieldPtr field_, bool force_/*=false
     // setting the fields to an empty string removes the value from the entry's list
     entry->setField(field_, QString());
   }
+  resetTextIndex();
 
   bool success = true;
   if(field_->formatType() == FieldFormat::FormatName) {
@@ -396,6 +425,11 @@ bool Collection::removeField(Tellico::Data::FieldPtr field_, bool force_/*=false
   }
   m_fieldByName.remove(field_->name());
   m_fieldByTitle.remove(field_->title());
+  // keep the slot reserved for the field name, in case it gets added back
+  const int slot = fieldSlot(field_->name());
+  if(slot > -1) {
+    m_fieldBySlot[slot] = nullptr;
+  }
 
   if(fieldsByCategory(field_->category()).count() == 1) {
     m_fieldCategories.removeAll(field_->category());
@@ -411,6 +445,7 @@ bool Collection::removeField(Tellico::Data::FieldPtr field_, bool force_/*=false
   }
 
   m_fields.removeAll(field_);
+  ++m_fieldRevision;
 
   // refresh all dependent fields, rather lazy, but there's
   // likely to be weird effects when checking dependent fields
@@ -477,6 +512,9 @@ void Collection::addEntries(const Tellico::Data::EntryList& entries_) {
       entry->setField(QLatin1String("mdate"), QDate::currentDate().toString(Qt::ISODate));
     }
   }
+  if(m_textIndex) {
+    m_textIndex->addEntries(entries_);
+  }
   if(m_trackGroups) {
     populateCurrentDicts(entries_, fieldNames());
   }
@@ -507,10 +545,15 @@ void Collection::removeEntriesFromDicts(const Tellico::Data::EntryList& entries_
 }
 
 // this function gets called whenever an entry is modified. Its purpose is to keep the
-// groupDicts current. It first removes the entry from every group to which it belongs,
-// then it repopulates the dicts with the entry's fields
+// groupDicts current. Only the dicts which depend on the modified fields are checked
 void Collection::updateDicts(const Tellico::Data::EntryList& entries_, const QStringList& fields_) {
-  if(entries_.isEmpty() || !m_trackGroups) {
+  if(entries_.isEmpty()) {
+    return;
+  }
+  if(m_textIndex) {
+    m_textIndex->updateEntries(entries_);
+  }
+  if(!m_trackGroups) {
     return;
   }
   QStringList modifiedFields = fields_;
@@ -518,11 +561,104 @@ void Collection::updateDicts(const Tellico::Data::EntryList& entries_, const QSt
 //    myDebug() << "updating all fields";
     modifiedFields = fieldNames();
   }
-  removeEntriesFromDicts(entries_, modifiedFields);
-  populateCurrentDicts(entries_, modifiedFields);
+  regroupEntries(entries_, dictNamesForFields(modifiedFields));
   cleanGroups();
 }
 
+// the dicts that might have different group names when the values of the fields change
+QStringList Collection::dictNamesForFields(const QStringList& fields_) {
+  QStringList dictNames;
+  bool peopleChanged = false;
+  bool derivedChanged = false;
+  foreach(const QString& fieldName, fields_) {
+    if(m_entryGroupDicts.contains(fieldName)) {
+      dictNames << fieldName;
+    }
+    FieldPtr field = m_fieldByName.value(fieldName);
+    if(field && field->formatType() == FieldFormat::FormatName) {
+      peopleChanged = true;
+    }
+  }
+  foreach(const QString& fieldName, fields_) {
+    if(isDerivedDependency(fieldName)) {
+      derivedChanged = true;
+      break;
+    }
+  }
+  if(peopleChanged && m_entryGroupDicts.contains(s_peopleGroupName)) {
+    dictNames << s_peopleGroupName;
+  }
+  if(derivedChanged) {
+    foreach(FieldPtr field, m_fields) {
+      if(field->hasFlag(Field::Derived) && m_entryGroupDicts.contains(field->name()) &&
+         !dictNames.contains(field->name())) {
+        dictNames << field->name();
+      }
+    }
+  }
+  return dictNames;
+}
+
+// compares the groups each entry is currently in with the group names from its current values,
+// and only moves the entry out of or into the groups which differ
+void Collection::regroupEntries(const Tellico::Data::EntryList& entries_, const QStringList& dictNames_) {
+  QSet<EntryGroup*> modifiedGroups;
+  foreach(const QString& dictName, dictNames_) {
+    EntryGroupDict* dict = m_entryGroupDicts.value(dictName);
+    // dicts are populated on demand, so an empty one is skipped unless it's the current one
+    if(!dict || (dict->isEmpty() && dictName != m_lastGroupField)) {
+      continue;
+    }
+    const bool isBool = hasField(dictName) && fieldByName(dictName)->type() == Field::Bool;
+
+    foreach(EntryPtr entry, entries_) {
+      QStringList groupTitles = entryGroupNamesByField(entry, dictName);
+      // bool fields use the field title
+      if(isBool) {
+        for(QStringList::Iterator it = groupTitles.begin(); it != groupTitles.end(); ++it) {
+          if(!(*it).isEmpty()) {
+            *it = fieldTitleByName(dictName);
+          }
+        }
+      }
+      // need a copy of the list since it gets changed
+      const QList<EntryGroup*> groups = entry->groups();
+      foreach(EntryGroup* group, groups) {
+        if(group->fieldName() != dictName) {
+          continue;
+        }
+        // the entry stays in any group whose name is unchanged
+        if(groupTitles.removeAll(group->groupName()) > 0) {
+          continue;
+        }
+        if(entry->removeFromGroup(group)) {
+          modifiedGroups.insert(group);
+        }
+        if(group->isEmpty() && !m_groupsToDelete.contains(group)) {
+          m_groupsToDelete.push_back(group);
+        }
+      }
+      // whatever is left is a new group for the entry
+      foreach(const QString& groupTitle, groupTitles) {
+        EntryGroup* group = dict->value(groupTitle);
+        if(!group) {
+          group = new EntryGroup(groupTitle, dictName);
+          dict->insert(groupTitle, group);
+        } else if(group->isEmpty()) {
+          // if it's empty, then it was previously added to the vector of groups to delete
+          m_groupsToDelete.removeOne(group);
+        }
+        if(entry->addToGroup(group)) {
+          modifiedGroups.insert(group);
+        }
+      }
+    }
+  }
+  if(!modifiedGroups.isEmpty()) {
+    emit signalGroupsModified(CollPtr(this), modifiedGroups.toList());
+  }
+}
+
 bool Collection::removeEntries(const Tellico::Data::EntryList& vec_) {
   if(vec_.isEmpty()) {
     return false;
@@ -534,6 +670,9 @@ bool Collection::removeEntries(const Tellico::Data::EntryList& vec_) {
     m_entryById.remove(entry->id());
     m_entries.removeAll(entry);
   }
+  if(m_textIndex) {
+    m_textIndex->removeEntries(vec_);
+  }
   cleanGroups();
   return success;
 }
@@ -614,6 +753,67 @@ bool Collection::hasField(const QString& name_) const {
   return m_fieldByName.contains(name_);
 }
 
+int Collection::fieldSlot(Tellico::Data::FieldPtr field_) const {
+  const int slot = field_->slot();
+  if(slot > -1 && slot < m_fieldBySlot.size() && m_fieldBySlot.at(slot) == field_.data()) {
+    return slot;
+  }
+  // the field might belong to another collection
+  return fieldSlot(field_->name());
+}
+
+int Collection::ensureFieldSlot(const QString& name_) {
+  int slot = m_slotByName.value(name_, -1);
+  if(slot == -1) {
+    slot = m_slotNames.count();
+    m_slotByName.insert(name_, slot);
+    m_slotNames << name_;
+    m_fieldBySlot.append(nullptr);
+  }
+  return slot;
+}
+
+int Collection::derivedRevision() {
+  if(m_derivedFieldsRevision != m_fieldRevision) {
+    m_derivedFields.clear();
+    foreach(FieldPtr field, m_fields) {
+      if(field->hasFlag(Field::Derived)) {
+        m_derivedFields.append(field);
+      }
+    }
+    m_derivedFieldsRevision = m_fieldRevision;
+    ++m_derivedRevision;
+  }
+  // a template can also be changed in place, without modifyField()
+  int templateRevision = 0;
+  foreach(FieldPtr field, m_derivedFields) {
+    templateRevision += field->derivedRevision();
+  }
+  if(templateRevision != m_derivedTemplateRevision) {
+    m_derivedTemplateRevision = templateRevision;
+    ++m_derivedRevision;
+  }
+  return m_derivedRevision;
+}
+
+bool Collection::isDerivedDependency(const QString& name_) {
+  if(m_derivedDependencyRevision != derivedRevision()) {
+    m_derivedDependencies.clear();
+    foreach(FieldPtr field, m_derivedFields) {
+      foreach(const QString& key, DerivedValue::derivedValue(field)->templateFields()) {
+        m_derivedDependencies.insert(key);
+        // the template may use the field title instead of the name
+        FieldPtr f = fieldByTitle(key);
+        if(f) {
+          m_derivedDependencies.insert(f->name());
+        }
+      }
+    }
+    m_derivedDependencyRevision = m_derivedRevision;
+  }
+  return m_derivedDependencies.contains(name_);
+}
+
 bool Collection::isAllowed(const QString& field_, const QString& value_) const {
   // empty string is always allowed
   if(value_.isEmpty()) {
@@ -746,19 +946,60 @@ QStringList Collection::entryGroupNamesByField(Tellico::Data::EntryPtr entry_, c
 }
 
 void Collection::invalidateGroups() {
+  // the group names come from the formatted values
+  foreach(EntryPtr entry, m_entries) {
+    entry->invalidateFormattedFieldValue();
+  }
+  // the formatted values are indexed too, so rebuild it the next time it's needed
+  resetTextIndex();
+
+  // the formatting settings only change the names of groups from formatted fields
+  QStringList fieldNames;
+  foreach(FieldPtr field, m_fields) {
+    if(field->formatType() != FieldFormat::FormatNone) {
+      fieldNames << field->name();
+    }
+  }
+  regroupDicts(dictNamesForFields(fieldNames));
+}
+
+void Collection::regroupDicts(const QStringList& dictNames_) {
+  if(dictNames_.isEmpty()) {
+    return;
+  }
+  // the group view gets refreshed afterwards, so block the signals for the modified groups
+  const bool b = signalsBlocked();
+  blockSignals(true);
+  regroupEntries(m_entries, dictNames_);
+  cleanGroups();
+  blockSignals(b);
+}
+
+void Collection::clearGroups() {
   foreach(EntryGroupDict* dict, m_entryGroupDicts) {
     qDeleteAll(*dict);
     dict->clear();
     // don't delete the dict, just clear it
   }
+  m_groupsToDelete.clear();
 
-  // populateDicts() will make signals that the group view is connected to, block those
-  blockSignals(true);
   foreach(EntryPtr entry, m_entries) {
     entry->invalidateFormattedFieldValue();
     entry->clearGroups();
   }
-  blockSignals(false);
+}
+
+void Collection::resetTextIndex() {
+  delete m_textIndex;
+  m_textIndex = nullptr;
+}
+
+Tellico::Data::EntryTextIndex* Collection::textIndex() {
+  if(!m_textIndex) {
+    m_textIndex = new EntryTextIndex();
+    m_textIndex->addEntries(m_entries);
+  }
+  return m_textIndex;
 }
 
 Tellico::Data::EntryPtr Collection::entryById(Data::ID id_) {
@@ -798,6 +1039,8 @@ void Collection::addFilter(Tellico::FilterPtr filter_) {
     return;
   }
 
+  // saved filters are matched against this collection, so resolve the fields now
+  filter_->compile(CollPtr(this));
   m_filters.append(filter_);
 }
 
@@ -820,10 +1063,14 @@ void Collection::clear() {
   m_fieldCategories.clear();
   m_fieldByName.clear();
   m_fieldByTitle.clear();
+  m_slotByName.clear();
+  m_slotNames.clear();
+  m_fieldBySlot.clear();
   m_defaultGroupField.clear();
 
   m_entries.clear();
   m_entryById.clear();
+  resetTextIndex();
   foreach(EntryGroupDict* dict, m_entryGroupDicts) {
     qDeleteAll(*dict);
   }
@@ -869,9 +1116,14 @@ int Collection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::EntryP
   return res;
 }
 
+QStringList Collection::sameEntryFields() const {
+  return fieldNames();
+}
+
 Tellico::Data::ID Collection::getID() {
-  static ID id = 0;
-  return ++id;
+  // collections are also created in the thread reading a file
+  static QAtomicInt id;
+  return id.fetchAndAddOrdered(1) + 1;
 }
 
 Data::FieldPtr Collection::primaryImageField() const {
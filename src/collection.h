@@ -38,6 +38,7 @@
 namespace Tellico {
   namespace Data {
     class EntryGroup;
+    class EntryTextIndex;
     typedef QHash<QString, EntryGroup*> EntryGroupDict;
 
 /**
@@ -175,9 +176,11 @@ public:
   void addEntries(const EntryList& entries);
   void addEntries(EntryPtr entry) { addEntries(EntryList() << entry); }
   /**
-   * Updates the dicts that include the entry.
+   * Updates the dicts that include the entry. Only the groups of the modified fields are checked,
+   * and the entries are only moved between groups whose names actually changed.
    *
-   * @param entry A pointer to the entry
+   * @param entries The modified entries
+   * @param fields The names of the modified fields, or empty for all of them
    */
   void updateDicts(const EntryList& entries, const QStringList& fields);
   /**
@@ -214,6 +217,11 @@ public:
   // the return values should be compared against the GOOD and PERFECT
   // static match constants
   virtual int sameEntry(Data::EntryPtr, Data::EntryPtr) const;
+  /**
+   * Returns the names of the fields scored by sameEntry(). Two entries can only be a match
+   * if at least one of these fields has a non-zero score.
+   */
+  virtual QStringList sameEntryFields() const;
 
   /**
    * Determines whether or not a certain value is allowed for an field.
@@ -286,6 +294,59 @@ public:
    * Returns @p true if the collection contains a field named @ref name;
    */
   bool hasField(const QString& name) const;
+  /**
+   * Returns the slot used by the entries to store values for a field name. Slots
+   * are never reused, so a field which is removed and added again keeps the same slot.
+   *
+   * @param name The field name
+   * @return The value slot, or -1 if no field by that name was ever added
+   */
+  int fieldSlot(const QString& name) const { return m_slotByName.value(name, -1); }
+  /**
+   * Returns the value slot for a field. If the field belongs to this collection,
+   * no name lookup is done.
+   *
+   * @param field The field
+   * @return The value slot, or -1 if no field by that name was ever added
+   */
+  int fieldSlot(FieldPtr field) const;
+  /**
+   * Returns the value slot for a field name, allocating a new one if necessary.
+   *
+   * @param name The field name
+   * @return The value slot
+   */
+  int ensureFieldSlot(const QString& name);
+  /**
+   * Returns the field name for a value slot.
+   *
+   * @param slot The value slot
+   * @return The field name
+   */
+  QString fieldNameBySlot(int slot) const { return m_slotNames.value(slot); }
+  /**
+   * Returns the field names of all the value slots, in slot order.
+   */
+  const QStringList& fieldSlotNames() const { return m_slotNames; }
+  /**
+   * Returns a counter that is incremented whenever a field is added, modified, or removed,
+   * so anything holding on to field pointers knows to look them up again.
+   */
+  int fieldRevision() const { return m_fieldRevision; }
+  /**
+   * Returns true if the value of any derived field depends on a field. The dependencies
+   * are recalculated whenever a derived template changes.
+   *
+   * @param name The field name
+   */
+  bool isDerivedDependency(const QString& name);
+  /**
+   * Returns a counter that is incremented whenever the value of a derived field might
+   * change for every entry, either because the fields changed or because a derived
+   * template was changed in place. Entries use it to know when their cached derived
+   * values are stale.
+   */
+  int derivedRevision();
   /**
    * Returns a list of all the possible entry groups. This value is cached rather
    * than generated with each call, so the method should be fairly fast.
@@ -302,9 +363,17 @@ public:
    */
   EntryGroupDict* entryGroupDictByName(const QString& name);
   /**
-   * Invalidates all group names in the collection.
+   * Invalidates all group names in the collection, such as when the formatting settings change.
+   * The groups are kept, and only the groups of formatted fields are checked for entries whose
+   * group names changed.
    */
   void invalidateGroups();
+  /**
+   * Returns the full-text index of the entry values, used by the filter rules that search
+   * every field. The index is built the first time it is needed, and then kept up to date
+   * as entries are added, modified, or removed.
+   */
+  EntryTextIndex* textIndex();
   /**
    * Returns true if the collection contains at least one Image field.
    *
@@ -350,7 +419,12 @@ private:
   void removeEntriesFromDicts(const EntryList& entries, const QStringList& fields);
   void populateDict(EntryGroupDict* dict, const QString& fieldName, const EntryList& entries);
   void populateCurrentDicts(const EntryList& entries, const QStringList& fields);
+  void regroupEntries(const EntryList& entries, const QStringList& dictNames);
+  void regroupDicts(const QStringList& dictNames);
+  QStringList dictNamesForFields(const QStringList& fields);
+  void clearGroups();
   void cleanGroups();
+  void resetTextIndex();
 
   /*
    * Gets the preferred ID of the collection. Currently, it just gets incremented as
@@ -372,9 +446,21 @@ private:
   QHash<QString, Field*> m_fieldByName;
   QHash<QString, Field*> m_fieldByTitle;
   QStringList m_fieldCategories;
+  // entry values are stored in a vector, indexed by the field slot
+  QHash<QString, int> m_slotByName;
+  QStringList m_slotNames;
+  QVector<Field*> m_fieldBySlot;
+  QSet<QString> m_derivedDependencies;
+  int m_derivedDependencyRevision;
+  FieldList m_derivedFields;
+  int m_derivedFieldsRevision;
+  int m_derivedTemplateRevision;
+  int m_derivedRevision;
+  int m_fieldRevision;
 
   EntryList m_entries;
   QHash<int, Entry*> m_entryById;
+  EntryTextIndex* m_textIndex;
 
   QHash<QString, EntryGroupDict*> m_entryGroupDicts;
   QStringList m_entryGroups;
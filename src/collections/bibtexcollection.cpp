@@ -359,6 +359,11 @@ int BibtexCollection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::
   return res;
 }
 
+QStringList BibtexCollection::sameEntryFields() const {
+  return QStringList() << QLatin1String("isbn") << QLatin1String("lccn") << QLatin1String("doi") << QLatin1String("pmid") << QLatin1String("arxiv")
+                       << QLatin1String("title") << QLatin1String("author") << QLatin1String("cr_year") << QLatin1String("pub_year") << QLatin1String("binding");
+}
+
 // static
 Tellico::Data::CollPtr BibtexCollection::convertBookCollection(Tellico::Data::CollPtr coll_) {
   const QString bibtex = QLatin1String("bibtex");
@@ -67,6 +67,7 @@ public:
 
   virtual QString prepareText(const QString& text) const Q_DECL_OVERRIDE;
   virtual int sameEntry(Data::EntryPtr entry1, Data::EntryPtr entry2) const Q_DECL_OVERRIDE;
+  virtual QStringList sameEntryFields() const Q_DECL_OVERRIDE;
   
   EntryList duplicateBibtexKeys() const;
 
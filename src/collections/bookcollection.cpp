@@ -211,3 +211,8 @@ int BookCollection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::En
   res += EntryComparison::score(entry1_, entry2_, QLatin1String("binding"), this);
   return res;
 }
+
+QStringList BookCollection::sameEntryFields() const {
+  return QStringList() << QLatin1String("isbn") << QLatin1String("lccn") << QLatin1String("title") << QLatin1String("author") << QLatin1String("cr_year")
+                       << QLatin1String("pub_year") << QLatin1String("binding");
+}
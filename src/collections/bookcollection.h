@@ -48,6 +48,7 @@ public:
 
   virtual Type type() const Q_DECL_OVERRIDE { return Book; }
   virtual int sameEntry(Data::EntryPtr entry1, Data::EntryPtr entry2) const Q_DECL_OVERRIDE;
+  virtual QStringList sameEntryFields() const Q_DECL_OVERRIDE;
 
   static FieldList defaultFields();
 };
@@ -195,3 +195,8 @@ int ComicBookCollection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Dat
   res += EntryComparison::score(entry1_, entry2_, QLatin1String("pub_year"), this);
   return res;
 }
+
+QStringList ComicBookCollection::sameEntryFields() const {
+  return QStringList() << QLatin1String("isbn") << QLatin1String("lccn") << QLatin1String("lien-bel") << QLatin1String("title") << QLatin1String("series")
+                       << QLatin1String("writer") << QLatin1String("artist") << QLatin1String("issue") << QLatin1String("publisher") << QLatin1String("pub_year");
+}
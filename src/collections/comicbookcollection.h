@@ -51,6 +51,7 @@ public:
 
   virtual Type type() const Q_DECL_OVERRIDE { return ComicBook; }
   virtual int sameEntry(Data::EntryPtr entry1, Data::EntryPtr entry2) const Q_DECL_OVERRIDE;
+  virtual QStringList sameEntryFields() const Q_DECL_OVERRIDE;
 
   static FieldList defaultFields();
 };
@@ -130,3 +130,7 @@ int FileCatalog::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::Entry
   res += EntryComparison::score(entry1_, entry2_, QLatin1String("mimetype"), this);
   return res;
 }
+
+QStringList FileCatalog::sameEntryFields() const {
+  return QStringList() << QLatin1String("url") << QLatin1String("title") << QLatin1String("description") << QLatin1String("mimetype");
+}
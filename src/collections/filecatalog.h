@@ -41,6 +41,7 @@ public:
 
   virtual Type type() const Q_DECL_OVERRIDE { return File; }
   virtual int sameEntry(Data::EntryPtr entry1, Data::EntryPtr entry2) const Q_DECL_OVERRIDE;
+  virtual QStringList sameEntryFields() const Q_DECL_OVERRIDE;
 
   static FieldList defaultFields();
 };
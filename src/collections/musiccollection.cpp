@@ -142,3 +142,7 @@ int MusicCollection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::E
   res += EntryComparison::score(entry1_, entry2_, QLatin1String("medium"), this);
   return res;
 }
+
+QStringList MusicCollection::sameEntryFields() const {
+  return QStringList() << QLatin1String("title") << QLatin1String("artist") << QLatin1String("year") << QLatin1String("label") << QLatin1String("medium");
+}
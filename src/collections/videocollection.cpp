@@ -246,3 +246,8 @@ int VideoCollection::sameEntry(Tellico::Data::EntryPtr entry1_, Tellico::Data::E
   res += 10*EntryComparison::score(entry1_, entry2_, QLatin1String("imdb"), this);
   return res;
 }
+
+QStringList VideoCollection::sameEntryFields() const {
+  return QStringList() << QLatin1String("title") << QLatin1String("year") << QLatin1String("director") << QLatin1String("studio") << QLatin1String("medium")
+                       << QLatin1String("imdb");
+}
@@ -48,6 +48,7 @@ public:
 
   virtual Type type() const Q_DECL_OVERRIDE { return Video; }
   virtual int sameEntry(Data::EntryPtr, Data::EntryPtr) const Q_DECL_OVERRIDE;
+  virtual QStringList sameEntryFields() const Q_DECL_OVERRIDE;
 
   static FieldList defaultFields();
 };
@@ -192,6 +192,27 @@ void Controller::slotCollectionDeleted(Tellico::Data::CollPtr coll_) {
   coll_->disconnect();
 }
 
+void Controller::slotEntriesAdded(Tellico::Data::EntryList entries_) {
+  addedEntries(entries_);
+  m_mainWindow->slotEntryCount();
+}
+
+void Controller::slotEntriesModified(Tellico::Data::EntryList entries_) {
+  modifiedEntries(entries_);
+}
+
+void Controller::slotCollectionRead(Tellico::Data::CollPtr coll_) {
+  if(!coll_ || !m_mainWindow->m_groupView) {
+    return;
+  }
+  foreach(FilterPtr filter, coll_->filters()) {
+    addedFilter(filter);
+  }
+  foreach(Data::BorrowerPtr borrower, coll_->borrowers()) {
+    addedBorrower(borrower);
+  }
+}
+
 void Controller::slotFieldAdded(Tellico::Data::CollPtr coll_, Tellico::Data::FieldPtr field_) {
   addedField(coll_, field_);
 }
@@ -128,6 +128,12 @@ public Q_SLOTS:
    * @param coll A pointer to the collection being added
    */
   void slotCollectionDeleted(Tellico::Data::CollPtr coll);
+  void slotEntriesAdded(Tellico::Data::EntryList entries);
+  void slotEntriesModified(Tellico::Data::EntryList entries);
+  /**
+   * Adds the filters and loans of a collection which was read after it was added.
+   */
+  void slotCollectionRead(Tellico::Data::CollPtr coll);
   void slotFieldAdded(Tellico::Data::CollPtr coll, Tellico::Data::FieldPtr field);
   void slotRefreshField(Tellico::Data::FieldPtr field);
 
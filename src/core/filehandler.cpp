@@ -322,6 +322,16 @@ bool FileHandler::writeDataURL(const QUrl& url_, const QByteArray& data_, bool f
   return success;
 }
 
+bool FileHandler::uploadFile(const QString& fileName_, const QUrl& url_, bool quiet_) {
+  KIO::Job* job = KIO::file_copy(QUrl::fromLocalFile(fileName_), url_, -1, KIO::Overwrite);
+  KJobWidgets::setWindow(job, GUI::Proxy::widget());
+  const bool success = job->exec();
+  if(!success && !quiet_) {
+    GUI::Proxy::sorry(i18n(errorUpload, url_.fileName()));
+  }
+  return success;
+}
+
 bool FileHandler::writeDataFile(QSaveFile& file_, const QByteArray& data_) {
 //  myDebug() << "Writing to" << file_.fileName();
   QDataStream s(&file_);
@@ -143,6 +143,14 @@ public:
    * @return A boolean indicating success
    */
   static bool writeDataURL(const QUrl& url, const QByteArray& data, bool force=false, bool quiet=false);
+  /**
+   * Copies a local file to a remote URL, overwriting any existing file.
+   *
+   * @param fileName The local file name
+   * @param url The target URL
+   * @return A boolean indicating success
+   */
+  static bool uploadFile(const QString& fileName, const QUrl& url, bool quiet=false);
   /**
    * Checks to see if a URL exists already, and if so, queries the user.
    *
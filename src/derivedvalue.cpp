@@ -28,17 +28,17 @@
 #include "utils/stringset.h"
 #include "tellico_debug.h"
 
+#include <QRegExp>
 #include <QStack>
 
 using namespace Tellico::Data;
 using Tellico::Data::DerivedValue;
 
-DerivedValue::DerivedValue(const QString& valueTemplate_) : m_valueTemplate(valueTemplate_)
-    , m_keyRx(QLatin1String("^([^:]+):?(-?\\d*)/?(.*)$")) {
-  m_keyRx.setMinimal(true);
+DerivedValue::DerivedValue(const QString& valueTemplate_) : m_valueTemplate(valueTemplate_) {
+  compile();
 }
 
-DerivedValue::DerivedValue(FieldPtr field_) : m_keyRx(QLatin1String("^([^:]+):?(-?\\d*)/?(.*)$")) {
+DerivedValue::DerivedValue(FieldPtr field_) {
   Q_ASSERT(field_);
   if(!field_->hasFlag(Field::Derived)) {
     myWarning() << "using DerivedValue for non-derived field";
@@ -46,7 +46,17 @@ DerivedValue::DerivedValue(FieldPtr field_) : m_keyRx(QLatin1String("^([^:]+):?(
     m_valueTemplate = field_->property(QLatin1String("template"));
     m_fieldName = field_->name();
   }
-  m_keyRx.setMinimal(true);
+  compile();
+}
+
+QSharedPointer<const DerivedValue> DerivedValue::derivedValue(FieldPtr field_) {
+  Q_ASSERT(field_);
+  QSharedPointer<const DerivedValue> dv = field_->derivedValue();
+  if(!dv) {
+    dv = QSharedPointer<const DerivedValue>(new DerivedValue(field_));
+    field_->setDerivedValue(dv);
+  }
+  return dv;
 }
 
 bool DerivedValue::isRecursive(Collection* coll_) const {
@@ -77,8 +87,7 @@ bool DerivedValue::isRecursive(Collection* coll_) const {
       fieldNamesFound.add(f->name());
     }
     if(f->hasFlag(Field::Derived)) {
-      DerivedValue dv(f);
-      foreach(const QString& key, dv.templateFields()) {
+      foreach(const QString& key, derivedValue(f)->templateFields()) {
         fieldsToCheck.push(key);
       }
     }
@@ -86,15 +95,13 @@ bool DerivedValue::isRecursive(Collection* coll_) const {
   return false;
 }
 
-QString DerivedValue::value(EntryPtr entry_, bool formatted_) const {
-  Q_ASSERT(entry_);
-  Q_ASSERT(entry_->collection());
-  if(!entry_ || !entry_->collection()) {
-    return m_valueTemplate;
-  }
-
-  QString result;
+// the template is split into literal text and keys, so that the template
+// string and the keys only have to be parsed once
+void DerivedValue::compile() {
+  QRegExp keyRx(QLatin1String("^([^:]+):?(-?\\d*)/?(.*)$"));
+  keyRx.setMinimal(true);
 
+  QString literal;
   int endPos;
   int curPos = 0;
   int pctPos = m_valueTemplate.indexOf(QLatin1Char('%'), curPos);
@@ -102,44 +109,75 @@ QString DerivedValue::value(EntryPtr entry_, bool formatted_) const {
     if(m_valueTemplate.at(pctPos+1) == QLatin1Char('{')) {
       endPos = m_valueTemplate.indexOf(QLatin1Char('}'), pctPos+2);
       if(endPos > -1) {
-        result += m_valueTemplate.midRef(curPos, pctPos-curPos)
-                + templateKeyValue(entry_, m_valueTemplate.mid(pctPos+2, endPos-pctPos-2), formatted_);
+        literal += m_valueTemplate.midRef(curPos, pctPos-curPos);
+        const QString key = m_valueTemplate.mid(pctPos+2, endPos-pctPos-2);
+        if(keyRx.indexIn(key) == -1) {
+          myDebug() << "unmatched regexp for" << key;
+          literal += QLatin1String("%{") + key + QLatin1Char('}');
+        } else {
+          if(!literal.isEmpty()) {
+            Token token;
+            token.text = literal;
+            m_tokens.append(token);
+            literal.clear();
+          }
+          Token token;
+          token.isKey = true;
+          token.key = key;
+          token.text = keyRx.cap(1);
+          // field name, followed by optional colon, optional value index (negative), and words after slash
+          token.pos = keyRx.cap(2).toInt();
+          token.func = keyRx.cap(3);
+          m_tokens.append(token);
+        }
         curPos = endPos+1;
       } else {
         break;
       }
     } else {
-      result += m_valueTemplate.midRef(curPos, pctPos-curPos+1);
+      literal += m_valueTemplate.midRef(curPos, pctPos-curPos+1);
       curPos = pctPos+1;
     }
     pctPos = m_valueTemplate.indexOf(QLatin1Char('%'), curPos);
   }
-  result += m_valueTemplate.midRef(curPos, m_valueTemplate.length()-curPos);
-//  myDebug() << "format_ << " = " << result;
-  // sometimes field value might empty, resulting in multiple consecutive white spaces
-  // so let's simplify that...
-  return result.simplified();
-}
+  literal += m_valueTemplate.midRef(curPos, m_valueTemplate.length()-curPos);
+  if(!literal.isEmpty()) {
+    Token token;
+    token.text = literal;
+    m_tokens.append(token);
+  }
 
-// format is something like "%{year} %{author}"
-QStringList DerivedValue::templateFields() const {
+  // format is something like "%{year} %{author}"
   QRegExp rx(QLatin1String("%\\{([^:]+):?.*\\}"));
   rx.setMinimal(true);
-
-  QStringList list;
   for(int pos = rx.indexIn(m_valueTemplate); pos > -1; pos = rx.indexIn(m_valueTemplate, pos+rx.matchedLength())) {
-    list << rx.cap(1);
+    m_templateFields << rx.cap(1);
   }
-  return list;
 }
 
-QString DerivedValue::templateKeyValue(EntryPtr entry_, const QString& key_, bool formatted_) const {
-  if(m_keyRx.indexIn(key_) == -1) {
-    myDebug() << "unmatched regexp for" << key_;
-    return QLatin1String("%{") + key_ + QLatin1Char('}');
+QString DerivedValue::value(EntryPtr entry_, bool formatted_) const {
+  Q_ASSERT(entry_);
+  Q_ASSERT(entry_->collection());
+  if(!entry_ || !entry_->collection()) {
+    return m_valueTemplate;
   }
 
-  const QString fieldName = m_keyRx.cap(1);
+  QString result;
+  foreach(const Token& token, m_tokens) {
+    if(token.isKey) {
+      result += templateKeyValue(entry_, token, formatted_);
+    } else {
+      result += token.text;
+    }
+  }
+//  myDebug() << "format_ << " = " << result;
+  // sometimes field value might empty, resulting in multiple consecutive white spaces
+  // so let's simplify that...
+  return result.simplified();
+}
+
+QString DerivedValue::templateKeyValue(EntryPtr entry_, const Token& token_, bool formatted_) const {
+  const QString& fieldName = token_.text;
   FieldPtr field = entry_->collection()->fieldByName(fieldName);
   if(!field) {
     // allow the user to also use field titles
@@ -151,11 +189,10 @@ QString DerivedValue::templateKeyValue(EntryPtr entry_, const QString& key_, boo
       // '@id' is the best way to use it, but formerly, we allowed just 'id'
       return QString::number(entry_->id());
     } else {
-      return QLatin1String("%{") + key_ + QLatin1Char('}');
+      return QLatin1String("%{") + token_.key + QLatin1Char('}');
     }
   }
-  // field name, followed by optional colon, optional value index (negative), and words after slash
-  int pos = m_keyRx.cap(2).toInt();
+  int pos = token_.pos;
   QString result;
   if(pos == 0) {
     // insert field value
@@ -187,7 +224,7 @@ QString DerivedValue::templateKeyValue(EntryPtr entry_, const QString& key_, boo
     result = values.value(pos);
   }
 
-  const QString func = m_keyRx.cap(3);
+  const QString& func = token_.func;
   if(func.contains(QLatin1Char('u'))) {
     result = result.toUpper();
   }
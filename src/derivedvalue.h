@@ -28,30 +28,56 @@
 #include "datavectors.h"
 #include "entry.h"
 
-#include <QRegExp>
+#include <QSharedPointer>
 
 namespace Tellico {
   namespace Data {
 
+/**
+ * A DerivedValue is compiled from the template into a list of tokens once, and
+ * then evaluated for each entry. The compiled template for a field is cached
+ * in the field itself, see @ref derivedValue.
+ */
 class DerivedValue {
 public:
   DerivedValue(const QString& valueTemplate);
   DerivedValue(FieldPtr field);
 
+  /**
+   * Returns the compiled template for a derived field. The result is cached in the
+   * field until the template changes.
+   */
+  static QSharedPointer<const DerivedValue> derivedValue(FieldPtr field);
+
   // the reason we don't use a CollPtr is because this gets
   // called when adding fields in the Collection() constructor
   // which would create a ptr then destroy it and dereference the object
   bool isRecursive(Collection* coll) const;
 
   QString value(EntryPtr entry, bool formatted) const;
+  /**
+   * Returns the field names or titles used in the template
+   */
+  const QStringList& templateFields() const { return m_templateFields; }
 
 private:
-  QStringList templateFields() const;
-  QString templateKeyValue(EntryPtr entry, const QString& key, bool formatted) const;
+  struct Token {
+    Token() : isKey(false), pos(0) {}
+    bool isKey;
+    QString key;
+    // text is the literal string or the field name or title for a key
+    QString text;
+    int pos;
+    QString func;
+  };
+
+  void compile();
+  QString templateKeyValue(EntryPtr entry, const Token& token, bool formatted) const;
 
   QString m_fieldName;
   QString m_valueTemplate;
-  mutable QRegExp m_keyRx;
+  QVector<Token> m_tokens;
+  QStringList m_templateFields;
 };
 
   } // end namespace
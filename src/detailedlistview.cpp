@@ -46,6 +46,11 @@
 #include <QHeaderView>
 #include <QContextMenuEvent>
 
+namespace {
+  // the number of rows measured to estimate a column width
+  static const int DETAILEDLISTVIEW_WIDTH_SAMPLE_SIZE = 500;
+}
+
 using namespace Tellico;
 using Tellico::DetailedListView;
 
@@ -62,6 +67,9 @@ DetailedListView::DetailedListView(QWidget* parent_) : GUI::TreeView(parent_)
   // header menu
   header()->installEventFilter(this);
   header()->setMinimumSectionSize(20);
+  // for a large collection, the column width is estimated from the visible rows and a sample
+  // of the others, rather than formatting every row
+  header()->setResizeContentsPrecision(DETAILEDLISTVIEW_WIDTH_SAMPLE_SIZE);
 
   m_headerMenu = new QMenu(this);
   m_columnMenu = new QMenu(this);
@@ -69,8 +77,10 @@ DetailedListView::DetailedListView(QWidget* parent_) : GUI::TreeView(parent_)
           SLOT(slotColumnMenuActivated(QAction*)));
 
   EntryModel* entryModel = new EntryModel(this);
+  entryModel->setVirtualized(true);
   EntrySortModel* sortModel = new EntrySortModel(this);
   sortModel->setSortRole(EntryPtrRole);
+  sortModel->setParallel(true);
   sortModel->setSourceModel(entryModel);
   setModel(sortModel);
   setItemDelegate(new DetailedEntryItemDelegate(this));
@@ -49,21 +49,70 @@
 #include <QRegExp>
 #include <QTimer>
 #include <QApplication>
+#include <QBuffer>
+#include <QImageReader>
+#include <QSaveFile>
 
 #include <unistd.h>
 
+namespace {
+  // images from the opened file are checked and written to disk in the background
+  // by a few threads, with a limited number read from the zip file and waiting at once
+  static const int s_imageThreads = 2;
+  static const int s_imageQueueSize = 32;
+
+  // checks the image header, without decoding the whole image, and writes the data to the file
+  class ImageExtractJob : public QRunnable {
+  public:
+    ImageExtractJob(Tellico::Data::Document* doc_, int generation_, const QString& id_,
+                    const QByteArray& data_, const QString& fileName_)
+        : QRunnable(), m_doc(doc_), m_generation(generation_), m_id(id_), m_data(data_), m_fileName(fileName_) {}
+
+    void run() Q_DECL_OVERRIDE {
+      QBuffer buffer(&m_data);
+      buffer.open(QIODevice::ReadOnly);
+      QImageReader reader(&buffer);
+      QByteArray format = reader.format();
+      const QSize size = reader.size();
+      if(format.isEmpty() || !size.isValid()) {
+        format.clear();
+      } else {
+        QSaveFile f(m_fileName);
+        if(!f.open(QIODevice::WriteOnly) || f.write(m_data) != m_data.size() || !f.commit()) {
+          myDebug() << "unable to write image:" << m_fileName;
+          format.clear();
+        }
+      }
+      QMetaObject::invokeMethod(m_doc, "slotImageExtracted", Qt::QueuedConnection,
+                                Q_ARG(int, m_generation), Q_ARG(QString, m_id),
+                                Q_ARG(QByteArray, format), Q_ARG(QSize, size));
+    }
+
+  private:
+    Tellico::Data::Document* m_doc;
+    int m_generation;
+    QString m_id;
+    QByteArray m_data;
+    QString m_fileName;
+  };
+}
+
 using namespace Tellico;
 using Tellico::Data::Document;
 Document* Document::s_self = nullptr;
 
 Document::Document() : QObject(), m_coll(nullptr), m_isModified(false),
     m_loadAllImages(false), m_validFile(false), m_importer(nullptr), m_cancelImageWriting(false),
-    m_fileFormat(Import::TellicoImporter::Unknown) {
+    m_fileFormat(Import::TellicoImporter::Unknown), m_loadingImages(false), m_imageLoadPos(0),
+    m_imageJobs(0), m_imageLoadGeneration(0) {
+  m_imagePool.setMaxThreadCount(s_imageThreads);
   m_allImagesOnDisk = Config::imageLocation() != Config::ImagesInFile;
   newDocument(Collection::Book);
 }
 
 Document::~Document() {
+  m_imagePool.clear();
+  m_imagePool.waitForDone();
   delete m_importer;
   m_importer = nullptr;
 }
@@ -96,6 +145,7 @@ void Document::slotSetClean(bool clean_) {
 }
 
 bool Document::newDocument(int type_) {
+  cancelReading();
   if(m_importer) {
     m_importer->deleteLater();
     m_importer = nullptr;
@@ -125,10 +175,20 @@ bool Document::openDocument(const QUrl& url_) {
     m_loadAllImages = true;
   }
 
+  cancelReading();
+  // the images of the earlier file must not be read from the new archive
+  cancelImageLoading();
   if(m_importer) {
     m_importer->deleteLater();
   }
   m_importer = new Import::TellicoImporter(url_, m_loadAllImages);
+  // the collection is shown as soon as the fields are read, and the entries are added as they are read
+  m_importer->setReadInBackground(true);
+  connect(m_importer, SIGNAL(signalEntriesRead(Tellico::Data::EntryList)),
+          SLOT(slotEntriesRead(Tellico::Data::EntryList)));
+  connect(m_importer, SIGNAL(signalEntriesModified(Tellico::Data::EntryList)),
+          SIGNAL(signalEntriesModified(Tellico::Data::EntryList)));
+  connect(m_importer, SIGNAL(signalReadFinished(bool)), SLOT(slotReadFinished(bool)));
 
   ProgressItem& item = ProgressManager::self()->newProgressItem(m_importer, m_importer->progressLabel(), true);
   connect(m_importer, SIGNAL(signalTotalSteps(QObject*, qulonglong)),
@@ -136,13 +196,16 @@ bool Document::openDocument(const QUrl& url_) {
   connect(m_importer, SIGNAL(signalProgress(QObject*, qulonglong)),
           ProgressManager::self(), SLOT(setProgress(QObject*, qulonglong)));
   connect(&item, SIGNAL(signalCancelled(ProgressItem*)), m_importer, SLOT(slotCancel()));
-  ProgressItem::Done done(m_importer);
 
   CollPtr coll = m_importer->collection();
   if(!m_importer) {
     myDebug() << "The importer was deleted out from under us";
     return false;
   }
+  // the progress continues while the entries are read in the background
+  if(!m_importer->isReading()) {
+    ProgressManager::self()->setDone(m_importer);
+  }
   // delayed image loading only works for zip files
   // format is only known AFTER collection() is called
 
@@ -166,14 +229,65 @@ bool Document::openDocument(const QUrl& url_) {
   m_validFile = true;
 
   emit signalCollectionAdded(m_coll);
+  if(m_importer && !m_importer->isReading()) {
+    finishOpening();
+  }
+  return true;
+}
 
-  // m_importer might have been deleted?
-  slotSetModified(m_importer && m_importer->modifiedOriginal());
+bool Document::finishLoading() {
+  const CollPtr coll = m_coll;
+  if(m_importer && m_importer->isReading()) {
+    m_importer->finishReading();
+  }
+  // the collection gets replaced if the rest of the file could not be read
+  return m_coll == coll;
+}
+
+void Document::cancelReading() {
+  if(!m_importer || !m_importer->isReading()) {
+    return;
+  }
+  // nothing else from the file is wanted
+  m_importer->disconnect(this);
+  m_importer->slotCancel();
+  m_importer->finishReading();
+  ProgressManager::self()->setDone(m_importer);
+}
+
+void Document::slotEntriesRead(Tellico::Data::EntryList entries_) {
+  // the importer already added them to the collection
+  emit signalEntriesAdded(entries_);
+}
+
+void Document::slotReadFinished(bool success_) {
+  if(!m_importer) {
+    return;
+  }
+  ProgressManager::self()->setDone(m_importer);
+  if(!success_) {
+    if(m_importer->format() != Import::TellicoImporter::Cancel) {
+      GUI::Proxy::sorry(m_importer->statusMessage());
+    }
+    // a partial collection must not get saved over the file
+    newDocument(m_coll ? m_coll->type() : Collection::Book);
+    return;
+  }
+  // the filters and loans are only added once the whole file is read
+  emit signalCollectionRead(m_coll);
+  finishOpening();
+}
+
+void Document::finishOpening() {
+  // for an xml file, the images are only known once it has been read completely
+  m_allImagesOnDisk = !m_importer->hasImages();
+  slotSetModified(m_importer->modifiedOriginal());
 //  if(pruneImages()) {
 //    slotSetModified(true);
 //  }
   if(m_importer && m_importer->hasImages()) {
-    m_cancelImageWriting = false;
+    cancelImageLoading();
+    m_loadingImages = true;
     QTimer::singleShot(500, this, SLOT(slotLoadAllImages()));
   } else {
     emit signalCollectionImagesLoaded(m_coll);
@@ -182,7 +296,6 @@ bool Document::openDocument(const QUrl& url_) {
       m_importer = nullptr;
     }
   }
-  return true;
 }
 
 bool Document::saveDocument(const QUrl& url_, bool force_) {
@@ -198,9 +311,14 @@ bool Document::saveDocument(const QUrl& url_, bool force_) {
     }
   }
 
-  // in case we're still loading images, give that a chance to cancel
-  m_cancelImageWriting = true;
-  qApp->processEvents();
+  // everything has to be in the collection before writing it
+  if(!finishLoading()) {
+    return false;
+  }
+
+  // in case we're still loading images, stop that, and wait for the images being written
+  cancelImageLoading();
+  m_imagePool.waitForDone();
 
   ProgressItem& item = ProgressManager::self()->newProgressItem(this, i18n("Saving file..."), false);
   ProgressItem::Done done(this);
@@ -253,6 +371,7 @@ bool Document::saveDocument(const QUrl& url_, bool force_) {
 }
 
 bool Document::closeDocument() {
+  cancelReading();
   if(m_importer) {
     m_importer->deleteLater();
     m_importer = nullptr;
@@ -275,9 +394,11 @@ void Document::deleteContents() {
   }
   m_coll = nullptr; // old collection gets deleted as refcount goes to 0
   m_cancelImageWriting = true;
+  cancelImageLoading();
 }
 
 void Document::appendCollection(Tellico::Data::CollPtr coll_) {
+  finishLoading();
   appendCollection(m_coll, coll_);
 }
 
@@ -304,6 +425,7 @@ void Document::appendCollection(Tellico::Data::CollPtr coll1_, Tellico::Data::Co
 }
 
 Tellico::Data::MergePair Document::mergeCollection(Tellico::Data::CollPtr coll_) {
+  finishLoading();
   return mergeCollection(m_coll, coll_);
 }
 
@@ -324,15 +446,15 @@ Tellico::Data::MergePair Document::mergeCollection(Tellico::Data::CollPtr coll1_
   std::sort(currEntries.begin(), currEntries.end(), Data::EntryCmp(QLatin1String("title")));
   std::sort(newEntries.begin(), newEntries.end(), Data::EntryCmp(QLatin1String("title")));
 
-  const int currTotal = currEntries.count();
-  int lastMatchId = 0;
+  // only the entries sharing a normalized title or identifier need to be compared
+  const EntryMatchIndex index(currEntries);
   bool checkSameId = false; // if the matching entries have the same id, then check that first for later comparisons
   foreach(EntryPtr newEntry, newEntries) {
     int bestMatch = 0;
     Data::EntryPtr matchEntry, currEntry;
     // first, if we're checking against same ID
     if(checkSameId) {
-      currEntry = currEntries.first()->collection()->entryById(newEntry->id());
+      currEntry = coll1_->entryById(newEntry->id());
       if(currEntry &&
          currEntry->collection()->sameEntry(currEntry, newEntry) >= EntryComparison::ENTRY_PERFECT_MATCH) {
         // only have to compare against perfect match
@@ -340,19 +462,15 @@ Tellico::Data::MergePair Document::mergeCollection(Tellico::Data::CollPtr coll1_
       }
     }
     if(!matchEntry) {
-      // alternative is to loop over them all
-      for(int i = 0; i < currTotal; ++i) {
-        // since we're sorted by title, track the index of the previous match and starts comparison there
-        currEntry = currEntries.at((i+lastMatchId) % currTotal);
+      // alternative is to loop over all the candidates, which are still sorted by title
+      foreach(currEntry, index.candidates(newEntry)) {
         int match = currEntry->collection()->sameEntry(currEntry, newEntry);
         if(match >= EntryComparison::ENTRY_PERFECT_MATCH) {
           matchEntry = currEntry;
-          lastMatchId = (i+lastMatchId) % currTotal;
           break;
         } else if(match >= EntryComparison::ENTRY_GOOD_MATCH && match > bestMatch) {
           bestMatch = match;
           matchEntry = currEntry;
-          lastMatchId = (i+lastMatchId) % currTotal;
           // don't break, keep looking for better one
         }
       }
@@ -367,6 +485,10 @@ Tellico::Data::MergePair Document::mergeCollection(Tellico::Data::CollPtr coll1_
       pair.first.append(e);
     }
   }
+  // the comparison keys are only needed while merging
+  foreach(EntryPtr entry, currEntries) {
+    entry->clearComparisonKeys();
+  }
   coll1_->addEntries(pair.first);
   // TODO: merge filters and loans
   coll1_->blockSignals(false);
@@ -378,6 +500,8 @@ void Document::replaceCollection(Tellico::Data::CollPtr coll_) {
     return;
   }
 
+  // the rest of the opened file would go to the old collection
+  cancelReading();
   QUrl url = QUrl::fromLocalFile(i18n(Tellico::untitledFilename));
   setURL(url);
   m_validFile = false;
@@ -388,6 +512,7 @@ void Document::replaceCollection(Tellico::Data::CollPtr coll_) {
   m_coll = coll_;
   m_coll->setTrackGroups(true);
   m_cancelImageWriting = true;
+  cancelImageLoading();
   // CollectionCommand takes care of calling Controller signals
 }
 
@@ -480,6 +605,7 @@ bool Document::loadAllImagesNow() const {
 Tellico::Data::EntryList Document::filteredEntries(Tellico::FilterPtr filter_) const {
   Data::EntryList matches;
   Data::EntryList entries = m_coll->entries();
+  filter_->compile(m_coll);
   foreach(EntryPtr entry, entries) {
     if(filter_->matches(entry)) {
       matches.append(entry);
@@ -527,40 +653,97 @@ void Document::renameCollection(const QString& newTitle_) {
 // by loading every image, it gets pulled out of the zip file and
 // copied to disk. Then the zip file can be closed and not retained in memory
 void Document::slotLoadAllImages() {
-  QString id;
+  if(!m_loadingImages) {
+    // cancelled before it started
+    return;
+  }
+  // any images still being written from an earlier start are ignored
+  cancelImageLoading();
+  m_loadingImages = true;
+
   StringSet images;
   foreach(EntryPtr entry, m_coll->entries()) {
     foreach(FieldPtr field, m_coll->imageFields()) {
-      id = entry->field(field);
+      const QString id = entry->field(field);
       if(id.isEmpty() || images.has(id)) {
         continue;
       }
-      // this is the early loading, so just by calling imageById()
-      // the image gets sucked from the zip file and written to disk
-      // by ImageFactory::imageById()
-      // TODO:: does this need to check against images with link only?
-      if(ImageFactory::imageById(id).isNull()) {
-        myDebug() << "Null image for entry:" << entry->title() << id;
-      }
       images.add(id);
-      if(m_cancelImageWriting) {
-        break;
-      }
+      m_imagesToLoad += id;
     }
-    if(m_cancelImageWriting) {
-      break;
+  }
+  slotLoadNextImages();
+}
+
+// the zip file can't be read from more than one thread, so the image data is read here
+// and the threads check the images and write them to the temporary directory
+void Document::slotLoadNextImages() {
+  // a timer from a cancelled load might still call this
+  if(!m_loadingImages) {
+    return;
+  }
+
+  const QString tempDir = ImageFactory::tempDir();
+  while(m_imageLoadPos < m_imagesToLoad.count() && m_imageJobs < s_imageQueueSize) {
+    const QString& id = m_imagesToLoad.at(m_imageLoadPos++);
+    const QByteArray data = ImageFactory::zipImageData(id);
+    if(!data.isEmpty()) {
+      ++m_imageJobs;
+      m_imagePool.start(new ImageExtractJob(this, m_imageLoadGeneration, id, data, tempDir + id));
+      continue;
+    }
+    // link only images are not loaded until they're shown
+    if(ImageFactory::hasImageInfo(id) && ImageFactory::imageInfo(id).linkOnly) {
+      continue;
     }
-    // stay responsive, do this in the background
-    qApp->processEvents();
+    // the image is not in the zip file, so make sure it can be found somewhere else
+    if(ImageFactory::imageById(id).isNull()) {
+      myDebug() << "Null image:" << id;
+    }
+    // stay responsive, do the rest in the background
+    QTimer::singleShot(0, this, SLOT(slotLoadNextImages()));
+    return;
   }
 
-  if(m_cancelImageWriting) {
-    myLog() << "slotLoadAllImages() - cancel image writing";
-  } else {
+  if(m_imageLoadPos >= m_imagesToLoad.count() && m_imageJobs == 0) {
+    m_imagesToLoad.clear();
     emit signalCollectionImagesLoaded(m_coll);
+    finishLoadingImages();
   }
+}
 
-  m_cancelImageWriting = false;
+void Document::slotImageExtracted(int generation_, const QString& id_, const QByteArray& format_, const QSize& size_) {
+  if(generation_ != m_imageLoadGeneration) {
+    return;
+  }
+  --m_imageJobs;
+  if(format_.isEmpty()) {
+    myDebug() << "Null image:" << id_;
+  } else {
+    ImageFactory::zipImageExtracted(Data::ImageInfo(id_, format_, size_.width(), size_.height(), false));
+  }
+  slotLoadNextImages();
+}
+
+void Document::cancelImageWriting() {
+  m_cancelImageWriting = true;
+  cancelImageLoading();
+}
+
+void Document::cancelImageLoading() {
+  if(m_loadingImages) {
+    myLog() << "Document::cancelImageLoading() - cancel image loading";
+  }
+  m_imagePool.clear();
+  ++m_imageLoadGeneration;
+  m_imagesToLoad.clear();
+  m_imageLoadPos = 0;
+  m_imageJobs = 0;
+  m_loadingImages = false;
+}
+
+void Document::finishLoadingImages() {
+  m_loadingImages = false;
   if(m_importer) {
     m_importer->deleteLater();
     m_importer = nullptr;
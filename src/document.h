@@ -31,6 +31,9 @@
 #include <QObject>
 #include <QPointer>
 #include <QUrl>
+#include <QStringList>
+#include <QSize>
+#include <QThreadPool>
 
 namespace Tellico {
   namespace Import {
@@ -104,6 +107,13 @@ public:
    * @return A boolean indicating success
    */
   bool openDocument(const QUrl& url);
+  /**
+   * The entries of an opened file are added while it is still being read. This blocks until
+   * the rest of the file is read, so that the collection can be used as a whole.
+   *
+   * @return False if the rest of the file could not be read, and the collection was replaced
+   */
+  bool finishLoading();
   /**
    * Saves the document contents to a file.
    *
@@ -177,7 +187,10 @@ public:
    * in addition to those already in the collection
    */
   void removeImagesNotInCollection(EntryList entries, EntryList entriesToKeep);
-  void cancelImageWriting() { m_cancelImageWriting = true; }
+  /**
+   * Stops writing images to the cache, and stops loading the images of the opened file
+   */
+  void cancelImageWriting();
 
   static bool mergeEntry(EntryPtr entry1, EntryPtr entry2, MergeConflictResolver* resolver=nullptr);
   // adds new fields into collection if any values in entries are not empty
@@ -213,6 +226,21 @@ Q_SIGNALS:
   void signalCollectionImagesLoaded(Tellico::Data::CollPtr coll);
   void signalCollectionAdded(Tellico::Data::CollPtr coll);
   void signalCollectionDeleted(Tellico::Data::CollPtr coll);
+  /**
+   * Signals that entries from the file being opened have been added to the collection,
+   * after the collection itself was added.
+   */
+  void signalEntriesAdded(Tellico::Data::EntryList entries);
+  /**
+   * Signals that entries from the file being opened have been modified after they were added,
+   * when their image values are checked at the end of reading.
+   */
+  void signalEntriesModified(Tellico::Data::EntryList entries);
+  /**
+   * Signals that the file being opened has been read completely. The filters and loans
+   * are only added to the collection at this point.
+   */
+  void signalCollectionRead(Tellico::Data::CollPtr coll);
 
 private Q_SLOTS:
   /**
@@ -220,6 +248,17 @@ private Q_SLOTS:
    * images to temp dir initially
    */
   void slotLoadAllImages();
+  /**
+   * Hands the next few images to the thread pool, and finishes once all are done
+   */
+  void slotLoadNextImages();
+  /**
+   * Called from the thread pool once an image is written to the temporary directory.
+   * The format is empty if the image is not valid.
+   */
+  void slotImageExtracted(int generation, const QString& id, const QByteArray& format, const QSize& size);
+  void slotEntriesRead(Tellico::Data::EntryList entries);
+  void slotReadFinished(bool success);
 
 private:
   static Document* s_self;
@@ -230,6 +269,17 @@ private:
    */
   void writeAllImages(int cacheDir, const QUrl& url=QUrl());
   bool pruneImages();
+  /**
+   * Stops reading the opened file, without adding anything else from it
+   */
+  void cancelReading();
+  void finishOpening();
+  /**
+   * Stops loading the images of the opened file. Jobs which are already running still
+   * finish, but their results are ignored.
+   */
+  void cancelImageLoading();
+  void finishLoadingImages();
 
   // make all constructors private
   Document();
@@ -246,6 +296,12 @@ private:
   bool m_cancelImageWriting;
   int m_fileFormat;
   bool m_allImagesOnDisk;
+  bool m_loadingImages;
+  QStringList m_imagesToLoad;
+  int m_imageLoadPos;
+  int m_imageJobs;
+  int m_imageLoadGeneration;
+  QThreadPool m_imagePool;
 };
 
   } // end namespace
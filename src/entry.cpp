@@ -27,6 +27,7 @@
 #include "collection.h"
 #include "field.h"
 #include "derivedvalue.h"
+#include "entrycomparison.h"
 #include "utils/string_utils.h"
 #include "utils/stringset.h"
 #include "tellico_debug.h"
@@ -39,7 +40,7 @@ using namespace Tellico;
 using namespace Tellico::Data;
 using Tellico::Data::Entry;
 
-Entry::Entry(Tellico::Data::CollPtr coll_) : QSharedData(), m_coll(coll_), m_id(-1) {
+Entry::Entry(Tellico::Data::CollPtr coll_) : QSharedData(), m_coll(coll_), m_id(-1), m_revision(0), m_derivedRevision(-1) {
 #ifndef NDEBUG
   if(!coll_) {
     myWarning() << "null collection pointer!";
@@ -47,7 +48,7 @@ Entry::Entry(Tellico::Data::CollPtr coll_) : QSharedData(), m_coll(coll_), m_id(
 #endif
 }
 
-Entry::Entry(Tellico::Data::CollPtr coll_, Data::ID id_) : QSharedData(), m_coll(coll_), m_id(id_) {
+Entry::Entry(Tellico::Data::CollPtr coll_, Data::ID id_) : QSharedData(), m_coll(coll_), m_id(id_), m_revision(0), m_derivedRevision(-1) {
 #ifndef NDEBUG
   if(!coll_) {
     myWarning() << "null collection pointer!";
@@ -59,8 +60,11 @@ Entry::Entry(const Entry& entry_) :
     QSharedData(entry_),
     m_coll(entry_.m_coll),
     m_id(-1),
+    m_revision(0),
     m_fieldValues(entry_.m_fieldValues),
-    m_formattedFields(entry_.m_formattedFields) {
+    m_formattedFields(entry_.m_formattedFields),
+    m_derivedRevision(-1),
+    m_comparisonKeys(entry_.m_comparisonKeys) {
 }
 
 Entry& Entry::operator=(const Entry& other_) {
@@ -71,6 +75,9 @@ Entry& Entry::operator=(const Entry& other_) {
   m_id = other_.m_id;
   m_fieldValues = other_.m_fieldValues;
   m_formattedFields = other_.m_formattedFields;
+  m_comparisonKeys = other_.m_comparisonKeys;
+  ++m_revision;
+  invalidateDerivedValues();
   return *this;
 }
 
@@ -91,6 +98,34 @@ void Entry::setCollection(Tellico::Data::CollPtr coll_) {
   const bool addEntryType = m_coll->type() == Collection::Book &&
                             coll_->type() == Collection::Bibtex &&
                             !m_coll->hasField(QLatin1String("entry-type"));
+  // value slots are specific to each collection, so the values have to be moved,
+  // unless both collections have the same fields in the same slots.
+  // values for fields that the new collection does not have are dropped
+  QVector<QString> values;
+  if(coll_->fieldSlotNames() == m_coll->fieldSlotNames() &&
+     coll_->fields().count() == m_coll->fields().count()) {
+    values = m_fieldValues;
+  } else {
+    for(int slot = 0; slot < m_fieldValues.size(); ++slot) {
+      if(m_fieldValues.at(slot).isEmpty()) {
+        continue;
+      }
+      const QString fieldName = m_coll->fieldNameBySlot(slot);
+      if(!coll_->hasField(fieldName)) {
+        continue;
+      }
+      const int newSlot = coll_->fieldSlot(fieldName);
+      if(newSlot >= values.size()) {
+        values.resize(newSlot+1);
+      }
+      values[newSlot] = m_fieldValues.at(slot);
+    }
+  }
+  m_fieldValues = values;
+  m_formattedFields.clear();
+  m_comparisonKeys.clear();
+  ++m_revision;
+  invalidateDerivedValues();
   m_coll = coll_;
   m_id = -1;
   // set this after changing the m_coll pointer since setField() checks field validity
@@ -99,6 +134,12 @@ void Entry::setCollection(Tellico::Data::CollPtr coll_) {
   }
 }
 
+void Entry::setId(Data::ID id_) {
+  m_id = id_;
+  // the id can be used in a derived value
+  invalidateDerivedValues();
+}
+
 QString Entry::title() const {
   return field(QLatin1String("title"));
 }
@@ -113,14 +154,10 @@ QString Entry::field(Tellico::Data::FieldPtr field_) const {
   }
 
   if(field_->hasFlag(Field::Derived)) {
-    DerivedValue dv(field_);
-    return dv.value(EntryPtr(const_cast<Entry*>(this)), false);
+    return derivedValue(field_, false);
   }
 
-  if(m_fieldValues.contains(field_->name())) {
-    return m_fieldValues.value(field_->name());
-  }
-  return QString();
+  return valueBySlot(m_coll->fieldSlot(field_));
 }
 
 QString Entry::formattedField(const QString& fieldName_, FieldFormat::Request request_) const {
@@ -128,6 +165,14 @@ QString Entry::formattedField(const QString& fieldName_, FieldFormat::Request re
 }
 
 QString Entry::formattedField(Tellico::Data::FieldPtr field_, FieldFormat::Request request_) const {
+  return formattedFieldImpl(field_, request_, true);
+}
+
+QString Entry::formatField(Tellico::Data::FieldPtr field_, FieldFormat::Request request_) const {
+  return formattedFieldImpl(field_, request_, false);
+}
+
+QString Entry::formattedFieldImpl(Tellico::Data::FieldPtr field_, FieldFormat::Request request_, bool cache_) const {
   if(!field_) {
     return QString();
   }
@@ -139,9 +184,8 @@ QString Entry::formattedField(Tellico::Data::FieldPtr field_, FieldFormat::Reque
 
   const FieldFormat::Type flag = field_->formatType();
   if(field_->hasFlag(Field::Derived)) {
-    DerivedValue dv(field_);
     // format sub fields and whole string
-    return FieldFormat::format(dv.value(EntryPtr(const_cast<Entry*>(this)), true), flag, request_);
+    return FieldFormat::format(derivedValue(field_, true), flag, request_);
   }
 
   // if auto format is not set or FormatNone, then just return the value
@@ -149,7 +193,8 @@ QString Entry::formattedField(Tellico::Data::FieldPtr field_, FieldFormat::Reque
     return m_coll->prepareText(field(field_));
   }
 
-  if(!m_formattedFields.contains(field_->name())) {
+  const int slot = m_coll->fieldSlot(field_);
+  if(slot < 0 || slot >= m_formattedFields.size() || m_formattedFields.at(slot).isEmpty()) {
     QString formattedValue;
     if(field_->type() == Field::Table) {
       QStringList rows;
@@ -179,13 +224,41 @@ QString Entry::formattedField(Tellico::Data::FieldPtr field_, FieldFormat::Reque
       }
       formattedValue = formattedValues.join(FieldFormat::delimiterString());
     }
-    if(!formattedValue.isEmpty()) {
-      m_formattedFields.insert(field_->name(), formattedValue);
+    if(cache_ && !formattedValue.isEmpty() && slot > -1) {
+      if(slot >= m_formattedFields.size()) {
+        m_formattedFields.resize(slot+1);
+      }
+      m_formattedFields[slot] = formattedValue;
     }
     return formattedValue;
   }
   // otherwise, just look it up
-  return m_formattedFields.value(field_->name());
+  return m_formattedFields.at(slot);
+}
+
+Tellico::Data::ComparisonKey Entry::comparisonKey(Tellico::Data::FieldPtr field_) const {
+  if(!field_) {
+    return ComparisonKey();
+  }
+  const int slot = m_coll->fieldSlot(field_);
+  // derived values can change without the entry knowing, so don't cache them
+  if(slot < 0 || field_->hasFlag(Field::Derived)) {
+    return EntryComparison::comparisonKey(field_, field(field_));
+  }
+  // only the few fields that get compared have a key, and an empty value is quick to check
+  QHash<int, ComparisonKey>::ConstIterator it = m_comparisonKeys.constFind(slot);
+  if(it != m_comparisonKeys.constEnd()) {
+    return it.value();
+  }
+  const QString value = valueBySlot(slot);
+  if(value.isEmpty()) {
+    return EntryComparison::comparisonKey(field_, value);
+  }
+  return m_comparisonKeys.insert(slot, EntryComparison::comparisonKey(field_, value)).value();
+}
+
+void Entry::clearComparisonKeys() {
+  m_comparisonKeys.clear();
 }
 
 bool Entry::setField(Tellico::Data::FieldPtr field_, const QString& value_) {
@@ -220,11 +293,15 @@ bool Entry::setField(const QString& name_, const QString& value_) {
 }
 
 bool Entry::setFieldImpl(const QString& name_, const QString& value_) {
+  const int slot = m_coll->fieldSlot(name_);
   // an empty value means remove the field
   if(value_.isEmpty()) {
-    if(m_fieldValues.contains(name_)) {
-      m_fieldValues.remove(name_);
+    if(slot > -1 && slot < m_fieldValues.size() && !m_fieldValues.at(slot).isEmpty()) {
+      m_fieldValues[slot] = QString();
       invalidateFormattedFieldValue(name_);
+      if(m_coll->isDerivedDependency(name_)) {
+        invalidateDerivedValues();
+      }
     }
     return true;
   }
@@ -235,7 +312,7 @@ bool Entry::setFieldImpl(const QString& name_, const QString& value_) {
   }
 
   Data::FieldPtr f = m_coll->fieldByName(name_);
-  if(!f) {
+  if(!f || slot < 0) {
     return false;
   }
 
@@ -245,14 +322,20 @@ bool Entry::setFieldImpl(const QString& name_, const QString& value_) {
                    f->type() == Field::Image ||
                    f->type() == Field::Rating ||
                    f->type() == Field::Number;
+  if(slot >= m_fieldValues.size()) {
+    m_fieldValues.resize(slot+1);
+  }
   if(!(f->hasFlag(Field::AllowMultiple)) &&
      (shareType ||
       (f->type() == Field::Line && (f->flags() & Field::AllowCompletion)))) {
-    m_fieldValues.insert(Tellico::shareString(name_), Tellico::shareString(value_));
+    m_fieldValues[slot] = Tellico::shareString(value_);
   } else {
-    m_fieldValues.insert(Tellico::shareString(name_), value_);
+    m_fieldValues[slot] = value_;
   }
   invalidateFormattedFieldValue(name_);
+  if(m_coll->isDerivedDependency(name_)) {
+    invalidateDerivedValues();
+  }
   return true;
 }
 
@@ -321,9 +404,58 @@ bool Entry::isOwned() {
 
 // an empty string means invalidate all
 void Entry::invalidateFormattedFieldValue(const QString& name_) {
+  // the comparison keys depend on the article list too, so they go along with the formatted values
+  ++m_revision;
   if(name_.isEmpty()) {
     m_formattedFields.clear();
-  } else if(!m_formattedFields.isEmpty() && m_formattedFields.contains(name_)) {
-    m_formattedFields.remove(name_);
+    m_comparisonKeys.clear();
+    invalidateDerivedValues();
+  } else if(!m_formattedFields.isEmpty() || !m_comparisonKeys.isEmpty()) {
+    const int slot = m_coll->fieldSlot(name_);
+    if(slot > -1 && slot < m_formattedFields.size()) {
+      m_formattedFields[slot] = QString();
+    }
+    m_comparisonKeys.remove(slot);
+  }
+}
+
+QString Entry::derivedValue(Tellico::Data::FieldPtr field_, bool formatted_) const {
+  // only a change to the fields or templates of this collection makes the values stale
+  const int revision = m_coll->derivedRevision();
+  if(m_derivedRevision != revision) {
+    invalidateDerivedValues();
+    m_derivedRevision = revision;
+  }
+  QVector<QString>& cache = formatted_ ? m_formattedDerivedValues : m_derivedValues;
+  const int slot = m_coll->fieldSlot(field_);
+  if(slot > -1 && slot < cache.size() && !cache.at(slot).isEmpty()) {
+    return cache.at(slot);
+  }
+  const QString value = DerivedValue::derivedValue(field_)->value(EntryPtr(const_cast<Entry*>(this)), formatted_);
+  if(!value.isEmpty() && slot > -1) {
+    if(slot >= cache.size()) {
+      cache.resize(slot+1);
+    }
+    cache[slot] = value;
+  }
+  return value;
+}
+
+void Entry::invalidateDerivedValues() const {
+  m_derivedValues.clear();
+  m_formattedDerivedValues.clear();
+}
+
+QString Entry::valueBySlot(int slot_) const {
+  return (slot_ > -1 && slot_ < m_fieldValues.size()) ? m_fieldValues.at(slot_) : QString();
+}
+
+QStringList Entry::nonEmptyValues(const QVector<QString>& values_) {
+  QStringList list;
+  foreach(const QString& value, values_) {
+    if(!value.isEmpty()) {
+      list << value;
+    }
   }
+  return list;
 }
@@ -29,6 +29,7 @@
 #include "fieldformat.h"
 
 #include <QStringList>
+#include <QVector>
 #include <QHash>
 
 #include <functional>
@@ -39,6 +40,21 @@ namespace Tellico {
     class Collection;
     class EntryGroup;
 
+/**
+ * The normalized forms of a field value, as compared by EntryComparison::score().
+ */
+struct ComparisonKey {
+  ComparisonKey() : hasIdentifier(false), isValid(false) {}
+
+  QString value;         // lower-cased
+  QString noPunctuation;
+  QString noArticles;
+  QString noParentheses; // articles and parentheses removed
+  QString identifier;    // ISBN-10, formalized LCCN, host-less IMDb link or unversioned arXiv id
+  bool hasIdentifier;
+  bool isValid;
+};
+
 /**
  * The Entry class represents a book, a CD, or whatever is the basic entity
  * in the collection.
@@ -96,6 +112,27 @@ public:
                          FieldFormat::Request formatted = FieldFormat::DefaultFormat) const;
   QString formattedField(Data::FieldPtr field,
                          FieldFormat::Request formatted = FieldFormat::DefaultFormat) const;
+  /**
+   * Returns the formatted value of a field, just like @ref formattedField, but without
+   * keeping the value in the entry afterward. Used by views which keep their own cache.
+   *
+   * @param field The field
+   * @return The formatted value of the field
+   */
+  QString formatField(Data::FieldPtr field,
+                      FieldFormat::Request formatted = FieldFormat::DefaultFormat) const;
+  /**
+   * Returns the normalized comparison key for a field value. The key is cached
+   * until the field value is changed.
+   *
+   * @param field The field
+   * @return The comparison key
+   */
+  ComparisonKey comparisonKey(Data::FieldPtr field) const;
+  /**
+   * Releases the cached comparison keys, once a merge or duplicate check is done.
+   */
+  void clearComparisonKeys();
   /**
    * Sets the value of an field for the entry. The method first verifies that
    * the value is allowed for that particular key.
@@ -122,7 +159,12 @@ public:
    * @return The id
    */
   ID id() const { return m_id; }
-  void setId(ID id) { m_id = id; }
+  void setId(ID id);
+  /**
+   * Returns a number which changes whenever a field value or a formatted value
+   * of the entry is changed or invalidated.
+   */
+  int revision() const { return m_revision; }
   /**
    * Adds the entry to a group. The group list within the entry is updated
    * and the entry is added to the group.
@@ -160,13 +202,13 @@ public:
    *
    * @return The list of field values
    */
-  QStringList fieldValues() const { return m_fieldValues.values(); }
+  QStringList fieldValues() const { return nonEmptyValues(m_fieldValues); }
   /**
    * Returns a list of all the formatted field values contained in the entry.
    *
    * @return The list of field values
    */
-  QStringList formattedFieldValues() const { return m_formattedFields.values(); }
+  QStringList formattedFieldValues() const { return nonEmptyValues(m_formattedFields); }
   /**
    * Returns a boolean indicating if the entry's parent collection recognizes
    * it existence, that is, the parent collection has this entry in its list.
@@ -189,11 +231,24 @@ private:
   bool operator==(const Entry& other) const;
 
   bool setFieldImpl(const QString& fieldName, const QString& value);
+  QString formattedFieldImpl(Data::FieldPtr field, FieldFormat::Request request, bool cache) const;
+  QString valueBySlot(int slot) const;
+  QString derivedValue(FieldPtr field, bool formatted) const;
+  void invalidateDerivedValues() const;
+  static QStringList nonEmptyValues(const QVector<QString>& values);
 
   CollPtr m_coll;
   ID m_id;
-  QHash<QString, QString> m_fieldValues;
-  mutable QHash<QString, QString> m_formattedFields;
+  int m_revision;
+  // the values are indexed by the field slot in the collection
+  QVector<QString> m_fieldValues;
+  mutable QVector<QString> m_formattedFields;
+  // derived values are cached until a dependent field or a derived template changes
+  mutable QVector<QString> m_derivedValues;
+  mutable QVector<QString> m_formattedDerivedValues;
+  mutable int m_derivedRevision;
+  // normalized keys used for comparing entries, keyed by slot, only for the fields that get compared
+  mutable QHash<int, ComparisonKey> m_comparisonKeys;
   QList<EntryGroup*> m_groups;
 };
 
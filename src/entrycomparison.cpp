@@ -30,7 +30,31 @@
 #include "utils/isbnvalidator.h"
 #include "utils/lccnvalidator.h"
 
+#include <QSet>
+
+#include <algorithm>
+
 using Tellico::EntryComparison;
+using Tellico::EntryMatchIndex;
+
+namespace {
+  // adds each of the normalized forms that EntryComparison::score() compares
+  void addKeys(QStringList& keys_, const QString& prefix_, const Tellico::Data::ComparisonKey& key_) {
+    keys_ += prefix_ + key_.value;
+    if(!key_.noPunctuation.isEmpty()) {
+      keys_ += prefix_ + key_.noPunctuation;
+    }
+    if(!key_.noArticles.isEmpty()) {
+      keys_ += prefix_ + key_.noArticles;
+    }
+    if(!key_.noParentheses.isEmpty()) {
+      keys_ += prefix_ + key_.noParentheses;
+    }
+    if(key_.hasIdentifier) {
+      keys_ += QLatin1Char('~') + prefix_ + key_.identifier;
+    }
+  }
+}
 
 QUrl EntryComparison::s_documentUrl;
 
@@ -47,8 +71,11 @@ int EntryComparison::score(Tellico::Data::EntryPtr e1, Tellico::Data::EntryPtr e
   if(!e1 || !e2 || !f) {
     return 0;
   }
-  QString s1 = e1->field(f).toLower();
-  QString s2 = e2->field(f).toLower();
+  // the normalized forms are cached by each entry
+  const Data::ComparisonKey k1 = e1->comparisonKey(f);
+  const Data::ComparisonKey k2 = e2->comparisonKey(f);
+  const QString& s1 = k1.value;
+  const QString& s2 = k2.value;
   if(s1.isEmpty() || s2.isEmpty()) {
     return 0;
   }
@@ -58,11 +85,8 @@ int EntryComparison::score(Tellico::Data::EntryPtr e1, Tellico::Data::EntryPtr e
   if(s1 == s2) {
     return 5;
   }
-  // special case for isbn
-  if(f->name() == QLatin1String("isbn") && ISBNValidator::isbn10(s1) == ISBNValidator::isbn10(s2)) {
-    return 5;
-  }
-  if(f->name() == QLatin1String("lccn") && LCCNValidator::formalize(s1) == LCCNValidator::formalize(s2)) {
+  // special case for isbn, lccn, imdb, and arxiv
+  if(k1.hasIdentifier && k2.hasIdentifier && k1.identifier == k2.identifier) {
     return 5;
   }
   if(f->name() == QLatin1String("url") && e1->collection() && e1->collection()->type() == Data::Collection::File) {
@@ -73,26 +97,6 @@ int EntryComparison::score(Tellico::Data::EntryPtr e1, Tellico::Data::EntryPtr e
       return 5;
     }
   }
-  if (f->name() == QLatin1String("imdb")) {
-    // imdb might be a different host since we query akas.imdb.com and normally it is www.imdb.com
-    QUrl us1 = QUrl::fromUserInput(s1);
-    QUrl us2 = QUrl::fromUserInput(s2);
-    us1.setHost(QString());
-    us2.setHost(QString());
-    if(us1 == us2) {
-      return 5;
-    }
-  }
-  if(f->name() == QLatin1String("arxiv")) {
-    // normalize and unVersion arxiv ID
-    s1.remove(QRegExp(QLatin1String("^arxiv:")));
-    s1.remove(QRegExp(QLatin1String("v\\d+$")));
-    s2.remove(QRegExp(QLatin1String("^arxiv:")));
-    s2.remove(QRegExp(QLatin1String("v\\d+$")));
-    if(s1 == s2) {
-      return 5;
-    }
-  }
   if(f->formatType() == FieldFormat::FormatName) {
     const QString s1n = e1->formattedField(f, FieldFormat::ForceFormat);
     const QString s2n = e2->formattedField(f, FieldFormat::ForceFormat);
@@ -101,26 +105,16 @@ int EntryComparison::score(Tellico::Data::EntryPtr e1, Tellico::Data::EntryPtr e
     }
   }
   // try removing punctuation
-  QRegExp notAlphaNum(QLatin1String("[^\\s\\w]"));
-  QString s1a = s1;
-  s1a.remove(notAlphaNum);
-  QString s2a = s2;
-  s2a.remove(notAlphaNum);
-  if(!s1a.isEmpty() && s1a == s2a) {
+  if(!k1.noPunctuation.isEmpty() && k1.noPunctuation == k2.noPunctuation) {
 //    myDebug() << "match without punctuation";
     return 5;
   }
-  FieldFormat::stripArticles(s1);
-  FieldFormat::stripArticles(s2);
-  if(!s1.isEmpty() && s1 == s2) {
+  if(!k1.noArticles.isEmpty() && k1.noArticles == k2.noArticles) {
 //    myDebug() << "match without articles";
     return 3;
   }
   // try removing everything between parentheses
-  QRegExp rx(QLatin1String("\\s*\\(.*\\)\\s*"));
-  s1.remove(rx);
-  s2.remove(rx);
-  if(!s1.isEmpty() && s1 == s2) {
+  if(!k1.noParentheses.isEmpty() && k1.noParentheses == k2.noParentheses) {
 //    myDebug() << "match without parentheses";
     return 2;
   }
@@ -142,3 +136,169 @@ int EntryComparison::score(Tellico::Data::EntryPtr e1, Tellico::Data::EntryPtr e
   }
   return 0;
 }
+
+Tellico::Data::ComparisonKey EntryComparison::comparisonKey(Tellico::Data::FieldPtr field_, const QString& value_) {
+  Data::ComparisonKey key;
+  key.isValid = true;
+  key.value = value_.toLower();
+  if(key.value.isEmpty() || !field_) {
+    return key;
+  }
+
+  key.noPunctuation = key.value;
+  key.noPunctuation.remove(QRegExp(QLatin1String("[^\\s\\w]")));
+
+  key.noArticles = key.value;
+  FieldFormat::stripArticles(key.noArticles);
+  key.noParentheses = key.noArticles;
+  key.noParentheses.remove(QRegExp(QLatin1String("\\s*\\(.*\\)\\s*")));
+
+  const QString name = field_->name();
+  if(name == QLatin1String("isbn")) {
+    key.identifier = ISBNValidator::isbn10(key.value);
+    key.hasIdentifier = true;
+  } else if(name == QLatin1String("lccn")) {
+    key.identifier = LCCNValidator::formalize(key.value);
+    key.hasIdentifier = true;
+  } else if(name == QLatin1String("imdb")) {
+    // imdb might be a different host since we query akas.imdb.com and normally it is www.imdb.com
+    QUrl url = QUrl::fromUserInput(key.value);
+    url.setHost(QString());
+    key.identifier = url.toString();
+    key.hasIdentifier = true;
+  } else if(name == QLatin1String("arxiv")) {
+    // normalize and unVersion arxiv ID
+    key.identifier = key.value;
+    key.identifier.remove(QRegExp(QLatin1String("^arxiv:")));
+    key.identifier.remove(QRegExp(QLatin1String("v\\d+$")));
+    key.hasIdentifier = true;
+  }
+  return key;
+}
+
+QStringList EntryComparison::matchKeys(Tellico::Data::EntryPtr entry_) {
+  QStringList keys;
+  if(!entry_ || !entry_->collection()) {
+    return keys;
+  }
+  Data::CollPtr coll = entry_->collection();
+  foreach(const QString& fieldName, coll->sameEntryFields()) {
+    Data::FieldPtr field = coll->fieldByName(fieldName);
+    if(field) {
+      addFieldKeys(keys, entry_, field);
+    }
+  }
+  keys.removeDuplicates();
+  return keys;
+}
+
+void EntryComparison::addFieldKeys(QStringList& keys_, Tellico::Data::EntryPtr entry_, Tellico::Data::FieldPtr field_) {
+  const Data::ComparisonKey key = entry_->comparisonKey(field_);
+  if(key.value.isEmpty()) {
+    return;
+  }
+  // the url is only compared specially in file catalogs
+  if(field_->name() == QLatin1String("url") && entry_->collection()->type() == Data::Collection::File) {
+    keys_ += QLatin1String("url:") + QUrl(key.value).toString();
+    if(field_->property(QLatin1String("relative")) == QLatin1String("true")) {
+      keys_ += QLatin1String("url~:") + s_documentUrl.resolved(QUrl(key.value)).toString();
+    }
+  }
+
+  const QString prefix = field_->name() + QLatin1Char(':');
+  addKeys(keys_, prefix, key);
+  if(field_->hasFlag(Data::Field::AllowMultiple)) {
+    foreach(const QString& value, FieldFormat::splitValue(key.value)) {
+      addKeys(keys_, prefix, comparisonKey(field_, value));
+    }
+  }
+  // names are also compared after formatting, and each name on its own
+  if(field_->formatType() == FieldFormat::FormatName) {
+    const QString formatted = entry_->formattedField(field_, FieldFormat::ForceFormat);
+    const QString namePrefix = field_->name() + QLatin1String("~name:");
+    keys_ += namePrefix + formatted;
+    if(field_->hasFlag(Data::Field::AllowMultiple)) {
+      foreach(const QString& value, FieldFormat::splitValue(formatted)) {
+        keys_ += namePrefix + value;
+      }
+    }
+  }
+}
+
+EntryMatchIndex::EntryMatchIndex() : m_count(0) {
+}
+
+EntryMatchIndex::EntryMatchIndex(const Tellico::Data::EntryList& entries_) : m_count(0) {
+  add(entries_);
+}
+
+void EntryMatchIndex::add(const Tellico::Data::EntryList& entries_) {
+  m_entries.reserve(m_entries.count() + entries_.count());
+  foreach(Data::EntryPtr entry, entries_) {
+    add(entry);
+  }
+}
+
+void EntryMatchIndex::add(Tellico::Data::EntryPtr entry_) {
+  if(!entry_ || m_positions.contains(entry_.data())) {
+    return;
+  }
+  const int pos = m_entries.count();
+  m_entries.append(entry_);
+  m_positions.insert(entry_.data(), pos);
+  ++m_count;
+
+  foreach(const QString& key, EntryComparison::matchKeys(entry_)) {
+    m_keys[key].append(pos);
+  }
+}
+
+void EntryMatchIndex::remove(Tellico::Data::EntryPtr entry_) {
+  if(!entry_) {
+    return;
+  }
+  // the key lists keep the stale position, candidates() skips over it
+  QHash<const Data::Entry*, int>::Iterator it = m_positions.find(entry_.data());
+  if(it != m_positions.end()) {
+    m_entries[it.value()] = Data::EntryPtr();
+    m_positions.erase(it);
+    --m_count;
+  }
+}
+
+void EntryMatchIndex::clear() {
+  m_entries.clear();
+  m_positions.clear();
+  m_keys.clear();
+  m_count = 0;
+}
+
+Tellico::Data::EntryList EntryMatchIndex::candidates(Tellico::Data::EntryPtr entry_) const {
+  Data::EntryList list;
+  if(!entry_) {
+    return list;
+  }
+  QSet<int> seen;
+  QList<int> positions;
+  foreach(const QString& key, EntryComparison::matchKeys(entry_)) {
+    QHash<QString, QList<int> >::ConstIterator it = m_keys.constFind(key);
+    if(it == m_keys.constEnd()) {
+      continue;
+    }
+    foreach(int pos, it.value()) {
+      if(!seen.contains(pos)) {
+        seen.insert(pos);
+        positions.append(pos);
+      }
+    }
+  }
+  std::sort(positions.begin(), positions.end());
+
+  foreach(int pos, positions) {
+    Data::EntryPtr e = m_entries.at(pos);
+    if(e && e != entry_) {
+      list.append(e);
+    }
+  }
+  return list;
+}
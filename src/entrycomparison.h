@@ -28,6 +28,8 @@
 #include "datavectors.h"
 
 #include <QUrl>
+#include <QHash>
+#include <QStringList>
 
 namespace Tellico {
 
@@ -42,6 +44,17 @@ public:
 
   static int score(Data::EntryPtr entry1, Data::EntryPtr entry2, Data::FieldPtr field);
   static int score(Data::EntryPtr entry1, Data::EntryPtr entry2, const QString& field, const Data::Collection* coll);
+  /**
+   * Returns the normalized blocking keys for an entry, using the same normalizations as score().
+   * Two entries with a non-zero score for any of the Collection::sameEntryFields() always
+   * share at least one key.
+   */
+  static QStringList matchKeys(Data::EntryPtr entry);
+  /**
+   * Calculates the normalized forms of a field value which are compared by score().
+   * Entry::comparisonKey() caches the result for each field.
+   */
+  static Data::ComparisonKey comparisonKey(Data::FieldPtr field, const QString& value);
 
   // these are the values that should be compared against
   // the result from Collection::sameEntry()
@@ -51,8 +64,41 @@ public:
   };
 
 private:
+  static void addFieldKeys(QStringList& keys, Data::EntryPtr entry, Data::FieldPtr field);
+
   static QUrl s_documentUrl;
 };
 
+/**
+ * Candidate index for Collection::sameEntry(). Entries are filed under their EntryComparison::matchKeys()
+ * so that only those entries sharing a normalized value of one of the fields scored by sameEntry()
+ * with the query have to be scored. Entries which share none of them score zero, so no match is missed.
+ *
+ * The keys are calculated when the entry is added, so a modified entry should be removed and added again.
+ */
+class EntryMatchIndex {
+public:
+  EntryMatchIndex();
+  explicit EntryMatchIndex(const Data::EntryList& entries);
+
+  void add(Data::EntryPtr entry);
+  void add(const Data::EntryList& entries);
+  void remove(Data::EntryPtr entry);
+  void clear();
+  int count() const { return m_count; }
+
+  /**
+   * Returns the indexed entries which could match the entry, in the order they were added.
+   * The entry itself is never included.
+   */
+  Data::EntryList candidates(Data::EntryPtr entry) const;
+
+private:
+  Data::EntryList m_entries;
+  QHash<const Data::Entry*, int> m_positions;
+  QHash<QString, QList<int> > m_keys;
+  int m_count;
+};
+
 } // namespace
 #endif
@@ -50,6 +50,7 @@ EntryMerger::EntryMerger(Tellico::Data::EntryList entries_, QObject* parent_)
     , m_resolver(new AskUserResolver) {
 
   m_entriesLeft = m_entriesToCheck;
+  m_index.add(m_entriesToCheck);
   Kernel::self()->beginCommandGroup(i18n("Merge Entries"));
 
   QString label = i18n("Merging entries...");
@@ -77,8 +78,8 @@ void EntryMerger::slotStartNext() {
   ProgressManager::self()->setProgress(this, m_origCount - m_entriesToCheck.count());
 
   Data::EntryPtr baseEntry = m_entriesToCheck[0];
-  for(int i = 1; i < m_entriesToCheck.count(); ++i) {  // skip checking against first
-    Data::EntryPtr it = m_entriesToCheck[i];
+  // the base entry itself is never a candidate, and earlier ones have already been removed from the index
+  foreach(Data::EntryPtr it, m_index.candidates(baseEntry)) {
     bool match = cleanMerge(baseEntry, it);
     if(!match) {
       int score = baseEntry->collection()->sameEntry(baseEntry, it);
@@ -93,6 +94,7 @@ void EntryMerger::slotStartNext() {
     }
   }
   m_entriesToCheck.removeAll(baseEntry);
+  m_index.remove(baseEntry);
 
   if(m_cancelled || m_entriesToCheck.count() < 2) {
     QTimer::singleShot(0, this, SLOT(slotCleanup()));
@@ -106,6 +108,10 @@ void EntryMerger::slotCancel() {
 }
 
 void EntryMerger::slotCleanup() {
+  // the comparison keys are only needed while merging
+  foreach(Data::EntryPtr entry, m_entriesLeft) {
+    entry->clearComparisonKeys();
+  }
   Kernel::self()->removeEntries(m_entriesToRemove);
   Controller::self()->slotUpdateSelection(m_entriesLeft);
   StatusBar::self()->clearStatus();
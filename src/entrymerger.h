@@ -27,6 +27,7 @@
 
 #include "datavectors.h"
 #include "document.h"
+#include "entrycomparison.h"
 
 #include <QObject>
 
@@ -64,6 +65,8 @@ private:
   Data::EntryList m_entriesToCheck;
   Data::EntryList m_entriesToRemove;
   Data::EntryList m_entriesLeft;
+  // candidate index over the entries still to be checked
+  EntryMatchIndex m_index;
   int m_origCount;
   bool m_cancelled;
   MergeConflictResolver* m_resolver;
@@ -0,0 +1,250 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "entrytextindex.h"
+#include "entry.h"
+#include "field.h"
+#include "collection.h"
+#include "utils/string_utils.h"
+
+#include <QAtomicInt>
+#include <QRegExp>
+#include <QStringList>
+
+#include <algorithm>
+#include <iterator>
+
+using Tellico::Data::EntryTextIndex;
+
+namespace {
+  // shared by every index so a revision never repeats, even for a new collection
+  static QAtomicInt s_revision;
+  // every substring of a token up to this long is indexed, and longer text is looked up by its trigrams
+  static const int TRIGRAM_LENGTH = 3;
+}
+
+EntryTextIndex::EntryTextIndex() : m_removedCount(0), m_revision(s_revision.fetchAndAddOrdered(1) + 1) {
+}
+
+void EntryTextIndex::addEntries(const Tellico::Data::EntryList& entries_) {
+  m_docs.reserve(m_docs.count() + entries_.count());
+  m_docRevisions.reserve(m_docRevisions.count() + entries_.count());
+  foreach(EntryPtr entry, entries_) {
+    removeEntry(entry.data());
+    addEntry(entry);
+  }
+  touch();
+}
+
+void EntryTextIndex::removeEntries(const Tellico::Data::EntryList& entries_) {
+  foreach(EntryPtr entry, entries_) {
+    removeEntry(entry.data());
+  }
+  // once more than half of the documents are gone, rebuild the postings
+  if(m_removedCount > m_docs.count() / 2) {
+    compact();
+  }
+  touch();
+}
+
+void EntryTextIndex::updateEntries(const Tellico::Data::EntryList& entries_) {
+  addEntries(entries_);
+  if(m_removedCount > m_docs.count() / 2) {
+    compact();
+  }
+}
+
+void EntryTextIndex::clear() {
+  m_docs.clear();
+  m_docRevisions.clear();
+  m_docByEntry.clear();
+  m_removedCount = 0;
+  m_values.clear();
+  m_grams.clear();
+  touch();
+}
+
+bool EntryTextIndex::isCurrent(const Tellico::Data::Entry* entry_) const {
+  QHash<const Entry*, int>::ConstIterator it = m_docByEntry.constFind(entry_);
+  return it != m_docByEntry.constEnd() && m_docRevisions.at(it.value()) == entry_->revision();
+}
+
+bool EntryTextIndex::findContains(const QString& text_, QSet<const Tellico::Data::Entry*>& candidates_) const {
+  // each whitespace-separated part of the text has to be inside a single token
+  const QStringList parts = text_.toCaseFolded().split(QRegExp(QLatin1String("\\s+")), QString::SkipEmptyParts);
+  if(parts.isEmpty()) {
+    return false;
+  }
+
+  Postings result;
+  bool first = true;
+  foreach(const QString& part, parts) {
+    Postings postings;
+    if(part.length() <= TRIGRAM_LENGTH) {
+      // a short part is indexed as it is, wherever it is in a token
+      postings = m_grams.value(part);
+    } else {
+      // every trigram of the part must be in the entry
+      bool firstTrigram = true;
+      for(int i = 0; i + TRIGRAM_LENGTH <= part.length(); ++i) {
+        const Postings trigramPostings = m_grams.value(part.mid(i, TRIGRAM_LENGTH));
+        postings = firstTrigram ? trigramPostings : intersect(postings, trigramPostings);
+        firstTrigram = false;
+        if(postings.isEmpty()) {
+          break;
+        }
+      }
+    }
+    result = first ? postings : intersect(result, postings);
+    first = false;
+    if(result.isEmpty()) {
+      break;
+    }
+  }
+
+  candidates_.clear();
+  addCandidates(result, candidates_);
+  return true;
+}
+
+bool EntryTextIndex::findEquals(const QString& text_, QSet<const Tellico::Data::Entry*>& candidates_) const {
+  if(text_.isEmpty()) {
+    return false;
+  }
+  candidates_.clear();
+  addCandidates(m_values.value(text_.toCaseFolded()), candidates_);
+  return true;
+}
+
+void EntryTextIndex::addEntry(Tellico::Data::EntryPtr entry_) {
+  if(!entry_ || !entry_->collection()) {
+    return;
+  }
+  const int doc = m_docs.count();
+  m_docs.append(entry_.data());
+  m_docRevisions.append(entry_->revision());
+  m_docByEntry.insert(entry_.data(), doc);
+
+  // match the same values that the filter rules check, which are the stored values, including
+  // any derived ones, and the formatted values the entry has cached. Any value which
+  // might get cached later is formatted without caching it in the entry
+  QStringList fieldValues = entry_->fieldValues() + entry_->formattedFieldValues();
+  foreach(FieldPtr field, entry_->collection()->fields()) {
+    if(field->hasFlag(Field::Derived) || field->formatType() == FieldFormat::FormatNone) {
+      continue;
+    }
+    const QString formatted = entry_->formatField(field);
+    if(!formatted.isEmpty()) {
+      fieldValues << formatted;
+    }
+  }
+
+  QSet<QString> values, grams;
+  foreach(const QString& value, fieldValues) {
+    const QString folded = value.toCaseFolded();
+    if(values.contains(folded)) {
+      continue;
+    }
+    values.insert(folded);
+    addGrams(folded, grams);
+    const QString noAccents = removeAccents(value);
+    if(noAccents != value) {
+      addGrams(noAccents.toCaseFolded(), grams);
+    }
+  }
+
+  // the document numbers only increase, so the postings stay sorted
+  foreach(const QString& value, values) {
+    m_values[value].append(doc);
+  }
+  foreach(const QString& gram, grams) {
+    m_grams[gram].append(doc);
+  }
+}
+
+void EntryTextIndex::removeEntry(const Tellico::Data::Entry* entry_) {
+  QHash<const Entry*, int>::Iterator it = m_docByEntry.find(entry_);
+  if(it == m_docByEntry.end()) {
+    return;
+  }
+  // the postings keep the document number, but it no longer maps to an entry
+  m_docs[it.value()] = nullptr;
+  m_docByEntry.erase(it);
+  ++m_removedCount;
+}
+
+void EntryTextIndex::compact() {
+  EntryList entries;
+  foreach(Entry* entry, m_docs) {
+    if(entry) {
+      entries.append(EntryPtr(entry));
+    }
+  }
+  clear();
+  addEntries(entries);
+}
+
+void EntryTextIndex::touch() {
+  m_revision = s_revision.fetchAndAddOrdered(1) + 1;
+}
+
+void EntryTextIndex::addCandidates(const Postings& postings_, QSet<const Tellico::Data::Entry*>& candidates_) const {
+  candidates_.reserve(postings_.count());
+  foreach(int doc, postings_) {
+    const Entry* entry = m_docs.at(doc);
+    if(entry) {
+      candidates_.insert(entry);
+    }
+  }
+}
+
+void EntryTextIndex::addGrams(const QString& value_, QSet<QString>& grams_) {
+  const int len = value_.length();
+  int start = 0;
+  while(start < len) {
+    while(start < len && value_.at(start).isSpace()) {
+      ++start;
+    }
+    int end = start;
+    while(end < len && !value_.at(end).isSpace()) {
+      ++end;
+    }
+    if(end > start) {
+      const QString token = value_.mid(start, end - start);
+      for(int n = 1; n <= TRIGRAM_LENGTH; ++n) {
+        for(int i = 0; i + n <= token.length(); ++i) {
+          grams_.insert(token.mid(i, n));
+        }
+      }
+    }
+    start = end;
+  }
+}
+
+EntryTextIndex::Postings EntryTextIndex::intersect(const Postings& p1_, const Postings& p2_) {
+  Postings result;
+  std::set_intersection(p1_.constBegin(), p1_.constEnd(), p2_.constBegin(), p2_.constEnd(),
+                        std::back_inserter(result));
+  return result;
+}
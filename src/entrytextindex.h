@@ -0,0 +1,112 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_ENTRYTEXTINDEX_H
+#define TELLICO_ENTRYTEXTINDEX_H
+
+#include "datavectors.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+namespace Tellico {
+  namespace Data {
+
+/**
+ * An inverted index over the raw and formatted values of every entry in a collection,
+ * used by the filter rules which search all the fields at once, like the quick filter.
+ *
+ * The values are case-folded and indexed with and without accents, by whole value
+ * and by every substring of up to three characters in each whitespace-separated token.
+ * A lookup only narrows down the candidates, each of which still has to be checked
+ * by the rule itself.
+ *
+ * An entry which has been modified since it was indexed is never excluded, so a stale
+ * index can only cost a rescan of that entry, and not a missed match.
+ */
+class EntryTextIndex {
+public:
+  EntryTextIndex();
+
+  void addEntries(const EntryList& entries);
+  void removeEntries(const EntryList& entries);
+  /**
+   * Re-indexes entries whose values have changed.
+   */
+  void updateEntries(const EntryList& entries);
+  void clear();
+
+  /**
+   * Changes whenever the index is modified, unique across all the indices.
+   */
+  int revision() const { return m_revision; }
+  /**
+   * Returns true if the entry is in the index and has not been modified since.
+   */
+  bool isCurrent(const Entry* entry) const;
+
+  /**
+   * Finds the entries which might contain the text in any field, ignoring case.
+   *
+   * @param text The text to search for
+   * @param candidates The set of candidate entries
+   * @return false if the text can't be looked up, in which case every entry is a candidate
+   */
+  bool findContains(const QString& text, QSet<const Entry*>& candidates) const;
+  /**
+   * Finds the entries with a field value equal to the text, ignoring case.
+   *
+   * @return false if the text can't be looked up, in which case every entry is a candidate
+   */
+  bool findEquals(const QString& text, QSet<const Entry*>& candidates) const;
+
+private:
+  typedef QVector<int> Postings;
+
+  void addEntry(EntryPtr entry);
+  void removeEntry(const Entry* entry);
+  void compact();
+  void touch();
+  void addCandidates(const Postings& postings, QSet<const Entry*>& candidates) const;
+
+  static void addGrams(const QString& value, QSet<QString>& grams);
+  static Postings intersect(const Postings& p1, const Postings& p2);
+
+  // each indexed entry gets a document number, and a removed one leaves an empty slot
+  QVector<Entry*> m_docs;
+  QVector<int> m_docRevisions;
+  QHash<const Entry*, int> m_docByEntry;
+  int m_removedCount;
+
+  QHash<QString, Postings> m_values;
+  // the substrings of up to three characters in each token
+  QHash<QString, Postings> m_grams;
+  int m_revision;
+};
+
+  } // end namespace
+} // end namespace
+
+#endif
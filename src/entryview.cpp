@@ -30,6 +30,7 @@
 #include "collection.h"
 #include "images/imagefactory.h"
 #include "images/imageinfo.h"
+#include "images/image.h"
 #include "tellico_kernel.h"
 #include "utils/tellico_utils.h"
 #include "utils/datafileregistry.h"
@@ -51,10 +52,85 @@
 #include <QTemporaryFile>
 #include <QApplication>
 #include <QDesktopServices>
+#include <QTimer>
+#include <QDir>
+#include <QSaveFile>
+#include <QRunnable>
+#include <QCryptographicHash>
+
+#include <algorithm>
 
 using Tellico::EntryView;
 using Tellico::EntryViewWidget;
 
+namespace {
+  // the cache cost is the length of the html
+  static const int ENTRYVIEW_HTML_CACHE_SIZE = 4 * 1024 * 1024;
+  static const int ENTRYVIEW_PREFETCH_THREADS = 2;
+
+// applies the stylesheet to an entry document, which was created in the GUI thread
+class EntryRenderJob : public QRunnable {
+public:
+  EntryRenderJob(EntryView* view_, const Tellico::XSLTHandler* handler_,
+                 const QHash<QByteArray, QByteArray>& params_, xmlDocPtr doc_, const QString& key_)
+      : QRunnable(), m_view(view_), m_handler(handler_), m_params(params_), m_doc(doc_), m_key(key_) {}
+  // the document is still owned by a job that was never run
+  ~EntryRenderJob() {
+    if(m_doc) {
+      xmlFreeDoc(m_doc);
+    }
+  }
+
+  void run() Q_DECL_OVERRIDE {
+    // the handler frees the document
+    const QByteArray output = m_handler->applyStylesheet(m_doc, m_params);
+    m_doc = nullptr;
+    // the view waits for every job before deleting the handler, or itself
+    QMetaObject::invokeMethod(m_view, "slotPrefetchDone", Qt::QueuedConnection,
+                              Q_ARG(QString, m_key), Q_ARG(QString, QString::fromUtf8(output)));
+  }
+
+private:
+  EntryView* m_view;
+  const Tellico::XSLTHandler* m_handler;
+  QHash<QByteArray, QByteArray> m_params;
+  xmlDocPtr m_doc;
+  QString m_key;
+};
+
+// the output format is found in the GUI thread, since the list of formats is shared
+// the image is only encoded when the original data is not available
+class ImageWriteJob : public QRunnable {
+public:
+  ImageWriteJob(EntryView* view_, const QImage& image_, const QByteArray& data_,
+                const QByteArray& format_, const QString& fileName_)
+      : QRunnable(), m_view(view_), m_image(image_), m_data(data_), m_format(format_), m_fileName(fileName_) {}
+
+  void run() Q_DECL_OVERRIDE {
+    if(m_data.isEmpty()) {
+      m_data = Tellico::Data::Image::byteArray(m_image, m_format);
+    }
+    QSaveFile f(m_fileName);
+    const bool success = f.open(QIODevice::WriteOnly)
+                      && f.write(m_data) > 0
+                      && f.commit();
+    if(!success) {
+      myDebug() << "unable to write image:" << m_fileName;
+    }
+    QMetaObject::invokeMethod(m_view, "slotImageWritten", Qt::QueuedConnection,
+                              Q_ARG(QString, m_fileName));
+  }
+
+private:
+  EntryView* m_view;
+  QImage m_image;
+  QByteArray m_data;
+  QByteArray m_format;
+  QString m_fileName;
+};
+
+}
+
 EntryViewWidget::EntryViewWidget(EntryView* part, QWidget* parent)
     : KHTMLView(part, parent) {}
 
@@ -75,11 +151,21 @@ void EntryViewWidget::changeEvent(QEvent* event_) {
 }
 
 EntryView::EntryView(QWidget* parent_) : KHTMLPart(new EntryViewWidget(this, parent_), parent_),
-    m_handler(nullptr), m_tempFile(nullptr), m_useGradientImages(true), m_checkCommonFile(true) {
+    m_handler(nullptr), m_tempFile(nullptr), m_useGradientImages(true), m_checkCommonFile(true),
+    m_cacheGeneration(0), m_prefetchTimer(nullptr) {
   setJScriptEnabled(false);
   setJavaEnabled(false);
   setMetaRefreshEnabled(false);
   setPluginsEnabled(false);
+
+  m_htmlCache.setMaxCost(ENTRYVIEW_HTML_CACHE_SIZE);
+  m_pool.setMaxThreadCount(ENTRYVIEW_PREFETCH_THREADS);
+  // prefetch once the current entry is shown
+  m_prefetchTimer = new QTimer(this);
+  m_prefetchTimer->setSingleShot(true);
+  m_prefetchTimer->setInterval(0);
+  connect(m_prefetchTimer, SIGNAL(timeout()), SLOT(slotPrefetch()));
+
   clear(); // needed for initial layout
 
   view()->setAcceptDrops(true);
@@ -91,14 +177,17 @@ EntryView::EntryView(QWidget* parent_) : KHTMLPart(new EntryViewWidget(this, par
 }
 
 EntryView::~EntryView() {
-  delete m_handler;
-  m_handler = nullptr;
+  deleteHandler();
   delete m_tempFile;
   m_tempFile = nullptr;
 }
 
 void EntryView::clear() {
   m_entry = nullptr;
+  // the entries might belong to a collection that is going away
+  m_prefetchEntries.clear();
+  m_prefetchTimer->stop();
+  clearCache();
 
   // just clear the view
   begin();
@@ -142,6 +231,38 @@ void EntryView::showEntry(Tellico::Data::EntryPtr entry_) {
   QUrl u = QUrl::fromLocalFile(m_xsltFile);
   begin(u);
 
+  const QString key = cacheKey(entry_);
+  QString html;
+  QString* cachedHtml = m_htmlCache.object(key);
+  if(cachedHtml) {
+    html = *cachedHtml;
+  } else {
+    html = m_handler->applyStylesheet(entryXML(entry_));
+    if(!html.isEmpty()) {
+      m_htmlCache.insert(key, new QString(html), html.size());
+    }
+  }
+  // images that were prefetched are already on disk
+  writeImages(entry_, false);
+
+#if 0
+  myWarning() << "turn me off!";
+  QFile f2(QLatin1String("/tmp/test.html"));
+  if(f2.open(QIODevice::WriteOnly)) {
+    QTextStream t(&f2);
+    t << html;
+  }
+  f2.close();
+#endif
+
+//  myDebug() << html;
+  write(html);
+  end();
+  // not need anymore?
+  view()->layout(); // I need this because some of the margins and widths may get messed up
+}
+
+QDomDocument EntryView::entryXML(Tellico::Data::EntryPtr entry_) const {
   Export::TellicoXMLExporter exporter(entry_->collection());
   exporter.setEntries(Data::EntryList() << entry_);
   long opt = exporter.options();
@@ -167,40 +288,143 @@ void EntryView::showEntry(Tellico::Data::EntryPtr entry_) {
   }
   f1.close();
 #endif
+  return dom;
+}
 
-  QString html = m_handler->applyStylesheet(dom.toString());
-  // write out image files
+void EntryView::writeImages(Tellico::Data::EntryPtr entry_, bool async_) {
+  const bool imagesOnDisk = Data::Document::self()->allImagesOnDisk();
+  const QString dir = imagesOnDisk ? ImageFactory::imageDir() : ImageFactory::tempDir();
   Data::FieldList fields = entry_->collection()->imageFields();
   foreach(Data::FieldPtr field, fields) {
-    QString id = entry_->field(field);
-    if(id.isEmpty()) {
+    const QString id = entry_->field(field);
+    // only write out image if it's not linked only
+    if(id.isEmpty() || ImageFactory::imageInfo(id).linkOnly) {
       continue;
     }
-    // only write out image if it's not linked only
-    if(!ImageFactory::imageInfo(id).linkOnly) {
-      if(Data::Document::self()->allImagesOnDisk()) {
+    if(!async_) {
+      if(imagesOnDisk) {
         ImageFactory::writeCachedImage(id, ImageFactory::cacheDir());
       } else {
         ImageFactory::writeCachedImage(id, ImageFactory::TempDir);
       }
+      continue;
+    }
+    // the image is only encoded and written in the thread pool, since the file name is all
+    // the view needs. When the entry is shown, the image factory finds the file
+    const QString fileName = dir + id;
+    if(dir.isEmpty() || m_pendingImages.contains(fileName) || QFile::exists(fileName)) {
+      continue;
+    }
+    // decoding is the slow part, so an image which isn't already loaded waits until the entry is shown
+    if(!ImageFactory::self()->hasImageInMemory(id)) {
+      continue;
     }
+    const Data::Image& img = ImageFactory::imageById(id);
+    if(img.isNull() || !QDir().mkpath(dir)) {
+      continue;
+    }
+    m_pendingImages.insert(fileName);
+    m_pool.start(new ImageWriteJob(this, img, img.rawData(),
+                                   Data::Image::outputFormat(img.format()), fileName));
   }
+}
 
-#if 0
-  myWarning() << "turn me off!";
-  QFile f2(QLatin1String("/tmp/test.html"));
-  if(f2.open(QIODevice::WriteOnly)) {
-    QTextStream t(&f2);
-    t << html;
+QString EntryView::cacheKey(Tellico::Data::EntryPtr entry_) const {
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  hash.addData(QFile::encodeName(m_xsltFile));
+  if(m_handler) {
+    const QHash<QByteArray, QByteArray> params = m_handler->params();
+    // the order of the hash is not fixed
+    QList<QByteArray> names = params.keys();
+    std::sort(names.begin(), names.end());
+    foreach(const QByteArray& name, names) {
+      hash.addData(name);
+      hash.addData(params.value(name));
+    }
   }
-  f2.close();
-#endif
+  return QString::fromLatin1("%1:%2:%3:%4:%5").arg(m_cacheGeneration)
+                                              .arg(reinterpret_cast<quintptr>(entry_->collection().data()))
+                                              .arg(entry_->id())
+                                              .arg(entry_->revision())
+                                              .arg(QLatin1String(hash.result().toHex()));
+}
 
-//  myDebug() << html;
-  write(html);
-  end();
-  // not need anymore?
-  view()->layout(); // I need this because some of the margins and widths may get messed up
+void EntryView::clearCache() {
+  m_htmlCache.clear();
+  // anything still being rendered is not added to the cache
+  m_pendingKeys.clear();
+  ++m_cacheGeneration;
+}
+
+void EntryView::deleteHandler() {
+  m_pool.clear();
+  m_pool.waitForDone();
+  m_pendingKeys.clear();
+  m_pendingImages.clear();
+  delete m_handler;
+  m_handler = nullptr;
+}
+
+void EntryView::prefetchEntries(Tellico::Data::EntryList entries_) {
+  m_prefetchEntries = entries_;
+  if(!m_prefetchEntries.isEmpty()) {
+    m_prefetchTimer->start();
+  }
+}
+
+void EntryView::slotPrefetch() {
+  if(!m_handler || !m_handler->isValid()) {
+    m_prefetchEntries.clear();
+    return;
+  }
+
+  // the xml is built for a single entry at a time, so the event loop is never held up for long
+  // and the entries which are no longer next to the current one are never built at all
+  while(!m_prefetchEntries.isEmpty()) {
+    Data::EntryPtr entry = m_prefetchEntries.takeFirst();
+    if(!entry || !entry->collection()) {
+      continue;
+    }
+    writeImages(entry, true);
+    const QString key = cacheKey(entry);
+    if(m_htmlCache.contains(key) || m_pendingKeys.contains(key) || !hasImagesLoaded(entry)) {
+      continue;
+    }
+    // the entry and the image factory are only used in the GUI thread
+    xmlDocPtr doc = XSLTHandler::xmlDocument(entryXML(entry));
+    if(!doc) {
+      continue;
+    }
+    m_pendingKeys.insert(key);
+    m_pool.start(new EntryRenderJob(this, m_handler, m_handler->params(), doc, key));
+    break;
+  }
+  if(!m_prefetchEntries.isEmpty()) {
+    m_prefetchTimer->start();
+  }
+}
+
+bool EntryView::hasImagesLoaded(Tellico::Data::EntryPtr entry_) const {
+  // the xml verifies the images, which loads any image that isn't known yet
+  foreach(Data::FieldPtr field, entry_->collection()->imageFields()) {
+    const QString id = entry_->field(field);
+    if(!id.isEmpty() && !ImageFactory::hasImageInfo(id) && !ImageFactory::self()->hasImageInMemory(id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void EntryView::slotPrefetchDone(const QString& key_, const QString& html_) {
+  // the cache might have been cleared since the entry was queued
+  if(!m_pendingKeys.remove(key_) || html_.isEmpty()) {
+    return;
+  }
+  m_htmlCache.insert(key_, new QString(html_), html_.size());
+}
+
+void EntryView::slotImageWritten(const QString& fileName_) {
+  m_pendingImages.remove(fileName_);
 }
 
 void EntryView::showText(const QString& text_) {
@@ -258,20 +482,19 @@ void EntryView::setXSLTFile(const QString& file_) {
   }
 
   if(!m_handler || m_xsltFile != oldFile) {
-    delete m_handler;
+    deleteHandler();
     // must read the file name to get proper context
     m_handler = new XSLTHandler(QFile::encodeName(m_xsltFile));
     if(m_checkCommonFile && !m_handler->isValid()) {
       Tellico::checkCommonXSLFile();
       m_checkCommonFile = false;
-      delete m_handler;
+      deleteHandler();
       m_handler = new XSLTHandler(QFile::encodeName(m_xsltFile));
     }
     if(!m_handler->isValid()) {
       myWarning() << "invalid xslt handler";
       clear();
-      delete m_handler;
-      m_handler = nullptr;
+      deleteHandler();
       return;
     }
   }
@@ -301,6 +524,8 @@ void EntryView::setXSLTFile(const QString& file_) {
 }
 
 void EntryView::slotRefresh() {
+  // fields may have changed, which the entry revision does not track
+  clearCache();
   setXSLTFile(m_xsltFile);
   showEntry(m_entry);
   view()->repaint();
@@ -371,8 +596,7 @@ void EntryView::setXSLTOptions(const Tellico::StyleOptions& opt_) {
 }
 
 void EntryView::resetView() {
-  delete m_handler;
-  m_handler = nullptr;
+  deleteHandler();
   setXSLTFile(m_xsltFile); // this ends up calling resetColors()
 }
 
@@ -31,8 +31,13 @@
 #include <KHTMLView>
 
 #include <QPointer>
+#include <QCache>
+#include <QSet>
+#include <QThreadPool>
 
 class QTemporaryFile;
+class QTimer;
+class QDomDocument;
 
 namespace Tellico {
   class XSLTHandler;
@@ -89,6 +94,13 @@ public Q_SLOTS:
    */
   void slotRefresh();
   void showEntries(Tellico::Data::EntryList entries);
+  /**
+   * Renders entries in the background, usually the ones next to the current entry,
+   * so that showing them later only needs the cached html.
+   *
+   * @param entries The entries likely to be shown next
+   */
+  void prefetchEntries(Tellico::Data::EntryList entries);
 
 private Q_SLOTS:
   /**
@@ -98,9 +110,26 @@ private Q_SLOTS:
    */
   void slotOpenURL(const QUrl& url);
   void slotReloadEntry();
+  void slotPrefetch();
+  void slotPrefetchDone(const QString& key, const QString& html);
+  void slotImageWritten(const QString& fileName);
 
 private:
   void resetColors();
+  QDomDocument entryXML(Data::EntryPtr entry) const;
+  void writeImages(Data::EntryPtr entry, bool async);
+  /**
+   * Returns true if the images of the entry can be checked without loading them.
+   */
+  bool hasImagesLoaded(Data::EntryPtr entry) const;
+  /**
+   * The cache key includes the entry revision and the stylesheet params,
+   * so an edited entry or a new style never shows stale html.
+   */
+  QString cacheKey(Data::EntryPtr entry) const;
+  void clearCache();
+  // the prefetch jobs use the handler, so they have to be done first
+  void deleteHandler();
 
   Data::EntryPtr m_entry;
   XSLTHandler* m_handler;
@@ -110,6 +139,14 @@ private:
   QTemporaryFile* m_tempFile;
   bool m_useGradientImages;
   bool m_checkCommonFile;
+
+  QCache<QString, QString> m_htmlCache;
+  int m_cacheGeneration;
+  QSet<QString> m_pendingKeys;
+  QSet<QString> m_pendingImages;
+  Data::EntryList m_prefetchEntries;
+  QTimer* m_prefetchTimer;
+  QThreadPool m_pool;
 };
 
 // stupid naming on my part, I need to subclass the view to
@@ -26,7 +26,6 @@
 
 #include "allocinefetcher.h"
 #include "../collections/videocollection.h"
-#include "../images/imagefactory.h"
 #include "../entry.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
@@ -233,7 +232,7 @@ Tellico::Data::EntryPtr AbstractAllocineFetcher::fetchEntryHook(uint uid_) {
   // image might still be a URL
   const QString image_id = entry->field(QLatin1String("cover"));
   if(image_id.contains(QLatin1Char('/'))) {
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(image_id), true /* quiet */);
+    const QString id = addImage(QUrl::fromUserInput(image_id));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
     }
@@ -28,7 +28,6 @@
 #include "amazonrequest.h"
 #include "../translators/xslthandler.h"
 #include "../translators/tellicoimporter.h"
-#include "../images/imagefactory.h"
 #include "../utils/guiproxy.h"
 #include "../collection.h"
 #include "../entry.h"
@@ -755,7 +754,7 @@ Tellico::Data::EntryPtr AmazonFetcher::fetchEntryHook(uint uid_) {
   }
 //  myDebug() << "grabbing " << imageURL.toDisplayString();
   if(!imageURL.isEmpty()) {
-    QString id = ImageFactory::addImage(QUrl::fromUserInput(imageURL), true);
+    QString id = addImage(QUrl::fromUserInput(imageURL));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
     } else { // amazon serves up 1x1 gifs occasionally, but that's caught in the image constructor
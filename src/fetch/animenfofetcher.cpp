@@ -30,7 +30,6 @@
 #include "../entry.h"
 #include "../fieldformat.h"
 #include "../core/filehandler.h"
-#include "../images/imagefactory.h"
 #include "../tellico_debug.h"
 
 #include <KLocalizedString>
@@ -417,7 +416,7 @@ Tellico::Data::EntryPtr AnimeNfoFetcher::parseEntry(const QString& str_, const Q
   int pos = imgRx.indexIn(s);
   if(pos > -1) {
     QUrl imgURL = QUrl(QLatin1String(ANIMENFO_BASE_URL)).resolved(QUrl(imgRx.cap(1)));
-    QString id = ImageFactory::addImage(imgURL, true);
+    QString id = addImage(imgURL);
     if(!id.isEmpty()) {
       entry->setField(QLatin1String("cover"), id);
     } else {
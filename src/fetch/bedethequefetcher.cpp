@@ -30,7 +30,6 @@
 #include "../entry.h"
 #include "../fieldformat.h"
 #include "../core/filehandler.h"
-#include "../images/imagefactory.h"
 #include "../tellico_debug.h"
 
 #include <KLocalizedString>
@@ -387,7 +386,7 @@ Tellico::Data::EntryPtr BedethequeFetcher::parseEntry(const QString& str_) {
   imgRx.setMinimal(true);
   if(imgRx.indexIn(str_) > -1) {
     QUrl u(imgRx.cap(1));
-    QString id = ImageFactory::addImage(u, true);
+    QString id = addImage(u);
     if(!id.isEmpty()) {
       entry->setField(QLatin1String("cover"), id);
     }
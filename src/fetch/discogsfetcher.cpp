@@ -26,7 +26,6 @@
 
 #include "discogsfetcher.h"
 #include "../collections/musiccollection.h"
-#include "../images/imagefactory.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
 #include "../core/filehandler.h"
@@ -186,7 +185,7 @@ Tellico::Data::EntryPtr DiscogsFetcher::fetchEntryHook(uint uid_) {
   const QString image_id = entry->field(QLatin1String("cover"));
   // if it's still a url, we need to load it
   if(image_id.contains(QLatin1Char('/'))) {
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(image_id), true /* quiet */);
+    const QString id = addImage(QUrl::fromUserInput(image_id));
     if(id.isEmpty()) {
       myDebug() << "empty id for" << image_id;
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
@@ -26,6 +26,7 @@
 #include "fetchmanager.h" // for calling static optional fields
 #include "../collection.h"
 #include "../entry.h"
+#include "../images/imagefactory.h"
 #include "../tellico_debug.h"
 
 #include <KLocalizedString>
@@ -48,7 +49,8 @@ Fetcher::Fetcher(QObject* parent) : QObject(parent)
     , QSharedData()
     , m_updateOverwrite(false)
     , m_hasMoreResults(false)
-    , m_messager(nullptr) {
+    , m_messager(nullptr)
+    , m_deferImages(false) {
 }
 
 Fetcher::~Fetcher() {
@@ -130,9 +132,13 @@ void Fetcher::setConfigGroup(const QString& group_) {
   m_configGroup = group_;
 }
 
-Tellico::Data::EntryPtr Fetcher::fetchEntry(uint uid_) {
+Tellico::Data::EntryPtr Fetcher::fetchEntry(uint uid_, bool deferImages_) {
   QPointer<Fetcher> ptr(this);
+  m_deferImages = deferImages_;
   Data::EntryPtr entry = fetchEntryHook(uid_);
+  if(ptr) {
+    m_deferImages = false;
+  }
   // could be cancelled and killed after fetching entry, check ptr
   if(ptr && entry) {
     // iterate over list of possible optional fields
@@ -149,6 +155,13 @@ Tellico::Data::EntryPtr Fetcher::fetchEntry(uint uid_) {
   return entry;
 }
 
+QString Fetcher::addImage(const QUrl& url_) const {
+  if(m_deferImages) {
+    return url_.isValid() ? url_.url() : QString();
+  }
+  return ImageFactory::addImage(url_, true /* quiet */);
+}
+
 void Fetcher::message(const QString& message_, int type_) const {
   if(m_messager) {
     m_messager->send(message_, static_cast<MessageHandler::Type>(type_));
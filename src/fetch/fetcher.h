@@ -112,9 +112,11 @@ public:
    */
   virtual void stop() = 0;
   /**
-   * Fetches an entry, given the uid of the search result.
+   * Fetches an entry, given the uid of the search result. When the images are deferred,
+   * the image fields hold the image URL rather than waiting for the download, and it's
+   * up to the caller to request the images from the @ref ImageFactory.
    */
-  Data::EntryPtr fetchEntry(uint uid);
+  Data::EntryPtr fetchEntry(uint uid, bool deferImages = false);
 
   void setMessageHandler(MessageHandler* handler) { m_messager = handler; }
   MessageHandler* messageHandler() const { return m_messager; }
@@ -148,6 +150,12 @@ protected:
   bool m_updateOverwrite : 1;
   bool m_hasMoreResults : 1;
 
+  /**
+   * Adds an image from a URL, returning the image id. If the images are deferred,
+   * the URL itself is returned and nothing is downloaded.
+   */
+  QString addImage(const QUrl& url) const;
+
 private:
   /**
    * Starts a search, using a key and value.
@@ -159,6 +167,7 @@ private:
   virtual Data::EntryPtr fetchEntryHook(uint uid) = 0;
 
   MessageHandler* m_messager;
+  bool m_deferImages : 1;
   QString m_configGroup;
   QStringList m_fields;
   QString m_uuid;
@@ -64,8 +64,8 @@ FetchResult::FetchResult(Fetcher::Ptr fetcher_, const QString& title_, const QSt
    , isbn(isbn_) {
 }
 
-Tellico::Data::EntryPtr FetchResult::fetchEntry() {
-  return fetcher->fetchEntry(uid);
+Tellico::Data::EntryPtr FetchResult::fetchEntry(bool deferImages_) {
+  return fetcher->fetchEntry(uid, deferImages_);
 }
 
 QString FetchResult::makeDescription(Data::EntryPtr entry) {
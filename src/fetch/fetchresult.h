@@ -40,7 +40,7 @@ public:
   FetchResult(QExplicitlySharedDataPointer<Fetcher> f, Data::EntryPtr entry);
   FetchResult(QExplicitlySharedDataPointer<Fetcher> f, const QString& t, const QString& d, const QString& i = QString());
 
-  Data::EntryPtr fetchEntry();
+  Data::EntryPtr fetchEntry(bool deferImages = false);
 
   uint uid;
   QExplicitlySharedDataPointer<Fetcher> fetcher;
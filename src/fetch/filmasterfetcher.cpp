@@ -24,7 +24,6 @@
 
 #include "filmasterfetcher.h"
 #include "../collections/videocollection.h"
-#include "../images/imagefactory.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
 #include "../entry.h"
@@ -136,7 +135,7 @@ Tellico::Data::EntryPtr FilmasterFetcher::fetchEntryHook(uint uid_) {
       imageUrl = QUrl(QString::fromLatin1(FILMASTER_API_URL));
       imageUrl.setPath(imageUrl.path() + image);
     }
-    const QString id = ImageFactory::addImage(imageUrl, true);
+    const QString id = addImage(imageUrl);
     if(id.isEmpty()) {
       myDebug() << "Failed to load" << imageUrl;
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
@@ -25,7 +25,6 @@
 #include "googlebookfetcher.h"
 #include "../collections/bookcollection.h"
 #include "../entry.h"
-#include "../images/imagefactory.h"
 #include "../utils/isbnvalidator.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
@@ -191,7 +190,7 @@ Tellico::Data::EntryPtr GoogleBookFetcher::fetchEntryHook(uint uid_) {
   const QString image_id = entry->field(QLatin1String("cover"));
   // if it's still a url, we need to load it
   if(image_id.startsWith(QLatin1String("http"))) {
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(image_id), true);
+    const QString id = addImage(QUrl::fromUserInput(image_id));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
       entry->setField(QLatin1String("cover"), QString());
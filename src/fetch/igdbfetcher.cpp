@@ -24,7 +24,6 @@
 
 #include "igdbfetcher.h"
 #include "../collections/gamecollection.h"
-#include "../images/imagefactory.h"
 #include "../core/filehandler.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
@@ -175,7 +174,7 @@ Tellico::Data::EntryPtr IGDBFetcher::fetchEntryHook(uint uid_) {
   // image might still be a URL
   const QString image_id = entry->field(QLatin1String("cover"));
   if(image_id.contains(QLatin1Char('/'))) {
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(image_id), true /* quiet */);
+    const QString id = addImage(QUrl::fromUserInput(image_id));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
     }
@@ -30,7 +30,6 @@
 #include "../entry.h"
 #include "../fieldformat.h"
 #include "../core/filehandler.h"
-#include "../images/imagefactory.h"
 #include "../tellico_debug.h"
 
 #include <KLocalizedString>
@@ -323,7 +322,7 @@ void KinoFetcher::parseEntry(Data::EntryPtr entry, const QString& str_) {
   if(divMetaMatch.hasMatch()) {
     QRegularExpression coverRx(QString::fromLatin1("<img.+?src=\"(.+?)\".+?%1 Poster.*?/>").arg(entry->field(QLatin1String("title"))));
     QRegularExpressionMatch coverMatch = coverRx.match(divMetaMatch.captured(1));
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(coverMatch.captured(1)), true /* quiet */);
+    const QString id = addImage(QUrl::fromUserInput(coverMatch.captured(1)));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
     }
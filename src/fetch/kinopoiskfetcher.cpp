@@ -29,7 +29,6 @@
 #include "../entry.h"
 #include "../fieldformat.h"
 #include "../core/filehandler.h"
-#include "../images/imagefactory.h"
 #include "../tellico_debug.h"
 
 #include <KLocalizedString>
@@ -378,7 +377,7 @@ Tellico::Data::EntryPtr KinoPoiskFetcher::parseEntry(const QString& str_) {
   QRegExp coverRx(QLatin1String("<a class=\"popupBigImage\"[^>]+>\\s*<img.*src=\"([^\"]+)\""));
   coverRx.setMinimal(true);
   if(str_.contains(coverRx)) {
-    const QString id = ImageFactory::addImage(QUrl::fromUserInput(coverRx.cap(1)), true /* quiet */);
+    const QString id = addImage(QUrl::fromUserInput(coverRx.cap(1)));
     if(id.isEmpty()) {
       message(i18n("The cover image could not be loaded."), MessageHandler::Warning);
     }
@@ -24,7 +24,6 @@
 
 #include "openlibraryfetcher.h"
 #include "../collections/bookcollection.h"
-#include "../images/imagefactory.h"
 #include "../utils/isbnvalidator.h"
 #include "../utils/guiproxy.h"
 #include "../utils/string_utils.h"
@@ -181,7 +180,7 @@ Tellico::Data::EntryPtr OpenLibraryFetcher::fetchEntryHook(uint uid_) {
     const QString isbn = ISBNValidator::cleanValue(entry->field(QLatin1String("isbn")));
     if(!isbn.isEmpty()) {
       QUrl imageUrl(QString::fromLatin1("http://covers.openlibrary.org/b/isbn/%1-M.jpg?default=false").arg(isbn));
-      const QString id = ImageFactory::addImage(imageUrl, true);
+      const QString id = addImage(imageUrl);
       if(!id.isEmpty()) {
         entry->setField(QLatin1String("cover"), id);
       }
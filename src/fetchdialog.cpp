@@ -43,6 +43,7 @@
 #include "utils/cursorsaver.h"
 #include "utils/stringset.h"
 #include "images/image.h"
+#include "images/imagefactory.h"
 #include "tellico_debug.h"
 
 #ifdef ENABLE_WEBCAM
@@ -76,6 +77,7 @@
 #include <QDesktopWidget>
 #include <QFileDialog>
 #include <QStatusBar>
+#include <QUrl>
 
 namespace {
   static const int FETCH_MIN_WIDTH = 600;
@@ -319,6 +321,8 @@ FetchDialog::FetchDialog(QWidget* parent_)
                                   SLOT(slotStatus(const QString&)));
   connect(Fetch::Manager::self(), SIGNAL(signalDone()),
                                   SLOT(slotFetchDone()));
+  connect(ImageFactory::self(), &ImageFactory::imageAdded,
+          this, &FetchDialog::slotImageAdded);
 
   KAcceleratorManager::manage(this);
   // initialize combos
@@ -344,6 +348,17 @@ FetchDialog::~FetchDialog() {
   qDeleteAll(m_results);
   m_results.clear();
 
+  // entries still waiting for their images are added without them
+  foreach(Data::EntryPtr entry, m_pendingAdds) {
+    foreach(Data::FieldPtr field, entry->collection()->imageFields()) {
+      if(m_pendingImages.contains(entry->field(field))) {
+        entry->setField(field, QString());
+      }
+    }
+  }
+  addEntries(m_pendingAdds);
+  m_pendingAdds.clear();
+
   // we might have downloaded a lot of images we don't need to keep
   Data::EntryList entriesToCheck;
   foreach(Data::EntryPtr entry, m_entries) {
@@ -510,25 +525,102 @@ void FetchDialog::slotAddEntry() {
     if(!entry) {
       setStatus(i18n("Fetching %1...", r->title));
       startProgress();
-      entry = r->fetchEntry();
+      entry = r->fetchEntry(true /* defer images */);
       if(!entry) {
         continue;
       }
       m_entries.insert(r->uid, entry);
+      requestImages(entry);
       stopProgress();
       setStatus(i18n("Ready."));
     }
+    item->setData(0, Qt::DecorationRole,
+                  QIcon::fromTheme(QLatin1String("checkmark"), QIcon(QLatin1String(":/icons/checkmark"))));
+    // the entry is added once its images are downloaded, see slotImageAdded()
+    if(hasPendingImages(entry)) {
+      m_pendingAdds.append(entry);
+    } else {
+      vec.append(entry);
+    }
+  }
+  addEntries(vec);
+}
+
+void FetchDialog::addEntries(const Tellico::Data::EntryList& entries_) {
+  if(entries_.isEmpty()) {
+    return;
+  }
+  Data::EntryList vec;
+  foreach(Data::EntryPtr entry, entries_) {
     if(entry->collection()->hasField(QLatin1String("fetchdialog_source"))) {
       entry->collection()->removeField(QLatin1String("fetchdialog_source"));
     }
     // add a copy, intentionally allowing multiple copies to be added
     vec.append(Data::EntryPtr(new Data::Entry(*entry)));
-    item->setData(0, Qt::DecorationRole,
-                  QIcon::fromTheme(QLatin1String("checkmark"), QIcon(QLatin1String(":/icons/checkmark"))));
   }
-  if(!vec.isEmpty()) {
-    Kernel::self()->addEntries(vec, true);
+  Kernel::self()->addEntries(vec, true);
+}
+
+void FetchDialog::requestImages(Tellico::Data::EntryPtr entry_) {
+  foreach(Data::FieldPtr field, entry_->collection()->imageFields()) {
+    const QString value = entry_->field(field);
+    const QUrl u(value);
+    // an image id is a relative file name, and anything else is still to be downloaded
+    if(value.isEmpty() || u.isRelative() || m_pendingImages.contains(value)) {
+      continue;
+    }
+    m_pendingImages.insert(value);
+    ImageFactory::requestImage(u, true /* quiet */);
+  }
+}
+
+bool FetchDialog::hasPendingImages(Tellico::Data::EntryPtr entry_) const {
+  foreach(Data::FieldPtr field, entry_->collection()->imageFields()) {
+    if(m_pendingImages.contains(entry_->field(field))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FetchDialog::slotImageAdded(const QUrl& url_, const QString& id_) {
+  const QString url = url_.url();
+  if(!m_pendingImages.remove(url)) {
+    return;
+  }
+  if(id_.isEmpty()) {
+    setStatus(i18n("The cover image could not be loaded."));
+  }
+
+  // replace the url with the image id, or clear it if the image could not be loaded
+  Data::EntryList changedEntries;
+  foreach(Data::EntryPtr entry, m_entries) {
+    foreach(Data::FieldPtr field, entry->collection()->imageFields()) {
+      if(entry->field(field) == url) {
+        entry->setField(field, id_);
+        changedEntries.append(entry);
+      }
+    }
+  }
+
+  QList<QTreeWidgetItem*> items = m_treeWidget->selectedItems();
+  if(items.count() == 1) {
+    Data::EntryPtr entry = m_entries.value(static_cast<FetchResultItem*>(items.first())->m_result->uid);
+    if(changedEntries.contains(entry)) {
+      m_entryView->showEntry(entry);
+    }
+  }
+
+  Data::EntryList vec;
+  QMutableListIterator<Data::EntryPtr> it(m_pendingAdds);
+  while(it.hasNext()) {
+    Data::EntryPtr entry = it.next();
+    if(!hasPendingImages(entry)) {
+      vec.append(entry);
+      it.remove();
+    }
   }
+  addEntries(vec);
 }
 
 void FetchDialog::slotMoreClicked() {
@@ -569,9 +661,10 @@ void FetchDialog::slotShowEntry() {
   if(!entry) {
     GUI::CursorSaver cs;
     startProgress();
-    entry = r->fetchEntry();
+    entry = r->fetchEntry(true /* defer images */);
     if(entry) { // might conceivably be null
       m_entries.insert(r->uid, entry);
+      requestImages(entry);
     }
     stopProgress();
   }
@@ -831,6 +924,8 @@ void FetchDialog::slotResetCollection() {
     return;
   }
   m_collType = Kernel::self()->collectionType();
+  // the entries waiting for images no longer match the collection
+  m_pendingAdds.clear();
   m_sourceCombo->clear();
   Fetch::FetcherVec sources = Fetch::Manager::self()->fetchers(m_collType);
   foreach(Fetch::Fetcher::Ptr fetcher, sources) {
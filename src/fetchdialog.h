@@ -32,6 +32,7 @@
 #include <QEvent>
 #include <QList>
 #include <QHash>
+#include <QSet>
 
 namespace Tellico {
   class EntryView;
@@ -60,6 +61,7 @@ class QProgressBar;
 class QTimer;
 class QCheckBox;
 class QTreeWidget;
+class QUrl;
 
 namespace Tellico {
 
@@ -104,8 +106,16 @@ private Q_SLOTS:
 
   void slotBarcodeRecognized(const QString&);
   void slotBarcodeGotImage(const QImage&);
+  void slotImageAdded(const QUrl& url, const QString& id);
 
 private:
+  /**
+   * Requests the images that the fetcher left as a URL in the image fields. The URL
+   * gets replaced with the image id once the image is downloaded.
+   */
+  void requestImages(Data::EntryPtr entry);
+  bool hasPendingImages(Data::EntryPtr entry) const;
+  void addEntries(const Data::EntryList& entries);
   void startProgress();
   void stopProgress();
   void setStatus(const QString& text);
@@ -139,6 +149,9 @@ private:
   QStringList m_isbnList;
   QStringList m_statusMessages;
   QHash<int, Data::EntryPtr> m_entries;
+  QSet<QString> m_pendingImages;
+  // entries to be added once their images are downloaded
+  Data::EntryList m_pendingAdds;
   QList<Fetch::FetchResult*> m_results;
   int m_collType;
   bool m_treeWasResized;
@@ -34,7 +34,7 @@ using Tellico::Data::Field;
 // this constructor is for anything but Choice type
 Field::Field(const QString& name_, const QString& title_, Type type_/*=Line*/)
     : QSharedData(), m_name(name_), m_title(title_),  m_category(i18n("General")), m_desc(title_),
-      m_type(type_), m_flags(0), m_formatType(FieldFormat::FormatNone) {
+      m_type(type_), m_flags(0), m_formatType(FieldFormat::FormatNone), m_slot(-1), m_derivedRevision(0) {
 
   Q_ASSERT(m_type != Choice);
   // a paragraph's category is always its title, along with tables
@@ -75,14 +75,14 @@ Field::Field(const QString& name_, const QString& title_, Type type_/*=Line*/)
 // if this constructor is called, the type is necessarily Choice
 Field::Field(const QString& name_, const QString& title_, const QStringList& allowed_)
     : QSharedData(), m_name(name_), m_title(title_), m_category(i18n("General")), m_desc(title_),
-      m_type(Field::Choice), m_allowed(allowed_), m_flags(0), m_formatType(FieldFormat::FormatNone) {
+      m_type(Field::Choice), m_allowed(allowed_), m_flags(0), m_formatType(FieldFormat::FormatNone), m_slot(-1), m_derivedRevision(0) {
 }
 
 Field::Field(const Field& field_)
     : QSharedData(field_), m_name(field_.name()), m_title(field_.title()), m_category(field_.category()),
       m_desc(field_.description()), m_type(field_.type()), m_allowed(field_.allowed()),
       m_flags(field_.flags()), m_formatType(field_.formatType()),
-      m_properties(field_.propertyList()) {
+      m_properties(field_.propertyList()), m_slot(-1), m_derivedRevision(0) {
 }
 
 Field& Field::operator=(const Field& field_) {
@@ -98,12 +98,21 @@ Field& Field::operator=(const Field& field_) {
   m_flags = field_.flags();
   m_formatType = field_.formatType();
   m_properties = field_.propertyList();
+  m_derivedValue.clear();
+  ++m_derivedRevision;
+  // the slot belongs to the owning collection, so keep it
   return *this;
 }
 
 Field::~Field() {
 }
 
+void Field::setName(const QString& name_) {
+  m_name = name_;
+  m_derivedValue.clear();
+  ++m_derivedRevision;
+}
+
 void Field::setTitle(const QString& title_) {
   m_title = title_;
   if(isSingleCategory()) {
@@ -160,6 +169,10 @@ void Field::setFlags(int flags_) {
   } else {
     m_flags = flags_;
   }
+  if(m_derivedValue) {
+    m_derivedValue.clear();
+    ++m_derivedRevision;
+  }
 }
 
 bool Field::hasFlag(FieldFlag flag_) const {
@@ -236,10 +249,16 @@ void Field::setProperty(const QString& key_, const QString& value_) {
   } else {
     m_properties.insert(key_, value_);
   }
+  if(key_ == QLatin1String("template")) {
+    m_derivedValue.clear();
+    ++m_derivedRevision;
+  }
 }
 
 void Field::setPropertyList(const Tellico::StringMap& props_) {
   m_properties = props_;
+  m_derivedValue.clear();
+  ++m_derivedRevision;
 }
 
 QString Field::property(const QString& key_) const {
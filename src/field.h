@@ -30,9 +30,11 @@
 
 #include <QStringList>
 #include <QRegExp>
+#include <QSharedPointer>
 
 namespace Tellico {
   namespace Data {
+    class DerivedValue;
 
 /**
  * The Field class encapsulates all the possible properties of a entry.
@@ -158,7 +160,7 @@ public:
    *
    * @param name The field name
    */
-  void setName(const QString& name) { m_name = name; }
+  void setName(const QString& name);
   /**
    * Returns the title of the field.
    *
@@ -295,6 +297,30 @@ public:
    * @return The property list
    */
   const StringMap& propertyList() const { return m_properties; }
+  /**
+   * Returns the storage slot assigned by the collection which owns the field,
+   * or -1 if the field has not been added to a collection.
+   *
+   * @return The value slot
+   */
+  int slot() const { return m_slot; }
+  /**
+   * Sets the storage slot. Only the owning collection should call this.
+   *
+   * @param slot The value slot
+   */
+  void setSlot(int slot) { m_slot = slot; }
+  /**
+   * Returns the compiled template for a derived field, if it has been cached.
+   * Use @ref DerivedValue::derivedValue() instead.
+   */
+  QSharedPointer<const DerivedValue> derivedValue() const { return m_derivedValue; }
+  void setDerivedValue(QSharedPointer<const DerivedValue> value) { m_derivedValue = value; }
+  /**
+   * Returns a counter that is incremented whenever the cached template is dropped, since
+   * the template of a field in a collection might be changed in place.
+   */
+  int derivedRevision() const { return m_derivedRevision; }
 
   /*************************** STATIC **********************************/
   /**
@@ -332,6 +358,9 @@ private:
   int m_flags;
   FieldFormat::Type m_formatType;
   StringMap m_properties;
+  int m_slot;
+  QSharedPointer<const DerivedValue> m_derivedValue;
+  int m_derivedRevision;
 };
 
   } // end namespace
@@ -69,8 +69,12 @@ QStringList FieldFormat::splitTable(const QString& string_, QString::SplitBehavi
 }
 
 QString FieldFormat::sortKeyTitle(const QString& title_) {
+  return sortKeyTitle(title_, Config::articleList(), Config::articleAposList());
+}
+
+QString FieldFormat::sortKeyTitle(const QString& title_, const QStringList& articles_, const QStringList& aposArticles_) {
   const QString lower = title_.toLower();
-  foreach(const QString& article, Config::articleList()) {
+  foreach(const QString& article, articles_) {
     // assume white space is already stripped
     // the articles are already in lower-case
     if(lower.startsWith(article + QLatin1Char(' '))) {
@@ -78,7 +82,7 @@ QString FieldFormat::sortKeyTitle(const QString& title_) {
     }
   }
   // check apostrophes, too
-  foreach(const QString& article, Config::articleAposList()) {
+  foreach(const QString& article, aposArticles_) {
     if(lower.startsWith(article)) {
       return title_.mid(article.length());
     }
@@ -94,6 +94,11 @@ public:
    * Return the key to be used for sorting titles
    */
   static QString sortKeyTitle(const QString& title);
+  /**
+   * Return the key to be used for sorting titles, with the articles read from the config
+   * beforehand, so that it can be used outside the main thread
+   */
+  static QString sortKeyTitle(const QString& title, const QStringList& articles, const QStringList& aposArticles);
 
   static void stripArticles(QString& value);
 
@@ -24,28 +24,103 @@
 
 #include "filter.h"
 #include "entry.h"
+#include "collection.h"
+#include "entrytextindex.h"
 #include "utils/string_utils.h"
 #include "tellico_debug.h"
 
 #include <QRegExp>
 
+#include <algorithm>
+
 using Tellico::Filter;
 using Tellico::FilterRule;
 
-FilterRule::FilterRule() : m_function(FuncEquals) {
+namespace {
+  // same as QDate::fromString(value, "yyyy-M-d"), without having to parse the format for every entry
+  // Bug 361625: some older versions of Tellico serialized the date with single digit month and day
+  QDate parseDate(const QString& value_) {
+    const QVector<QStringRef> parts = value_.splitRef(QLatin1Char('-'));
+    if(parts.count() != 3 || parts.at(0).length() != 4 ||
+       parts.at(1).isEmpty() || parts.at(1).length() > 2 ||
+       parts.at(2).isEmpty() || parts.at(2).length() > 2) {
+      return QDate();
+    }
+    bool ok1, ok2, ok3;
+    const int y = parts.at(0).toInt(&ok1);
+    const int m = parts.at(1).toInt(&ok2);
+    const int d = parts.at(2).toInt(&ok3);
+    return (ok1 && ok2 && ok3) ? QDate(y, m, d) : QDate();
+  }
+
+  bool lessCost(const FilterRule* rule1_, const FilterRule* rule2_) {
+    return rule1_->cost() < rule2_->cost();
+  }
+}
+
+FilterRule::FilterRule() : m_function(FuncEquals), m_indexRevision(-1), m_useCandidates(false)
+    , m_formatted(false), m_number(0.0), m_compiledCollId(-1), m_compiledFieldRevision(-1) {
 }
 
 FilterRule::FilterRule(const QString& fieldName_, const QString& pattern_, Function func_)
-    : m_fieldName(fieldName_), m_function(func_), m_pattern(pattern_) {
+    : m_fieldName(fieldName_), m_function(func_), m_pattern(pattern_), m_indexRevision(-1), m_useCandidates(false)
+    , m_formatted(false), m_number(0.0), m_compiledCollId(-1), m_compiledFieldRevision(-1) {
   updatePattern();
 }
 
+void FilterRule::compile(Tellico::Data::CollPtr coll_) const {
+  if(!coll_) {
+    return;
+  }
+  m_field = m_fieldName.isEmpty() ? Data::FieldPtr() : coll_->fieldByName(m_fieldName);
+  m_formatted = m_field && m_field->formatType() != FieldFormat::FormatNone;
+  if(m_function == FuncRegExp || m_function == FuncNotRegExp) {
+    // QRegExp matches unicode word characters with \w, so use the unicode properties too
+    m_regExp = QRegularExpression(m_pattern, QRegularExpression::CaseInsensitiveOption |
+                                             QRegularExpression::UseUnicodePropertiesOption);
+    m_regExp.optimize();
+  } else {
+    m_regExp = QRegularExpression();
+  }
+  m_date = m_patternVariant.toDate();
+  m_number = m_patternVariant.toDouble();
+  m_compiledCollId = coll_->id();
+  m_compiledFieldRevision = coll_->fieldRevision();
+}
+
+bool FilterRule::isCompiled(const Tellico::Data::Collection* coll_) const {
+  return coll_ && m_compiledFieldRevision == coll_->fieldRevision() && m_compiledCollId == coll_->id();
+}
+
+int FilterRule::cost() const {
+  switch(m_function) {
+    case FuncBefore:
+    case FuncAfter:
+    case FuncLess:
+    case FuncGreater:
+      return 1;
+    case FuncEquals:
+    case FuncNotEquals:
+    case FuncContains:
+    case FuncNotContains:
+      // searching every field goes through the text index
+      return m_fieldName.isEmpty() ? 3 : 2;
+    case FuncRegExp:
+    case FuncNotRegExp:
+      return m_fieldName.isEmpty() ? 5 : 4;
+  }
+  return 5;
+}
+
 bool FilterRule::matches(Tellico::Data::EntryPtr entry_) const {
   Q_ASSERT(entry_);
   Q_ASSERT(entry_->collection());
   if(!entry_ || !entry_->collection()) {
     return false;
   }
+  if(!isCompiled(entry_->collection().data())) {
+    compile(entry_->collection());
+  }
   switch (m_function) {
     case FuncEquals:
       return equals(entry_);
@@ -77,21 +152,22 @@ bool FilterRule::matches(Tellico::Data::EntryPtr entry_) const {
 bool FilterRule::equals(Tellico::Data::EntryPtr entry_) const {
   // empty field name means search all
   if(m_fieldName.isEmpty()) {
+    if(!isIndexCandidate(entry_)) {
+      return false;
+    }
     foreach(const QString& value, entry_->fieldValues()) {
-      if(m_pattern.compare(value, Qt::CaseInsensitive) == 0) {
+      if(matchesValue(value)) {
         return true;
       }
     }
     foreach(const QString& value, entry_->formattedFieldValues()) {
-      if(m_pattern.compare(value, Qt::CaseInsensitive) == 0) {
+      if(matchesValue(value)) {
         return true;
       }
     }
   } else {
-    return m_pattern.compare(entry_->field(m_fieldName), Qt::CaseInsensitive) == 0 ||
-           (entry_->collection()->hasField(m_fieldName) &&
-            entry_->collection()->fieldByName(m_fieldName)->formatType() != FieldFormat::FormatNone &&
-            m_pattern.compare(entry_->formattedField(m_fieldName, FieldFormat::ForceFormat), Qt::CaseInsensitive) == 0);
+    return matchesValue(entry_->field(m_field)) ||
+           (m_formatted && matchesValue(entry_->formattedField(m_field, FieldFormat::ForceFormat)));
   }
 
   return false;
@@ -100,47 +176,24 @@ bool FilterRule::equals(Tellico::Data::EntryPtr entry_) const {
 bool FilterRule::contains(Tellico::Data::EntryPtr entry_) const {
   // empty field name means search all
   if(m_fieldName.isEmpty()) {
-    QString value2;
+    if(!isIndexCandidate(entry_)) {
+      return false;
+    }
     // match is true if any strings match
     foreach(const QString& value, entry_->fieldValues()) {
-      if(value.contains(m_pattern, Qt::CaseInsensitive)) {
-        return true;
-      }
-      value2 = removeAccents(value);
-      if(value2 != value && value2.contains(m_pattern, Qt::CaseInsensitive)) {
+      if(matchesValue(value)) {
         return true;
       }
     }
     // match is true if any strings match
     foreach(const QString& value, entry_->formattedFieldValues()) {
-      if(value.contains(m_pattern, Qt::CaseInsensitive)) {
-        return true;
-      }
-      value2 = removeAccents(value);
-      if(value2 != value && value2.contains(m_pattern, Qt::CaseInsensitive)) {
+      if(matchesValue(value)) {
         return true;
       }
     }
   } else {
-    QString value = entry_->field(m_fieldName);
-    if(value.contains(m_pattern, Qt::CaseInsensitive)) {
-        return true;
-    }
-    QString value2 = removeAccents(value);
-    if(value2 != value && value2.contains(m_pattern, Qt::CaseInsensitive)) {
-      return true;
-    }
-    if(entry_->collection()->hasField(m_fieldName) &&
-       entry_->collection()->fieldByName(m_fieldName)->formatType() != FieldFormat::FormatNone) {
-      value = entry_->formattedField(m_fieldName);
-      if(value.contains(m_pattern, Qt::CaseInsensitive)) {
-        return true;
-      }
-      value2 = removeAccents(value);
-      if(value2 != value && value2.contains(m_pattern, Qt::CaseInsensitive)) {
-        return true;
-      }
-    }
+    return matchesValue(entry_->field(m_field)) ||
+           (m_formatted && matchesValue(entry_->formattedField(m_field)));
   }
 
   return false;
@@ -148,23 +201,20 @@ bool FilterRule::contains(Tellico::Data::EntryPtr entry_) const {
 
 bool FilterRule::matchesRegExp(Tellico::Data::EntryPtr entry_) const {
   // empty field name means search all
-  const QRegExp pattern = m_patternVariant.toRegExp();
   if(m_fieldName.isEmpty()) {
     foreach(const QString& value, entry_->fieldValues()) {
-      if(pattern.indexIn(value) >= 0) {
+      if(matchesValue(value)) {
         return true;
       }
     }
     foreach(const QString& value, entry_->formattedFieldValues()) {
-      if(pattern.indexIn(value) >= 0) {
+      if(matchesValue(value)) {
         return true;
       }
     }
   } else {
-    return pattern.indexIn(entry_->field(m_fieldName)) >= 0 ||
-           (entry_->collection()->hasField(m_fieldName) &&
-            entry_->collection()->fieldByName(m_fieldName)->formatType() != FieldFormat::FormatNone &&
-            pattern.indexIn(entry_->formattedField(m_fieldName, FieldFormat::ForceFormat)) >= 0);
+    return matchesValue(entry_->field(m_field)) ||
+           (m_formatted && matchesValue(entry_->formattedField(m_field, FieldFormat::ForceFormat)));
   }
 
   return false;
@@ -176,11 +226,7 @@ bool FilterRule::before(Tellico::Data::EntryPtr entry_) const {
   if(m_fieldName.isEmpty()) {
     return false;
   }
-  const QDate pattern = m_patternVariant.toDate();
-//  const QDate value = QDate::fromString(entry_->field(m_fieldName), Qt::ISODate);
-  // Bug 361625: some older versions of Tellico serialized the date with single digit month and day
-  const QDate value = QDate::fromString(entry_->field(m_fieldName), QLatin1String("yyyy-M-d"));
-  return value.isValid() && value < pattern;
+  return matchesValue(entry_->field(m_field));
 }
 
 bool FilterRule::after(Tellico::Data::EntryPtr entry_) const {
@@ -189,11 +235,7 @@ bool FilterRule::after(Tellico::Data::EntryPtr entry_) const {
   if(m_fieldName.isEmpty()) {
     return false;
   }
-  const QDate pattern = m_patternVariant.toDate();
-//  const QDate value = QDate::fromString(entry_->field(m_fieldName), Qt::ISODate);
-  // Bug 361625: some older versions of Tellico serialized the date with single digit month and day
-  const QDate value = QDate::fromString(entry_->field(m_fieldName), QLatin1String("yyyy-M-d"));
-  return value.isValid() && value > pattern;
+  return matchesValue(entry_->field(m_field));
 }
 
 bool FilterRule::lessThan(Tellico::Data::EntryPtr entry_) const {
@@ -202,10 +244,7 @@ bool FilterRule::lessThan(Tellico::Data::EntryPtr entry_) const {
   if(m_fieldName.isEmpty()) {
     return false;
   }
-  const double pattern = m_patternVariant.toDouble();
-  bool ok = false;
-  const double value = entry_->field(m_fieldName).toDouble(&ok);
-  return ok && value < pattern;
+  return matchesValue(entry_->field(m_field));
 }
 
 bool FilterRule::greaterThan(Tellico::Data::EntryPtr entry_) const {
@@ -214,13 +253,155 @@ bool FilterRule::greaterThan(Tellico::Data::EntryPtr entry_) const {
   if(m_fieldName.isEmpty()) {
     return false;
   }
-  const double pattern = m_patternVariant.toDouble();
-  bool ok = false;
-  const double value = entry_->field(m_fieldName).toDouble(&ok);
-  return ok && value > pattern;
+  return matchesValue(entry_->field(m_field));
+}
+
+QStringList FilterRule::values(Tellico::Data::EntryPtr entry_) const {
+  QStringList values;
+  if(!entry_ || !entry_->collection()) {
+    return values;
+  }
+  if(!isCompiled(entry_->collection().data())) {
+    compile(entry_->collection());
+  }
+  // the same values as the matching functions above look at
+  switch(m_function) {
+    case FuncEquals:
+    case FuncNotEquals:
+    case FuncContains:
+    case FuncNotContains:
+      if(m_fieldName.isEmpty()) {
+        if(isIndexCandidate(entry_)) {
+          values = entry_->fieldValues() + entry_->formattedFieldValues();
+        }
+      } else {
+        values << entry_->field(m_field);
+        if(m_formatted) {
+          values << entry_->formattedField(m_field, (m_function == FuncContains || m_function == FuncNotContains)
+                                                    ? FieldFormat::DefaultFormat : FieldFormat::ForceFormat);
+        }
+      }
+      break;
+    case FuncRegExp:
+    case FuncNotRegExp:
+      if(m_fieldName.isEmpty()) {
+        values = entry_->fieldValues() + entry_->formattedFieldValues();
+      } else {
+        values << entry_->field(m_field);
+        if(m_formatted) {
+          values << entry_->formattedField(m_field, FieldFormat::ForceFormat);
+        }
+      }
+      break;
+    case FuncBefore:
+    case FuncAfter:
+    case FuncLess:
+    case FuncGreater:
+      if(!m_fieldName.isEmpty()) {
+        values << entry_->field(m_field);
+      }
+      break;
+  }
+  return values;
+}
+
+bool FilterRule::matchesValues(const QStringList& values_) const {
+  bool match = false;
+  foreach(const QString& value, values_) {
+    if(matchesValue(value)) {
+      match = true;
+      break;
+    }
+  }
+  switch(m_function) {
+    case FuncNotEquals:
+    case FuncNotContains:
+    case FuncNotRegExp:
+      return !match;
+    default:
+      return match;
+  }
+}
+
+// checks a single value, whether or not the function is negated
+bool FilterRule::matchesValue(const QString& value_) const {
+  switch(m_function) {
+    case FuncEquals:
+    case FuncNotEquals:
+      return m_pattern.compare(value_, Qt::CaseInsensitive) == 0;
+    case FuncContains:
+    case FuncNotContains:
+      {
+        if(value_.contains(m_pattern, Qt::CaseInsensitive)) {
+          return true;
+        }
+        const QString value2 = removeAccents(value_);
+        return value2 != value_ && value2.contains(m_pattern, Qt::CaseInsensitive);
+      }
+    case FuncRegExp:
+    case FuncNotRegExp:
+      return matchesPattern(value_);
+    case FuncBefore:
+      {
+        const QDate value = parseDate(value_);
+        return value.isValid() && value < m_date;
+      }
+    case FuncAfter:
+      {
+        const QDate value = parseDate(value_);
+        return value.isValid() && value > m_date;
+      }
+    case FuncLess:
+      {
+        bool ok = false;
+        const double value = value_.toDouble(&ok);
+        return ok && value < m_number;
+      }
+    case FuncGreater:
+      {
+        bool ok = false;
+        const double value = value_.toDouble(&ok);
+        return ok && value > m_number;
+      }
+  }
+  return false;
+}
+
+bool FilterRule::matchesPattern(const QString& value_) const {
+  if(m_regExp.isValid()) {
+    return m_regExp.match(value_).hasMatch();
+  }
+  // a few patterns valid for QRegExp might not be for QRegularExpression
+  return m_patternVariant.toRegExp().indexIn(value_) >= 0;
+}
+
+// the index rules out most of the entries without having to check each of their values
+bool FilterRule::isIndexCandidate(Tellico::Data::EntryPtr entry_) const {
+  // an entry without an id has never been added to the collection, so it's not indexed either,
+  // and copies of entries can be matched in other threads without touching the index
+  if(entry_->id() < 0) {
+    return true;
+  }
+  Data::EntryTextIndex* index = entry_->collection()->textIndex();
+  // an entry which is not in the index, or has been modified since, has to be checked directly
+  if(!index->isCurrent(entry_.data())) {
+    return true;
+  }
+  if(m_indexRevision != index->revision()) {
+    m_indexRevision = index->revision();
+    if(m_function == FuncEquals || m_function == FuncNotEquals) {
+      m_useCandidates = index->findEquals(m_pattern, m_candidates);
+    } else {
+      m_useCandidates = index->findContains(m_pattern, m_candidates);
+    }
+  }
+  return !m_useCandidates || m_candidates.contains(entry_.data());
 }
 
 void FilterRule::updatePattern() {
+  // the candidates have to be looked up again, and the pattern compiled
+  m_indexRevision = -1;
+  m_compiledFieldRevision = -1;
   if(m_function == FuncRegExp || m_function == FuncNotRegExp) {
     m_patternVariant = QRegExp(m_pattern, Qt::CaseInsensitive);
   } else if(m_function == FuncBefore || m_function == FuncAfter)  {
@@ -261,9 +442,10 @@ bool Filter::matches(Tellico::Data::EntryPtr entry_) const {
   if(isEmpty()) {
     return true;
   }
+  compile(entry_ ? entry_->collection() : Data::CollPtr());
 
   bool match = false;
-  foreach(const FilterRule* rule, *this) {
+  foreach(const FilterRule* rule, m_compiledRules) {
     if(rule->matches(entry_)) {
       match = true;
       if(m_op == Filter::MatchAny) {
@@ -279,6 +461,63 @@ bool Filter::matches(Tellico::Data::EntryPtr entry_) const {
   return match;
 }
 
+QList<QStringList> Filter::values(Tellico::Data::EntryPtr entry_) const {
+  QList<QStringList> values;
+  if(isEmpty()) {
+    return values;
+  }
+  compile(entry_ ? entry_->collection() : Data::CollPtr());
+  foreach(const FilterRule* rule, m_compiledRules) {
+    values << rule->values(entry_);
+  }
+  return values;
+}
+
+bool Filter::matchesValues(const QList<QStringList>& values_) const {
+  if(isEmpty()) {
+    return true;
+  }
+  // the values are in the order of the compiled rules
+  Q_ASSERT(values_.count() == m_compiledRules.count());
+  bool match = false;
+  for(int i = 0; i < m_compiledRules.count() && i < values_.count(); ++i) {
+    if(m_compiledRules.at(i)->matchesValues(values_.at(i))) {
+      match = true;
+      if(m_op == Filter::MatchAny) {
+        break; // don't need to check other rules
+      }
+    } else {
+      match = false;
+      if(m_op == Filter::MatchAll) {
+        break; // no need to check further
+      }
+    }
+  }
+  return match;
+}
+
+void Filter::compile(Tellico::Data::CollPtr coll_) const {
+  // this is called for every entry, so when nothing has changed it only compares a few values per rule
+  const QList<FilterRule*>& rules = *this;
+  bool changed = m_compiledFrom != rules;
+  foreach(const FilterRule* rule, rules) {
+    if(coll_ && !rule->isCompiled(coll_.data())) {
+      rule->compile(coll_);
+      changed = true;
+    }
+  }
+  if(!changed) {
+    return;
+  }
+  m_compiledFrom = rules;
+  m_compiledRules.clear();
+  foreach(const FilterRule* rule, rules) {
+    m_compiledRules.append(rule);
+  }
+  // the result doesn't depend on the order, so check the cheapest rules first
+  std::stable_sort(m_compiledRules.begin(), m_compiledRules.end(), lessCost);
+}
+
 bool Filter::operator==(const Filter& other) const {
   return m_op == other.m_op &&
          m_name == other.m_name &&
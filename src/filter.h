@@ -29,7 +29,11 @@
 
 #include <QList>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
+#include <QSet>
+#include <QDate>
+#include <QRegularExpression>
 
 namespace Tellico {
   namespace Data {
@@ -68,6 +72,27 @@ public:
    * @return Returns true if the entry is matched by the rule.
    */
   bool matches(Data::EntryPtr entry) const;
+  /**
+   * Returns the values of an entry that the rule looks at. Matching them with @ref matchesValues
+   * gives the same result as matching the entry.
+   */
+  QStringList values(Data::EntryPtr entry) const;
+  /**
+   * Matches the values from @ref values. Neither the entry nor the collection is used,
+   * so a compiled rule can match values in several threads at once.
+   */
+  bool matchesValues(const QStringList& values) const;
+  /**
+   * Resolves the field and parses the pattern for a collection, so that matching
+   * an entry does not have to look them up again. Matching an entry from a different
+   * collection, or after the collection fields change, compiles the rule again.
+   */
+  void compile(Data::CollPtr coll) const;
+  bool isCompiled(const Data::Collection* coll) const;
+  /**
+   * Returns the relative cost of matching the rule, so the cheapest rules can be checked first.
+   */
+  int cost() const;
 
   /**
    * Return filter function. This can be any of the operators
@@ -85,7 +110,7 @@ public:
   /**
    * Set field name
    */
-  void setFieldName(const QString& fieldName) { m_fieldName = fieldName; }
+  void setFieldName(const QString& fieldName) { m_fieldName = fieldName; m_compiledFieldRevision = -1; }
   /**
    * Return pattern
    */
@@ -103,12 +128,27 @@ private:
   bool after(Data::EntryPtr entry) const;
   bool lessThan(Data::EntryPtr entry) const;
   bool greaterThan(Data::EntryPtr entry) const;
+  bool isIndexCandidate(Data::EntryPtr entry) const;
+  bool matchesValue(const QString& value) const;
+  bool matchesPattern(const QString& value) const;
   void updatePattern();
 
   QString m_fieldName;
   Function m_function;
   QString m_pattern;
   QVariant m_patternVariant;
+  // the entries which might match, looked up in the collection's text index
+  mutable QSet<const Data::Entry*> m_candidates;
+  mutable int m_indexRevision;
+  mutable bool m_useCandidates;
+  // set by compile() for a single collection
+  mutable Data::FieldPtr m_field;
+  mutable bool m_formatted;
+  mutable QRegularExpression m_regExp;
+  mutable QDate m_date;
+  mutable double m_number;
+  mutable Data::ID m_compiledCollId;
+  mutable int m_compiledFieldRevision;
 };
 
 /**
@@ -131,6 +171,22 @@ public:
   void setMatch(FilterOp op) { m_op = op; }
   FilterOp op() const { return m_op; }
   bool matches(Data::EntryPtr entry) const;
+  /**
+   * Returns the values of an entry that each rule looks at, compiling the filter first.
+   * Entries can only be read in the main thread, but the values can be matched anywhere.
+   */
+  QList<QStringList> values(Data::EntryPtr entry) const;
+  /**
+   * Matches the values from @ref values, without compiling the filter again,
+   * so that it can be called from several threads at once.
+   */
+  bool matchesValues(const QList<QStringList>& values) const;
+  /**
+   * Compiles every rule for the collection, and orders them so the cheapest ones are checked first.
+   * This is done automatically when matching an entry, but only does any work the first time,
+   * or after the rules or the collection fields change.
+   */
+  void compile(Data::CollPtr coll) const;
 
   void setName(const QString& name) { m_name = name; }
   const QString& name() const { return m_name; }
@@ -144,6 +200,9 @@ private:
 
   FilterOp m_op;
   QString m_name;
+  // the rules as they were when last compiled, and the compiled rules, cheapest first
+  mutable QList<FilterRule*> m_compiledFrom;
+  mutable QList<const FilterRule*> m_compiledRules;
 };
 
 } // end namespace
@@ -102,6 +102,8 @@ ImageWidget::ImageWidget(QWidget* parent_) : QWidget(parent_), m_editMenu(nullpt
   QPushButton* button1 = new QPushButton(i18n("Select Image..."), this);
   button1->setIcon(QIcon::fromTheme(QLatin1String("insert-image")));
   connect(button1, SIGNAL(clicked()), this, SLOT(slotGetImage()));
+  connect(ImageFactory::self(), &ImageFactory::imageAdded,
+          this, &ImageWidget::slotImageAdded);
   boxLayout->addWidget(button1);
 
   QPushButton* button2 = new QPushButton(i18n("Scan Image..."), this);
@@ -177,6 +179,8 @@ void ImageWidget::setImage(const QString& id_) {
     slotClear();
     return;
   }
+  // an image that is set directly replaces any image still being downloaded
+  m_requestedURL.clear();
   m_imageID = id_;
   m_pixmap = ImageFactory::pixmap(id_, MAX_UNSCALED_WIDTH, MAX_UNSCALED_HEIGHT);
   const bool link = ImageFactory::imageInfo(id_).linkOnly;
@@ -199,6 +203,7 @@ void ImageWidget::slotClear() {
   bool wasEmpty = m_imageID.isEmpty();
 //  m_image = Data::Image();
   m_imageID.clear();
+  m_requestedURL.clear();
   m_pixmap = QPixmap();
   m_scaled = m_pixmap;
   m_originalURL.clear();
@@ -453,11 +458,20 @@ void ImageWidget::dropEvent(QDropEvent* event_) {
 void ImageWidget::loadImage(const QUrl& url_) {
   const bool link = m_cbLinkOnly->isChecked();
 
-  GUI::CursorSaver cs;
+  // the image is downloaded in the background, slotImageAdded() sets it once it's done
   // if we're linking only, then we want the image id to be the same as the url
-  const QString& id = ImageFactory::addImage(url_, false, QUrl(), link);
-  if(id != m_imageID) {
-    setImage(id);
+  m_requestedURL = url_;
+  ImageFactory::requestImage(url_, false, QUrl(), link);
+}
+
+void ImageWidget::slotImageAdded(const QUrl& url_, const QString& id_) {
+  // ignore images requested by someone else, or replaced by a later request
+  if(m_requestedURL.isEmpty() || url_ != m_requestedURL) {
+    return;
+  }
+  m_requestedURL.clear();
+  if(id_ != m_imageID) {
+    setImage(id_);
     emit signalModified();
   }
   // at the end, cause setImage() resets it
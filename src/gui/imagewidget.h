@@ -89,6 +89,7 @@ private Q_SLOTS:
   void imageReady(QByteArray &data, int w, int h, int bpl, int f);
   void slotEditImage();
   void slotEditMenu(QAction* action);
+  void slotImageAdded(const QUrl& url, const QString& id);
   void slotFinished();
   void cancelScan();
 
@@ -102,6 +103,7 @@ private:
   QLabel* m_label;
   QCheckBox* m_cbLinkOnly;
   QUrl m_originalURL;
+  QUrl m_requestedURL;
   QPoint m_dragStart;
   QMenu* m_editMenu;
   QToolButton* m_edit;
@@ -27,6 +27,7 @@
 #include "../tellico_debug.h"
 
 #include <QBuffer>
+#include <QFile>
 #include <QRegExp>
 #include <QImageReader>
 #include <QImageWriter>
@@ -34,6 +35,18 @@
 
 using Tellico::Data::Image;
 
+namespace {
+  // the format is known up front, so the image plugins don't have to be probed for it,
+  // but an image saved with the wrong extension still loads
+  QImage imageFromData(const QByteArray& data_, const QByteArray& format_) {
+    QImage img;
+    if(format_.isEmpty() || !img.loadFromData(data_, format_.constData())) {
+      img.loadFromData(data_);
+    }
+    return img;
+  }
+}
+
 const Image Image::null;
 QList<QByteArray> Image::s_outputFormats;
 
@@ -43,17 +56,26 @@ Image::Image() : QImage(), m_linkOnly(false) {
 // I'm using the MD5 hash as the id. I consider it rather unlikely that two images in one
 // collection could ever have the same hash, and this lets me do a fast comparison of two images
 // simply by comparing their ids.
-Image::Image(const QString& filename_, const QString& id_) : QImage(filename_), m_id(idClean(id_)), m_linkOnly(false) {
+Image::Image(const QString& filename_, const QString& id_) : QImage(), m_id(idClean(id_)), m_linkOnly(false) {
+  // keep the file contents so the image never needs to be encoded again when written
+  QFile file(filename_);
+  if(file.open(QIODevice::ReadOnly)) {
+    m_data = file.readAll();
+  }
   m_format = QImageReader::imageFormat(filename_);
+  QImage::operator=(imageFromData(m_data, m_format));
   if(isNull()) {
     // Tellico had an earlier bug where images were written in PNG format with a GIF extension
     // and for some reason, qt doesn't recognize the file then, so fall back and try to load as PNG
-    load(filename_, "PNG");
+    loadFromData(m_data, "PNG");
     if(!isNull()) {
       myWarning() << filename_ << "loaded as PNG image";
       m_format = "PNG";
     }
   }
+  if(isNull()) {
+    m_data.clear();
+  }
   if(m_id.isEmpty()) {
     calculateID();
   }
@@ -64,9 +86,10 @@ Image::Image(const QImage& img_, const QString& format_) : QImage(img_), m_forma
 }
 
 Image::Image(const QByteArray& data_, const QString& format_, const QString& id_)
-    : QImage(QImage::fromData(data_)), m_id(idClean(id_)), m_format(format_.toLatin1()), m_linkOnly(false) {
+    : QImage(imageFromData(data_, format_.toLatin1())), m_id(idClean(id_)), m_format(format_.toLatin1()), m_data(data_), m_linkOnly(false) {
   if(isNull()) {
     m_id.clear();
+    m_data.clear();
   }
 }
 
@@ -74,6 +97,9 @@ Image::~Image() {
 }
 
 QByteArray Image::byteArray() const {
+  if(!m_data.isEmpty()) {
+    return m_data;
+  }
   return byteArray(*this, outputFormat(m_format));
 }
 
@@ -126,6 +152,14 @@ QString Image::idClean(const QString& id_) {
   return Tellico::shareString(clean.remove(rx));
 }
 
+void Image::setFormat(const QByteArray& format_) {
+  // the original data is only useful if it is in the same format
+  if(qstricmp(format_.constData(), m_format.constData()) != 0) {
+    m_data.clear();
+  }
+  m_format = format_;
+}
+
 void Image::setID(const QString& id_) {
   // don't clean the id if we're linking only
   m_id = m_linkOnly ? id_ : idClean(id_);
@@ -134,7 +168,11 @@ void Image::setID(const QString& id_) {
 void Image::calculateID() {
   // the id will eventually be used as a filename
   if(!isNull()) {
-    m_id = calculateID(byteArray(), QLatin1String(m_format));
+    // an image created from pixels is encoded once, and the data kept for writing later
+    if(m_data.isEmpty()) {
+      m_data = byteArray(*this, outputFormat(m_format));
+    }
+    m_id = calculateID(m_data, QLatin1String(m_format));
   }
 }
 
@@ -55,7 +55,15 @@ public:
 
   const QString& id() const { return m_id; };
   const QByteArray& format() const { return m_format; };
+  /**
+   * Returns the encoded image data, which is the original data when the image was read
+   * from a file or from memory, so the image is only encoded when necessary.
+   */
   QByteArray byteArray() const;
+  /**
+   * Returns the original encoded data, or an empty array if the image has none
+   */
+  const QByteArray& rawData() const { return m_data; }
   bool isNull() const;
   bool linkOnly() const { return m_linkOnly; }
   void setLinkOnly(bool l) { m_linkOnly = l; }
@@ -77,11 +85,13 @@ private:
   Image(const QByteArray& data, const QString& format, const QString& id);
 
   void setID(const QString& id);
-  void setFormat(const QByteArray& format_) { m_format = format_; }
+  void setFormat(const QByteArray& format);
   void calculateID();
 
   QString m_id;
   QByteArray m_format;
+  // the encoded data, in m_format
+  QByteArray m_data;
   bool m_linkOnly : 1;
 
   static QList<QByteArray> s_outputFormats;
@@ -31,14 +31,27 @@
 
 #include <QFile>
 #include <QDir>
+#include <QFileInfo>
 #include <QUrl>
 #include <QTemporaryDir>
+#include <QSaveFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QDateTime>
+
+#include <algorithm>
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0) && defined(Q_OS_UNIX)
+#include <utime.h>
+#endif
 
 using namespace Tellico;
 using Tellico::ImageStorage;
 using Tellico::ImageDirectory;
 using Tellico::TemporaryImageDirectory;
 using Tellico::ImageZipArchive;
+using Tellico::ThumbnailDirectory;
 
 ImageDirectory::ImageDirectory() : ImageStorage(), m_pathExists(false), m_dir(nullptr) {
 }
@@ -180,6 +193,44 @@ bool ImageZipArchive::hasImage(const QString& id_) {
   return m_images.has(id_);
 }
 
+QByteArray ImageZipArchive::imageData(const QString& id_) {
+  if(!hasImage(id_)) {
+    return QByteArray();
+  }
+  const KArchiveEntry* file = m_imgDir->entry(id_);
+  if(!file || !file->isFile()) {
+    return QByteArray();
+  }
+  return static_cast<const KArchiveFile*>(file)->data();
+}
+
+QByteArray ImageZipArchive::imageData(const QString& id_, qint64 maxSize_) {
+  if(!hasImage(id_)) {
+    return QByteArray();
+  }
+  const KArchiveEntry* file = m_imgDir->entry(id_);
+  if(!file || !file->isFile()) {
+    return QByteArray();
+  }
+  // the device decompresses as it is read, rather than all at once
+  QIODevice* device = static_cast<const KArchiveFile*>(file)->createDevice();
+  if(!device) {
+    return QByteArray();
+  }
+  const QByteArray data = device->read(maxSize_);
+  delete device;
+  return data;
+}
+
+void ImageZipArchive::releaseImage(const QString& id_) {
+  m_images.remove(id_);
+  if(m_images.isEmpty()) {
+    delete m_zip;
+    m_zip = nullptr;
+    m_imgDir = nullptr;
+  }
+}
+
 Tellico::Data::Image* ImageZipArchive::imageById(const QString& id_) {
   if(!hasImage(id_)) {
     return nullptr;
@@ -192,12 +243,7 @@ Tellico::Data::Image* ImageZipArchive::imageById(const QString& id_) {
   }
   // might be unexpected behavior, but in order to delete the zip object after
   // all images are read, we need to consider the image gone now
-  m_images.remove(id_);
-  if(m_images.isEmpty()) {
-    delete m_zip;
-    m_zip = nullptr;
-    m_imgDir = nullptr;
-  }
+  releaseImage(id_);
   if(!img) {
     myLog() << "image not found:" << id_;
     return nullptr;
@@ -209,3 +255,124 @@ Tellico::Data::Image* ImageZipArchive::imageById(const QString& id_) {
   }
   return img;
 }
+
+namespace {
+  bool newerThan(const QFileInfo& info1_, const QFileInfo& info2_) {
+    return info1_.lastModified() > info2_.lastModified();
+  }
+}
+
+ThumbnailDirectory::ThumbnailDirectory() {
+}
+
+ThumbnailDirectory::ThumbnailDirectory(const QString& path_) {
+  setPath(path_);
+}
+
+void ThumbnailDirectory::setPath(const QString& path_) {
+  m_path = path_;
+  if(!m_path.isEmpty() && !m_path.endsWith(QLatin1Char('/'))) {
+    m_path += QLatin1Char('/');
+  }
+}
+
+QString ThumbnailDirectory::filePath(const QString& id_, const QSize& size_) const {
+  return m_path + fileStem(id_) + QLatin1Char('/') + QString::number(size_.width())
+                + QLatin1Char('x') + QString::number(size_.height()) + QLatin1String(".png");
+}
+
+bool ThumbnailDirectory::hasThumbnail(const QString& id_, const QSize& size_) const {
+  return !m_path.isEmpty() && QFile::exists(filePath(id_, size_));
+}
+
+QImage ThumbnailDirectory::thumbnail(const QString& id_, const QSize& size_) const {
+  if(!hasThumbnail(id_, size_)) {
+    return QImage();
+  }
+  const QString path = filePath(id_, size_);
+  const QImage img(path, "PNG");
+  if(!img.isNull()) {
+    touch(path);
+  }
+  return img;
+}
+
+bool ThumbnailDirectory::writeThumbnail(const QString& id_, const QSize& size_, const QImage& image_) const {
+  if(m_path.isEmpty() || image_.isNull()) {
+    return false;
+  }
+  const QString dirPath = m_path + fileStem(id_);
+  QDir dir(dirPath);
+  if(!dir.exists() && !dir.mkpath(dirPath)) {
+    myWarning() << "unable to create dir:" << dirPath;
+    return false;
+  }
+  // QSaveFile writes to a temporary file and renames it on commit
+  QSaveFile file(filePath(id_, size_));
+  if(!file.open(QIODevice::WriteOnly)) {
+    myDebug() << "unable to open thumbnail file:" << file.fileName();
+    return false;
+  }
+  QImageWriter writer(&file, "PNG");
+  if(!writer.write(image_)) {
+    myDebug() << writer.errorString();
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+void ThumbnailDirectory::removeThumbnails(const QString& id_) const {
+  if(m_path.isEmpty()) {
+    return;
+  }
+  // every size is in the image's own directory
+  QDir(m_path + fileStem(id_)).removeRecursively();
+}
+
+int ThumbnailDirectory::collectGarbage(qint64 maxSize_) const {
+  if(m_path.isEmpty()) {
+    return 0;
+  }
+  QFileInfoList files;
+  QDirIterator it(m_path, QStringList() << QLatin1String("*.png"), QDir::Files, QDirIterator::Subdirectories);
+  while(it.hasNext()) {
+    it.next();
+    files << it.fileInfo();
+  }
+  // a thumbnail is touched whenever it is read, so the least recently used ones go first
+  std::sort(files.begin(), files.end(), newerThan);
+  QDir dir(m_path);
+  qint64 totalSize = 0;
+  int count = 0;
+  foreach(const QFileInfo& info, files) {
+    totalSize += info.size();
+    if(totalSize > maxSize_ && QFile::remove(info.absoluteFilePath())) {
+      ++count;
+      // only succeeds once the last size of the image is gone
+      dir.rmdir(info.absolutePath());
+    }
+  }
+  if(count > 0) {
+    myLog() << "removed" << count << "thumbnails from" << m_path;
+  }
+  return count;
+}
+
+void ThumbnailDirectory::touch(const QString& filePath_) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+  QFile file(filePath_);
+  if(file.open(QIODevice::ReadWrite)) {
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+  }
+#elif defined(Q_OS_UNIX)
+  ::utime(QFile::encodeName(filePath_).constData(), nullptr);
+#else
+  Q_UNUSED(filePath_);
+#endif
+}
+
+QString ThumbnailDirectory::fileStem(const QString& id_) {
+  // image ids may be urls, so hash them for a safe file name
+  return QString::fromLatin1(QCryptographicHash::hash(id_.toUtf8(), QCryptographicHash::Md5).toHex());
+}
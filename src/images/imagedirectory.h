@@ -28,8 +28,10 @@
 #include "../utils/stringset.h"
 
 #include <QString>
+#include <QSize>
 
 class QTemporaryDir;
+class QImage;
 
 class KZip;
 class KArchiveDirectory;
@@ -92,6 +94,12 @@ public:
 
   bool hasImage(const QString& id) Q_DECL_OVERRIDE;
   Data::Image* imageById(const QString& id) Q_DECL_OVERRIDE;
+  // returns the encoded image data, leaving the image in the archive
+  QByteArray imageData(const QString& id);
+  // returns no more than the first maxSize bytes of the image data, without decompressing the rest
+  QByteArray imageData(const QString& id, qint64 maxSize);
+  // the image has been read from the archive, which is closed once all are read
+  void releaseImage(const QString& id);
 
 private:
   KZip* m_zip;
@@ -99,5 +107,47 @@ private:
   StringSet m_images;
 };
 
+/**
+ * Thumbnails are kept in a directory next to the data image directory, with a subdirectory
+ * for each image id and a file for each thumbnail size, so that they last between sessions.
+ * Only the path is kept, so a copy can be used from a worker thread.
+ */
+class ThumbnailDirectory {
+public:
+  ThumbnailDirectory();
+  explicit ThumbnailDirectory(const QString& path);
+
+  QString path() const { return m_path; }
+  void setPath(const QString& path);
+
+  QString filePath(const QString& id, const QSize& size) const;
+  bool hasThumbnail(const QString& id, const QSize& size) const;
+  /**
+   * Returns the saved thumbnail, or a null image if there is none. Reading a thumbnail
+   * updates its modification time, which is what @ref collectGarbage goes by.
+   */
+  QImage thumbnail(const QString& id, const QSize& size) const;
+  /**
+   * Saves a thumbnail. The file is written atomically, so a reader never sees a partial file.
+   */
+  bool writeThumbnail(const QString& id, const QSize& size, const QImage& image) const;
+  /**
+   * Removes the thumbnails of every size for an image
+   */
+  void removeThumbnails(const QString& id) const;
+  /**
+   * Removes the least recently used thumbnails until the total size of the directory is no more than @p maxSize
+   *
+   * @return The number of thumbnails removed
+   */
+  int collectGarbage(qint64 maxSize) const;
+
+private:
+  static void touch(const QString& filePath);
+  static QString fileStem(const QString& id);
+
+  QString m_path;
+};
+
 } // end namespace
 #endif
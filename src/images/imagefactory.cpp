@@ -38,38 +38,186 @@
 #include <QCache>
 #include <QFileInfo>
 #include <QDir>
+#include <QTimer>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+#include <QRunnable>
 #ifdef HAVE_QIMAGEBLITZ
 #include <qimageblitz.h>
 #endif
 
-#define RELEASE_IMAGES
+namespace {
+  // the most images downloaded at once from a single host
+  static const int IMAGE_MAX_JOBS_PER_HOST = 4;
+  // the most evicted images kept alive for references returned by imageById()
+  static const int IMAGE_MAX_RETIRED = 8;
+  // the most read from an image in a zip file to find its size, which allows for
+  // a jpeg with a full EXIF segment, including its thumbnail, before the frame header
+  static const qint64 IMAGE_HEADER_MAX_SIZE = 128 * 1024;
+
+  // encoding and saving a thumbnail is slow enough to do outside the GUI thread
+  class ThumbnailWriter : public QRunnable {
+  public:
+    ThumbnailWriter(const Tellico::ThumbnailDirectory& dir_, const QString& id_,
+                    const QSize& size_, const QImage& thumb_)
+        : QRunnable(), m_dir(dir_), m_id(id_), m_size(size_), m_thumb(thumb_) {}
+
+    void run() Q_DECL_OVERRIDE {
+      if(!m_dir.writeThumbnail(m_id, m_size, m_thumb)) {
+        myDebug() << "unable to save thumbnail:" << m_dir.filePath(m_id, m_size);
+      }
+    }
+
+  private:
+    Tellico::ThumbnailDirectory m_dir;
+    QString m_id;
+    QSize m_size;
+    QImage m_thumb;
+  };
+}
 
 using Tellico::ImageFactory;
 
 // this image info map is primarily for big images that don't fit
 // in the cache, so that don't have to be continually reloaded to get info
 QHash<QString, Tellico::Data::ImageInfo> ImageFactory::s_imageInfoMap;
-Tellico::StringSet ImageFactory::s_imagesToRelease;
 
 Tellico::ImageFactory* ImageFactory::factory = nullptr;
 
 class ImageFactory::Private {
 public:
-  // since most images get turned into pixmaps quickly, use 10 megs
-  // for images and 10 megs for pixmaps
-  Private() {}
-
+  // the caches delete their objects when evicted, but a caller may still be holding the reference
+  // returned by imageById(), so the image itself is only deleted once the event loop runs again,
+  // or once a few more images have been evicted after it
+  class CachedImage {
+  public:
+    CachedImage(Private* d_, Data::Image* image_) : d(d_), image(image_) {}
+    ~CachedImage() { d->retireImage(image); }
+
+    Private* d;
+    Data::Image* image;
+  };
+
+  Private(ImageFactory* q_) : q(q_), dictCost(0), pixelBudget(0), clearing(false) {}
+  ~Private();
+
+  void setBudget(int budget);
+  void addToDict(Data::Image* img);
+  Data::Image* takeFromDict(const QString& id);
+  bool insertInCache(Data::Image* img);
+  void retireImage(Data::Image* img);
+  void clearCaches();
+
+  ImageFactory* q;
+  // images that are not stored anywhere else, which can never be evicted
   QHash<QString, Data::Image*> imageDict;
-  QCache<QString, Data::Image> imageCache;
+  int dictCost;
+  int pixelBudget;
+  // encoded data of images recently evicted from the image cache, so they don't have to be read again
+  QCache<QString, QByteArray> dataCache;
+  QList<Data::Image*> retiredImages;
+  bool clearing;
+  // the decoded images, declared after the retired list since deleting them adds to it
+  QCache<QString, CachedImage> imageCache;
   QCache<QString, QPixmap> pixmapCache;
+  CacheStatistics stats;
+
+  class ImageRequest {
+  public:
+    QUrl url;
+    QUrl referrer;
+    bool quiet;
+    bool linkOnly;
+  };
+  // requests waiting for a free download slot, and the number of downloads running for each host
+  QList<ImageRequest> queuedRequests;
+  QHash<QString, int> hostJobs;
+  // urls being downloaded or waiting to be
+  QSet<QUrl> pendingUrls;
   ImageDirectory dataImageDir; // kept in $HOME/.local/share/tellico/data/
   ImageDirectory localImageDir; // kept local to data file
   TemporaryImageDirectory tempImageDir; // kept in tmp directory
   ImageZipArchive imageZipArchive;
+  ThumbnailDirectory thumbnailDir; // kept in $HOME/.local/share/tellico/thumbnails/
+  // saves the thumbnails created by scaledImage()
+  QThreadPool thumbnailPool;
   StringSet nullImages;
 };
 
-ImageFactory::ImageFactory() : QObject(), d(new Private()) {
+ImageFactory::Private::~Private() {
+  thumbnailPool.waitForDone();
+  clearCaches();
+  qDeleteAll(retiredImages);
+}
+
+// the budget is shared by the tiers: half for the decoded images, including the ones held in the dict,
+// a quarter for the pixmaps and a quarter for the encoded data
+void ImageFactory::Private::setBudget(int budget_) {
+  pixelBudget = budget_ / 2;
+  imageCache.setMaxCost(qMax(0, pixelBudget - dictCost));
+  pixmapCache.setMaxCost(budget_ / 4);
+  dataCache.setMaxCost(budget_ / 4);
+}
+
+// the images are only kept in the dict until they take more than half the space for decoded images.
+// Then they are written to the temporary directory, and go in the cache like any other image
+void ImageFactory::Private::addToDict(Data::Image* img_) {
+  imageDict.insert(img_->id(), img_);
+  dictCost += imageCost(*img_);
+  imageCache.setMaxCost(qMax(0, pixelBudget - dictCost));
+  if(dictCost <= pixelBudget / 2) {
+    return;
+  }
+  foreach(Data::Image* img, imageDict) {
+    // link only images are not written locally, they get loaded again from the url
+    if(!img->linkOnly()) {
+      ImageFactory::writeCachedImage(img->id(), TempDir);
+    }
+  }
+}
+
+Tellico::Data::Image* ImageFactory::Private::takeFromDict(const QString& id_) {
+  Data::Image* img = imageDict.take(id_);
+  if(img) {
+    dictCost -= imageCost(*img);
+    imageCache.setMaxCost(qMax(0, pixelBudget - dictCost));
+  }
+  return img;
+}
+
+// if the image is too big for the cache, it gets retired right away, but
+// the reference is still good until the event loop runs or a few more images are retired
+bool ImageFactory::Private::insertInCache(Data::Image* img_) {
+  return imageCache.insert(img_->id(), new CachedImage(this, img_), imageCost(*img_));
+}
+
+void ImageFactory::Private::retireImage(Data::Image* img_) {
+  if(!img_) {
+    return;
+  }
+  if(!clearing && !img_->rawData().isEmpty() && !dataCache.contains(img_->id())) {
+    dataCache.insert(img_->id(), new QByteArray(img_->rawData()), img_->rawData().size());
+  }
+  if(retiredImages.isEmpty()) {
+    QTimer::singleShot(0, q, SLOT(slotDeleteRetiredImages()));
+  }
+  retiredImages.append(img_);
+  // a loop which never returns to the event loop, like exporting every image, would otherwise keep them all
+  while(retiredImages.count() > IMAGE_MAX_RETIRED) {
+    delete retiredImages.takeFirst();
+  }
+}
+
+void ImageFactory::Private::clearCaches() {
+  clearing = true;
+  imageCache.clear();
+  pixmapCache.clear();
+  dataCache.clear();
+  clearing = false;
+}
+
+ImageFactory::ImageFactory() : QObject(), d(new Private(this)) {
 }
 
 ImageFactory::~ImageFactory() {
@@ -81,9 +229,11 @@ void ImageFactory::init() {
     return;
   }
   factory = new ImageFactory();
-  factory->d->imageCache.setMaxCost(Config::imageCacheSize());
-  factory->d->pixmapCache.setMaxCost(Config::imageCacheSize());
+  factory->d->setBudget(Config::imageCacheSize());
   factory->d->dataImageDir.setPath(Tellico::saveLocation(QLatin1String("data/")));
+  factory->d->thumbnailDir.setPath(Tellico::saveLocation(QLatin1String("thumbnails/")));
+  // one thread is enough, saving is not urgent
+  factory->d->thumbnailPool.setMaxThreadCount(1);
 }
 
 Tellico::ImageFactory* ImageFactory::self() {
@@ -152,8 +302,8 @@ const Tellico::Data::Image& ImageFactory::addImageImpl(const QUrl& url_, bool qu
 
   // hold the image in memory since it probably isn't written locally to disk yet
   if(!d->imageDict.contains(img.id())) {
-    d->imageDict.insert(img.id(), new Data::Image(img));
     s_imageInfoMap.insert(img.id(), Data::ImageInfo(img));
+    d->addToDict(new Data::Image(img));
   }
   return img;
 }
@@ -181,8 +331,8 @@ const Tellico::Data::Image& ImageFactory::addImageImpl(const QImage& image_, con
     delete img;
     return Data::Image::null;
   }
-  d->imageDict.insert(img->id(), img);
   s_imageInfoMap.insert(img->id(), Data::ImageInfo(*img));
+  d->addToDict(img);
   return *img;
 }
 
@@ -198,13 +348,13 @@ const Tellico::Data::Image& ImageFactory::addImageImpl(const QByteArray& data_,
   }
 
   // do not call imageById(), it causes infinite looping with Document::loadImage()
-  Data::Image* img = d->imageCache.object(id_);
-  if(img) {
+  Private::CachedImage* cached = d->imageCache.object(id_);
+  if(cached) {
     myLog() << "already exists in cache: " << id_;
-    return *img;
+    return *cached->image;
   }
 
-  img = d->imageDict.value(id_);
+  Data::Image* img = d->imageDict.value(id_);
   if(img) {
     myLog() << "already exists in dict: " << id_;
     return *img;
@@ -220,8 +370,8 @@ const Tellico::Data::Image& ImageFactory::addImageImpl(const QByteArray& data_,
 //  myLog() << "//          << " bytes, format = " << format_
 //          << ", id = "<< img->id();
 
-  d->imageDict.insert(img->id(), img);
   s_imageInfoMap.insert(img->id(), Data::ImageInfo(*img));
+  d->addToDict(img);
   return *img;
 }
 
@@ -249,24 +399,9 @@ const Tellico::Data::Image& ImageFactory::addCachedImageImpl(const QString& id_,
 
   s_imageInfoMap.insert(img->id(), Data::ImageInfo(*img));
 
-  // if byteCount() is greater than maxCost, then trying and failing to insert it would
-  // mean the image gets deleted
-  if(img->byteCount() > d->imageCache.maxCost()) {
-    // can't hold it in the cache
-    myWarning() << "Image cache is unable to hold the image, it's too big!";
-    myWarning() << "Image name is " << img->id();
-    myWarning() << "Image size is " << img->byteCount();
-    myWarning() << "Max cache size is " << d->imageCache.maxCost();
-
-    // add it back to the dict, but add the image to the list of
-    // images to release later. Necessary to avoid a memory leak since new Image()
-    // was called, we need to keep the pointer
-    d->imageDict.insert(img->id(), img);
-    s_imagesToRelease.add(img->id());
-  } else if(!d->imageCache.insert(img->id(), img, img->byteCount())) {
-    // at this point, img has been deleted!
-    myWarning() << "Unable to insert into image cache";
-    return Data::Image::null;
+  if(!d->insertInCache(img)) {
+    // the image is too big for the cache, but it isn't deleted until the event loop runs
+    myLog() << "Image cache is unable to hold the image, it's too big:" << img->id() << imageCost(*img);
   }
   return *img;
 }
@@ -285,13 +420,10 @@ bool ImageFactory::writeCachedImage(const QString& id_, CacheDir dir_, bool forc
   if(success) {
     // remove from dict and add to cache
     // it might not be in dict though
-    if(factory->d->imageDict.contains(id_)) {
-      Data::Image* img = factory->d->imageDict.take(id_);
-      Q_ASSERT(img);
-      // imageCache.insert will delete the image by itself if the cost exceeds the cache size
-      if(factory->d->imageCache.insert(img->id(), img, img->byteCount())) {
-        s_imageInfoMap.remove(id_);
-      }
+    Data::Image* img = factory->d->takeFromDict(id_);
+    // the cache retires the image by itself if the cost exceeds the cache size
+    if(img && factory->d->insertInCache(img)) {
+      s_imageInfoMap.remove(id_);
     }
   }
   return success;
@@ -322,25 +454,38 @@ const Tellico::Data::Image& ImageFactory::imageById(const QString& id_) {
   }
 //  myLog() << "imageById" << id_;
 
-  // can't think of a better place to regularly check for images to release
-  // but don't release image that just got asked for
-  s_imagesToRelease.remove(id_);
-  factory->releaseImages();
-
- // first check the cache, used for images that are in the data file, or are only temporary
- // then the dict, used for images downloaded, but not yet saved anywhere
-  Data::Image* img = factory->d->imageCache.object(id_);
-  if(img) {
+  // first check the cache, used for images that are in the data file, or are only temporary
+  // then the dict, used for images downloaded, but not yet saved anywhere
+  Private::CachedImage* cached = factory->d->imageCache.object(id_);
+  if(cached) {
 //    myLog() << "found in cache";
-    return *img;
+    ++factory->d->stats.imageHits;
+    return *cached->image;
   }
 
-  img = factory->d->imageDict.value(id_);
+  Data::Image* img = factory->d->imageDict.value(id_);
   if(img) {
 //    myLog() << "found in dict";
+    ++factory->d->stats.imageHits;
     return *img;
   }
 
+  // an image evicted from the cache may still have its data in memory, so decode it again from there
+  QByteArray* data = factory->d->dataCache.object(id_);
+  if(data) {
+    const QByteArray format = s_imageInfoMap.contains(id_) ? s_imageInfoMap[id_].format
+                                                           : id_.section(QLatin1Char('.'), -1).toUpper().toLatin1();
+    img = new Data::Image(*data, QLatin1String(format), id_);
+    if(!img->isNull()) {
+      ++factory->d->stats.dataHits;
+      factory->d->insertInCache(img);
+      return *img;
+    }
+    delete img;
+    factory->d->dataCache.remove(id_);
+  }
+  ++factory->d->stats.imageMisses;
+
   // if the image is link only, we need to load it
   // but can't call imageInfo() since that might recurse into imageById()
   // also, the image info cache might not have it so check if the
@@ -349,7 +494,24 @@ const Tellico::Data::Image& ImageFactory::imageById(const QString& id_) {
   if((s_imageInfoMap.contains(id_) && s_imageInfoMap[id_].linkOnly) || !QUrl(id_).isRelative()) {
     QUrl u(id_);
     if(u.isValid()) {
-      return factory->addImageImpl(u, true, QUrl(), true);
+      // a local file is read right away, the same as an image in one of the image directories
+      if(u.isLocalFile() && !factory->d->pendingUrls.contains(u)) {
+        img = new Data::Image(u.toLocalFile(), id_);
+        if(img->isNull()) {
+          delete img;
+          factory->d->nullImages.add(id_);
+          return Data::Image::null;
+        }
+        img->setLinkOnly(true);
+        img->setID(id_);
+        s_imageInfoMap.insert(id_, Data::ImageInfo(*img));
+        factory->d->addToDict(img);
+        return *img;
+      }
+      // anything else is downloaded in the background, without waiting for it.
+      // The imageAvailable() signal gets emitted once it's done
+      factory->requestImageByUrlImpl(u, true /* quiet */, QUrl() /* referrer */, true /* link only */);
+      return Data::Image::null;
     }
   }
 
@@ -498,12 +660,84 @@ void ImageFactory::requestImageById(const QString& id_) {
   }
 }
 
+QString ImageFactory::imageFilePath(const QString& id_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  if(id_.isEmpty() || !factory || factory->d->nullImages.contains(id_)) {
+    return QString();
+  }
+  const QUrl u(id_);
+  if(u.isValid() && !u.isRelative() && u.isLocalFile()) {
+    return u.toLocalFile();
+  }
+  if(factory->d->tempImageDir.hasImage(id_)) {
+    return factory->d->tempImageDir.path() + id_;
+  }
+  if(Config::imageLocation() == Config::ImagesInLocalDir && factory->d->localImageDir.hasImage(id_)) {
+    return factory->d->localImageDir.path() + id_;
+  }
+  if(Config::imageLocation() == Config::ImagesInAppDir && factory->d->dataImageDir.hasImage(id_)) {
+    return factory->d->dataImageDir.path() + id_;
+  }
+  return QString();
+}
+
+QByteArray ImageFactory::zipImageData(const QString& id_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  if(id_.isEmpty() || !factory) {
+    return QByteArray();
+  }
+  return factory->d->imageZipArchive.imageData(id_);
+}
+
+void ImageFactory::zipImageExtracted(const Data::ImageInfo& info_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  if(info_.id.isEmpty() || !factory) {
+    return;
+  }
+  s_imageInfoMap.insert(info_.id, info_);
+  factory->d->imageZipArchive.releaseImage(info_.id);
+}
+
+void ImageFactory::requestImage(const QUrl& url_, bool quiet_, const QUrl& refer_, bool link_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  if(url_.isEmpty() || !url_.isValid() || factory->d->nullImages.contains(url_.url())) {
+    emit factory->imageAdded(url_, QString());
+    return;
+  }
+  factory->requestImageByUrlImpl(url_, quiet_, refer_, link_);
+}
+
 void ImageFactory::requestImageByUrlImpl(const QUrl& url_, bool quiet_, const QUrl& refer_, bool link_) {
-  ImageJob* job = new ImageJob(url_, QString() /* id, use calculated one */, quiet_);
-  job->setLinkOnly(link_);
-  job->setReferrer(refer_);
-  connect(job, &ImageJob::result,
-          this, &ImageFactory::slotImageJobResult);
+  // the image is only downloaded once, no matter how many times it gets requested
+  if(d->pendingUrls.contains(url_)) {
+    return;
+  }
+  d->pendingUrls.insert(url_);
+  Private::ImageRequest request;
+  request.url = url_;
+  request.referrer = refer_;
+  request.quiet = quiet_;
+  request.linkOnly = link_;
+  d->queuedRequests.append(request);
+  startImageJobs();
+}
+
+void ImageFactory::startImageJobs() {
+  QMutableListIterator<Private::ImageRequest> it(d->queuedRequests);
+  while(it.hasNext()) {
+    const Private::ImageRequest& request = it.next();
+    const QString host = request.url.host();
+    if(d->hostJobs.value(host) >= IMAGE_MAX_JOBS_PER_HOST) {
+      continue;
+    }
+    ++d->hostJobs[host];
+    ImageJob* job = new ImageJob(request.url, QString() /* id, use calculated one */, request.quiet);
+    job->setLinkOnly(request.linkOnly);
+    job->setReferrer(request.referrer);
+    connect(job, &ImageJob::result,
+            this, &ImageFactory::slotImageJobResult);
+    it.remove();
+  }
 }
 
 Tellico::Data::ImageInfo ImageFactory::imageInfo(const QString& id_) {
@@ -511,6 +745,11 @@ Tellico::Data::ImageInfo ImageFactory::imageInfo(const QString& id_) {
     return s_imageInfoMap[id_];
   }
 
+  const Data::ImageInfo info = probeImageInfo(id_);
+  if(!info.isNull()) {
+    return info;
+  }
+
   const Data::Image& img = imageById(id_);
   if(img.isNull()) {
     return Data::ImageInfo();
@@ -518,6 +757,40 @@ Tellico::Data::ImageInfo ImageFactory::imageInfo(const QString& id_) {
   return Data::ImageInfo(img);
 }
 
+Tellico::Data::ImageInfo ImageFactory::probeImageInfo(const QString& id_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  if(id_.isEmpty() || !factory) {
+    return Data::ImageInfo();
+  }
+  // an image already in memory is quicker to ask than any file
+  if(factory->hasImageInMemory(id_)) {
+    const Data::Image& img = imageById(id_);
+    if(!img.isNull()) {
+      return Data::ImageInfo(img);
+    }
+  }
+
+  QByteArray format;
+  QSize size;
+  bool found = false;
+  const QString path = imageFilePath(id_);
+  if(!path.isEmpty()) {
+    found = Data::ImageInfo::readFileHeader(path, format, size);
+  }
+  if(!found) {
+    const QByteArray data = factory->d->imageZipArchive.imageData(id_, IMAGE_HEADER_MAX_SIZE);
+    found = !data.isEmpty() && Data::ImageInfo::readHeader(data, format, size);
+  }
+  if(!found) {
+    return Data::ImageInfo();
+  }
+
+  const bool linkOnly = (s_imageInfoMap.contains(id_) && s_imageInfoMap[id_].linkOnly);
+  const Data::ImageInfo info(id_, format, size.width(), size.height(), linkOnly);
+  s_imageInfoMap.insert(id_, info);
+  return info;
+}
+
 void ImageFactory::cacheImageInfo(const Tellico::Data::ImageInfo& info) {
   s_imageInfoMap.insert(info.id, info);
 }
@@ -539,17 +812,22 @@ QPixmap ImageFactory::pixmap(const QString& id_, int width_, int height_) {
   const QString key = id_ + QLatin1Char('|') + QString::number(width_) + QLatin1Char('|') + QString::number(height_);
   QPixmap* pix = factory->d->pixmapCache.object(key);
   if(pix) {
+    ++factory->d->stats.pixmapHits;
     return *pix;
   }
-
-  const Data::Image& img = imageById(id_);
-  if(img.isNull()) {
-    return QPixmap();
-  }
+  ++factory->d->stats.pixmapMisses;
 
   if(width_ > 0 && height_ > 0) {
-    pix = new QPixmap(img.convertToPixmap(width_, height_));
+    const QImage img = scaledImage(id_, width_, height_);
+    if(img.isNull()) {
+      return QPixmap();
+    }
+    pix = new QPixmap(QPixmap::fromImage(img));
   } else {
+    const Data::Image& img = imageById(id_);
+    if(img.isNull()) {
+      return QPixmap();
+    }
     pix = new QPixmap(img.convertToPixmap());
   }
 
@@ -566,16 +844,47 @@ QPixmap ImageFactory::pixmap(const QString& id_, int width_, int height_) {
   return *pix;
 }
 
+QImage ImageFactory::scaledImage(const QString& id_, int width_, int height_) {
+  if(id_.isEmpty() || width_ < 1 || height_ < 1) {
+    return QImage();
+  }
+  const QSize size(width_, height_);
+  // a saved thumbnail avoids loading the full image at all
+  QImage thumb = factory->d->thumbnailDir.thumbnail(id_, size);
+  if(!thumb.isNull()) {
+    return thumb;
+  }
+
+  const Data::Image& img = imageById(id_);
+  if(img.isNull()) {
+    return QImage();
+  }
+  // only worth saving if the image actually gets scaled down
+  if(width_ < img.width() || height_ < img.height()) {
+    thumb = img.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    factory->d->thumbnailPool.start(new ThumbnailWriter(factory->d->thumbnailDir, id_, size, thumb));
+    return thumb;
+  }
+  return img;
+}
+
+Tellico::ThumbnailDirectory ImageFactory::thumbnailDirectory() {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  return factory->d->thumbnailDir;
+}
+
 void ImageFactory::clean(bool purgeTempDirectory_) {
   // the caches all auto-delete
-  s_imagesToRelease.clear();
   qDeleteAll(factory->d->imageDict);
   factory->d->imageDict.clear();
+  factory->d->dictCost = 0;
+  factory->d->imageCache.setMaxCost(factory->d->pixelBudget);
   s_imageInfoMap.clear();
-  factory->d->imageCache.clear();
-  factory->d->pixmapCache.clear();
+  factory->d->clearCaches();
   if(purgeTempDirectory_) {
     factory->d->tempImageDir.purge();
+    // keep the thumbnail directory from growing without bound
+    factory->d->thumbnailDir.collectGarbage(Config::thumbnailCacheSize());
     // just to make sure all the image locations clean themselves up
     // delete the factory (which deletes the storage objects) and
     // then recreate the factory, in case anything else needs it
@@ -639,14 +948,19 @@ void ImageFactory::createStyleImages(int collectionType_, const Tellico::StyleOp
 
 void ImageFactory::removeImage(const QString& id_, bool deleteImage_) {
   // be careful using this
-  delete factory->d->imageDict.take(id_);
+  factory->d->retireImage(factory->d->takeFromDict(id_));
   factory->d->imageCache.remove(id_);
+  // the image might be replaced by different data with the same id
+  factory->d->dataCache.remove(id_);
 
   if(deleteImage_) {
     // remove from everywhere
     factory->d->dataImageDir.removeImage(id_);
     factory->d->localImageDir.removeImage(id_);
     factory->d->tempImageDir.removeImage(id_);
+    // a thumbnail still being saved would otherwise be left behind
+    factory->d->thumbnailPool.waitForDone();
+    factory->d->thumbnailDir.removeThumbnails(id_);
   }
 }
 
@@ -669,27 +983,30 @@ bool ImageFactory::hasNullImage(const QString& id_) const {
   return d->nullImages.contains(id_);
 }
 
-// the purpose here is to remove images from the dict if they're is on the disk somewhere,
-// either in tempDir() or in dataDir(). The use for this is for calling pixmap() on an
-// image too big to stay in the cache. Then it stays in the dict forever.
-void ImageFactory::releaseImages() {
-#ifdef RELEASE_IMAGES
-  if(s_imagesToRelease.isEmpty()) {
-    return;
+Tellico::CacheStatistics ImageFactory::cacheStatistics() {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  CacheStatistics stats = factory->d->stats;
+  stats.imageCost = factory->d->imageCache.totalCost() + factory->d->dictCost;
+  stats.pixmapCost = factory->d->pixmapCache.totalCost();
+  stats.dataCost = factory->d->dataCache.totalCost();
+  foreach(const Data::Image* img, factory->d->retiredImages) {
+    stats.retiredCost += imageCost(*img);
   }
+  return stats;
+}
 
-  foreach(const QString& id, s_imagesToRelease) {
-    if(!d->imageDict.contains(id)) {
-      continue;
-    }
-    if(d->dataImageDir.hasImage(id) ||
-       d->localImageDir.hasImage(id) ||
-       d->tempImageDir.hasImage(id)) {
-      delete d->imageDict.take(id);
-    }
-  }
-  s_imagesToRelease.clear();
-#endif
+void ImageFactory::resetCacheStatistics() {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  factory->d->stats = CacheStatistics();
+}
+
+void ImageFactory::setCacheSize(int size_) {
+  Q_ASSERT(factory && "ImageFactory is not initialized!");
+  factory->d->setBudget(size_);
+}
+
+int ImageFactory::imageCost(const Data::Image& img_) {
+  return img_.byteCount() + img_.rawData().size();
 }
 
 void ImageFactory::emitImageMismatch() {
@@ -735,20 +1052,31 @@ void ImageFactory::slotImageJobResult(KJob* job_) {
     myWarning() << "No image job";
     return;
   }
+  const QUrl url = imageJob->url();
+  d->pendingUrls.remove(url);
+  if(--d->hostJobs[url.host()] < 1) {
+    d->hostJobs.remove(url.host());
+  }
+  startImageJobs();
+
   const Data::Image& img = imageJob->image();
   if(img.isNull()) {
-     myDebug() << "null image for" << imageJob->url();
-     d->nullImages.add(imageJob->url().url());
-     // don't emit anything
+     myDebug() << "null image for" << url;
+     d->nullImages.add(url.url());
+     emit factory->imageAdded(url, QString());
      return;
   }
 
   // hold the image in memory since it probably isn't written locally to disk yet
   if(!d->imageDict.contains(img.id())) {
-    d->imageDict.insert(img.id(), new Data::Image(img));
     s_imageInfoMap.insert(img.id(), Data::ImageInfo(img));
+    d->addToDict(new Data::Image(img));
   }
   emit factory->imageAvailable(img.id());
+  emit factory->imageAdded(url, img.id());
 }
 
-#undef RELEASE_IMAGES
+void ImageFactory::slotDeleteRetiredImages() {
+  qDeleteAll(d->retiredImages);
+  d->retiredImages.clear();
+}
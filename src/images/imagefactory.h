@@ -42,6 +42,7 @@ namespace Tellico {
     class ImageInfo;
   }
   class ImageDirectory;
+  class ThumbnailDirectory;
 
 class StyleOptions {
 public:
@@ -54,6 +55,28 @@ public:
   QString imgDir;
 };
 
+/**
+ * Counts of image lookups in the @ref ImageFactory, and the memory used by each tier of the cache
+ */
+class CacheStatistics {
+public:
+  CacheStatistics() : imageHits(0), imageMisses(0), dataHits(0), pixmapHits(0), pixmapMisses(0),
+                      imageCost(0), pixmapCost(0), dataCost(0), retiredCost(0) {}
+  // the decoded image was already in memory
+  int imageHits;
+  // the image had to be read from disk or the network
+  int imageMisses;
+  // the image was decoded from data held in memory
+  int dataHits;
+  int pixmapHits;
+  int pixmapMisses;
+  int imageCost;
+  int pixmapCost;
+  int dataCost;
+  // evicted images which are not deleted yet
+  int retiredCost;
+};
+
 /**
  * @author Robby Stephenson
  */
@@ -85,8 +108,8 @@ public:
   static CacheDir cacheDir();
 
   /**
-   * Add an image, reading it from a URL, which is the case when adding a new image from the
-   * @ref ImageWidget.
+   * Add an image, reading it from a URL and waiting for the download, which is the case when
+   * a fetcher needs the image id before returning an entry.
    *
    * @param url The URL of the image, anything KIO can handle
    * @param quiet If any error should not be reported.
@@ -94,6 +117,18 @@ public:
    */
   static QString addImage(const QUrl& url, bool quiet=false,
                           const QUrl& referrer = QUrl(), bool linkOnly=false);
+  /**
+   * Add an image from a URL without waiting for it, which is the case when adding a new image
+   * from the @ref ImageWidget. The imageAdded() signal is emitted
+   * with the url and the new image id once the download is done, or with an empty id if it
+   * fails. A url already being downloaded is not requested again, and only a few images are
+   * downloaded from the same host at once.
+   *
+   * @param url The URL of the image, anything KIO can handle
+   * @param quiet If any error should not be reported.
+   */
+  static void requestImage(const QUrl& url, bool quiet=false,
+                           const QUrl& referrer = QUrl(), bool linkOnly=false);
   /**
    * Add an image, reading it from a regular QImage, which is the case when dragging and dropping
    * an image in the @ref ImageWidget. The format has to be included, since the QImage doesn't
@@ -123,7 +158,11 @@ public:
 
   /**
    * Returns an image reference given its id. If none is found, a null image
-   * is returned.
+   * is returned. The reference stays valid until the event loop runs again or
+   * a few more images have been loaded, so it should not be kept.
+   *
+   * A link-only image from a remote URL is never waited for. The download is started
+   * and a null image is returned, with the imageAvailable() signal emitted once it's done.
    *
    * @param id The image id
    * @return The image reference
@@ -141,13 +180,58 @@ public:
    * @param id The image id
    */
   static void requestImageById(const QString& id);
+  /**
+   * Returns the path of the file containing the image, if it can be read directly from
+   * a local file without going through the image cache. Otherwise, the path is empty.
+   *
+   * @param id The image id
+   */
+  static QString imageFilePath(const QString& id);
+  /**
+   * Returns the encoded image data from the zip archive, without decoding it or removing
+   * it from the archive. The data is empty if the archive does not have the image.
+   *
+   * @param id The image id
+   */
+  static QByteArray zipImageData(const QString& id);
+  /**
+   * Records that an image from the zip archive has been written to the temporary directory
+   * outside of the image factory. The archive is closed once every image has been read.
+   *
+   * @param info The image info, found without loading the whole image
+   */
+  static void zipImageExtracted(const Data::ImageInfo& info);
   static Data::ImageInfo imageInfo(const QString& id);
+  /**
+   * Finds the format and size of an image from the image header in a local file or the zip
+   * archive, without loading the image. The result is cached with the other image info.
+   * The image info is null if the header can't be read.
+   *
+   * @param id The image id
+   */
+  static Data::ImageInfo probeImageInfo(const QString& id);
   static void cacheImageInfo(const Data::ImageInfo& info);
   static bool hasImageInfo(const QString& id);
   // basically returns !imageById().isNull()
   static bool validImage(const QString& id);
 
+  /**
+   * Returns a pixmap of the image, scaled down to fit within @p w and @p h, if both are positive.
+   * Scaled pixmaps are saved in the thumbnail directory, so that later sessions don't have to
+   * load the full image.
+   */
   static QPixmap pixmap(const QString& id, int w, int h);
+  /**
+   * Returns the image scaled down to fit within @p w and @p h, using the thumbnail directory
+   * when possible. Unlike pixmap(), this can be used without a GUI. A new thumbnail is
+   * saved in the background.
+   */
+  static QImage scaledImage(const QString& id, int w, int h);
+  /**
+   * Returns the directory where image thumbnails are kept between sessions. The copy is
+   * safe to use outside the GUI thread.
+   */
+  static ThumbnailDirectory thumbnailDirectory();
 
   /**
    * Clear the image cache and dict
@@ -162,6 +246,20 @@ public:
   static void removeImage(const QString& id_, bool deleteImage);
   static StringSet imagesNotInCache();
 
+  /**
+   * Returns the cache hit and miss counts since the factory was created or the counts were reset
+   */
+  static CacheStatistics cacheStatistics();
+  static void resetCacheStatistics();
+  /**
+   * Sets the memory budget for the cache, shared by the decoded images, the pixmaps,
+   * and the encoded image data. Images not saved anywhere else are spilled to the
+   * temporary directory rather than exceeding the budget.
+   *
+   * @param size The budget in bytes
+   */
+  static void setCacheSize(int size);
+
   static QString localDirectory(const QUrl& url);
   static void setLocalDirectory(const QUrl& url);
   static void setZipArchive(KZip* zip);
@@ -170,10 +268,12 @@ public:
 
 Q_SIGNALS:
   void imageAvailable(const QString& id);
+  void imageAdded(const QUrl& url, const QString& id);
   void imageLocationMismatch();
 
 private Q_SLOTS:
   void slotImageJobResult(KJob* job);
+  void slotDeleteRetiredImages();
 
 private:
   /**
@@ -188,6 +288,7 @@ private:
                                   const QUrl& referrer = QUrl(), bool linkOnly = false);
   void requestImageByUrlImpl(const QUrl& url, bool quiet=false,
                              const QUrl& referrer = QUrl(), bool linkOnly = false);
+  void startImageJobs();
   /**
    * Add an image, reading it from a regular QImage, which is the case when dragging and dropping
    * an image in the @ref ImageWidget. The format has to be included, since the QImage doesn't
@@ -215,13 +316,12 @@ private:
   static ImageFactory* factory;
 
   static QHash<QString, Data::ImageInfo> s_imageInfoMap;
-  static StringSet s_imagesToRelease;
 
   ImageFactory();
   ~ImageFactory();
 
-  void releaseImages();
   void emitImageMismatch();
+  static int imageCost(const Data::Image& img);
 
   class Private;
   Private* const d;
@@ -26,6 +26,83 @@
 #include "image.h"
 #include "imagefactory.h"
 
+#include <QIODevice>
+#include <QBuffer>
+#include <QFile>
+#include <QSize>
+
+namespace {
+  inline int readBigEndian16(const char* data) {
+    return (static_cast<uchar>(data[0]) << 8) | static_cast<uchar>(data[1]);
+  }
+
+  inline int readLittleEndian16(const char* data) {
+    return static_cast<uchar>(data[0]) | (static_cast<uchar>(data[1]) << 8);
+  }
+
+  inline int readLittleEndian24(const char* data) {
+    return readLittleEndian16(data) | (static_cast<uchar>(data[2]) << 16);
+  }
+
+  inline quint32 readBigEndian32(const char* data) {
+    return (quint32(readBigEndian16(data)) << 16) | quint32(readBigEndian16(data + 2));
+  }
+
+  // the segments before the start of frame are skipped, so a large EXIF block is never read
+  bool readJpegSize(QIODevice* device_, QSize& size_) {
+    char marker[2];
+    // skip past the SOI marker
+    if(!device_->seek(device_->pos() + 2)) {
+      return false;
+    }
+    forever {
+      if(device_->read(marker, 1) != 1) {
+        return false;
+      }
+      if(static_cast<uchar>(marker[0]) != 0xFF) {
+        return false;
+      }
+      // any number of fill bytes can come before the marker
+      do {
+        if(device_->read(marker + 1, 1) != 1) {
+          return false;
+        }
+      } while(static_cast<uchar>(marker[1]) == 0xFF);
+      const uchar type = static_cast<uchar>(marker[1]);
+      // standalone markers have no length
+      if(type == 0x01 || (type >= 0xD0 && type <= 0xD8)) {
+        continue;
+      }
+      // end of image or start of scan, with no frame header
+      if(type == 0xD9 || type == 0xDA) {
+        return false;
+      }
+      char length[2];
+      if(device_->read(length, 2) != 2) {
+        return false;
+      }
+      const int segmentLength = readBigEndian16(length);
+      if(segmentLength < 2) {
+        return false;
+      }
+      // every start of frame marker, other than DHT, JPG and DAC, which share the range
+      if(type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC) {
+        char frame[5];
+        if(segmentLength < 7 || device_->read(frame, 5) != 5) {
+          return false;
+        }
+        // frame[0] is the sample precision
+        size_ = QSize(readBigEndian16(frame + 3), readBigEndian16(frame + 1));
+        return true;
+      }
+      if(!device_->seek(device_->pos() + segmentLength - 2)) {
+        return false;
+      }
+    }
+    return false;
+  }
+}
+
 using namespace Tellico;
 using Tellico::Data::ImageInfo;
 
@@ -47,22 +124,95 @@ ImageInfo::ImageInfo(const QString& id_, const QByteArray& format_, int w_, int
 
 int ImageInfo::width(bool loadIfNecessary) const {
   if(m_width < 1 && loadIfNecessary) {
-    const Image& img = ImageFactory::imageById(id);
-    if(!img.isNull()) {
-      m_width = img.width();
-      m_height = img.height();
-    }
+    loadSize();
   }
   return m_width;
 }
 
 int ImageInfo::height(bool loadIfNecessary) const {
   if(m_height < 1 && loadIfNecessary) {
-    const Image& img = ImageFactory::imageById(id);
-    if(!img.isNull()) {
-      m_width = img.width();
-      m_height = img.height();
-    }
+    loadSize();
   }
   return m_height;
 }
+
+// the image header is usually enough to find the size, so the whole image is only loaded as a last resort
+void ImageInfo::loadSize() const {
+  const ImageInfo info = ImageFactory::probeImageInfo(id);
+  if(!info.isNull()) {
+    m_width = info.m_width;
+    m_height = info.m_height;
+    return;
+  }
+  const Image& img = ImageFactory::imageById(id);
+  if(!img.isNull()) {
+    m_width = img.width();
+    m_height = img.height();
+  }
+}
+
+bool ImageInfo::readHeader(QIODevice* device_, QByteArray& format_, QSize& size_) {
+  if(!device_ || !device_->isReadable()) {
+    return false;
+  }
+  const qint64 start = device_->pos();
+  // the largest fixed header is for WebP, which needs 30 bytes
+  const QByteArray header = device_->peek(30);
+  const char* data = header.constData();
+  bool success = false;
+  if(header.startsWith("\xFF\xD8")) {
+    format_ = "jpeg";
+    success = readJpegSize(device_, size_);
+    device_->seek(start);
+  } else if(header.startsWith("\x89PNG\r\n\x1A\n")) {
+    // the IHDR chunk always comes first
+    if(header.size() >= 24 && header.mid(12, 4) == "IHDR") {
+      format_ = "png";
+      size_ = QSize(readBigEndian32(data + 16), readBigEndian32(data + 20));
+      success = true;
+    }
+  } else if(header.startsWith("GIF87a") || header.startsWith("GIF89a")) {
+    // the logical screen size
+    if(header.size() >= 10) {
+      format_ = "gif";
+      size_ = QSize(readLittleEndian16(data + 6), readLittleEndian16(data + 8));
+      success = true;
+    }
+  } else if(header.startsWith("RIFF") && header.mid(8, 4) == "WEBP" && header.size() >= 30) {
+    const QByteArray chunk = header.mid(12, 4);
+    if(chunk == "VP8 ") {
+      // lossy, the key frame start code comes first
+      if(header.mid(23, 3) == "\x9D\x01\x2A") {
+        size_ = QSize(readLittleEndian16(data + 26) & 0x3FFF, readLittleEndian16(data + 28) & 0x3FFF);
+        success = true;
+      }
+    } else if(chunk == "VP8L") {
+      // lossless, 14 bits each for the width and height, minus one
+      if(static_cast<uchar>(data[20]) == 0x2F) {
+        const quint32 bits = static_cast<uchar>(data[21]) | (static_cast<uchar>(data[22]) << 8) |
+                             (static_cast<uchar>(data[23]) << 16) | (quint32(static_cast<uchar>(data[24])) << 24);
+        size_ = QSize((bits & 0x3FFF) + 1, ((bits >> 14) & 0x3FFF) + 1);
+        success = true;
+      }
+    } else if(chunk == "VP8X") {
+      // extended, 24 bits each for the canvas width and height, minus one
+      size_ = QSize(readLittleEndian24(data + 24) + 1, readLittleEndian24(data + 27) + 1);
+      success = true;
+    }
+    if(success) {
+      format_ = "webp";
+    }
+  }
+  return success && size_.isValid() && !size_.isEmpty();
+}
+
+bool ImageInfo::readHeader(const QByteArray& data_, QByteArray& format_, QSize& size_) {
+  QBuffer buffer;
+  buffer.setData(data_);
+  return buffer.open(QIODevice::ReadOnly) && readHeader(&buffer, format_, size_);
+}
+
+bool ImageInfo::readFileHeader(const QString& fileName_, QByteArray& format_, QSize& size_) {
+  QFile file(fileName_);
+  return file.open(QIODevice::ReadOnly) && readHeader(&file, format_, size_);
+}
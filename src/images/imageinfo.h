@@ -28,6 +28,9 @@
 #include <QString>
 #include <QByteArray>
 
+class QIODevice;
+class QSize;
+
 namespace Tellico {
   namespace Data {
 
@@ -46,7 +49,19 @@ public:
   int width(bool loadIfNecessary=true) const;
   int height(bool loadIfNecessary=true) const;
 
+  /**
+   * Reads the format and size of a JPEG, PNG, GIF or WebP image from its header,
+   * without decoding the image. Only as much of the device is read as is needed.
+   *
+   * @return false if the header is not recognized
+   */
+  static bool readHeader(QIODevice* device, QByteArray& format, QSize& size);
+  static bool readHeader(const QByteArray& data, QByteArray& format, QSize& size);
+  static bool readFileHeader(const QString& fileName, QByteArray& format, QSize& size);
+
 private:
+  void loadSize() const;
+
   mutable int m_width;
   mutable int m_height;
 };
@@ -0,0 +1,176 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "imagethumbnailer.h"
+#include "imagefactory.h"
+#include "imagedirectory.h"
+#include "../tellico_debug.h"
+
+#include <QImage>
+#include <QImageReader>
+#include <QBuffer>
+#include <QRunnable>
+
+using Tellico::ImageThumbnailer;
+
+namespace {
+
+// the image source is at most one of a decoded image, a local file, or encoded data
+// if there's no source, only the saved thumbnail is read
+class ThumbnailJob : public QRunnable {
+public:
+  ThumbnailJob(ImageThumbnailer* thumbnailer_, const QString& id_, int size_,
+               const Tellico::ThumbnailDirectory& thumbnailDir_, const QImage& image_,
+               const QString& filePath_, const QByteArray& data_)
+      : QRunnable(), m_thumbnailer(thumbnailer_), m_id(id_), m_size(size_), m_thumbnailDir(thumbnailDir_),
+        m_image(image_), m_filePath(filePath_), m_data(data_) {
+  }
+
+  void run() Q_DECL_OVERRIDE {
+    const QSize size(m_size, m_size);
+    QImage thumb = m_thumbnailDir.thumbnail(m_id, size);
+    if(thumb.isNull()) {
+      thumb = createThumbnail();
+      if(!thumb.isNull() && !m_thumbnailDir.writeThumbnail(m_id, size, thumb)) {
+        myDebug() << "unable to save thumbnail:" << m_thumbnailDir.filePath(m_id, size);
+      }
+    }
+    // the thumbnailer waits for every job in its destructor, so the pointer is still valid
+    QMetaObject::invokeMethod(m_thumbnailer, "slotThumbnailDone", Qt::QueuedConnection,
+                              Q_ARG(QString, m_id), Q_ARG(int, m_size), Q_ARG(QImage, thumb));
+  }
+
+private:
+  QImage createThumbnail() const {
+    QImage img;
+    if(!m_image.isNull()) {
+      img = m_image;
+    } else if(!m_filePath.isEmpty() || !m_data.isEmpty()) {
+      QBuffer buffer;
+      QImageReader reader;
+      if(m_filePath.isEmpty()) {
+        buffer.setData(m_data);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+      } else {
+        reader.setFileName(m_filePath);
+      }
+      // let the image plugin scale while decoding, which is much faster for large jpegs
+      const QSize fullSize = reader.size();
+      if(fullSize.width() > m_size || fullSize.height() > m_size) {
+        reader.setScaledSize(fullSize.scaled(m_size, m_size, Qt::KeepAspectRatio));
+      }
+      if(!reader.read(&img)) {
+        myDebug() << "unable to read image:" << m_id << reader.errorString();
+        return QImage();
+      }
+    }
+    // 1x1 images are considered null, same as in Data::Image
+    if(img.isNull() || (img.width() < 2 && img.height() < 2)) {
+      return QImage();
+    }
+    if(img.width() > m_size || img.height() > m_size) {
+      img = img.scaled(m_size, m_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return img;
+  }
+
+  ImageThumbnailer* m_thumbnailer;
+  QString m_id;
+  int m_size;
+  Tellico::ThumbnailDirectory m_thumbnailDir;
+  QImage m_image;
+  QString m_filePath;
+  QByteArray m_data;
+};
+
+}
+
+ImageThumbnailer::ImageThumbnailer(QObject* parent_) : QObject(parent_) {
+}
+
+ImageThumbnailer::~ImageThumbnailer() {
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
+bool ImageThumbnailer::requestThumbnail(const QString& id_, int size_) {
+  if(id_.isEmpty() || size_ < 1) {
+    return false;
+  }
+  const QString key = requestKey(id_, size_);
+  if(m_pending.contains(key)) {
+    return true;
+  }
+  if(m_failed.contains(key)) {
+    return false;
+  }
+
+  // the image factory is only used in the GUI thread, so figure out where the image
+  // can be read from before handing it off. An image already in memory is shared with the job
+  QImage image;
+  QString filePath;
+  QByteArray data;
+  if(ImageFactory::self()->hasImageInMemory(id_)) {
+    image = ImageFactory::imageById(id_);
+  } else {
+    filePath = ImageFactory::imageFilePath(id_);
+    if(filePath.isEmpty()) {
+      data = ImageFactory::zipImageData(id_);
+    }
+  }
+  // a saved thumbnail is still useful when the image itself has not been loaded yet
+  const ThumbnailDirectory thumbnailDir = ImageFactory::thumbnailDirectory();
+  if(image.isNull() && filePath.isEmpty() && data.isEmpty() &&
+     !thumbnailDir.hasThumbnail(id_, QSize(size_, size_))) {
+    return false;
+  }
+
+  m_pending.insert(key);
+  m_pool.start(new ThumbnailJob(this, id_, size_, thumbnailDir, image, filePath, data));
+  return true;
+}
+
+bool ImageThumbnailer::isPending(const QString& id_, int size_) const {
+  return m_pending.contains(requestKey(id_, size_));
+}
+
+void ImageThumbnailer::cancel() {
+  m_pool.clear();
+  // any job that already started still reports back
+  m_pending.clear();
+}
+
+void ImageThumbnailer::slotThumbnailDone(const QString& id_, int size_, const QImage& thumbnail_) {
+  const QString key = requestKey(id_, size_);
+  m_pending.remove(key);
+  if(thumbnail_.isNull()) {
+    m_failed.insert(key);
+  }
+  emit thumbnailAvailable(id_, size_, thumbnail_);
+}
+
+QString ImageThumbnailer::requestKey(const QString& id_, int size_) {
+  return id_ + QLatin1Char('|') + QString::number(size_);
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_IMAGETHUMBNAILER_H
+#define TELLICO_IMAGETHUMBNAILER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QSet>
+
+class QImage;
+
+namespace Tellico {
+
+/**
+ * The image thumbnailer decodes and scales images in a thread pool, so that views showing
+ * many images at once don't have to load every full-size image in the GUI thread. Thumbnails
+ * are also saved in the @ref ThumbnailDirectory, so later requests only have to read the small image.
+ *
+ * The thumbnailer lives in the GUI thread, since the image source is found through
+ * the @ref ImageFactory.
+ *
+ * @author Robby Stephenson
+ */
+class ImageThumbnailer : public QObject {
+Q_OBJECT
+
+public:
+  ImageThumbnailer(QObject* parent = nullptr);
+  virtual ~ImageThumbnailer();
+
+  /**
+   * Queues a thumbnail of the image, no larger than @p size in either dimension. The
+   * thumbnailAvailable() signal is emitted when it is done. A failed thumbnail is not
+   * requested again.
+   *
+   * @param id The image id
+   * @param size The maximum width and height of the thumbnail
+   * @return false if the image can not be read in the background, i.e. it is not yet
+   *         available locally, or a previous thumbnail failed
+   */
+  bool requestThumbnail(const QString& id, int size);
+  bool isPending(const QString& id, int size) const;
+  /**
+   * Cancels any thumbnail request that has not started yet
+   */
+  void cancel();
+
+Q_SIGNALS:
+  /**
+   * Signals that a thumbnail is done. If the image could not be read,
+   * the thumbnail is null.
+   */
+  void thumbnailAvailable(const QString& id, int size, const QImage& thumbnail);
+
+private Q_SLOTS:
+  void slotThumbnailDone(const QString& id, int size, const QImage& thumbnail);
+
+private:
+  static QString requestKey(const QString& id, int size);
+
+  QThreadPool m_pool;
+  QSet<QString> m_pending;
+  QSet<QString> m_failed;
+};
+
+} // end namespace
+#endif
@@ -721,6 +721,12 @@ void MainWindow::initDocument() {
           Controller::self(), SLOT(slotCollectionAdded(Tellico::Data::CollPtr)));
   connect(doc, SIGNAL(signalCollectionDeleted(Tellico::Data::CollPtr)),
           Controller::self(), SLOT(slotCollectionDeleted(Tellico::Data::CollPtr)));
+  connect(doc, SIGNAL(signalEntriesAdded(Tellico::Data::EntryList)),
+          Controller::self(), SLOT(slotEntriesAdded(Tellico::Data::EntryList)));
+  connect(doc, SIGNAL(signalEntriesModified(Tellico::Data::EntryList)),
+          Controller::self(), SLOT(slotEntriesModified(Tellico::Data::EntryList)));
+  connect(doc, SIGNAL(signalCollectionRead(Tellico::Data::CollPtr)),
+          Controller::self(), SLOT(slotCollectionRead(Tellico::Data::CollPtr)));
 
   connect(Kernel::self()->commandHistory(), SIGNAL(cleanChanged(bool)),
           doc, SLOT(slotSetClean(bool)));
@@ -759,6 +765,8 @@ void MainWindow::initView() {
                                        "for each entry.</qt>"));
   connect(Data::Document::self(), SIGNAL(signalCollectionImagesLoaded(Tellico::Data::CollPtr)),
           m_detailedView, SLOT(slotRefreshImages()));
+  // large collections are filtered in the background, so the count changes afterward
+  connect(m_detailedView->model(), SIGNAL(signalParallelPassFinished()), SLOT(slotEntryCount()));
 
   m_iconView = m_viewStack->iconView();
   EntryIconModel* iconModel = new EntryIconModel(m_iconView);
@@ -812,6 +820,8 @@ void MainWindow::initConnections() {
           m_editDialog, SLOT(setContents(Tellico::Data::EntryList)));
   connect(proxySelect, SIGNAL(entriesSelected(Tellico::Data::EntryList)),
           m_entryView, SLOT(showEntries(Tellico::Data::EntryList)));
+  connect(proxySelect, SIGNAL(entriesAdjacent(Tellico::Data::EntryList)),
+          m_entryView, SLOT(prefetchEntries(Tellico::Data::EntryList)));
 
   // let the group view call filters, too
   connect(m_groupView, SIGNAL(signalUpdateFilter(Tellico::FilterPtr)),
@@ -1319,6 +1329,8 @@ bool MainWindow::fileSaveAs() {
 
 void MainWindow::slotFilePrint() {
   slotStatusMsg(i18n("Printing..."));
+  // every entry has to be read before printing
+  Data::Document::self()->finishLoading();
 
   bool printGrouped = Config::printGrouped();
   bool printHeaders = Config::printFieldHeaders();
@@ -1594,6 +1606,7 @@ void MainWindow::slotChangeGrouping() {
 }
 
 void MainWindow::slotShowReportDialog() {
+  Data::Document::self()->finishLoading();
   if(!m_reportDlg) {
     m_reportDlg = new ReportDialog(this);
     connect(m_reportDlg, SIGNAL(finished(int)),
@@ -1816,6 +1829,8 @@ void MainWindow::slotFileImport(int format_) {
 void MainWindow::slotFileExport(int format_) {
   slotStatusMsg(i18n("Exporting data..."));
 
+  // the file being opened has to be read completely before exporting
+  Data::Document::self()->finishLoading();
   Export::Format format = static_cast<Export::Format>(format_);
   ExportDialog dlg(format, Data::Document::self()->collection(), this);
 
@@ -1929,6 +1944,7 @@ void MainWindow::slotShowEntryEditor() {
 }
 
 void MainWindow::slotConvertToBibliography() {
+  Data::Document::self()->finishLoading();
   // only book collections can be converted to bibtex
   Data::CollPtr coll = Data::Document::self()->collection();
   if(!coll || coll->type() != Data::Collection::Book) {
@@ -2028,6 +2044,7 @@ bool MainWindow::exportCollection(Tellico::Export::Format format_, const QUrl& u
   }
 
   GUI::CursorSaver cs;
+  Data::Document::self()->finishLoading();
   const Data::CollPtr coll = Data::Document::self()->collection();
   if(!coll) {
     return false;
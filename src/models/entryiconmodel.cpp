@@ -25,16 +25,26 @@
 #include "entryiconmodel.h"
 #include "models.h"
 #include "../collectionfactory.h"
+#include "../images/imagethumbnailer.h"
 #include "../config/tellico_config.h"
 #include "../tellico_debug.h"
 
 #include <QIcon>
 #include <QPixmap>
+#include <QImage>
+
+namespace {
+  static const int ENTRYICONMODEL_MIN_THUMBNAIL_SIZE = 32;
+  static const int ENTRYICONMODEL_DEFAULT_THUMBNAIL_SIZE = 128;
+}
 
 using Tellico::EntryIconModel;
 
-EntryIconModel::EntryIconModel(QObject* parent_) : QIdentityProxyModel(parent_) {
+EntryIconModel::EntryIconModel(QObject* parent_) : QIdentityProxyModel(parent_)
+    , m_thumbnailer(new ImageThumbnailer(this))
+    , m_thumbnailSize(ENTRYICONMODEL_DEFAULT_THUMBNAIL_SIZE) {
   m_iconCache.setMaxCost(Config::iconCacheSize());
+  connect(m_thumbnailer, &ImageThumbnailer::thumbnailAvailable, this, &EntryIconModel::slotThumbnailAvailable);
 }
 
 EntryIconModel::~EntryIconModel() {
@@ -69,6 +79,15 @@ QVariant EntryIconModel::data(const QModelIndex& index_, int role_) const {
         return QIcon(*m_iconCache.object(id));
       }
 
+      // rather than loading the full image here, show the default icon until the thumbnail is ready
+      if(m_thumbnailer->requestThumbnail(id, m_thumbnailSize)) {
+        const QPersistentModelIndex pIndex(index_);
+        if(!m_pendingIcons.contains(id, pIndex)) {
+          m_pendingIcons.insert(id, pIndex);
+        }
+        return defaultIcon(entry->collection());
+      }
+
       QVariant v = QIdentityProxyModel::data(index_, PrimaryImageRole);
       if(v.isNull() || !v.canConvert<QPixmap>()) {
         return defaultIcon(entry->collection());
@@ -88,8 +107,43 @@ QVariant EntryIconModel::data(const QModelIndex& index_, int role_) const {
   return QIdentityProxyModel::data(index_, role_);
 }
 
+void EntryIconModel::setThumbnailSize(int size_) {
+  // moving the icon size slider shouldn't create new thumbnails for every step
+  int size = ENTRYICONMODEL_MIN_THUMBNAIL_SIZE;
+  while(size < size_) {
+    size *= 2;
+  }
+  if(size == m_thumbnailSize) {
+    return;
+  }
+  m_thumbnailSize = size;
+  clearCache();
+  if(rowCount() > 0) {
+    emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1), QVector<int>() << Qt::DecorationRole);
+  }
+}
+
 void EntryIconModel::clearCache() {
   m_iconCache.clear();
+  m_pendingIcons.clear();
+  m_thumbnailer->cancel();
+}
+
+void EntryIconModel::slotThumbnailAvailable(const QString& id_, int size_, const QImage& thumbnail_) {
+  if(size_ != m_thumbnailSize || !m_pendingIcons.contains(id_)) {
+    return;
+  }
+  // a null thumbnail is not requested again, the next call to data() loads the full image instead
+  if(!thumbnail_.isNull()) {
+    m_iconCache.insert(id_, new QIcon(QPixmap::fromImage(thumbnail_)));
+  }
+  foreach(const QPersistentModelIndex& pIndex, m_pendingIcons.values(id_)) {
+    if(pIndex.isValid()) {
+      const QModelIndex index = pIndex;
+      emit dataChanged(index, index, QVector<int>() << Qt::DecorationRole);
+    }
+  }
+  m_pendingIcons.remove(id_);
 }
 
 const QIcon& EntryIconModel::defaultIcon(Data::CollPtr coll_) const {
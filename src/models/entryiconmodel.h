@@ -30,14 +30,22 @@
 #include <QIdentityProxyModel>
 #include <QHash>
 #include <QCache>
+#include <QMultiHash>
+#include <QPersistentModelIndex>
+
+class QImage;
 
 namespace Tellico {
+  class ImageThumbnailer;
 
 /**
  * @author Robby Stephenson
  *
  * This identity model does nothing except modify EntryModel::data() to return an entry's icon
  * for every column. It's intended to be used in EntryIconView.
+ *
+ * Icons are thumbnails created in the background by an @ref ImageThumbnailer. Until the thumbnail
+ * is ready, the default icon is returned, and dataChanged() is emitted once it is available.
  */
 class EntryIconModel : public QIdentityProxyModel {
 Q_OBJECT
@@ -49,14 +57,28 @@ public:
   void setSourceModel(QAbstractItemModel* newSourceModel) Q_DECL_OVERRIDE;
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
 
+  /**
+   * Sets the size of the icon thumbnails. The size is rounded up to one of a few
+   * fixed sizes, so the view is expected to scale the icon down.
+   */
+  void setThumbnailSize(int size);
+  int thumbnailSize() const { return m_thumbnailSize; }
+
 public Q_SLOTS:
   void clearCache();
 
+private Q_SLOTS:
+  void slotThumbnailAvailable(const QString& id, int size, const QImage& thumbnail);
+
 private:
   const QIcon& defaultIcon(Data::CollPtr coll) const;
 
   mutable QHash<int, QIcon*> m_defaultIcons;
   mutable QCache<QString, QIcon> m_iconCache;
+  ImageThumbnailer* m_thumbnailer;
+  int m_thumbnailSize;
+  // the indexes waiting on a thumbnail, keyed by image id
+  mutable QMultiHash<QString, QPersistentModelIndex> m_pendingIcons;
 };
 
 } // end namespace
@@ -31,16 +31,20 @@
 #include "../document.h"
 #include "../images/image.h"
 #include "../images/imagefactory.h"
+#include "../config/tellico_config.h"
 #include "../tellico_debug.h"
 
 namespace {
   static const int ENTRYMODEL_IMAGE_HEIGHT = 64;
+  // a rough guess at the memory used for each cached value, besides the text itself
+  static const int ENTRYMODEL_FORMAT_OVERHEAD = 64;
 }
 
 using Tellico::EntryModel;
 
 EntryModel::EntryModel(QObject* parent) : QAbstractItemModel(parent),
-    m_imagesAreAvailable(false) {
+    m_imagesAreAvailable(false), m_virtualized(false) {
+  m_formatCache.setMaxCost(Config::formatCacheSize());
   m_checkPix = QIcon::fromTheme(QLatin1String("checkmark"), QIcon(QLatin1String(":/icons/checkmark")));
   connect(ImageFactory::self(), &ImageFactory::imageAvailable, this, &EntryModel::refreshImage);
 }
@@ -114,7 +118,7 @@ QVariant EntryModel::data(const QModelIndex& index_, int role_) const {
       if(!entry) {
         return QVariant();
       }
-      value = entry->formattedField(field);
+      value = m_virtualized ? formattedValue(entry, field, index_.column()) : entry->formattedField(field);
       return value.isEmpty() ? QVariant() : value;
 
     case Qt::DecorationRole:
@@ -256,6 +260,7 @@ void EntryModel::clear() {
   m_entries.clear();
   m_fields.clear();
   m_saveStates.clear();
+  m_formatCache.clear();
   endResetModel();
 }
 
@@ -270,6 +275,7 @@ void EntryModel::setEntries(const Tellico::Data::EntryList& entries_) {
   Q_ASSERT(!m_fields.isEmpty() || entries_.isEmpty());
   beginResetModel();
   m_entries = entries_;
+  m_formatCache.clear();
   endResetModel();
 }
 
@@ -281,6 +287,7 @@ void EntryModel::addEntries(const Tellico::Data::EntryList& entries_) {
 
 void EntryModel::modifyEntries(const Tellico::Data::EntryList& entries_) {
   foreach(Data::EntryPtr entry, entries_) {
+    removeFormattedValues(entry);
     QModelIndex index = indexFromEntry(entry);
     if(index.isValid()) {
       emit dataChanged(index, index);
@@ -296,6 +303,7 @@ void EntryModel::removeEntries(const Tellico::Data::EntryList& entries_) {
     beginResetModel();
   }
   foreach(Data::EntryPtr entry, entries_) {
+    removeFormattedValues(entry);
     int idx = m_entries.indexOf(entry);
     if(idx > -1) {
       if(!bigRemoval) {
@@ -316,6 +324,7 @@ void EntryModel::setFields(const Tellico::Data::FieldList& fields_) {
   if(!m_fields.isEmpty()) {
     beginResetModel();
     m_fields.clear();
+    m_formatCache.clear();
     endResetModel();
   }
   if(!fields_.isEmpty()) {
@@ -337,6 +346,7 @@ void EntryModel::modifyField(Data::FieldPtr oldField_, Data::FieldPtr newField_)
   for(int i = 0; i < m_fields.count(); ++i) {
     if(m_fields.at(i)->name() == oldField_->name()) {
       m_fields.replace(i, newField_);
+      m_formatCache.clear();
       emit headerDataChanged(Qt::Horizontal, i, i);
       break;
     }
@@ -349,11 +359,49 @@ void EntryModel::removeFields(const Tellico::Data::FieldList& fields_) {
     if(idx > -1) {
       beginRemoveColumns(QModelIndex(), idx, idx);
       m_fields.removeAt(idx);
+      // the cache is keyed by column
+      m_formatCache.clear();
       endRemoveColumns();
     }
   }
 }
 
+void EntryModel::setVirtualized(bool virtualized_) {
+  m_virtualized = virtualized_;
+  if(!m_virtualized) {
+    m_formatCache.clear();
+  }
+}
+
+void EntryModel::setFormatCacheSize(int size_) {
+  m_formatCache.setMaxCost(size_);
+}
+
+QString EntryModel::formattedValue(Data::EntryPtr entry_, Data::FieldPtr field_, int column_) const {
+  const FormatKey key(entry_.data(), column_);
+  // the revision changes when the entry is modified, or when the formatting options change
+  FormattedValue* cached = m_formatCache.object(key);
+  if(cached && cached->revision == entry_->revision()) {
+    return cached->value;
+  }
+  FormattedValue* formatted = new FormattedValue;
+  formatted->value = entry_->formatField(field_);
+  formatted->revision = entry_->revision();
+  const QString value = formatted->value;
+  // inserting an object larger than the cache deletes it
+  m_formatCache.insert(key, formatted, formatted->value.size() * sizeof(QChar) + ENTRYMODEL_FORMAT_OVERHEAD);
+  return value;
+}
+
+void EntryModel::removeFormattedValues(Data::EntryPtr entry_) {
+  if(m_formatCache.isEmpty()) {
+    return;
+  }
+  for(int col = 0; col < m_fields.count(); ++col) {
+    m_formatCache.remove(FormatKey(entry_.data(), col));
+  }
+}
+
 void EntryModel::setImagesAreAvailable(bool available_) {
   if(m_imagesAreAvailable != available_) {
     beginResetModel();
@@ -31,6 +31,8 @@
 #include <QIcon>
 #include <QAbstractItemModel>
 #include <QMultiHash>
+#include <QCache>
+#include <QPair>
 
 namespace Tellico {
 
@@ -56,6 +58,17 @@ public:
   void clear();
   void clearSaveState();
   void setImagesAreAvailable(bool b);
+  /**
+   * In virtualized mode, the formatted values are not kept in the entries. Instead,
+   * the model keeps the values of the rows most recently shown, up to the size of the
+   * format cache, so a view of a very large collection only formats the rows in view.
+   */
+  void setVirtualized(bool virtualized);
+  bool isVirtualized() const { return m_virtualized; }
+  /**
+   * Sets the size of the format cache, in bytes
+   */
+  void setFormatCacheSize(int size);
 
   void    setEntries(const Data::EntryList& entries);
   void    addEntries(const Data::EntryList& entries);
@@ -76,12 +89,23 @@ private:
   Data::EntryPtr entry(const QModelIndex& index) const;
   Data::FieldPtr field(const QModelIndex& index) const;
   QVariant requestImage(Data::EntryPtr entry, const QString& id) const;
+  QString formattedValue(Data::EntryPtr entry, Data::FieldPtr field, int column) const;
+  void removeFormattedValues(Data::EntryPtr entry);
+
+  struct FormattedValue {
+    QString value;
+    int revision;
+  };
+  typedef QPair<const Data::Entry*, int> FormatKey;
 
   Data::EntryList m_entries;
   Data::FieldList m_fields;
   QIcon m_checkPix;
   QHash<int, int> m_saveStates;
   bool m_imagesAreAvailable;
+  bool m_virtualized;
+  // the cost of each value is its size in bytes
+  mutable QCache<FormatKey, FormattedValue> m_formatCache;
 
   // maps ids of requested images into entries
   mutable QMultiHash<QString, Data::EntryPtr> m_requestedImages;
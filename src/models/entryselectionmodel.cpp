@@ -85,6 +85,13 @@ void EntrySelectionModel::selectedEntriesChanged(const QItemSelection& selected_
   }
 
   emit entriesSelected(m_selectedEntries);
+  // the current index is set before the selection changes
+  if(m_selectedEntries.count() == 1) {
+    const QModelIndex current = selectionModel->currentIndex();
+    if(current.data(EntryPtrRole).value<Data::EntryPtr>() == m_selectedEntries.first()) {
+      emit entriesAdjacent(adjacentEntries(current));
+    }
+  }
   // for every selection model which did not call this function, clear the selection
   foreach(const QPointer<QItemSelectionModel>& ptr, m_modelList) { //krazy:exclude=foreach
     QItemSelectionModel* const otherModel = ptr.data();
@@ -99,3 +106,25 @@ void EntrySelectionModel::selectedEntriesChanged(const QItemSelection& selected_
   }
   m_processing = false;
 }
+
+Tellico::Data::EntryList EntrySelectionModel::adjacentEntries(const QModelIndex& index_) {
+  Data::EntryList entries;
+  const QAbstractItemModel* model = index_.model();
+  if(!model) {
+    return entries;
+  }
+  // the row after is more likely to be next
+  if(index_.row() + 1 < model->rowCount(index_.parent())) {
+    Data::EntryPtr entry = index_.sibling(index_.row() + 1, 0).data(EntryPtrRole).value<Data::EntryPtr>();
+    if(entry) {
+      entries += entry;
+    }
+  }
+  if(index_.row() > 0) {
+    Data::EntryPtr entry = index_.sibling(index_.row() - 1, 0).data(EntryPtrRole).value<Data::EntryPtr>();
+    if(entry) {
+      entries += entry;
+    }
+  }
+  return entries;
+}
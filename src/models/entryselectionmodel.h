@@ -49,11 +49,18 @@ public:
 
 Q_SIGNALS:
   void entriesSelected(Tellico::Data::EntryList entries);
+  /**
+   * Signals the entries in the rows next to a single selected entry, in the order
+   * of the view, since those are likely to be selected next.
+   */
+  void entriesAdjacent(Tellico::Data::EntryList entries);
 
 private Q_SLOTS:
   void selectedEntriesChanged(const QItemSelection& selected, const QItemSelection& deselected);
 
 private:
+  static Data::EntryList adjacentEntries(const QModelIndex& index);
+
   Data::EntryList m_selectedEntries;
   QList< QPointer<QItemSelectionModel> > m_modelList;
   QPointer<QItemSelectionModel> m_recentSelectionModel;
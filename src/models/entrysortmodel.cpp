@@ -25,34 +25,120 @@
 #include "entrysortmodel.h"
 #include "models.h"
 #include "fieldcomparison.h"
+#include "entrysortthread.h"
 #include "../field.h"
 #include "../entry.h"
 
+#include <QTimer>
+
 using Tellico::EntrySortModel;
 
-EntrySortModel::EntrySortModel(QObject* parent) : AbstractSortModel(parent) {
+namespace {
+  // smaller models are filtered and sorted quickly enough without another thread
+  static const int ENTRY_SORT_PARALLEL_MIN_ROWS = 2000;
+}
+
+EntrySortModel::EntrySortModel(QObject* parent) : AbstractSortModel(parent)
+    , m_parallel(false), m_thread(nullptr), m_pendingSort(false), m_pendingSortColumn(-1)
+    , m_pendingSortOrder(Qt::AscendingOrder), m_pendingFilter(false) {
   setDynamicSortFilter(true);
   setSortLocaleAware(true);
   connect(this, SIGNAL(modelReset()), SLOT(clearData()));
 }
 
+EntrySortModel::~EntrySortModel() {
+  // every pass is a child of the model, including cancelled ones which have not stopped yet
+  const QList<EntrySortThread*> threads = findChildren<EntrySortThread*>(QString(), Qt::FindDirectChildrenOnly);
+  foreach(EntrySortThread* thread, threads) {
+    disconnect(thread, nullptr, this, nullptr);
+    thread->slotCancel();
+  }
+  foreach(EntrySortThread* thread, threads) {
+    thread->wait();
+  }
+}
+
 void EntrySortModel::setFilter(Tellico::FilterPtr filter_) {
   if(m_filter != filter_ || (m_filter && *m_filter != *filter_)) {
     m_filter = filter_;
-    invalidateFilter();
+    // the ranks of the last pass are only good for the filter they were calculated with
+    m_ranks.clear();
+    m_pendingFilter = true;
+    if(!startParallelPass()) {
+      applyPendingChanges();
+    }
   }
 }
 
+void EntrySortModel::setParallel(bool parallel_) {
+  m_parallel = parallel_;
+}
+
+void EntrySortModel::sort(int col_, Qt::SortOrder order_) {
+  const int currentColumn = m_pendingSort ? m_pendingSortColumn : sortColumn();
+  if(col_ != currentColumn) {
+    // only a new sort column is worth a pass, the keys of the current one are already calculated
+    m_pendingSort = true;
+    m_pendingSortColumn = col_;
+    m_pendingSortOrder = order_;
+    if(!startParallelPass()) {
+      applyPendingChanges();
+    }
+    return;
+  } else if(m_pendingSort) {
+    // the order is applied along with the column, once the pass is finished
+    m_pendingSortOrder = order_;
+    return;
+  }
+  AbstractSortModel::sort(col_, order_);
+}
+
 Tellico::FilterPtr EntrySortModel::filter() const {
   return m_filter;
 }
 
+void EntrySortModel::setSourceModel(QAbstractItemModel* sourceModel_) {
+  if(sourceModel()) {
+    disconnect(sourceModel(), nullptr, this, SLOT(slotDataChanged(const QModelIndex&, const QModelIndex&)));
+    disconnect(sourceModel(), nullptr, this, SLOT(clearSortKeys()));
+    disconnect(sourceModel(), nullptr, this, SLOT(clearRanks()));
+  }
+  clearSortKeys();
+  clearRanks();
+  // connected before the proxy model connects its own slots, so the keys and ranks of the
+  // changed rows are already gone when the proxy filters and sorts them again
+  if(sourceModel_) {
+    // when entries are modified, their old keys are useless
+    connect(sourceModel_, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&)),
+            SLOT(slotDataChanged(const QModelIndex&, const QModelIndex&)));
+    // the entries might be deleted, and their addresses reused
+    connect(sourceModel_, SIGNAL(rowsAboutToBeRemoved(const QModelIndex&, int, int)), SLOT(clearSortKeys()));
+    // the fields of the columns change
+    connect(sourceModel_, SIGNAL(columnsInserted(const QModelIndex&, int, int)), SLOT(clearSortKeys()));
+    connect(sourceModel_, SIGNAL(columnsRemoved(const QModelIndex&, int, int)), SLOT(clearSortKeys()));
+    connect(sourceModel_, SIGNAL(headerDataChanged(Qt::Orientation, int, int)), SLOT(clearSortKeys()));
+    // the ranks are kept by row and by column
+    connect(sourceModel_, SIGNAL(rowsAboutToBeInserted(const QModelIndex&, int, int)), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(rowsAboutToBeRemoved(const QModelIndex&, int, int)), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(rowsAboutToBeMoved(const QModelIndex&, int, int, const QModelIndex&, int)), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(layoutAboutToBeChanged()), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(columnsAboutToBeInserted(const QModelIndex&, int, int)), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(columnsAboutToBeRemoved(const QModelIndex&, int, int)), SLOT(clearRanks()));
+    connect(sourceModel_, SIGNAL(headerDataChanged(Qt::Orientation, int, int)), SLOT(clearRanks()));
+  }
+  AbstractSortModel::setSourceModel(sourceModel_);
+}
+
 bool EntrySortModel::filterAcceptsRow(int row_, const QModelIndex& parent_) const {
   if(!m_filter) {
     return true;
   }
   QModelIndex index = sourceModel()->index(row_, 0, parent_);
   Q_ASSERT(index.isValid());
+  const int rowRank = rank(row_);
+  if(rowRank > -2) {
+    return rowRank > -1;
+  }
   Data::EntryPtr entry = index.data(EntryPtrRole).value<Data::EntryPtr>();
   Q_ASSERT(entry);
   return m_filter->matches(entry);
@@ -62,6 +148,15 @@ bool EntrySortModel::lessThan(const QModelIndex& left_, const QModelIndex& right
   if(sortRole() != EntryPtrRole) {
     return AbstractSortModel::lessThan(left_, right_);
   }
+  if(ranksMatchSortColumns()) {
+    // rows which the filter rejected sort first, they are dropped anyway
+    const int leftRank = rank(left_.row());
+    const int rightRank = rank(right_.row());
+    if(leftRank > -2 && rightRank > -2) {
+      return leftRank < rightRank;
+    }
+  }
+
   Data::EntryPtr leftEntry = left_.data(EntryPtrRole).value<Data::EntryPtr>();
   Data::EntryPtr rightEntry = right_.data(EntryPtrRole).value<Data::EntryPtr>();
   if(!leftEntry) {
@@ -83,7 +178,8 @@ bool EntrySortModel::lessThan(const QModelIndex& left_, const QModelIndex& right
       return false;
     }
 
-    const int res = comp->compare(leftEntry, rightEntry);
+    const int res = comp->compare(sortKey(comp, left.column(), leftEntry),
+                                  sortKey(comp, left.column(), rightEntry));
     if(res == 0) {
       switch (i) {
         case 0:
@@ -106,8 +202,52 @@ bool EntrySortModel::lessThan(const QModelIndex& left_, const QModelIndex& right
 
 void EntrySortModel::clearData() {
   m_filter = FilterPtr();
+  clearSortKeys();
+  cancelParallelPass();
+  m_ranks.clear();
+  m_pendingSort = false;
+  m_pendingFilter = false;
+}
+
+void EntrySortModel::clearSortKeys() {
   qDeleteAll(m_comparisons);
   m_comparisons.clear();
+  m_sortKeys.clear();
+}
+
+void EntrySortModel::clearRanks() {
+  m_ranks.clear();
+  m_rankColumns.clear();
+  if(m_thread) {
+    // the rows of the pass are gone, so the pending changes get a new one once the source model is done
+    cancelParallelPass();
+    QTimer::singleShot(0, this, SLOT(slotRestartParallelPass()));
+  }
+}
+
+void EntrySortModel::slotDataChanged(const QModelIndex& topLeft_, const QModelIndex& bottomRight_) {
+  // the modified rows are filtered and sorted by their values again
+  for(int row = topLeft_.row(); row <= bottomRight_.row(); ++row) {
+    if(row < m_ranks.size()) {
+      m_ranks[row] = -2;
+    }
+    if(row < m_passRows.size()) {
+      m_passRows[row].entry = nullptr;
+    }
+  }
+  if(m_sortKeys.isEmpty()) {
+    return;
+  }
+  for(int row = topLeft_.row(); row <= bottomRight_.row(); ++row) {
+    Data::EntryPtr entry = sourceModel()->index(row, 0, topLeft_.parent()).data(EntryPtrRole).value<Data::EntryPtr>();
+    if(!entry) {
+      continue;
+    }
+    QMutableHashIterator<int, SortKeyHash> it(m_sortKeys);
+    while(it.hasNext()) {
+      it.next().value().remove(entry.data());
+    }
+  }
 }
 
 Tellico::FieldComparison* EntrySortModel::getComparison(const QModelIndex& index_) const {
@@ -124,3 +264,249 @@ Tellico::FieldComparison* EntrySortModel::getComparison(const QModelIndex& index
   }
   return comp;
 }
+
+Tellico::SortKey EntrySortModel::sortKey(FieldComparison* comp_, int column_, Data::EntryPtr entry_) const {
+  if(!m_sortKeys.contains(column_)) {
+    materializeSortKeys(comp_, column_);
+  }
+  SortKeyHash& keys = m_sortKeys[column_];
+  SortKeyHash::Iterator it = keys.find(entry_.data());
+  if(it == keys.end()) {
+    CachedSortKey cached;
+    cached.key = comp_->sortKey(entry_);
+    cached.revision = entry_->revision();
+    it = keys.insert(entry_.data(), cached);
+  } else if(it.value().revision != entry_->revision()) {
+    it.value().key = comp_->sortKey(entry_);
+    it.value().revision = entry_->revision();
+  }
+  return it.value().key;
+}
+
+void EntrySortModel::materializeSortKeys(FieldComparison* comp_, int column_) const {
+  SortKeyHash& keys = m_sortKeys[column_];
+  if(!sourceModel()) {
+    return;
+  }
+  const int rows = sourceModel()->rowCount();
+  keys.reserve(rows);
+  for(int row = 0; row < rows; ++row) {
+    Data::EntryPtr entry = sourceModel()->index(row, column_).data(EntryPtrRole).value<Data::EntryPtr>();
+    if(!entry) {
+      continue;
+    }
+    CachedSortKey cached;
+    cached.key = comp_->sortKey(entry);
+    cached.revision = entry->revision();
+    keys.insert(entry.data(), cached);
+  }
+}
+
+bool EntrySortModel::startParallelPass() {
+  cancelParallelPass();
+  if(!m_parallel || !sourceModel() || sourceModel()->rowCount() < ENTRY_SORT_PARALLEL_MIN_ROWS) {
+    return false;
+  }
+
+  // the pass sorts by the same columns as lessThan(), and stops at the first missing one.
+  // When the sort order is not changing, the rows keep their order and need no keys.
+  Data::FieldList fields;
+  m_passColumns.clear();
+  if(m_pendingSort && sortRole() == EntryPtrRole) {
+    m_passColumns = passSortColumns();
+    foreach(int col, m_passColumns) {
+      Data::FieldPtr field = col < 0 ? Data::FieldPtr()
+                                     : sourceModel()->headerData(col, Qt::Horizontal, FieldPtrRole).value<Data::FieldPtr>();
+      if(!field) {
+        break;
+      }
+      if(field->type() == Data::Field::Image) {
+        // images can only be compared in this thread
+        fields.clear();
+        m_passColumns.clear();
+        break;
+      }
+      fields << field;
+    }
+  }
+  const bool filtering = m_pendingFilter && m_filter && !m_filter->isEmpty();
+  if(!filtering && fields.isEmpty()) {
+    return false;
+  }
+  // when the filter is not changing, the rows it rejected stay rejected
+  const bool filtered = !m_pendingFilter && m_filter;
+
+  // the pass gets its own copy of the filter, which gets compiled by reading the values
+  FilterPtr filter;
+  if(filtering) {
+    filter = FilterPtr(new Filter(*m_filter));
+  }
+  // the keys which are already known are not created again
+  QVector<const SortKeyHash*> knownKeys;
+  for(int i = 0; i < fields.count(); ++i) {
+    QHash<int, SortKeyHash>::ConstIterator it = m_sortKeys.constFind(m_passColumns.at(i));
+    knownKeys << (it == m_sortKeys.constEnd() ? nullptr : &it.value());
+  }
+
+  const int rows = sourceModel()->rowCount();
+  QVector<QList<QStringList> > filterValues;
+  QVector<EntrySortThread::SortValue> sortValues;
+  if(filter) {
+    filterValues.reserve(rows);
+  }
+  sortValues.reserve(rows * fields.count());
+  m_passRows.resize(rows);
+  int passCount = 0;
+  for(int row = 0; row < rows; ++row) {
+    const QModelIndex index = sourceModel()->index(row, 0);
+    Data::EntryPtr entry = index.data(EntryPtrRole).value<Data::EntryPtr>();
+    if(!entry) {
+      m_passRows.clear();
+      return false;
+    }
+    PassRow& passRow = m_passRows[row];
+    passRow.entry = entry.data();
+    passRow.revision = entry->revision();
+    if(filtered && !mapFromSource(index).isValid()) {
+      passRow.index = -1;
+      continue;
+    }
+    passRow.index = passCount++;
+    if(filter) {
+      filterValues << filter->values(entry);
+    }
+    // the workers create the keys, only the formatted values are read here
+    for(int i = 0; i < fields.count(); ++i) {
+      EntrySortThread::SortValue value;
+      if(knownKeys.at(i)) {
+        SortKeyHash::ConstIterator it = knownKeys.at(i)->constFind(passRow.entry);
+        if(it != knownKeys.at(i)->constEnd() && it.value().revision == passRow.revision) {
+          value.key = it.value().key;
+          value.hasKey = true;
+        }
+      }
+      if(!value.hasKey) {
+        value.value = entry->formatField(fields.at(i));
+      }
+      sortValues << value;
+    }
+  }
+  if(passCount == 0) {
+    m_passRows.clear();
+    return false;
+  }
+
+  m_thread = new EntrySortThread(passCount, filter, filterValues, fields, sortValues, this);
+  connect(m_thread, SIGNAL(finished()), SLOT(slotParallelPassFinished()));
+  connect(m_thread, SIGNAL(finished()), m_thread, SLOT(deleteLater()));
+  m_thread->start();
+  return true;
+}
+
+void EntrySortModel::cancelParallelPass() {
+  m_passRows.clear();
+  if(!m_thread) {
+    return;
+  }
+  // the thread deletes itself once it notices, or gets waited for when the model is deleted
+  disconnect(m_thread, nullptr, this, nullptr);
+  m_thread->slotCancel();
+  m_thread = nullptr;
+}
+
+void EntrySortModel::applyPendingChanges() {
+  cancelParallelPass();
+  if(m_pendingSort) {
+    m_pendingSort = false;
+    AbstractSortModel::sort(m_pendingSortColumn, m_pendingSortOrder);
+  }
+  if(m_pendingFilter) {
+    m_pendingFilter = false;
+    invalidateFilter();
+  }
+}
+
+void EntrySortModel::slotRestartParallelPass() {
+  if(m_thread || (!m_pendingSort && !m_pendingFilter)) {
+    return;
+  }
+  if(!startParallelPass()) {
+    applyPendingChanges();
+  }
+}
+
+void EntrySortModel::slotParallelPassFinished() {
+  if(!m_thread || sender() != m_thread) {
+    return;
+  }
+  const QVector<int> passRanks = m_thread->ranks();
+  const QVector<EntrySortThread::SortValue> sortValues = m_thread->sortValues();
+  m_thread = nullptr;
+  if(passRanks.isEmpty()) {
+    applyPendingChanges();
+    return;
+  }
+
+  const int fieldCount = sortValues.count() / passRanks.count();
+  m_ranks.fill(-1, m_passRows.count());
+  for(int row = 0; row < m_passRows.count(); ++row) {
+    const PassRow& passRow = m_passRows.at(row);
+    if(passRow.index < 0) {
+      continue;
+    }
+    if(!passRow.entry) {
+      m_ranks[row] = -2;
+      continue;
+    }
+    m_ranks[row] = passRanks.at(passRow.index);
+    // the keys are kept for sorting later changes
+    for(int i = 0; i < fieldCount; ++i) {
+      const EntrySortThread::SortValue& value = sortValues.at(passRow.index*fieldCount + i);
+      if(value.hasKey) {
+        CachedSortKey cached;
+        cached.key = value.key;
+        cached.revision = passRow.revision;
+        m_sortKeys[m_passColumns.at(i)].insert(passRow.entry, cached);
+      }
+    }
+  }
+  m_rankColumns = m_passColumns;
+  m_passRows.clear();
+
+  // the new sort columns are only recorded here, without moving the rows, since invalidate()
+  // filters and sorts every row again by its rank, so the views get a single layout change
+  if(m_pendingSort) {
+    m_pendingSort = false;
+    const bool blocked = blockSignals(true);
+    AbstractSortModel::sort(m_pendingSortColumn, m_pendingSortOrder);
+    blockSignals(blocked);
+  }
+  m_pendingFilter = false;
+  invalidate();
+  emit signalParallelPassFinished();
+}
+
+QVector<int> EntrySortModel::passSortColumns() const {
+  // same as the columns that AbstractSortModel::sort() will end up with
+  QVector<int> cols;
+  if(m_pendingSort && m_pendingSortColumn != sortColumn()) {
+    cols << m_pendingSortColumn << sortColumn() << secondarySortColumn();
+  } else {
+    cols << sortColumn() << secondarySortColumn() << tertiarySortColumn();
+  }
+  return cols;
+}
+
+bool EntrySortModel::ranksMatchSortColumns() const {
+  return m_rankColumns.size() == 3 && !m_ranks.isEmpty() &&
+         m_rankColumns.at(0) == sortColumn() &&
+         m_rankColumns.at(1) == secondarySortColumn() &&
+         m_rankColumns.at(2) == tertiarySortColumn();
+}
+
+int EntrySortModel::rank(int row_) const {
+  if(row_ < 0 || row_ >= m_ranks.size()) {
+    return -2;
+  }
+  return m_ranks.at(row_);
+}
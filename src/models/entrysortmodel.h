@@ -26,14 +26,17 @@
 #define TELLICO_ENTRYSORTMODEL_H
 
 #include "abstractsortmodel.h"
+#include "stringcomparison.h"
 #include "../datavectors.h"
 #include "../filter.h"
 
 #include <QHash>
+#include <QVector>
 
 namespace Tellico {
 
 class FieldComparison;
+class EntrySortThread;
 
 /**
  * @author Robby Stephenson
@@ -43,9 +46,26 @@ Q_OBJECT
 
 public:
   EntrySortModel(QObject* parent);
+  ~EntrySortModel();
 
   void setFilter(FilterPtr filter);
   FilterPtr filter() const;
+  /**
+   * In parallel mode, changing the filter or the sort column of a large model filters
+   * and sorts the entries in a background thread, and the result is applied all at once,
+   * with a single layout change. A change made while the previous one is still running cancels it.
+   */
+  void setParallel(bool parallel);
+  bool isParallel() const { return m_parallel; }
+
+  virtual void setSourceModel(QAbstractItemModel* sourceModel) Q_DECL_OVERRIDE;
+  virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+  /**
+   * Emitted after the result of a parallel filter and sort pass has been applied.
+   */
+  void signalParallelPassFinished();
 
 protected:
   virtual bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const Q_DECL_OVERRIDE;
@@ -53,12 +73,67 @@ protected:
 
 private Q_SLOTS:
   void clearData();
+  void clearSortKeys();
+  void clearRanks();
+  void slotDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+  void slotParallelPassFinished();
+  void slotRestartParallelPass();
 
 private:
+  struct CachedSortKey {
+    SortKey key;
+    int revision;
+  };
+  typedef QHash<const Data::Entry*, CachedSortKey> SortKeyHash;
+  struct PassRow {
+    // null once the entry is modified during the pass
+    const Data::Entry* entry;
+    int revision;
+    // the row in the pass, or -1 if the filter already rejected it
+    int index;
+  };
+
   FieldComparison* getComparison(const QModelIndex& index) const;
+  /**
+   * Returns the sort key of an entry for a column. The first time a column is sorted,
+   * the keys for every row are calculated at once.
+   */
+  SortKey sortKey(FieldComparison* comp, int column, Data::EntryPtr entry) const;
+  void materializeSortKeys(FieldComparison* comp, int column) const;
+
+  /**
+   * Starts a pass for the pending changes. Only the filter values are read when the sort
+   * order has not changed, and only the sort values when the filter has not changed.
+   */
+  bool startParallelPass();
+  void cancelParallelPass();
+  void applyPendingChanges();
+  QVector<int> passSortColumns() const;
+  bool ranksMatchSortColumns() const;
+  /**
+   * Returns the rank of a row from the last parallel pass, -1 if the row was not accepted
+   * by the filter, or -2 if the row has been modified since the pass started.
+   */
+  int rank(int row) const;
 
   FilterPtr m_filter;
   mutable QHash<int, FieldComparison*> m_comparisons;
+  // the keys are checked against the entry revision, so modified entries are never compared with old values
+  mutable QHash<int, SortKeyHash> m_sortKeys;
+
+  bool m_parallel;
+  EntrySortThread* m_thread;
+  // the rows and sort columns of the running pass
+  QVector<PassRow> m_passRows;
+  QVector<int> m_passColumns;
+  // the result of the last pass, by source row. Cleared when the source rows move.
+  QVector<int> m_ranks;
+  QVector<int> m_rankColumns;
+  // the changes waiting for the running pass
+  bool m_pendingSort;
+  int m_pendingSortColumn;
+  Qt::SortOrder m_pendingSortOrder;
+  bool m_pendingFilter;
 };
 
 } // end namespace
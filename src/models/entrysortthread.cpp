@@ -0,0 +1,185 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "entrysortthread.h"
+#include "fieldcomparison.h"
+#include "../field.h"
+#include "../filter.h"
+
+#include <algorithm>
+
+using Tellico::EntrySortThread;
+
+namespace {
+  // the fewest rows worth handing to a separate thread
+  static const int ENTRY_SORT_MIN_ROWS_PER_THREAD = 500;
+
+  // compares two rows by their sort keys, one field after the other
+  class RowLessThan {
+  public:
+    RowLessThan(const QList<Tellico::FieldComparison*>& comps_, const EntrySortThread::SortValue* values_)
+        : m_comps(comps_), m_values(values_) {}
+
+    int compare(int row1_, int row2_) const {
+      const int count = m_comps.count();
+      for(int i = 0; i < count; ++i) {
+        const int res = m_comps.at(i)->compare(m_values[row1_*count + i].key, m_values[row2_*count + i].key);
+        if(res != 0) {
+          return res;
+        }
+      }
+      return 0;
+    }
+
+    bool operator()(int row1_, int row2_) const {
+      return compare(row1_, row2_) < 0;
+    }
+
+  private:
+    QList<Tellico::FieldComparison*> m_comps;
+    const EntrySortThread::SortValue* m_values;
+  };
+}
+
+// filters a range of the rows, creates their missing sort keys, and sorts them
+class EntrySortThread::Worker : public QThread {
+public:
+  Worker(EntrySortThread* parent_, const QList<FieldComparison*>& comps_, SortValue* values_, int begin_, int end_)
+      : QThread(), m_parent(parent_), m_comps(comps_), m_values(values_), m_begin(begin_), m_end(end_) {}
+
+  // the rows accepted by the filter, in sort order
+  QVector<int> rows;
+
+protected:
+  virtual void run() Q_DECL_OVERRIDE {
+    const FilterPtr filter = m_parent->m_filter;
+    const int count = m_comps.count();
+    for(int row = m_begin; row < m_end; ++row) {
+      if(row % 64 == 0 && m_parent->isCancelled()) {
+        break;
+      }
+      if(filter && !filter->matchesValues(m_parent->m_filterValues.at(row))) {
+        continue;
+      }
+      // only the rows which are shown need keys
+      for(int i = 0; i < count; ++i) {
+        SortValue& value = m_values[row*count + i];
+        if(!value.hasKey) {
+          value.key = m_comps.at(i)->sortKey(value.value);
+          value.hasKey = true;
+        }
+      }
+      rows.append(row);
+    }
+    if(count > 0 && !m_parent->isCancelled()) {
+      std::stable_sort(rows.begin(), rows.end(), RowLessThan(m_comps, m_values));
+    }
+  }
+
+private:
+  EntrySortThread* m_parent;
+  QList<FieldComparison*> m_comps;
+  SortValue* m_values;
+  int m_begin;
+  int m_end;
+};
+
+EntrySortThread::EntrySortThread(int rowCount_, FilterPtr filter_, const QVector<QList<QStringList> >& filterValues_,
+                                 const Data::FieldList& sortFields_, const QVector<SortValue>& sortValues_,
+                                 QObject* parent_)
+    : QThread(parent_), m_rowCount(rowCount_), m_filterValues(filterValues_)
+    , m_sortValues(sortValues_), m_cancelled(0) {
+  if(filter_ && !filter_->isEmpty()) {
+    Q_ASSERT(m_filterValues.count() == m_rowCount);
+    m_filter = filter_;
+  }
+  Q_ASSERT(m_sortValues.count() == m_rowCount * sortFields_.count());
+  m_threadCount = qBound(1, m_rowCount / ENTRY_SORT_MIN_ROWS_PER_THREAD, qMax(1, QThread::idealThreadCount()));
+  // the comparisons are created here, where the fields and the config can be read
+  for(int i = 0; i < m_threadCount; ++i) {
+    QList<FieldComparison*> comps;
+    foreach(Data::FieldPtr field, sortFields_) {
+      Q_ASSERT(field->type() != Data::Field::Image);
+      comps << FieldComparison::create(field);
+    }
+    m_comparisons << comps;
+  }
+}
+
+EntrySortThread::~EntrySortThread() {
+  foreach(const QList<FieldComparison*>& comps, m_comparisons) {
+    qDeleteAll(comps);
+  }
+}
+
+bool EntrySortThread::isCancelled() const {
+  return m_cancelled.loadAcquire();
+}
+
+void EntrySortThread::slotCancel() {
+  m_cancelled.storeRelease(1);
+}
+
+void EntrySortThread::run() {
+  const int rowCount = m_rowCount;
+  const int chunkSize = (rowCount + m_threadCount - 1) / m_threadCount;
+  // each worker only writes the keys of its own rows
+  SortValue* values = m_sortValues.data();
+  QList<Worker*> workers;
+  for(int begin = 0; begin < rowCount; begin += chunkSize) {
+    Worker* worker = new Worker(this, m_comparisons.at(workers.count()), values, begin, qMin(begin + chunkSize, rowCount));
+    workers << worker;
+    worker->start();
+  }
+  foreach(Worker* worker, workers) {
+    worker->wait();
+  }
+
+  const QList<FieldComparison*> comps = m_comparisons.first();
+  const RowLessThan lessThan(comps, values);
+  QVector<int> rows;
+  rows.reserve(rowCount);
+  foreach(Worker* worker, workers) {
+    if(isCancelled()) {
+      break;
+    }
+    const int middle = rows.count();
+    rows += worker->rows;
+    if(!comps.isEmpty()) {
+      std::inplace_merge(rows.begin(), rows.begin() + middle, rows.end(), lessThan);
+    }
+  }
+
+  if(!isCancelled()) {
+    m_ranks.fill(-1, rowCount);
+    int rank = 0;
+    for(int i = 0; i < rows.count(); ++i) {
+      if(i > 0 && lessThan.compare(rows.at(i-1), rows.at(i)) != 0) {
+        ++rank;
+      }
+      m_ranks[rows.at(i)] = rank;
+    }
+  }
+  qDeleteAll(workers);
+}
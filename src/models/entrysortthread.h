@@ -0,0 +1,111 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_ENTRYSORTTHREAD_H
+#define TELLICO_ENTRYSORTTHREAD_H
+
+#include "stringcomparison.h"
+#include "../datavectors.h"
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+
+namespace Tellico {
+  class FieldComparison;
+
+/**
+ * Filters and sorts a list of entries in a background thread, splitting the work
+ * over every available processor.
+ *
+ * The model reads everything the filter and the sort look at from the entries in the main
+ * thread, before creating the thread: the values each filter rule matches, and either the
+ * sort key or the formatted value of each sort field. The workers create the missing keys,
+ * match the values and compare the keys, and never touch an entry, a field, or the collection.
+ * Image fields can not be sorted, since the image factory can only be used from the main thread.
+ */
+class EntrySortThread : public QThread {
+Q_OBJECT
+
+public:
+  /**
+   * The value of a row for one of the sort fields. When the model already has the key,
+   * the formatted value is not needed.
+   */
+  struct SortValue {
+    SortValue() : hasKey(false) {}
+    QString value;
+    SortKey key;
+    bool hasKey;
+  };
+
+  /**
+   * @param rowCount The number of rows
+   * @param filter The filter, which may be null to accept every row. The thread compiles
+   *               its own copy, which must be the same as the filter the values were read with.
+   * @param filterValues The values of each row from Filter::values(). Empty when there is no filter.
+   * @param sortFields The fields to sort by, the most significant first. May be empty.
+   * @param sortValues The sort values of each row, one for each sort field
+   */
+  EntrySortThread(int rowCount, FilterPtr filter, const QVector<QList<QStringList> >& filterValues,
+                  const Data::FieldList& sortFields, const QVector<SortValue>& sortValues,
+                  QObject* parent = nullptr);
+  ~EntrySortThread();
+
+  bool isCancelled() const;
+  /**
+   * Returns the rank of each row in sort order, or -1 for rows which are not
+   * accepted by the filter. Rows which sort equally have the same rank. Only valid
+   * after the thread is finished, if it was not cancelled.
+   */
+  QVector<int> ranks() const { return m_ranks; }
+  /**
+   * Returns the sort values, with every key filled in by the workers, so the model
+   * can keep them. Only valid after the thread is finished, if it was not cancelled.
+   */
+  QVector<SortValue> sortValues() const { return m_sortValues; }
+
+public Q_SLOTS:
+  void slotCancel();
+
+protected:
+  virtual void run() Q_DECL_OVERRIDE;
+
+private:
+  class Worker;
+
+  int m_rowCount;
+  int m_threadCount;
+  FilterPtr m_filter;
+  QVector<QList<QStringList> > m_filterValues;
+  // the keys are created by each worker with its own comparisons, since a collator is not
+  // safe to share between threads. Comparing keys only reads them, so the merge uses the first set.
+  QList<QList<FieldComparison*> > m_comparisons;
+  QVector<SortValue> m_sortValues;
+  QAtomicInt m_cancelled;
+  QVector<int> m_ranks;
+};
+
+} // end namespace
+#endif
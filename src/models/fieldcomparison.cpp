@@ -23,7 +23,6 @@
  ***************************************************************************/
 
 #include "fieldcomparison.h"
-#include "stringcomparison.h"
 #include "../field.h"
 #include "../collection.h"
 #include "../document.h"
@@ -53,6 +52,11 @@ int Tellico::FieldComparison::compare(Data::EntryPtr entry1_, Data::EntryPtr ent
   return compare(entry1_->formattedField(m_field), entry2_->formattedField(m_field));
 }
 
+Tellico::SortKey Tellico::FieldComparison::sortKey(Data::EntryPtr entry_) {
+  // the key is kept instead, so there's no need to keep the formatted value in the entry too
+  return sortKey(entry_->formatField(m_field));
+}
+
 Tellico::ValueComparison::ValueComparison(Data::FieldPtr field, StringComparison* comp)
     : FieldComparison(field)
     , m_stringComparison(comp) {
@@ -67,6 +71,14 @@ int Tellico::ValueComparison::compare(const QString& str1_, const QString& str2_
   return m_stringComparison->compare(str1_, str2_);
 }
 
+Tellico::SortKey Tellico::ValueComparison::sortKey(const QString& str_) {
+  return m_stringComparison->sortKey(str_);
+}
+
+int Tellico::ValueComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return m_stringComparison->compare(key1_, key2_);
+}
+
 Tellico::ImageComparison::ImageComparison(Data::FieldPtr field) : FieldComparison(field) {
 }
 
@@ -96,6 +108,23 @@ int Tellico::ImageComparison::compare(const QString& str1_, const QString& str2_
   return image1.width() - image2.width();
 }
 
+Tellico::SortKey Tellico::ImageComparison::sortKey(const QString& str_) {
+  // empty values sort before null images, which sort before all others
+  SortKey key;
+  key.isNull = str_.isEmpty();
+  if(key.isNull) {
+    key.value = -2;
+  } else {
+    const Data::Image& image = ImageFactory::imageById(str_);
+    key.value = image.isNull() ? -1 : image.width();
+  }
+  return key;
+}
+
+int Tellico::ImageComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return key1_.value < key2_.value ? -1 : (key1_.value > key2_.value ? 1 : 0);
+}
+
 Tellico::ChoiceComparison::ChoiceComparison(Data::FieldPtr field) : FieldComparison(field) {
   m_values = field->allowed();
 }
@@ -103,3 +132,14 @@ Tellico::ChoiceComparison::ChoiceComparison(Data::FieldPtr field) : FieldCompari
 int Tellico::ChoiceComparison::compare(const QString& str1, const QString& str2) {
   return m_values.indexOf(str1) - m_values.indexOf(str2);
 }
+
+Tellico::SortKey Tellico::ChoiceComparison::sortKey(const QString& str_) {
+  SortKey key;
+  key.isNull = str_.isEmpty();
+  key.value = m_values.indexOf(str_);
+  return key;
+}
+
+int Tellico::ChoiceComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return key1_.value < key2_.value ? -1 : (key1_.value > key2_.value ? 1 : 0);
+}
@@ -25,14 +25,13 @@
 #ifndef TELLICO_FIELDCOMPARISON_H
 #define TELLICO_FIELDCOMPARISON_H
 
+#include "stringcomparison.h"
 #include "../datavectors.h"
 
 #include <QStringList>
 
 namespace Tellico {
 
-class StringComparison;
-
 class FieldComparison {
 public:
   FieldComparison(Data::FieldPtr field);
@@ -41,6 +40,18 @@ public:
   Data::FieldPtr field() const { return m_field; }
 
   virtual int compare(Data::EntryPtr entry1, Data::EntryPtr entry2);
+  /**
+   * Returns the sort key for the field value of an entry. Comparing the keys of two entries
+   * gives the same result as comparing the entries themselves.
+   */
+  SortKey sortKey(Data::EntryPtr entry);
+  /**
+   * Returns the sort key for a formatted field value. Except for images, the key is created
+   * without reading any entry, field, or config, so it can be done in another thread, as long
+   * as no other thread uses the same comparison.
+   */
+  virtual SortKey sortKey(const QString& str) = 0;
+  virtual int compare(const SortKey& key1, const SortKey& key2) = 0;
 
   static FieldComparison* create(Data::FieldPtr field);
 
@@ -57,9 +68,11 @@ public:
   ~ValueComparison();
 
   using FieldComparison::compare;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 
 protected:
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
 
 private:
   StringComparison* m_stringComparison;
@@ -70,9 +83,11 @@ public:
   ImageComparison(Data::FieldPtr field);
 
   using FieldComparison::compare;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 
 protected:
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
 };
 
 class ChoiceComparison : public FieldComparison {
@@ -80,9 +95,11 @@ public:
   ChoiceComparison(Data::FieldPtr field);
 
   using FieldComparison::compare;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 
 protected:
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
 
 private:
   QStringList m_values;
@@ -24,9 +24,12 @@
 
 #include "stringcomparison.h"
 #include "../fieldformat.h"
+#include "../config/tellico_config.h"
 #include "../tellico_debug.h"
 
 #include <QDateTime>
+#include <QLocale>
+#include <QtNumeric>
 
 namespace {
   int compareFloat(const QString& s1, const QString& s2) {
@@ -41,6 +44,38 @@ namespace {
     }
     return n1 > n2 ? 1 : (n1 < n2 ? -1 : 0);
   }
+
+  // a value which fails to parse is kept as NaN, which compares equal to everything, like compareFloat()
+  float parseFloat(const QString& s) {
+    bool ok;
+    const float n = s.toFloat(&ok);
+    return ok ? n : qQNaN();
+  }
+
+  int compareFloat(float n1, float n2) {
+    return n1 > n2 ? 1 : (n1 < n2 ? -1 : 0);
+  }
+
+  // modelled after Field::formatDate()
+  // so dates would sort as expected without padding month and day with zero
+  // and accounting for "current year - 1 - 1" default scheme
+  QDate parseDate(const QString& str) {
+    QStringList dlist = str.split(QLatin1Char('-'), QString::KeepEmptyParts);
+    bool ok = true;
+    int y = dlist.count() > 0 ? dlist[0].toInt(&ok) : QDate::currentDate().year();
+    if(!ok) {
+      y = QDate::currentDate().year();
+    }
+    int m = dlist.count() > 1 ? dlist[1].toInt(&ok) : 1;
+    if(!ok) {
+      m = 1;
+    }
+    int d = dlist.count() > 2 ? dlist[2].toInt(&ok) : 1;
+    if(!ok) {
+      d = 1;
+    }
+    return QDate(y, m, d);
+  }
 }
 
 Tellico::StringComparison* Tellico::StringComparison::create(Data::FieldPtr field_) {
@@ -64,13 +99,36 @@ Tellico::StringComparison* Tellico::StringComparison::create(Data::FieldPtr fiel
   return new StringComparison();
 }
 
-Tellico::StringComparison::StringComparison() {
+// the keys have to sort the same as QString::localeAwareCompare(), which uses the system locale
+Tellico::StringComparison::StringComparison() : m_collator(QLocale::system()) {
 }
 
 int Tellico::StringComparison::compare(const QString& str1_, const QString& str2_) {
   return str1_.localeAwareCompare(str2_);
 }
 
+Tellico::SortKey Tellico::StringComparison::sortKey(const QString& str_) {
+  return collationKey(str_);
+}
+
+int Tellico::StringComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return compareCollation(key1_, key2_);
+}
+
+Tellico::SortKey Tellico::StringComparison::collationKey(const QString& str_) {
+  SortKey key;
+  key.collationKey = QSharedPointer<QCollatorSortKey>(new QCollatorSortKey(m_collator.sortKey(str_)));
+  key.isNull = str_.isEmpty();
+  return key;
+}
+
+int Tellico::StringComparison::compareCollation(const SortKey& key1_, const SortKey& key2_) {
+  if(!key1_.collationKey || !key2_.collationKey) {
+    return key1_.collationKey ? 1 : (key2_.collationKey ? -1 : 0);
+  }
+  return key1_.collationKey->compare(*key2_.collationKey);
+}
+
 Tellico::BoolComparison::BoolComparison() : StringComparison() {
 }
 
@@ -78,15 +136,35 @@ int Tellico::BoolComparison::compare(const QString& str1_, const QString& str2_)
   return str1_.compare(str2_);
 }
 
-Tellico::TitleComparison::TitleComparison() : StringComparison() {
+Tellico::SortKey Tellico::BoolComparison::sortKey(const QString& str_) {
+  SortKey key;
+  key.text = str_;
+  key.isNull = str_.isEmpty();
+  return key;
+}
+
+int Tellico::BoolComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return key1_.text.compare(key2_.text);
+}
+
+Tellico::TitleComparison::TitleComparison() : StringComparison()
+    , m_articles(Config::articleList()), m_aposArticles(Config::articleAposList()) {
 }
 
 int Tellico::TitleComparison::compare(const QString& str1_, const QString& str2_) {
-  const QString title1 = FieldFormat::sortKeyTitle(str1_).toLower();
-  const QString title2 = FieldFormat::sortKeyTitle(str2_).toLower();
+  const QString title1 = FieldFormat::sortKeyTitle(str1_, m_articles, m_aposArticles).toLower();
+  const QString title2 = FieldFormat::sortKeyTitle(str2_, m_articles, m_aposArticles).toLower();
   return title1.localeAwareCompare(title2);
 }
 
+Tellico::SortKey Tellico::TitleComparison::sortKey(const QString& str_) {
+  return collationKey(FieldFormat::sortKeyTitle(str_, m_articles, m_aposArticles).toLower());
+}
+
+int Tellico::TitleComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  return compareCollation(key1_, key2_);
+}
+
 Tellico::NumberComparison::NumberComparison() : StringComparison() {
 }
 
@@ -123,6 +201,34 @@ int Tellico::NumberComparison::compare(const QString& str1_, const QString& str2
   return 0;
 }
 
+Tellico::SortKey Tellico::NumberComparison::sortKey(const QString& str_) {
+  SortKey key;
+  key.isNull = str_.isEmpty();
+  // the comparison stops at the first value which is not a number, so only the leading numbers matter
+  foreach(const QString& value, FieldFormat::splitValue(str_)) {
+    bool ok;
+    const float num = value.toFloat(&ok);
+    if(!ok) {
+      break;
+    }
+    key.numbers.append(num);
+  }
+  return key;
+}
+
+int Tellico::NumberComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  const int count = qMin(key1_.numbers.count(), key2_.numbers.count());
+  for(int index = 0; index < count; ++index) {
+    const float num1 = key1_.numbers.at(index);
+    const float num2 = key2_.numbers.at(index);
+    if(!qFuzzyCompare(num1, num2)) {
+      const float ret = num1 - num2;
+      return ret < 0 ? qMin(-1, qRound(ret)) : qMax(1, qRound(ret));
+    }
+  }
+  return key1_.numbers.count() > count ? 1 : (key2_.numbers.count() > count ? -1 : 0);
+}
+
 // for details on the LCC comparison, see
 // http://www.mcgees.org/2001/08/08/sort-by-library-of-congress-call-number-in-perl/
 // http://library.dts.edu/Pages/RM/Helps/lc_call.shtml
@@ -158,6 +264,35 @@ int Tellico::LCCComparison::compare(const QString& str1_, const QString& str2_)
   return StringComparison::compare(str1_, str2_);
 }
 
+Tellico::SortKey Tellico::LCCComparison::sortKey(const QString& str_) {
+  // the collation key is only used when one of the values is not an LCC number
+  SortKey key = collationKey(str_);
+  if(m_regexp.indexIn(str_) == -1) {
+    return key;
+  }
+  const QStringList cap = m_regexp.capturedTexts();
+  key.parts << cap[1] << cap[3] << cap[5] << cap[7];
+  key.numbers << parseFloat(cap[2])
+              << parseFloat(QLatin1String("0.") + cap[4])
+              << parseFloat(QLatin1String("0.") + cap[6]);
+  return key;
+}
+
+int Tellico::LCCComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  if(key1_.parts.isEmpty() || key2_.parts.isEmpty()) {
+    return compareCollation(key1_, key2_);
+  }
+  // same order as compareLCC()
+  int res = 0;
+  return (res = key1_.parts[0].compare(key2_.parts[0]))            != 0 ? res :
+         (res = compareFloat(key1_.numbers[0], key2_.numbers[0])) != 0 ? res :
+         (res = key1_.parts[1].compare(key2_.parts[1]))            != 0 ? res :
+         (res = compareFloat(key1_.numbers[1], key2_.numbers[1])) != 0 ? res :
+         (res = key1_.parts[2].compare(key2_.parts[2]))            != 0 ? res :
+         (res = compareFloat(key1_.numbers[2], key2_.numbers[2])) != 0 ? res :
+         (res = key1_.parts[3].compare(key2_.parts[3]))            != 0 ? res : 0;
+}
+
 int Tellico::LCCComparison::compareLCC(const QStringList& cap1, const QStringList& cap2) const {
   // the first item in the list is the full match, so start array index at 1
   int res = 0;
@@ -182,40 +317,8 @@ int Tellico::ISODateComparison::compare(const QString& str1, const QString& str2
   if(str2.isEmpty()) { // str1 is not
     return 1;
   }
-  // modelled after Field::formatDate()
-  // so dates would sort as expected without padding month and day with zero
-  // and accounting for "current year - 1 - 1" default scheme
-  QStringList dlist1 = str1.split(QLatin1Char('-'), QString::KeepEmptyParts);
-  bool ok = true;
-  int y1 = dlist1.count() > 0 ? dlist1[0].toInt(&ok) : QDate::currentDate().year();
-  if(!ok) {
-    y1 = QDate::currentDate().year();
-  }
-  int m1 = dlist1.count() > 1 ? dlist1[1].toInt(&ok) : 1;
-  if(!ok) {
-    m1 = 1;
-  }
-  int d1 = dlist1.count() > 2 ? dlist1[2].toInt(&ok) : 1;
-  if(!ok) {
-    d1 = 1;
-  }
-  QDate date1(y1, m1, d1);
-
-  QStringList dlist2 = str2.split(QLatin1Char('-'), QString::KeepEmptyParts);
-  int y2 = dlist2.count() > 0 ? dlist2[0].toInt(&ok) : QDate::currentDate().year();
-  if(!ok) {
-    y2 = QDate::currentDate().year();
-  }
-  int m2 = dlist2.count() > 1 ? dlist2[1].toInt(&ok) : 1;
-  if(!ok) {
-    m2 = 1;
-  }
-  int d2 = dlist2.count() > 2 ? dlist2[2].toInt(&ok) : 1;
-  if(!ok) {
-    d2 = 1;
-  }
-  QDate date2(y2, m2, d2);
-
+  const QDate date1 = parseDate(str1);
+  const QDate date2 = parseDate(str2);
   if(date1 < date2) {
     return -1;
   } else if(date1 > date2) {
@@ -223,3 +326,23 @@ int Tellico::ISODateComparison::compare(const QString& str1, const QString& str2
   }
   return 0;
 }
+
+Tellico::SortKey Tellico::ISODateComparison::sortKey(const QString& str_) {
+  SortKey key;
+  if(!str_.isEmpty()) {
+    // an invalid date has the smallest julian day, so it sorts first, just like QDate::operator<
+    key.value = parseDate(str_).toJulianDay();
+    key.isNull = false;
+  }
+  return key;
+}
+
+int Tellico::ISODateComparison::compare(const SortKey& key1_, const SortKey& key2_) {
+  if(key1_.isNull) {
+    return key2_.isNull ? 0 : -1;
+  }
+  if(key2_.isNull) {
+    return 1;
+  }
+  return key1_.value < key2_.value ? -1 : (key1_.value > key2_.value ? 1 : 0);
+}
@@ -26,42 +26,88 @@
 #define TELLICO_STRINGCOMPARISON_H
 
 #include <QRegExp>
+#include <QCollator>
+#include <QSharedPointer>
+#include <QVector>
 
 #include "../datavectors.h"
 
 namespace Tellico {
 
+/**
+ * A value prepared for sorting. A comparison creates the key once for each value, so
+ * that sorting does not have to format and parse the same value for every comparison.
+ * Which members are used depends on the comparison that created the key.
+ */
+class SortKey {
+public:
+  SortKey() : value(0), isNull(true) {}
+
+  QString text;
+  QStringList parts;
+  QVector<float> numbers;
+  QSharedPointer<QCollatorSortKey> collationKey;
+  qint64 value;
+  bool isNull;
+};
+
 class StringComparison {
 public:
   StringComparison();
   virtual ~StringComparison() {}
   virtual int compare(const QString& str1, const QString& str2);
+  /**
+   * Returns a key for the string, such that comparing two keys gives the same result
+   * as comparing the two strings
+   */
+  virtual SortKey sortKey(const QString& str);
+  virtual int compare(const SortKey& key1, const SortKey& key2);
 
   static StringComparison* create(Data::FieldPtr field);
+
+protected:
+  SortKey collationKey(const QString& str);
+  static int compareCollation(const SortKey& key1, const SortKey& key2);
+
+private:
+  QCollator m_collator;
 };
 
 class BoolComparison : public StringComparison {
 public:
   BoolComparison();
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 };
 
 class TitleComparison : public StringComparison {
 public:
   TitleComparison();
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
+
+private:
+  // read from the config once, so keys can be created in another thread
+  QStringList m_articles;
+  QStringList m_aposArticles;
 };
 
 class NumberComparison : public StringComparison {
 public:
   NumberComparison();
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 };
 
 class LCCComparison : public StringComparison {
 public:
   LCCComparison();
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 
 private:
   int compareLCC(const QStringList& cap1, const QStringList& cap2) const;
@@ -72,6 +118,8 @@ class ISODateComparison : public StringComparison {
 public:
   ISODateComparison();
   virtual int compare(const QString& str1, const QString& str2) Q_DECL_OVERRIDE;
+  virtual SortKey sortKey(const QString& str) Q_DECL_OVERRIDE;
+  virtual int compare(const SortKey& key1, const SortKey& key2) Q_DECL_OVERRIDE;
 };
 
 }
@@ -150,6 +150,8 @@ void Kernel::addEntries(Tellico::Data::EntryList entries_, bool checkFields_) {
   if(entries_.isEmpty()) {
     return;
   }
+  // the new entries get ids after all the ones in the file being opened
+  Data::Document::self()->finishLoading();
 
   QUndoCommand* cmd = new Command::AddEntries(Tellico::Data::Document::self()->collection(), entries_);
   if(checkFields_) {
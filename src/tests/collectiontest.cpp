@@ -29,6 +29,8 @@
 #include "../collection.h"
 #include "../field.h"
 #include "../entry.h"
+#include "../entrygroup.h"
+#include "../entrycomparison.h"
 #include "../collectionfactory.h"
 #include "../collections/collectioninitializer.h"
 #include "../translators/tellicoxmlexporter.h"
@@ -243,6 +245,58 @@ void CollectionTest::testFields() {
   QCOMPARE(coll->fieldByTitle(QLatin1String("Editor")), Tellico::Data::FieldPtr());
 }
 
+void CollectionTest::testFieldSlots() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::Collection(true)); // add default fields
+  Tellico::Data::FieldPtr field1(new Tellico::Data::Field(QLatin1String("test"), QLatin1String("Test")));
+  QVERIFY(coll->addField(field1));
+  const int slot = coll->fieldSlot(QLatin1String("test"));
+  QVERIFY(slot > -1);
+  QCOMPARE(field1->slot(), slot);
+  QCOMPARE(coll->fieldSlot(field1), slot);
+  QCOMPARE(coll->fieldNameBySlot(slot), QLatin1String("test"));
+  QCOMPARE(coll->fieldSlot(QLatin1String("nothing")), -1);
+
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(field1, QLatin1String("value1"));
+  coll->addEntries(entry1);
+  QCOMPARE(entry1->field(field1), QLatin1String("value1"));
+  QVERIFY(entry1->fieldValues().contains(QLatin1String("value1")));
+
+  // a modified field keeps the same slot
+  Tellico::Data::FieldPtr field2(new Tellico::Data::Field(*field1));
+  field2->setTitle(QLatin1String("New Test"));
+  QVERIFY(coll->modifyField(field2));
+  QCOMPARE(field2->slot(), slot);
+  QCOMPARE(entry1->field(field2), QLatin1String("value1"));
+  QCOMPARE(entry1->field(QLatin1String("test")), QLatin1String("value1"));
+
+  // a field from a different collection still finds the value by name
+  Tellico::Data::CollPtr coll2(new Tellico::Data::Collection(true));
+  Tellico::Data::FieldPtr field3(new Tellico::Data::Field(*field1));
+  QVERIFY(coll2->addField(field3));
+  QCOMPARE(entry1->field(field3), QLatin1String("value1"));
+
+  // moving the entry to another collection keeps the values
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(*entry1));
+  entry2->setCollection(coll2);
+  QCOMPARE(entry2->field(field3), QLatin1String("value1"));
+  QCOMPARE(entry2->title(), entry1->title());
+
+  // moving the entry to a collection without the field does not add a slot for it
+  Tellico::Data::CollPtr coll3(new Tellico::Data::Collection(true));
+  Tellico::Data::EntryPtr entry3(new Tellico::Data::Entry(*entry1));
+  entry3->setCollection(coll3);
+  QCOMPARE(coll3->fieldSlot(QLatin1String("test")), -1);
+  QCOMPARE(entry3->field(QLatin1String("test")), QString());
+
+  // removing a field and adding it back keeps the slot
+  QVERIFY(coll->removeField(field2));
+  QCOMPARE(entry1->field(QLatin1String("test")), QString());
+  Tellico::Data::FieldPtr field4(new Tellico::Data::Field(QLatin1String("test"), QLatin1String("Test")));
+  QVERIFY(coll->addField(field4));
+  QCOMPARE(field4->slot(), slot);
+}
+
 void CollectionTest::testDerived() {
   Tellico::Data::CollPtr coll(new Tellico::Data::Collection(true)); // add default field
 
@@ -303,6 +357,31 @@ void CollectionTest::testDerived() {
 
   field->setProperty(QLatin1String("template"), QLatin1String("%{author:-2}"));
   QCOMPARE(entry->field(QLatin1String("test")), QLatin1String("Albert Einstein"));
+
+  // the cached value is updated when the dependent field changes
+  entry->setField(QLatin1String("author"), QLatin1String("Marie Curie; Niels Bohr"));
+  QCOMPARE(entry->field(QLatin1String("test")), QLatin1String("Marie Curie"));
+
+  field->setProperty(QLatin1String("template"), QLatin1String("%{Author:1/u} %{@id}"));
+  QCOMPARE(entry->field(QLatin1String("test")), QLatin1String("MARIE CURIE 1"));
+  entry->setId(5);
+  QCOMPARE(entry->field(QLatin1String("test")), QLatin1String("MARIE CURIE 5"));
+  entry->setId(1);
+
+  // a modified field replaces the cached template
+  Tellico::Data::FieldPtr newField(new Tellico::Data::Field(*field));
+  newField->setProperty(QLatin1String("template"), QLatin1String("%{author:2} %{unknown:1/u}"));
+  QVERIFY(coll->modifyField(newField));
+  QCOMPARE(entry->field(QLatin1String("test")), QLatin1String("Niels Bohr %{unknown:1/u}"));
+
+  // the fields of another collection have nothing to do with the cached values
+  const int revision = coll->derivedRevision();
+  Tellico::Data::CollPtr coll2(new Tellico::Data::Collection(true));
+  Tellico::Data::FieldPtr field4(new Tellico::Data::Field(QLatin1String("test4"), QLatin1String("Test")));
+  field4->setProperty(QLatin1String("template"), QLatin1String("%{title}"));
+  field4->setFlags(Tellico::Data::Field::Derived);
+  coll2->addField(field4);
+  QCOMPARE(coll->derivedRevision(), revision);
 }
 
 void CollectionTest::testValue() {
@@ -608,3 +687,248 @@ void CollectionTest::testMergeBenchmark() {
     Tellico::Data::Document::mergeCollection(coll1, coll2);
   }
 }
+
+void CollectionTest::testMatchIndex() {
+  Tellico::Data::CollPtr coll = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(QLatin1String("title"), QLatin1String("Bend It Like Beckham"));
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll));
+  entry2->setField(QLatin1String("title"), QLatin1String("Bend it like Beckham (Widescreen Edition)"));
+  Tellico::Data::EntryPtr entry3(new Tellico::Data::Entry(coll));
+  entry3->setField(QLatin1String("title"), QLatin1String("To Kill a Mockingbird"));
+  entry3->setField(QLatin1String("isbn"), QLatin1String("978-0-06-112008-4"));
+  Tellico::Data::EntryPtr entry4(new Tellico::Data::Entry(coll));
+  entry4->setField(QLatin1String("title"), QLatin1String("Mockingbird"));
+  entry4->setField(QLatin1String("isbn"), QLatin1String("0061120081"));
+  Tellico::Data::EntryPtr entry5(new Tellico::Data::Entry(coll));
+  entry5->setField(QLatin1String("author"), QLatin1String("Harper Lee"));
+  coll->addEntries(Tellico::Data::EntryList() << entry1 << entry2 << entry3 << entry4 << entry5);
+
+  Tellico::EntryMatchIndex index(coll->entries());
+  QCOMPARE(index.count(), 5);
+
+  // every candidate pair is one that scores on one of the fields compared by sameEntry()
+  QCOMPARE(index.candidates(entry1), Tellico::Data::EntryList() << entry2);
+  QCOMPARE(index.candidates(entry2), Tellico::Data::EntryList() << entry1);
+  QCOMPARE(index.candidates(entry3), Tellico::Data::EntryList() << entry4);
+  QCOMPARE(index.candidates(entry4), Tellico::Data::EntryList() << entry3);
+  QVERIFY(Tellico::EntryComparison::score(entry1, entry2, QLatin1String("title"), coll.data()) > 0);
+  QVERIFY(Tellico::EntryComparison::score(entry3, entry4, QLatin1String("isbn"), coll.data()) > 0);
+  // an entry sharing nothing else can't be a match
+  QVERIFY(index.candidates(entry5).isEmpty());
+
+  // a different title can still match on the other fields
+  Tellico::Data::EntryPtr entry8(new Tellico::Data::Entry(coll));
+  entry8->setField(QLatin1String("title"), QLatin1String("Go Set a Watchman"));
+  entry8->setField(QLatin1String("author"), QLatin1String("Harper Lee"));
+  QVERIFY(coll->sameEntry(entry5, entry8) >= Tellico::EntryComparison::ENTRY_GOOD_MATCH);
+  QCOMPARE(index.candidates(entry8), Tellico::Data::EntryList() << entry5);
+
+  index.remove(entry2);
+  QCOMPARE(index.count(), 4);
+  QVERIFY(index.candidates(entry1).isEmpty());
+
+  // the merge still matches every existing entry
+  Tellico::Data::CollPtr coll2 = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  Tellico::Data::EntryPtr entry6(new Tellico::Data::Entry(*entry4));
+  entry6->setCollection(coll2);
+  Tellico::Data::EntryPtr entry7(new Tellico::Data::Entry(coll2));
+  entry7->setField(QLatin1String("title"), QLatin1String("Go Set a Watchman"));
+  coll2->addEntries(Tellico::Data::EntryList() << entry6 << entry7);
+
+  Tellico::Data::MergePair mergePair = Tellico::Data::Document::mergeCollection(coll, coll2);
+  QCOMPARE(mergePair.first.count(), 1);
+  QCOMPARE(mergePair.first.front()->field(QLatin1String("title")), QLatin1String("Go Set a Watchman"));
+  QCOMPARE(coll->entryCount(), 6);
+}
+
+void CollectionTest::testComparisonKeys() {
+  Tellico::Data::CollPtr coll = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  Tellico::Data::FieldPtr title = coll->fieldByName(QLatin1String("title"));
+  Tellico::Data::FieldPtr isbn = coll->fieldByName(QLatin1String("isbn"));
+
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(title, QLatin1String("Bend It Like Beckham (Widescreen Edition)"));
+  entry1->setField(isbn, QLatin1String("978-0-06-112008-4"));
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll));
+  entry2->setField(title, QLatin1String("Bend it like Beckham"));
+  entry2->setField(isbn, QLatin1String("0-06-112008-1"));
+
+  Tellico::Data::ComparisonKey key = entry1->comparisonKey(title);
+  QVERIFY(key.isValid);
+  QVERIFY(!key.hasIdentifier);
+  QCOMPARE(key.value, QLatin1String("bend it like beckham (widescreen edition)"));
+  QCOMPARE(key.noPunctuation, QLatin1String("bend it like beckham widescreen edition"));
+  QCOMPARE(key.noParentheses, QLatin1String("bend it like beckham"));
+  key = entry1->comparisonKey(isbn);
+  QVERIFY(key.hasIdentifier);
+  QCOMPARE(key.identifier, entry2->comparisonKey(isbn).identifier);
+
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, title), 2);
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, isbn), 5);
+
+  // the cached keys have to be updated when the value changes
+  entry1->setField(title, QLatin1String("Bend It Like Beckham!"));
+  QCOMPARE(entry1->comparisonKey(title).value, QLatin1String("bend it like beckham!"));
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, title), 5);
+  entry1->setField(title, QLatin1String("Whale Rider"));
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, title), 0);
+  entry1->setField(isbn, QString());
+  QVERIFY(entry1->comparisonKey(isbn).value.isEmpty());
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, isbn), 0);
+
+  // released keys are calculated again when needed
+  entry2->clearComparisonKeys();
+  QCOMPARE(entry2->comparisonKey(title).noArticles, QLatin1String("bend it like beckham"));
+  QCOMPARE(Tellico::EntryComparison::score(entry1, entry2, title), 0);
+}
+
+void CollectionTest::testMatchIndexBenchmark() {
+  QFETCH(int, count);
+
+  Tellico::Data::CollPtr coll1 = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  Tellico::Data::CollPtr coll2 = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  Tellico::Data::EntryList entries1, entries2;
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll1));
+    entry1->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i));
+    // the same author is a good enough match on its own
+    entry1->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i));
+    entry1->setField(QLatin1String("pub_year"), QString::number(1900 + i % 100));
+    entries1 << entry1;
+    // half the entries are already in the first collection
+    Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll2));
+    entry2->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i + count/2));
+    entry2->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i + count/2));
+    entry2->setField(QLatin1String("pub_year"), QString::number(1900 + (i + count/2) % 100));
+    entries2 << entry2;
+  }
+  coll1->addEntries(entries1);
+  coll2->addEntries(entries2);
+
+  Tellico::Data::MergePair mergePair;
+  QBENCHMARK_ONCE {
+    mergePair = Tellico::Data::Document::mergeCollection(coll1, coll2);
+  }
+  QCOMPARE(mergePair.first.count(), count - count/2);
+  QCOMPARE(coll1->entryCount(), count + count - count/2);
+}
+
+void CollectionTest::testMatchIndexBenchmark_data() {
+  QTest::addColumn<int>("count");
+  QTest::newRow("1000") << 1000;
+  QTest::newRow("10000") << 10000;
+}
+
+void CollectionTest::testFieldLookupBenchmark() {
+  Tellico::Data::CollPtr coll = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  Tellico::Data::FieldList fields = coll->fields();
+
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < 10000; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 100));
+    entry->setField(QLatin1String("pub_year"), QString::number(1900 + i % 100));
+    entry->setField(QLatin1String("isbn"), QString::number(1000000000 + i));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  int count = 0;
+  QBENCHMARK {
+    foreach(Tellico::Data::EntryPtr entry, entries) {
+      foreach(Tellico::Data::FieldPtr field, fields) {
+        if(!field->hasFlag(Tellico::Data::Field::Derived) && !entry->field(field).isEmpty()) {
+          ++count;
+        }
+      }
+    }
+  }
+  QVERIFY(count > 0);
+}
+
+void CollectionTest::testGroupUpdates() {
+  Tellico::Data::CollPtr coll = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  coll->setTrackGroups(true);
+
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(QLatin1String("author"), QLatin1String("Asimov"));
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll));
+  entry2->setField(QLatin1String("author"), QLatin1String("Asimov; Bradbury"));
+  coll->addEntries(Tellico::Data::EntryList() << entry1 << entry2);
+
+  Tellico::Data::EntryGroupDict* peopleDict = coll->entryGroupDictByName(Tellico::Data::Collection::s_peopleGroupName);
+  QVERIFY(peopleDict);
+  Tellico::Data::EntryGroupDict* authorDict = coll->entryGroupDictByName(QLatin1String("author"));
+  QVERIFY(authorDict);
+  QCOMPARE(authorDict->count(), 2);
+  Tellico::Data::EntryGroup* asimovGroup = authorDict->value(QLatin1String("Asimov"));
+  QVERIFY(asimovGroup);
+  QCOMPARE(asimovGroup->count(), 2);
+  QCOMPARE(peopleDict->value(QLatin1String("Asimov"))->count(), 2);
+
+  // a group that is not affected by the edit keeps its entries
+  entry2->setField(QLatin1String("author"), QLatin1String("Bradbury"));
+  coll->updateDicts(Tellico::Data::EntryList() << entry2, QStringList() << QLatin1String("author"));
+  QCOMPARE(authorDict->value(QLatin1String("Asimov")), asimovGroup);
+  QCOMPARE(asimovGroup->count(), 1);
+  QCOMPARE(authorDict->value(QLatin1String("Bradbury"))->count(), 1);
+  QCOMPARE(peopleDict->value(QLatin1String("Asimov"))->count(), 1);
+  QCOMPARE(peopleDict->value(QLatin1String("Bradbury"))->count(), 1);
+
+  // an emptied group gets removed
+  entry1->setField(QLatin1String("author"), QLatin1String("Bradbury"));
+  coll->updateDicts(Tellico::Data::EntryList() << entry1, QStringList() << QLatin1String("author"));
+  QVERIFY(!authorDict->contains(QLatin1String("Asimov")));
+  QVERIFY(!peopleDict->contains(QLatin1String("Asimov")));
+  QCOMPARE(authorDict->value(QLatin1String("Bradbury"))->count(), 2);
+  QCOMPARE(entry1->groups().count(), 2);
+
+  // editing another field leaves the people groups alone
+  entry1->setField(QLatin1String("title"), QLatin1String("Fahrenheit 451"));
+  coll->updateDicts(Tellico::Data::EntryList() << entry1, QStringList() << QLatin1String("title"));
+  QCOMPARE(peopleDict->value(QLatin1String("Bradbury"))->count(), 2);
+
+  // invalidating keeps the groups whose names did not change
+  Tellico::Data::EntryGroup* bradburyGroup = authorDict->value(QLatin1String("Bradbury"));
+  coll->invalidateGroups();
+  QCOMPARE(authorDict->value(QLatin1String("Bradbury")), bradburyGroup);
+  QCOMPARE(bradburyGroup->count(), 2);
+}
+
+void CollectionTest::testGroupUpdateBenchmark() {
+  QFETCH(int, count);
+
+  Tellico::Data::CollPtr coll = Tellico::CollectionFactory::collection(Tellico::Data::Collection::Book, true);
+  coll->setTrackGroups(true);
+
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author%1").arg(i % 500));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+  QVERIFY(coll->entryGroupDictByName(Tellico::Data::Collection::s_peopleGroupName));
+  QVERIFY(coll->entryGroupDictByName(QLatin1String("author")));
+
+  Tellico::Data::EntryPtr entry = entries.at(count/2);
+  const QStringList fields = QStringList() << QLatin1String("author");
+  int i = 0;
+  QBENCHMARK {
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author%1").arg(++i % 2 ? 1 : 2));
+    coll->updateDicts(Tellico::Data::EntryList() << entry, fields);
+  }
+  QCOMPARE(entry->groups().count(), 2);
+}
+
+void CollectionTest::testGroupUpdateBenchmark_data() {
+  QTest::addColumn<int>("count");
+
+  QTest::newRow("1000") << 1000;
+  QTest::newRow("10000") << 10000;
+  QTest::newRow("100000") << 100000;
+}
@@ -37,6 +37,7 @@ private Q_SLOTS:
   void testEmpty();
   void testCollection();
   void testFields();
+  void testFieldSlots();
   void testDerived();
   void testValue();
   void testValue_data();
@@ -47,6 +48,14 @@ private Q_SLOTS:
   void testAppendCollection();
   void testMergeCollection();
   void testMergeBenchmark();
+  void testMatchIndex();
+  void testComparisonKeys();
+  void testMatchIndexBenchmark();
+  void testMatchIndexBenchmark_data();
+  void testFieldLookupBenchmark();
+  void testGroupUpdates();
+  void testGroupUpdateBenchmark();
+  void testGroupUpdateBenchmark_data();
 };
 
 #endif
@@ -26,10 +26,42 @@
 
 #include "comparisontest.h"
 #include "../models/stringcomparison.h"
+#include "../config/tellico_config.h"
 
 #include <QTest>
+#include <QScopedPointer>
 
-QTEST_APPLESS_MAIN( ComparisonTest )
+#include <algorithm>
+
+QTEST_GUILESS_MAIN( ComparisonTest )
+
+namespace {
+  int sign(int value) {
+    return value < 0 ? -1 : (value > 0 ? 1 : 0);
+  }
+
+  // sorts the strings by comparing them directly
+  class StringLessThan {
+  public:
+    StringLessThan(Tellico::StringComparison* comp) : m_comp(comp) {}
+    bool operator()(const QString& s1, const QString& s2) const { return m_comp->compare(s1, s2) < 0; }
+  private:
+    Tellico::StringComparison* m_comp;
+  };
+
+  // sorts the strings by comparing their sort keys
+  class KeyLessThan {
+  public:
+    KeyLessThan(Tellico::StringComparison* comp, const QHash<QString, Tellico::SortKey>& keys)
+      : m_comp(comp), m_keys(keys) {}
+    bool operator()(const QString& s1, const QString& s2) const {
+      return m_comp->compare(m_keys.value(s1), m_keys.value(s2)) < 0;
+    }
+  private:
+    Tellico::StringComparison* m_comp;
+    const QHash<QString, Tellico::SortKey>& m_keys;
+  };
+}
 
 void ComparisonTest::testNumber() {
   QFETCH(QString, string1);
@@ -39,6 +71,7 @@ void ComparisonTest::testNumber() {
   Tellico::NumberComparison comp;
 
   QCOMPARE(comp.compare(string1, string2), res);
+  QCOMPARE(comp.compare(comp.sortKey(string1), comp.sortKey(string2)), res);
 }
 
 void ComparisonTest::testNumber_data() {
@@ -66,3 +99,61 @@ void ComparisonTest::testNumber_data() {
   QTest::newRow("float3") << QString("5.2") << QString("5.1") << 1;
   QTest::newRow("float4") << QString("5.1") << QString("5.1") << 0;
 }
+
+void ComparisonTest::testSortKeyOrder() {
+  QFETCH(QString, type);
+  QFETCH(QStringList, values);
+
+  Tellico::Config::setArticlesString(QString("the,l'"));
+  QScopedPointer<Tellico::StringComparison> comp;
+  if(type == QLatin1String("lcc")) {
+    comp.reset(new Tellico::LCCComparison());
+  } else if(type == QLatin1String("date")) {
+    comp.reset(new Tellico::ISODateComparison());
+  } else if(type == QLatin1String("title")) {
+    comp.reset(new Tellico::TitleComparison());
+  } else {
+    comp.reset(new Tellico::StringComparison());
+  }
+
+  QHash<QString, Tellico::SortKey> keys;
+  foreach(const QString& value, values) {
+    keys.insert(value, comp->sortKey(value));
+  }
+
+  // every pair compares the same with the keys as with the strings
+  foreach(const QString& value1, values) {
+    foreach(const QString& value2, values) {
+      QCOMPARE(sign(comp->compare(keys.value(value1), keys.value(value2))),
+               sign(comp->compare(value1, value2)));
+    }
+  }
+
+  // so the sorted order is the same, too
+  QStringList byString = values;
+  std::stable_sort(byString.begin(), byString.end(), StringLessThan(comp.data()));
+  QStringList byKey = values;
+  std::stable_sort(byKey.begin(), byKey.end(), KeyLessThan(comp.data(), keys));
+  QCOMPARE(byKey, byString);
+}
+
+void ComparisonTest::testSortKeyOrder_data() {
+  QTest::addColumn<QString>("type");
+  QTest::addColumn<QStringList>("values");
+
+  QTest::newRow("lcc") << QString("lcc")
+                       << (QStringList() << "QA76.73.C153 S77 2000" << "PS3557.R5355 C6 1993" << "QA76.73.C15 S7"
+                                         << "QA9.58 .D35" << "QA76.9.D3 C67" << "E184.A1 T34" << ""
+                                         << "not an lcc number" << "QA76.73.C153 S77 1999" << "PS3557.R5355");
+  QTest::newRow("date") << QString("date")
+                        << (QStringList() << "2001-05-04" << "2001-5-4" << "1999-12-31" << "2001" << ""
+                                          << "2001-05" << "not a date" << "1999-1-2" << "2010-10-10");
+  QTest::newRow("title") << QString("title")
+                         << (QStringList() << "The Hobbit" << "Hobbit" << "the empire strikes back" << "Dune"
+                                           << QString::fromUtf8("L'Étranger") << "Etranger" << "A Wizard of Earthsea" << ""
+                                           << "Thermodynamics" << QString::fromUtf8("théâtre"));
+  QTest::newRow("string") << QString("string")
+                          << (QStringList() << "apple" << "Apple" << "banana" << "Banana split" << ""
+                                            << QString::fromUtf8("éclair") << "eclair" << "zebra" << "10" << "9"
+                                            << "a b" << "ab");
+}
@@ -28,13 +28,20 @@
 #include "../document.h"
 #include "../images/imagefactory.h"
 #include "../images/image.h"
+#include "../images/imageinfo.h"
 #include "../config/tellico_config.h"
 #include "../collections/bookcollection.h"
 #include "../collectionfactory.h"
+#include "../translators/tellicozipexporter.h"
 
 #include <QTest>
 #include <QTemporaryDir>
 #include <QFile>
+#include <QSignalSpy>
+#include <QImage>
+
+#include <KZip>
+#include <KZipFileEntry>
 
 QTEST_GUILESS_MAIN( DocumentTest )
 
@@ -42,6 +49,7 @@ void DocumentTest::initTestCase() {
   Tellico::ImageFactory::init();
   // test case is a book file
   Tellico::RegisterCollection<Tellico::Data::BookCollection> registerBook(Tellico::Data::Collection::Book, "book");
+  qRegisterMetaType<Tellico::Data::CollPtr>("Tellico::Data::CollPtr");
 }
 
 void DocumentTest::cleanupTestCase() {
@@ -139,3 +147,176 @@ void DocumentTest::testImageLocalDirectory() {
   tempDir.remove();
   QVERIFY(!QDir(tempDirName).exists());
 }
+
+void DocumentTest::testLoadAllImages() {
+  Tellico::Config::setImageLocation(Tellico::Config::ImagesInFile);
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QString fileName = tempDir.path() + "/with-image.tc";
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/with-image.tc"), fileName));
+
+  Tellico::Data::Document* doc = Tellico::Data::Document::self();
+  QVERIFY(doc->openDocument(QUrl::fromLocalFile(fileName)));
+  Tellico::Data::CollPtr coll = doc->collection();
+  QVERIFY(coll);
+  QCOMPARE(coll->entries().size(), 1);
+  const QString id = coll->entries().at(0)->field(QLatin1String("cover"));
+  QVERIFY(!id.isEmpty());
+
+  // the image is copied out of the zip file in the background, without being loaded
+  QTRY_VERIFY(QFile::exists(Tellico::ImageFactory::tempDir() + id));
+  QVERIFY(!Tellico::ImageFactory::self()->hasImageInMemory(id));
+  QVERIFY(Tellico::ImageFactory::hasImageInfo(id));
+  const Tellico::Data::ImageInfo info = Tellico::ImageFactory::imageInfo(id);
+  QVERIFY(info.width(false) > 0);
+  QVERIFY(info.height(false) > 0);
+  QVERIFY(!Tellico::ImageFactory::imageById(id).isNull());
+}
+
+void DocumentTest::testReopenWhileLoadingImages() {
+  Tellico::Config::setImageLocation(Tellico::Config::ImagesInFile);
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QString fileName1 = tempDir.path() + "/with-image1.tc";
+  QString fileName2 = tempDir.path() + "/with-image2.tc";
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/with-image.tc"), fileName1));
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/with-image.tc"), fileName2));
+
+  Tellico::Data::Document* doc = Tellico::Data::Document::self();
+  QSignalSpy spy(doc, SIGNAL(signalCollectionImagesLoaded(Tellico::Data::CollPtr)));
+  QVERIFY(doc->openDocument(QUrl::fromLocalFile(fileName1)));
+  // the images of the first file have not been loaded yet
+  QVERIFY(doc->openDocument(QUrl::fromLocalFile(fileName2)));
+  Tellico::Data::CollPtr coll = doc->collection();
+  QVERIFY(coll);
+  QVERIFY(spy.wait());
+  // nothing left from the first file finishes the second load again
+  QTest::qWait(1000);
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(doc->collection(), coll);
+
+  const QString id = coll->entries().at(0)->field(QLatin1String("cover"));
+  QVERIFY(QFile::exists(Tellico::ImageFactory::tempDir() + id));
+  QVERIFY(!Tellico::ImageFactory::imageById(id).isNull());
+}
+
+void DocumentTest::testSaveWhileLoadingImages() {
+  Tellico::Config::setImageLocation(Tellico::Config::ImagesInFile);
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QString fileName = tempDir.path() + "/with-image.tc";
+  QString fileName2 = tempDir.path() + "/with-image-saved.tc";
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/with-image.tc"), fileName));
+
+  Tellico::Data::Document* doc = Tellico::Data::Document::self();
+  QSignalSpy spy(doc, SIGNAL(signalCollectionImagesLoaded(Tellico::Data::CollPtr)));
+  QVERIFY(doc->openDocument(QUrl::fromLocalFile(fileName)));
+  QVERIFY(doc->saveDocument(QUrl::fromLocalFile(fileName2)));
+  // saving cancels loading the images
+  QTest::qWait(1000);
+  QCOMPARE(spy.count(), 0);
+
+  // the saved file still has the image
+  QVERIFY(doc->openDocument(QUrl::fromLocalFile(fileName2)));
+  Tellico::Data::CollPtr coll = doc->collection();
+  QVERIFY(coll);
+  QCOMPARE(coll->entries().size(), 1);
+  const QString id = coll->entries().at(0)->field(QLatin1String("cover"));
+  QVERIFY(!id.isEmpty());
+  QVERIFY(spy.wait());
+  QVERIFY(!Tellico::ImageFactory::imageById(id).isNull());
+}
+
+void DocumentTest::testZipExport() {
+  Tellico::Config::setImageLocation(Tellico::Config::ImagesInFile);
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  const QString fileName = tempDir.path() + "/export.tc";
+  const QUrl url = QUrl::fromLocalFile(fileName);
+
+  QImage image(32, 32, QImage::Format_RGB32);
+  image.fill(Qt::red);
+  const QString pngId = Tellico::ImageFactory::addImage(image, QLatin1String("PNG"));
+  image.fill(Qt::blue);
+  const QString jpegId = Tellico::ImageFactory::addImage(image, QLatin1String("JPEG"));
+  image.fill(Qt::green);
+  const QString bmpId = Tellico::ImageFactory::addImage(image, QLatin1String("BMP"));
+  QVERIFY(!pngId.isEmpty());
+  QVERIFY(!jpegId.isEmpty());
+  QVERIFY(!bmpId.isEmpty());
+
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true));
+  Tellico::Data::EntryList entries;
+  foreach(const QString& id, QStringList() << pngId << jpegId << bmpId) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), id);
+    entry->setField(QLatin1String("cover"), id);
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::Export::TellicoZipExporter exporter(coll);
+  exporter.setEntries(coll->entries());
+  exporter.setURL(url);
+  exporter.setOptions(exporter.options() | Tellico::Export::ExportForce);
+  QVERIFY(exporter.exec());
+
+  // the jpeg and png images are stored as they are, anything else is deflated
+  KZip zip(fileName);
+  QVERIFY(zip.open(QIODevice::ReadOnly));
+  QVERIFY(zip.directory()->entry(QLatin1String("tellico.xml")));
+  const KArchiveEntry* imagesEntry = zip.directory()->entry(QLatin1String("images"));
+  QVERIFY(imagesEntry && imagesEntry->isDirectory());
+  const KArchiveDirectory* imagesDir = static_cast<const KArchiveDirectory*>(imagesEntry);
+  const KZipFileEntry* pngEntry = static_cast<const KZipFileEntry*>(imagesDir->entry(pngId));
+  const KZipFileEntry* jpegEntry = static_cast<const KZipFileEntry*>(imagesDir->entry(jpegId));
+  const KZipFileEntry* bmpEntry = static_cast<const KZipFileEntry*>(imagesDir->entry(bmpId));
+  QVERIFY(pngEntry);
+  QVERIFY(jpegEntry);
+  QVERIFY(bmpEntry);
+  QCOMPARE(pngEntry->encoding(), 0);
+  QCOMPARE(jpegEntry->encoding(), 0);
+  QCOMPARE(bmpEntry->encoding(), 8);
+  QVERIFY(!QImage::fromData(pngEntry->data()).isNull());
+  QVERIFY(!QImage::fromData(jpegEntry->data()).isNull());
+  QVERIFY(!QImage::fromData(bmpEntry->data()).isNull());
+  zip.close();
+
+  // the file reads back with all of the entries and images
+  Tellico::Data::Document* doc = Tellico::Data::Document::self();
+  QVERIFY(doc->openDocument(url));
+  Tellico::Data::CollPtr coll2 = doc->collection();
+  QVERIFY(coll2);
+  QCOMPARE(coll2->entryCount(), 3);
+  QStringList ids;
+  foreach(Tellico::Data::EntryPtr entry, coll2->entries()) {
+    ids << entry->field(QLatin1String("cover"));
+    QVERIFY(!Tellico::ImageFactory::imageById(entry->field(QLatin1String("cover"))).isNull());
+  }
+  ids.sort();
+  QStringList expectedIds = QStringList() << pngId << jpegId << bmpId;
+  expectedIds.sort();
+  QCOMPARE(ids, expectedIds);
+
+  // cancelling an export leaves the existing file alone
+  QFile file(fileName);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QByteArray oldData = file.readAll();
+  file.close();
+  coll->removeEntries(Tellico::Data::EntryList() << coll->entries().first());
+  Tellico::Export::TellicoZipExporter exporter2(coll);
+  exporter2.setEntries(coll->entries());
+  exporter2.setURL(url);
+  exporter2.setOptions(exporter2.options() | Tellico::Export::ExportForce);
+  // the cancel is handled while the exporter processes events after writing an image
+  QMetaObject::invokeMethod(&exporter2, "slotCancel", Qt::QueuedConnection);
+  QVERIFY(exporter2.exec());
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QCOMPARE(file.readAll(), oldData);
+  file.close();
+  QCOMPARE(QDir(tempDir.path()).entryList(QDir::Files), QStringList() << QLatin1String("export.tc"));
+}
@@ -35,6 +35,10 @@ private Q_SLOTS:
   void cleanupTestCase();
 
   void testImageLocalDirectory();
+  void testLoadAllImages();
+  void testReopenWhileLoadingImages();
+  void testSaveWhileLoadingImages();
+  void testZipExport();
 };
 
 #endif
@@ -28,6 +28,7 @@
 
 #include "../filter.h"
 #include "../entry.h"
+#include "../entrytextindex.h"
 #include "../collections/bookcollection.h"
 
 #include <QTest>
@@ -250,3 +251,205 @@ void FilterTest::testGroupViewFilter() {
   QVERIFY(filter2.matches(entry4));
   QVERIFY(!filter2.matches(entry5));
 }
+
+void FilterTest::testFilterIndex() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true, QLatin1String("TestCollection")));
+  Tellico::Data::FieldPtr field(new Tellico::Data::Field(QLatin1String("nickname"), QLatin1String("Nickname"), Tellico::Data::Field::Dependent));
+  field->setProperty(QLatin1String("template"), QLatin1String("%{author}"));
+  coll->addField(field);
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(QLatin1String("title"), QLatin1String("Star Wars"));
+  entry1->setField(QLatin1String("author"), QLatin1String("George Lucas"));
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll));
+  entry2->setField(QLatin1String("title"), QString::fromUtf8("Tmavomodrý Svět"));
+  Tellico::Data::EntryPtr entry3(new Tellico::Data::Entry(coll));
+  entry3->setField(QLatin1String("title"), QLatin1String("The Empire Strikes Back"));
+  // the stored value of a derived field is checked by the rules, so it's indexed too
+  entry3->setField(QLatin1String("nickname"), QLatin1String("Obi-Wan"));
+  coll->addEntries(Tellico::Data::EntryList() << entry1 << entry2 << entry3);
+
+  Tellico::Data::EntryTextIndex* index = coll->textIndex();
+  QVERIFY(index);
+  QVERIFY(index->isCurrent(entry1.data()));
+
+  // a word, a short text inside a word, text with whitespace, and text without accents
+  Tellico::Filter filter1(Tellico::Filter::MatchAll);
+  filter1.append(new Tellico::FilterRule(QString(), QLatin1String("wars"), Tellico::FilterRule::FuncContains));
+  QVERIFY(filter1.matches(entry1));
+  QVERIFY(!filter1.matches(entry2));
+  QVERIFY(!filter1.matches(entry3));
+
+  Tellico::Filter filter2(Tellico::Filter::MatchAll);
+  filter2.append(new Tellico::FilterRule(QString(), QLatin1String("wA"), Tellico::FilterRule::FuncContains));
+  QVERIFY(filter2.matches(entry1));
+  QVERIFY(!filter2.matches(entry2));
+  QVERIFY(!filter2.matches(entry3));
+
+  Tellico::Filter filter2b(Tellico::Filter::MatchAll);
+  filter2b.append(new Tellico::FilterRule(QString(), QLatin1String("k"), Tellico::FilterRule::FuncContains));
+  QVERIFY(!filter2b.matches(entry1));
+  QVERIFY(!filter2b.matches(entry2));
+  QVERIFY(filter2b.matches(entry3));
+
+  Tellico::Filter filter2c(Tellico::Filter::MatchAll);
+  filter2c.append(new Tellico::FilterRule(QString(), QLatin1String("obi-wan"), Tellico::FilterRule::FuncContains));
+  QVERIFY(!filter2c.matches(entry1));
+  QVERIFY(filter2c.matches(entry3));
+
+  Tellico::Filter filter3(Tellico::Filter::MatchAll);
+  filter3.append(new Tellico::FilterRule(QString(), QLatin1String("ar wa"), Tellico::FilterRule::FuncContains));
+  QVERIFY(filter3.matches(entry1));
+  QVERIFY(!filter3.matches(entry3));
+
+  Tellico::Filter filter4(Tellico::Filter::MatchAll);
+  filter4.append(new Tellico::FilterRule(QString(), QLatin1String("svet"), Tellico::FilterRule::FuncContains));
+  QVERIFY(!filter4.matches(entry1));
+  QVERIFY(filter4.matches(entry2));
+
+  Tellico::Filter filter5(Tellico::Filter::MatchAll);
+  filter5.append(new Tellico::FilterRule(QString(), QLatin1String("star wars"), Tellico::FilterRule::FuncEquals));
+  QVERIFY(filter5.matches(entry1));
+  QVERIFY(!filter5.matches(entry2));
+  filter5.append(new Tellico::FilterRule(QString(), QLatin1String("star"), Tellico::FilterRule::FuncNotEquals));
+  QVERIFY(filter5.matches(entry1));
+
+  // a modified entry must still match before the index is updated
+  Tellico::Filter filter6(Tellico::Filter::MatchAll);
+  filter6.append(new Tellico::FilterRule(QString(), QLatin1String("jedi"), Tellico::FilterRule::FuncContains));
+  QVERIFY(!filter6.matches(entry3));
+  entry3->setField(QLatin1String("title"), QLatin1String("Return of the Jedi"));
+  QVERIFY(!index->isCurrent(entry3.data()));
+  QVERIFY(filter6.matches(entry3));
+  coll->updateDicts(Tellico::Data::EntryList() << entry3, QStringList() << QLatin1String("title"));
+  QVERIFY(index->isCurrent(entry3.data()));
+  QVERIFY(filter6.matches(entry3));
+  QVERIFY(!filter1.matches(entry3));
+
+  coll->removeEntries(Tellico::Data::EntryList() << entry1);
+  QVERIFY(!coll->textIndex()->isCurrent(entry1.data()));
+  QVERIFY(filter6.matches(entry3));
+}
+
+void FilterTest::testCompiledFilter() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true, QLatin1String("TestCollection")));
+  Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+  entry->setField(QLatin1String("title"), QString::fromUtf8("Tmavomodrý Svět"));
+  entry->setField(QLatin1String("pub_year"), QLatin1String("1999"));
+  coll->addEntries(entry);
+
+  Tellico::FilterRule* rule1 = new Tellico::FilterRule(QString(), QString::fromUtf8("^\\w+ý"), Tellico::FilterRule::FuncRegExp);
+  Tellico::FilterRule* rule2 = new Tellico::FilterRule(QLatin1String("title"), QLatin1String("svět"), Tellico::FilterRule::FuncContains);
+  Tellico::FilterRule* rule3 = new Tellico::FilterRule(QLatin1String("pub_year"), QLatin1String("2000"), Tellico::FilterRule::FuncLess);
+  QVERIFY(rule3->cost() < rule2->cost());
+  QVERIFY(rule2->cost() < rule1->cost());
+
+  Tellico::Filter filter(Tellico::Filter::MatchAll);
+  filter << rule1 << rule2 << rule3;
+  filter.compile(coll);
+  QVERIFY(rule1->isCompiled(coll.data()));
+  QVERIFY(rule3->isCompiled(coll.data()));
+  QVERIFY(filter.matches(entry));
+
+  // changing the fields of some other collection doesn't matter
+  Tellico::Data::CollPtr otherColl(new Tellico::Data::BookCollection(true));
+  otherColl->addField(Tellico::Data::FieldPtr(new Tellico::Data::Field(QLatin1String("other"), QLatin1String("Other"))));
+  QVERIFY(rule1->isCompiled(coll.data()));
+
+  // changing a rule or a field compiles the rule again
+  rule3->setFunction(Tellico::FilterRule::FuncGreater);
+  QVERIFY(!rule3->isCompiled(coll.data()));
+  QVERIFY(!filter.matches(entry));
+  QVERIFY(rule3->isCompiled(coll.data()));
+
+  Tellico::Data::FieldPtr date(new Tellico::Data::Field(QLatin1String("date"),
+                                                        QLatin1String("Date"),
+                                                        Tellico::Data::Field::Date));
+  coll->addField(date);
+  QVERIFY(!rule3->isCompiled(coll.data()));
+  entry->setField(QLatin1String("date"), QLatin1String("2011-1-25"));
+  rule3->setFunction(Tellico::FilterRule::FuncLess);
+  rule2->setFieldName(QLatin1String("date"));
+  rule2->setFunction(Tellico::FilterRule::FuncNotContains);
+  QVERIFY(filter.matches(entry));
+
+  Tellico::Filter filter2(Tellico::Filter::MatchAll);
+  filter2.append(new Tellico::FilterRule(QLatin1String("date"), QLatin1String("2011-01-24"), Tellico::FilterRule::FuncAfter));
+  QVERIFY(filter2.matches(entry));
+  entry->setField(QLatin1String("date"), QLatin1String("2011-1-2"));
+  QVERIFY(!filter2.matches(entry));
+  entry->setField(QLatin1String("date"), QLatin1String("2011-01-2x"));
+  QVERIFY(!filter2.matches(entry));
+}
+
+void FilterTest::testCompiledFilterBenchmark() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true, QLatin1String("TestCollection")));
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < 10000; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 100));
+    entry->setField(QLatin1String("pub_year"), QString::number(1900 + i % 100));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::Filter filter(Tellico::Filter::MatchAll);
+  filter.append(new Tellico::FilterRule(QLatin1String("title"), QLatin1String("title \\d+5$"), Tellico::FilterRule::FuncRegExp));
+  filter.append(new Tellico::FilterRule(QLatin1String("author"), QLatin1String("author 1"), Tellico::FilterRule::FuncContains));
+  filter.append(new Tellico::FilterRule(QLatin1String("cdate"), QLatin1String("2000-01-01"), Tellico::FilterRule::FuncAfter));
+  filter.append(new Tellico::FilterRule(QLatin1String("pub_year"), QLatin1String("1950"), Tellico::FilterRule::FuncLess));
+
+  int count = 0;
+  QBENCHMARK {
+    count = 0;
+    foreach(Tellico::Data::EntryPtr entry, entries) {
+      if(filter.matches(entry)) {
+        ++count;
+      }
+    }
+  }
+  QVERIFY(count > 0);
+}
+
+void FilterTest::testQuickFilterBenchmark() {
+  QFETCH(int, count);
+
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true, QLatin1String("TestCollection")));
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("Title %1 Volume %2").arg(i).arg(i % 97));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 1000));
+    entry->setField(QLatin1String("publisher"), QString::fromLatin1("Publisher %1").arg(i % 50));
+    if(i % 100 == 0) {
+      entry->setField(QLatin1String("title"), QString::fromLatin1("To Kill a Mockingbird %1").arg(i));
+    }
+    entries << entry;
+  }
+  coll->addEntries(entries);
+  // the index is built once, when the quick filter is first used
+  QVERIFY(coll->textIndex());
+
+  // every keystroke of the quick filter creates a new filter, which is matched against every entry
+  const QString text = QLatin1String("mockingbird");
+  int matchCount = 0;
+  QBENCHMARK {
+    for(int len = 1; len <= text.length(); ++len) {
+      Tellico::Filter filter(Tellico::Filter::MatchAll);
+      filter.append(new Tellico::FilterRule(QString(), text.left(len), Tellico::FilterRule::FuncContains));
+      matchCount = 0;
+      foreach(Tellico::Data::EntryPtr entry, entries) {
+        if(filter.matches(entry)) {
+          ++matchCount;
+        }
+      }
+    }
+  }
+  QCOMPARE(matchCount, (count + 99) / 100);
+}
+
+void FilterTest::testQuickFilterBenchmark_data() {
+  QTest::addColumn<int>("count");
+  QTest::newRow("10000") << 10000;
+  QTest::newRow("100000") << 100000;
+}
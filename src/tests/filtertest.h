@@ -34,6 +34,11 @@ private Q_SLOTS:
   void initTestCase();
   void testFilter();
   void testGroupViewFilter();
+  void testFilterIndex();
+  void testCompiledFilter();
+  void testCompiledFilterBenchmark();
+  void testQuickFilterBenchmark();
+  void testQuickFilterBenchmark_data();
 };
 
 #endif
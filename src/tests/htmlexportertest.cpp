@@ -27,6 +27,8 @@
 #include "htmlexportertest.h"
 
 #include "../translators/htmlexporter.h"
+#include "../translators/tellicoxmlexporter.h"
+#include "../translators/xslthandler.h"
 #include "../collections/bookcollection.h"
 #include "../collectionfactory.h"
 #include "../entry.h"
@@ -200,3 +202,64 @@ void HtmlExporterTest::testDirectoryNames() {
   exp.setCollectionURL(QUrl::fromLocalFile(QDir::homePath()));
   QCOMPARE(exp.fileDirName(), QLatin1String("/"));
 }
+
+void HtmlExporterTest::testEntryFiles() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true));
+  // enough entries that the entry files get written by several threads
+  const int count = 200;
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr e(new Tellico::Data::Entry(coll));
+    e->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg(i));
+    coll->addEntries(e);
+  }
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+
+  Tellico::Export::HTMLExporter exp(coll);
+  exp.setEntries(coll->entries());
+  exp.setExportEntryFiles(true);
+  exp.setEntryXSLTFile(QLatin1String("Fancy"));
+  exp.setOptions(Tellico::Export::ExportUTF8 | Tellico::Export::ExportForce);
+  exp.setURL(QUrl::fromLocalFile(tempDir.path() + "/entries.html"));
+  QVERIFY(exp.exec());
+
+  foreach(Tellico::Data::EntryPtr e, coll->entries()) {
+    const QString title = e->field(QLatin1String("title"));
+    QString fileName = title;
+    fileName.replace(QLatin1Char(' '), QLatin1Char('_'));
+    QFile f(tempDir.path() + "/entries_files/" + fileName + QLatin1Char('-') + QString::number(e->id()) + ".html");
+    QVERIFY2(f.exists(), qPrintable(f.fileName()));
+    QVERIFY(f.open(QIODevice::ReadOnly | QIODevice::Text));
+    const QString text = QString::fromUtf8(f.readAll());
+    QVERIFY(text.contains(title));
+    // verify link to parent html file
+    QVERIFY(text.contains(QLatin1String("href=\"../entries.html")));
+  }
+}
+
+void HtmlExporterTest::testXmlDocument() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true));
+  coll->setTitle(QLatin1String("Robby's Books"));
+  Tellico::Data::EntryPtr e(new Tellico::Data::Entry(coll));
+  e->setField(QLatin1String("title"), QString::fromUtf8("Title & <Ümlaut>"));
+  e->setField(QLatin1String("author"), QLatin1String("Author One; Author Two"));
+  e->setField(QLatin1String("comments"), QLatin1String("Line one<br/>  Line two"));
+  coll->addEntries(e);
+
+  Tellico::Export::TellicoXMLExporter exporter(coll);
+  exporter.setEntries(coll->entries());
+  exporter.setOptions(exporter.options() | Tellico::Export::ExportUTF8);
+  const QDomDocument dom = exporter.exportXML();
+  QVERIFY(!dom.isNull());
+
+  Tellico::XSLTHandler handler(QUrl::fromLocalFile(QFINDTESTDATA("../../xslt/entry-templates/Fancy.xsl")));
+  QVERIFY(handler.isValid());
+
+  // handing the DOM straight to libxml2 has to give the same result as parsing its text
+  const QString fromText = handler.applyStylesheet(dom.toString());
+  QVERIFY(!fromText.isEmpty());
+  QCOMPARE(handler.applyStylesheet(dom), fromText);
+  QCOMPARE(QString::fromUtf8(handler.applyStylesheet(Tellico::XSLTHandler::xmlDocument(dom), handler.params())),
+           fromText);
+}
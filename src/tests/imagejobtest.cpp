@@ -27,15 +27,24 @@
 #include "../images/imagejob.h"
 #include "../images/imagefactory.h"
 #include "../images/imageinfo.h"
+#include "../core/filehandler.h"
 
 #include <QTest>
 #include <QEventLoop>
 #include <QTemporaryFile>
 #include <QNetworkInterface>
 #include <QSignalSpy>
+#include <QCryptographicHash>
 
 QTEST_GUILESS_MAIN( ImageJobTest )
 
+namespace {
+  // the image id of png data, calculated independently of Data::Image
+  QString md5Id(const QByteArray& data_) {
+    return QLatin1String(QCryptographicHash::hash(data_, QCryptographicHash::Md5).toHex()) + QLatin1String(".png");
+  }
+}
+
 bool ImageJobTest::networkIsAvailable() {
   foreach(const QNetworkInterface& net, QNetworkInterface::allInterfaces()) {
     if(net.flags().testFlag(QNetworkInterface::IsUp) && !net.flags().testFlag(QNetworkInterface::IsLoopBack)) {
@@ -142,7 +151,7 @@ void ImageJobTest::testImageLoad() {
 
   Tellico::Data::Image img = job->image();
   QVERIFY(!img.isNull());
-  QCOMPARE(img.id(), QLatin1String("dde5bf2cbd90fad8635a26dfb362e0ff.png"));
+  QCOMPARE(img.id(), QLatin1String("238facd056a59ca8458ebca76edd3493.png"));
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), false);
 
@@ -186,7 +195,7 @@ void ImageJobTest::testImageLink() {
   Tellico::Data::Image img = job->image();
   QVERIFY(!img.isNull());
   // id is not the MD5 hash
-  QVERIFY(img.id() != QLatin1String("dde5bf2cbd90fad8635a26dfb362e0ff.png"));
+  QVERIFY(img.id() != QLatin1String("238facd056a59ca8458ebca76edd3493.png"));
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), true);
 }
@@ -209,7 +218,11 @@ void ImageJobTest::testNetworkImage() {
 
   Tellico::Data::Image img = job->image();
   QVERIFY(!img.isNull());
-  QCOMPARE(img.id(), QLatin1String("757322046f4aa54290a3d92b05b71ca1.png"));
+  // the id is the md5 hash of the file as it was downloaded, not encoded again
+  const QByteArray data = Tellico::FileHandler::readDataFile(u, true /* quiet */);
+  QVERIFY(!data.isEmpty());
+  QCOMPARE(img.byteArray(), data);
+  QCOMPARE(img.id(), md5Id(data));
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), false);
 
@@ -279,7 +292,7 @@ void ImageJobTest::testFactoryRequestLocal() {
   Tellico::Data::Image img = Tellico::ImageFactory::imageById(m_imageId);
   QVERIFY(!img.isNull());
   // id is not the MD5 hash
-  QVERIFY(img.id() != QLatin1String("dde5bf2cbd90fad8635a26dfb362e0ff.png"));
+  QVERIFY(img.id() != QLatin1String("238facd056a59ca8458ebca76edd3493.png"));
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), true);
 }
@@ -333,8 +346,10 @@ void ImageJobTest::testFactoryRequestNetwork() {
 
   const Tellico::Data::Image& img = Tellico::ImageFactory::imageById(m_imageId);
   QVERIFY(!img.isNull());
-  // id is the MD5 hash, since it's not link only
-  QCOMPARE(img.id(), QLatin1String("757322046f4aa54290a3d92b05b71ca1.png"));
+  // id is the MD5 hash of the downloaded file, since it's not link only
+  const QByteArray data = Tellico::FileHandler::readDataFile(u, true /* quiet */);
+  QVERIFY(!data.isEmpty());
+  QCOMPARE(img.id(), md5Id(data));
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), false);
 }
@@ -371,3 +386,43 @@ void ImageJobTest::testFactoryRequestNetworkLinkOnly() {
   QCOMPARE(img.format(), QByteArray("png"));
   QCOMPARE(img.linkOnly(), true);
 }
+
+void ImageJobTest::testFactoryRequestImage() {
+  QSignalSpy spy(Tellico::ImageFactory::self(), &Tellico::ImageFactory::imageAdded);
+
+  QUrl u = QUrl::fromLocalFile(QFINDTESTDATA("../../icons/tellico.png"));
+  // the same url is only loaded once, and nothing happens until the event loop runs
+  Tellico::ImageFactory::requestImage(u);
+  Tellico::ImageFactory::requestImage(u);
+  QCOMPARE(spy.count(), 0);
+  QVERIFY(spy.wait());
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.at(0).at(0).toUrl(), u);
+  const QString id = spy.at(0).at(1).toString();
+  QCOMPARE(id, QLatin1String("238facd056a59ca8458ebca76edd3493.png"));
+  QVERIFY(Tellico::ImageFactory::self()->hasImageInMemory(id));
+
+  // an invalid image has an empty id
+  spy.clear();
+  u = QUrl::fromLocalFile(QFINDTESTDATA("imagejobtest.cpp"));
+  Tellico::ImageFactory::requestImage(u);
+  // it might already be known to be null
+  if(spy.isEmpty()) {
+    QVERIFY(spy.wait());
+  }
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.at(0).at(0).toUrl(), u);
+  QVERIFY(spy.at(0).at(1).toString().isEmpty());
+
+  // a link-only image that is still downloading is not waited for
+  spy.clear();
+  QSignalSpy availableSpy(Tellico::ImageFactory::self(), &Tellico::ImageFactory::imageAvailable);
+  u = QUrl::fromLocalFile(QFINDTESTDATA("../../icons/32-apps-tellico.png"));
+  Tellico::ImageFactory::requestImage(u, true /* quiet */, QUrl(), true /* link only */);
+  QVERIFY(Tellico::ImageFactory::imageById(u.url()).isNull());
+  QVERIFY(spy.wait());
+  QCOMPARE(spy.at(0).at(1).toString(), u.url());
+  QCOMPARE(availableSpy.count(), 1);
+  QCOMPARE(availableSpy.at(0).at(0).toString(), u.url());
+  QVERIFY(!Tellico::ImageFactory::imageById(u.url()).isNull());
+}
@@ -51,6 +51,7 @@ private Q_SLOTS:
   void testFactoryRequestLocalInvalid();
   void testFactoryRequestNetwork();
   void testFactoryRequestNetworkLinkOnly();
+  void testFactoryRequestImage();
 
 Q_SIGNALS:
   void exitLoop();
@@ -27,12 +27,31 @@
 #include "imagetest.h"
 
 #include "../images/imagefactory.h"
+#include "../images/image.h"
+#include "../images/imageinfo.h"
+#include "../images/imagethumbnailer.h"
+#include "../images/imagedirectory.h"
+#include "../config/tellico_config.h"
 
 #include <QTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QImage>
+#include <QImageReader>
+#include <QFile>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <KZip>
 
 QTEST_GUILESS_MAIN( ImageTest )
 
 void ImageTest::initTestCase() {
+  QStandardPaths::setTestModeEnabled(true);
   Tellico::ImageFactory::init();
 }
 
@@ -42,3 +61,289 @@ void ImageTest::testLinkOnly() {
   QString id = Tellico::ImageFactory::addImage(u, false, QUrl(), true);
   QCOMPARE(id, u.url());
 }
+
+void ImageTest::testThumbnailer() {
+  QUrl u = QUrl::fromLocalFile(QFINDTESTDATA("../../icons/128-apps-tellico.png"));
+  QString id = Tellico::ImageFactory::addImage(u, false);
+  QVERIFY(!id.isEmpty());
+
+  const Tellico::ThumbnailDirectory thumbDir = Tellico::ImageFactory::thumbnailDirectory();
+  const QString thumbFile = thumbDir.filePath(id, QSize(64, 64));
+  QFile::remove(thumbFile);
+
+  Tellico::ImageThumbnailer thumbnailer;
+  QSignalSpy spy(&thumbnailer, SIGNAL(thumbnailAvailable(QString, int, QImage)));
+  QVERIFY(thumbnailer.requestThumbnail(id, 64));
+  QVERIFY(thumbnailer.isPending(id, 64));
+  // a second request is not queued again
+  QVERIFY(thumbnailer.requestThumbnail(id, 64));
+  QVERIFY(spy.wait());
+  QCOMPARE(spy.count(), 1);
+  QVERIFY(!thumbnailer.isPending(id, 64));
+
+  QList<QVariant> args = spy.takeFirst();
+  QCOMPARE(args.at(0).toString(), id);
+  QCOMPARE(args.at(1).toInt(), 64);
+  QImage thumb = args.at(2).value<QImage>();
+  QCOMPARE(thumb.size(), QSize(64, 64));
+  // the thumbnail is saved to disk
+  QVERIFY(QFile::exists(thumbFile));
+
+  // an unknown image can't be thumbnailed
+  QVERIFY(!thumbnailer.requestThumbnail(QLatin1String("nonexistent.png"), 64));
+  QFile::remove(thumbFile);
+}
+
+void ImageTest::testThumbnailDirectory() {
+  QTemporaryDir tmpDir;
+  Tellico::ThumbnailDirectory thumbDir(tmpDir.path());
+  QVERIFY(thumbDir.path().endsWith(QLatin1Char('/')));
+  const QDir dir(tmpDir.path());
+  const QDir::Filters dirFilter = QDir::Dirs | QDir::NoDotAndDotDot;
+
+  const QString id = QLatin1String("http://example.com/cover.jpg");
+  const QSize size(32, 48);
+  QVERIFY(!thumbDir.hasThumbnail(id, size));
+  QVERIFY(thumbDir.thumbnail(id, size).isNull());
+
+  QImage img(size, QImage::Format_RGB32);
+  img.fill(Qt::red);
+  QVERIFY(thumbDir.writeThumbnail(id, size, img));
+  QVERIFY(thumbDir.hasThumbnail(id, size));
+  QVERIFY(!thumbDir.hasThumbnail(id, QSize(48, 32)));
+  QCOMPARE(thumbDir.thumbnail(id, size).size(), size);
+  // the url is hashed for the directory name, and nothing but the thumbnail is left behind
+  QCOMPARE(dir.entryList(dirFilter).count(), 1);
+  QVERIFY(!dir.entryList(dirFilter).first().contains(QLatin1String("example")));
+  QCOMPARE(QDir(dir.filePath(dir.entryList(dirFilter).first())).entryList(QDir::Files).count(), 1);
+
+  QVERIFY(thumbDir.writeThumbnail(id, QSize(16, 16), img.scaled(16, 16)));
+  QVERIFY(thumbDir.writeThumbnail(QLatin1String("other.png"), size, img));
+  QCOMPARE(dir.entryList(dirFilter).count(), 2);
+
+  thumbDir.removeThumbnails(id);
+  QVERIFY(!thumbDir.hasThumbnail(id, size));
+  QVERIFY(!thumbDir.hasThumbnail(id, QSize(16, 16)));
+  QVERIFY(thumbDir.hasThumbnail(QLatin1String("other.png"), size));
+  QCOMPARE(dir.entryList(dirFilter).count(), 1);
+
+  // nothing is removed while under the limit, everything when the limit is zero
+  QCOMPARE(thumbDir.collectGarbage(1024 * 1024), 0);
+  QCOMPARE(thumbDir.collectGarbage(0), 1);
+  QVERIFY(!thumbDir.hasThumbnail(QLatin1String("other.png"), size));
+  QVERIFY(dir.entryList(dirFilter).isEmpty());
+}
+
+void ImageTest::testThumbnailGarbageOrder() {
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
+  QSKIP("The modification time can only be set with Qt 5.10", SkipAll);
+#else
+  QTemporaryDir tmpDir;
+  Tellico::ThumbnailDirectory thumbDir(tmpDir.path());
+
+  const QString id1 = QLatin1String("first.png");
+  const QString id2 = QLatin1String("second.png");
+  const QSize size(32, 32);
+  QImage img(size, QImage::Format_RGB32);
+  img.fill(Qt::blue);
+  QVERIFY(thumbDir.writeThumbnail(id1, size, img));
+  QVERIFY(thumbDir.writeThumbnail(id2, size, img));
+
+  // the first thumbnail was written an hour before the second one
+  const QDateTime now = QDateTime::currentDateTime();
+  QFile file1(thumbDir.filePath(id1, size));
+  QVERIFY(file1.open(QIODevice::ReadWrite));
+  QVERIFY(file1.setFileTime(now.addSecs(-7200), QFileDevice::FileModificationTime));
+  file1.close();
+  QFile file2(thumbDir.filePath(id2, size));
+  QVERIFY(file2.open(QIODevice::ReadWrite));
+  QVERIFY(file2.setFileTime(now.addSecs(-3600), QFileDevice::FileModificationTime));
+  file2.close();
+
+  // but it was used more recently, so the second one is removed
+  QVERIFY(!thumbDir.thumbnail(id1, size).isNull());
+  QCOMPARE(thumbDir.collectGarbage(QFileInfo(file1).size()), 1);
+  QVERIFY(thumbDir.hasThumbnail(id1, size));
+  QVERIFY(!thumbDir.hasThumbnail(id2, size));
+#endif
+}
+
+void ImageTest::testOriginalData() {
+  const QString fileName = QFINDTESTDATA("../../icons/tellico.png");
+  QFile file(fileName);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QByteArray fileData = file.readAll();
+
+  QString id = Tellico::ImageFactory::addImage(QUrl::fromLocalFile(fileName), false);
+  QVERIFY(!id.isEmpty());
+  const Tellico::Data::Image& img = Tellico::ImageFactory::imageById(id);
+  QVERIFY(!img.isNull());
+  // the file is not encoded again, and the id is the hash of the file itself
+  QCOMPARE(img.rawData(), fileData);
+  QCOMPARE(img.byteArray(), fileData);
+  QCOMPARE(id, QLatin1String(QCryptographicHash::hash(fileData, QCryptographicHash::Md5).toHex()) + QLatin1String(".png"));
+
+  // an image created from pixels is encoded once and keeps that data
+  QImage pixels(16, 16, QImage::Format_RGB32);
+  pixels.fill(Qt::blue);
+  id = Tellico::ImageFactory::addImage(pixels, QLatin1String("PNG"));
+  const Tellico::Data::Image& img2 = Tellico::ImageFactory::imageById(id);
+  QVERIFY(!img2.isNull());
+  QVERIFY(!img2.rawData().isEmpty());
+  QCOMPARE(img2.byteArray(), img2.rawData());
+  QCOMPARE(id, Tellico::Data::Image::calculateID(img2.rawData(), QLatin1String("PNG")));
+}
+
+void ImageTest::testCacheBudget() {
+  const int budget = 1024 * 1024;
+  Tellico::ImageFactory::setCacheSize(budget);
+
+  // each image takes 16K decoded, so they can't all stay in memory
+  QStringList ids;
+  for(int i = 0; i < 64; ++i) {
+    QImage img(64, 64, QImage::Format_RGB32);
+    img.fill(qRgb(i, 255 - i, 2 * i));
+    ids << Tellico::ImageFactory::addImage(img, QLatin1String("PNG"));
+    QVERIFY(!ids.last().isEmpty());
+    // half the budget is for decoded images
+    QVERIFY(Tellico::ImageFactory::cacheStatistics().imageCost <= budget / 2);
+  }
+
+  Tellico::ImageFactory::resetCacheStatistics();
+  foreach(const QString& id, ids) {
+    QVERIFY(!Tellico::ImageFactory::imageById(id).isNull());
+  }
+  Tellico::CacheStatistics stats = Tellico::ImageFactory::cacheStatistics();
+  QCOMPARE(stats.imageHits + stats.dataHits + stats.imageMisses, ids.count());
+  // some images were evicted and had to be decoded again
+  QVERIFY(stats.dataHits + stats.imageMisses > 0);
+  QVERIFY(stats.imageCost <= budget / 2);
+  QVERIFY(stats.pixmapCost <= budget / 4);
+  QVERIFY(stats.dataCost <= budget / 4);
+  // without the event loop running, only the last few evicted images are kept alive
+  QVERIFY(stats.retiredCost > 0);
+  QVERIFY(stats.retiredCost <= budget / 4);
+
+  // the last one is still in memory
+  Tellico::ImageFactory::resetCacheStatistics();
+  QVERIFY(!Tellico::ImageFactory::imageById(ids.last()).isNull());
+  QCOMPARE(Tellico::ImageFactory::cacheStatistics().imageHits, 1);
+
+  Tellico::ImageFactory::setCacheSize(Tellico::Config::imageCacheSize());
+}
+
+void ImageTest::testImageInfoProbe() {
+  QFETCH(QString, fileName);
+  QFETCH(QByteArray, format);
+
+  const QString path = QFINDTESTDATA(QLatin1String("data/") + fileName);
+  QImageReader reader(path);
+  if(!reader.canRead()) {
+    QSKIP("This test requires a Qt image plugin which is not available.", SkipSingle);
+  }
+  const QImage decoded = reader.read();
+  QVERIFY(!decoded.isNull());
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QByteArray data = file.readAll();
+
+  QByteArray probedFormat;
+  QSize probedSize;
+  QVERIFY(Tellico::Data::ImageInfo::readHeader(data, probedFormat, probedSize));
+  QCOMPARE(probedFormat, format);
+  QCOMPARE(probedSize, decoded.size());
+
+  probedSize = QSize();
+  QVERIFY(Tellico::Data::ImageInfo::readFileHeader(path, probedFormat, probedSize));
+  QCOMPARE(probedSize, decoded.size());
+
+  // a truncated header is not enough
+  QVERIFY(!Tellico::Data::ImageInfo::readHeader(data.left(8), probedFormat, probedSize));
+
+  // the image factory reads the header of a linked file without loading the image
+  const QString id = QUrl::fromLocalFile(path).url();
+  Tellico::ImageFactory::cacheImageInfo(Tellico::Data::ImageInfo(id, QByteArray(), 0, 0, true));
+  const Tellico::Data::ImageInfo info = Tellico::ImageFactory::probeImageInfo(id);
+  QVERIFY(!info.isNull());
+  QVERIFY(info.linkOnly);
+  QCOMPARE(info.width(false), decoded.width());
+  QCOMPARE(info.height(false), decoded.height());
+  QVERIFY(Tellico::ImageFactory::hasImageInfo(id));
+  QCOMPARE(Tellico::ImageFactory::imageInfo(id).width(false), decoded.width());
+  QCOMPARE(Tellico::ImageFactory::imageInfo(id).format, format);
+  QVERIFY(!Tellico::ImageFactory::self()->hasImageInMemory(id));
+
+  // the header of an image in a zip file is read without extracting the image
+  QTemporaryFile zipFile;
+  QVERIFY(zipFile.open());
+  const QString zipId = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex())
+                      + QLatin1Char('.') + QString::fromLatin1(format);
+  KZip writeZip(zipFile.fileName());
+  QVERIFY(writeZip.open(QIODevice::WriteOnly));
+  QVERIFY(writeZip.writeFile(QLatin1String("images/") + zipId, data));
+  QVERIFY(writeZip.close());
+
+  KZip* readZip = new KZip(zipFile.fileName());
+  QVERIFY(readZip->open(QIODevice::ReadOnly));
+  Tellico::ImageFactory::setZipArchive(readZip);
+  const Tellico::Data::ImageInfo zipInfo = Tellico::ImageFactory::probeImageInfo(zipId);
+  QVERIFY(!zipInfo.isNull());
+  QCOMPARE(zipInfo.format, format);
+  QCOMPARE(zipInfo.width(false), decoded.width());
+  QCOMPARE(zipInfo.height(false), decoded.height());
+  QVERIFY(!Tellico::ImageFactory::self()->hasImageInMemory(zipId));
+}
+
+void ImageTest::testImageInfoProbe_data() {
+  QTest::addColumn<QString>("fileName");
+  QTest::addColumn<QByteArray>("format");
+
+  QTest::newRow("png") << QStringLiteral("image-probe.png") << QByteArray("png");
+  QTest::newRow("gif") << QStringLiteral("image-probe.gif") << QByteArray("gif");
+  QTest::newRow("webp lossless") << QStringLiteral("image-probe.webp") << QByteArray("webp");
+  QTest::newRow("webp lossy") << QStringLiteral("image-probe-vp8.webp") << QByteArray("webp");
+  QTest::newRow("webp extended") << QStringLiteral("image-probe-vp8x.webp") << QByteArray("webp");
+  QTest::newRow("jpeg") << QStringLiteral("image-probe.jpeg") << QByteArray("jpeg");
+  // an EXIF segment comes before the frame header
+  QTest::newRow("jpeg progressive exif") << QStringLiteral("image-probe-progressive.jpeg") << QByteArray("jpeg");
+}
+
+void ImageTest::testSaveBenchmark() {
+  QFETCH(int, count);
+  QFETCH(bool, encode);
+
+  // small covers, so the test doesn't take too much memory, each one different
+  QStringList ids;
+  for(int i = 0; i < count; ++i) {
+    QImage cover(30, 45, QImage::Format_RGB32);
+    for(int y = 0; y < cover.height(); ++y) {
+      for(int x = 0; x < cover.width(); ++x) {
+        cover.setPixel(x, y, qRgb((x * 8 + i) % 256, (y * 5 + i / 256) % 256, (x + y) * 3 % 256));
+      }
+    }
+    ids << Tellico::ImageFactory::addImage(cover, QLatin1String("JPEG"));
+  }
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  KZip zip(file.fileName());
+  QVERIFY(zip.open(QIODevice::WriteOnly));
+  zip.setCompression(KZip::NoCompression);
+  QBENCHMARK_ONCE {
+    foreach(const QString& id, ids) {
+      const Tellico::Data::Image& img = Tellico::ImageFactory::imageById(id);
+      const QByteArray data = encode ? Tellico::Data::Image::byteArray(img, img.format()) : img.byteArray();
+      QVERIFY(zip.writeFile(QLatin1String("images/") + id, data));
+    }
+  }
+  QVERIFY(zip.close());
+}
+
+void ImageTest::testSaveBenchmark_data() {
+  QTest::addColumn<int>("count");
+  QTest::addColumn<bool>("encode");
+
+  QTest::newRow("encoded 20000") << 20000 << true;
+  QTest::newRow("original 20000") << 20000 << false;
+}
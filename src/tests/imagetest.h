@@ -33,6 +33,15 @@ Q_OBJECT
 private Q_SLOTS:
   void initTestCase();
   void testLinkOnly();
+  void testThumbnailer();
+  void testThumbnailDirectory();
+  void testThumbnailGarbageOrder();
+  void testOriginalData();
+  void testCacheBudget();
+  void testImageInfoProbe();
+  void testImageInfoProbe_data();
+  void testSaveBenchmark();
+  void testSaveBenchmark_data();
 };
 
 #endif
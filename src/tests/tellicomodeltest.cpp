@@ -40,8 +40,10 @@
 #include "../images/imagefactory.h"
 
 #include <QTest>
+#include <QSignalSpy>
+#include <QTreeView>
 
-QTEST_GUILESS_MAIN( TellicoModelTest )
+QTEST_MAIN( TellicoModelTest )
 
 void TellicoModelTest::initTestCase() {
   Tellico::ImageFactory::init();
@@ -179,3 +181,305 @@ void TellicoModelTest::testGroupModel() {
     QVERIFY(!group->hasEmptyGroupName());
   }
 }
+
+void TellicoModelTest::testSortKeys() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryPtr entry1(new Tellico::Data::Entry(coll));
+  entry1->setField(QLatin1String("title"), QLatin1String("The Aardvark"));
+  entry1->setField(QLatin1String("pub_year"), QLatin1String("2001"));
+  Tellico::Data::EntryPtr entry2(new Tellico::Data::Entry(coll));
+  entry2->setField(QLatin1String("title"), QLatin1String("Mouse"));
+  entry2->setField(QLatin1String("pub_year"), QLatin1String("1999"));
+  coll->addEntries(Tellico::Data::EntryList() << entry1 << entry2);
+
+  Tellico::EntryModel entryModel(this);
+  Tellico::EntrySortModel sortModel(this);
+  ModelTest test1(&sortModel);
+  sortModel.setSourceModel(&entryModel);
+  sortModel.setSortRole(Tellico::EntryPtrRole);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+
+  const int titleColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("title")));
+  const int yearColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("pub_year")));
+
+  // the article is ignored when sorting titles
+  sortModel.sort(titleColumn, Qt::AscendingOrder);
+  QCOMPARE(sortModel.index(0, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(), entry1);
+
+  sortModel.sort(yearColumn, Qt::AscendingOrder);
+  QCOMPARE(sortModel.index(0, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(), entry2);
+
+  // the cached key for the modified entry must not be used
+  entry2->setField(QLatin1String("pub_year"), QLatin1String("2010"));
+  entryModel.modifyEntries(Tellico::Data::EntryList() << entry2);
+  sortModel.invalidate();
+  QCOMPARE(sortModel.index(0, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(), entry1);
+}
+
+void TellicoModelTest::testParallelSort() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < 5000; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("Title %1").arg((i * 7919) % 5000));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 100));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::EntryModel entryModel(this);
+  Tellico::EntrySortModel sortModel(this);
+  sortModel.setSourceModel(&entryModel);
+  sortModel.setSortRole(Tellico::EntryPtrRole);
+  Tellico::EntrySortModel parallelModel(this);
+  ModelTest test1(&parallelModel);
+  parallelModel.setParallel(true);
+  parallelModel.setSourceModel(&entryModel);
+  parallelModel.setSortRole(Tellico::EntryPtrRole);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+
+  const int titleColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("title")));
+  const int authorColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("author")));
+  QSignalSpy spy(&parallelModel, SIGNAL(signalParallelPassFinished()));
+  QSignalSpy layoutSpy(&parallelModel, SIGNAL(layoutChanged()));
+
+  sortModel.sort(titleColumn, Qt::AscendingOrder);
+  parallelModel.sort(authorColumn, Qt::AscendingOrder);
+  // the second sort cancels the first pass
+  parallelModel.sort(titleColumn, Qt::AscendingOrder);
+  QVERIFY(spy.wait());
+  QCOMPARE(spy.count(), 1);
+  // the result is applied all at once
+  QCOMPARE(layoutSpy.count(), 1);
+  QCOMPARE(parallelModel.sortColumn(), titleColumn);
+  QCOMPARE(parallelModel.rowCount(), sortModel.rowCount());
+  for(int row = 0; row < sortModel.rowCount(); ++row) {
+    QCOMPARE(parallelModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(),
+             sortModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>());
+  }
+
+  Tellico::FilterPtr filter(new Tellico::Filter(Tellico::Filter::MatchAny));
+  filter->append(new Tellico::FilterRule(QLatin1String("author"), QLatin1String("Author 1"), Tellico::FilterRule::FuncContains));
+  QSignalSpy removeSpy(&parallelModel, SIGNAL(rowsRemoved(const QModelIndex&, int, int)));
+  sortModel.setFilter(filter);
+  parallelModel.setFilter(filter);
+  QVERIFY(spy.wait());
+  QCOMPARE(layoutSpy.count(), 2);
+  QCOMPARE(removeSpy.count(), 0);
+  // Author 1, and Author 10-19
+  QCOMPARE(sortModel.rowCount(), 550);
+  QCOMPARE(parallelModel.rowCount(), sortModel.rowCount());
+  for(int row = 0; row < sortModel.rowCount(); ++row) {
+    QCOMPARE(parallelModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(),
+             sortModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>());
+  }
+}
+
+void TellicoModelTest::testParallelFilter() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < 5000; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    // the accents get removed while matching
+    entry->setField(QLatin1String("title"), (i % 3 == 0 ? QString::fromUtf8("Caf\xc3\xa9 %1") : QString::fromLatin1("Tea %1")).arg(i));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 100));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::EntryModel entryModel(this);
+  Tellico::EntrySortModel sortModel(this);
+  sortModel.setSourceModel(&entryModel);
+  sortModel.setSortRole(Tellico::EntryPtrRole);
+  Tellico::EntrySortModel parallelModel(this);
+  ModelTest test1(&parallelModel);
+  parallelModel.setParallel(true);
+  parallelModel.setSourceModel(&entryModel);
+  parallelModel.setSortRole(Tellico::EntryPtrRole);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+  QSignalSpy spy(&parallelModel, SIGNAL(signalParallelPassFinished()));
+
+  // the same rules as the quick filter, matching any field
+  Tellico::FilterPtr filter(new Tellico::Filter(Tellico::Filter::MatchAll));
+  filter->append(new Tellico::FilterRule(QString(), QLatin1String("cafe"), Tellico::FilterRule::FuncContains));
+  filter->append(new Tellico::FilterRule(QString(), QLatin1String("Author 1"), Tellico::FilterRule::FuncContains));
+  foreach(Tellico::Data::EntryPtr entry, entries) {
+    QCOMPARE(filter->matchesValues(filter->values(entry)), filter->matches(entry));
+  }
+
+  sortModel.setFilter(filter);
+  parallelModel.setFilter(filter);
+  QVERIFY(spy.wait());
+  // every third entry, by Author 1 or Author 10-19
+  QCOMPARE(sortModel.rowCount(), 182);
+  QCOMPARE(parallelModel.rowCount(), sortModel.rowCount());
+  for(int row = 0; row < sortModel.rowCount(); ++row) {
+    QCOMPARE(parallelModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>(),
+             sortModel.index(row, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>());
+  }
+
+  // a new filter cancels the running pass, which must not outlive the model
+  Tellico::FilterPtr filter2(new Tellico::Filter(Tellico::Filter::MatchAny));
+  filter2->append(new Tellico::FilterRule(QString(), QLatin1String("tea"), Tellico::FilterRule::FuncNotContains));
+  parallelModel.setFilter(filter2);
+  parallelModel.setFilter(filter);
+  QVERIFY(spy.wait());
+  QCOMPARE(parallelModel.rowCount(), sortModel.rowCount());
+}
+
+void TellicoModelTest::testVirtualizedModel() {
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < 100; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("The Title %1").arg(i));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::EntryModel entryModel(this);
+  ModelTest test1(&entryModel);
+  entryModel.setVirtualized(true);
+  QVERIFY(entryModel.isVirtualized());
+  // room for a handful of values
+  entryModel.setFormatCacheSize(1000);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+
+  const int titleColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("title")));
+  for(int row = 0; row < entryModel.rowCount(); ++row) {
+    const QModelIndex index = entryModel.index(row, titleColumn);
+    Tellico::Data::EntryPtr entry = index.data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>();
+    QCOMPARE(index.data().toString(), entry->formatField(coll->fieldByName(QLatin1String("title"))));
+    // the formatted value is not kept in the entry
+    QVERIFY(entry->formattedFieldValues().isEmpty());
+  }
+
+  // a modified entry is formatted again
+  Tellico::Data::EntryPtr entry = entries.last();
+  const QModelIndex index = entryModel.indexFromEntry(entry).sibling(entryModel.indexFromEntry(entry).row(), titleColumn);
+  QCOMPARE(index.data().toString(), QLatin1String("Title 99, The"));
+  entry->setField(QLatin1String("title"), QLatin1String("The New Title"));
+  entryModel.modifyEntries(Tellico::Data::EntryList() << entry);
+  QCOMPARE(index.data().toString(), QLatin1String("New Title, The"));
+}
+
+void TellicoModelTest::testScrollBenchmark() {
+  QFETCH(int, count);
+
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryList entries;
+  entries.reserve(count);
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("The Title %1").arg(i));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 1000));
+    entry->setField(QLatin1String("pub_year"), QString::number(1900 + i % 120));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  // the same models as the detailed view, sorted by year
+  Tellico::EntryModel entryModel(this);
+  entryModel.setVirtualized(true);
+  Tellico::EntrySortModel sortModel(this);
+  sortModel.setSortRole(Tellico::EntryPtrRole);
+  sortModel.setSourceModel(&entryModel);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+
+  QList<int> columns;
+  columns << coll->fields().indexOf(coll->fieldByName(QLatin1String("title")))
+          << coll->fields().indexOf(coll->fieldByName(QLatin1String("author")))
+          << coll->fields().indexOf(coll->fieldByName(QLatin1String("pub_year")));
+  sortModel.sort(columns.last(), Qt::DescendingOrder);
+
+  QTreeView view;
+  view.setUniformRowHeights(true);
+  view.setModel(&sortModel);
+  for(int col = 0; col < sortModel.columnCount(); ++col) {
+    view.setColumnHidden(col, !columns.contains(col));
+  }
+  view.resize(800, 600);
+  view.show();
+  QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+  // scrolled a page at a time, with a few jumps of the scroll bar
+  const int pageSize = qMax(1, view.viewport()->height() / qMax(1, view.visualRect(sortModel.index(0, columns.first())).height()));
+  const int pageCount = count / pageSize;
+  QSet<int> pages;
+  pages.insert(0);
+  int page = 0;
+  QBENCHMARK {
+    for(int i = 0; i < 100; ++i) {
+      page = (i % 10 == 0) ? (page + 7919) % pageCount : (page + 1) % pageCount;
+      pages.insert(page);
+      view.scrollTo(sortModel.index(page * pageSize, columns.first()), QAbstractItemView::PositionAtTop);
+      view.viewport()->repaint();
+    }
+  }
+
+  // rows out of view are never formatted
+  int unseenPage = 1;
+  while(pages.contains(unseenPage - 1) || pages.contains(unseenPage) || pages.contains(unseenPage + 1)) {
+    ++unseenPage;
+  }
+  QVERIFY(unseenPage < pageCount - 1);
+  Tellico::Data::EntryPtr unseenEntry = sortModel.index(unseenPage * pageSize, 0).data(Tellico::EntryPtrRole).value<Tellico::Data::EntryPtr>();
+  QVERIFY(unseenEntry);
+  QVERIFY(unseenEntry->formattedFieldValues().isEmpty());
+}
+
+void TellicoModelTest::testScrollBenchmark_data() {
+  QTest::addColumn<int>("count");
+
+  QTest::newRow("100000") << 100000;
+  // the largest data set takes a lot of time and memory, so only run it on request
+  if(qEnvironmentVariableIsSet("TELLICO_BENCHMARK_LARGE")) {
+    QTest::newRow("1000000") << 1000000;
+  }
+}
+
+void TellicoModelTest::testSortBenchmark() {
+  QFETCH(int, count);
+
+  Tellico::Data::CollPtr coll(new Tellico::Data::BookCollection(true)); // add default fields
+  Tellico::Data::EntryList entries;
+  for(int i = 0; i < count; ++i) {
+    Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+    entry->setField(QLatin1String("title"), QString::fromLatin1("The Title %1").arg((i * 7919) % count));
+    entry->setField(QLatin1String("author"), QString::fromLatin1("Author %1").arg(i % 1000));
+    entry->setField(QLatin1String("pub_year"), QString::number(1900 + (i * 31) % 120));
+    entries << entry;
+  }
+  coll->addEntries(entries);
+
+  Tellico::EntryModel entryModel(this);
+  Tellico::EntrySortModel sortModel(this);
+  sortModel.setSourceModel(&entryModel);
+  sortModel.setSortRole(Tellico::EntryPtrRole);
+  entryModel.setFields(coll->fields());
+  entryModel.setEntries(coll->entries());
+
+  const int titleColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("title")));
+  const int authorColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("author")));
+  const int yearColumn = coll->fields().indexOf(coll->fieldByName(QLatin1String("pub_year")));
+
+  // clicking on the column headers, one after another
+  QBENCHMARK {
+    sortModel.sort(titleColumn, Qt::AscendingOrder);
+    sortModel.sort(authorColumn, Qt::AscendingOrder);
+    sortModel.sort(yearColumn, Qt::DescendingOrder);
+  }
+  QCOMPARE(sortModel.rowCount(), count);
+}
+
+void TellicoModelTest::testSortBenchmark_data() {
+  QTest::addColumn<int>("count");
+
+  QTest::newRow("1000") << 1000;
+  QTest::newRow("10000") << 10000;
+}
@@ -35,6 +35,14 @@ private Q_SLOTS:
   void testEntryModel();
   void testFilterModel();
   void testGroupModel();
+  void testSortKeys();
+  void testParallelSort();
+  void testParallelFilter();
+  void testVirtualizedModel();
+  void testScrollBenchmark();
+  void testScrollBenchmark_data();
+  void testSortBenchmark();
+  void testSortBenchmark_data();
 };
 
 #endif
@@ -31,19 +31,91 @@
 #include "../collections/coincollection.h"
 #include "../collectionfactory.h"
 #include "../translators/tellicoxmlexporter.h"
+#include "../translators/tellicoxmlhandler.h"
+#include "../translators/tellicoxmlreader.h"
 #include "../images/imagefactory.h"
 #include "../images/image.h"
 #include "../fieldformat.h"
 #include "../entry.h"
 #include "../utils/xmlhandler.h"
+#include "../core/filehandler.h"
 
 #include <QTest>
+#include <QSignalSpy>
+#include <QXmlSimpleReader>
+#include <QXmlStreamReader>
+#include <QDomDocument>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QCryptographicHash>
 
 QTEST_GUILESS_MAIN( TellicoReadTest )
 
 #define QL1(x) QString::fromLatin1(x)
 #define TELLICOREAD_NUMBER_OF_CASES 10
 
+namespace {
+  // synthetic book collection using the default fields
+  QByteArray bookData(int count) {
+    QByteArray data;
+    data.reserve(count * 300);
+    data += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<tellico xmlns=\"http://periapsis.org/tellico/\" syntaxVersion=\"11\">\n"
+            " <collection title=\"Books\" type=\"2\">\n"
+            "  <fields>\n   <field name=\"_default\"/>\n  </fields>\n";
+    for(int i = 0; i < count; ++i) {
+      data += "  <entry id=\"" + QByteArray::number(i+1) + "\">\n"
+              "   <title>Title " + QByteArray::number(i) + "</title>\n"
+              "   <authors><author>Author " + QByteArray::number(i % 1000) + "</author>"
+              "<author>Editor " + QByteArray::number(i % 77) + "</author></authors>\n"
+              "   <publisher>Publisher " + QByteArray::number(i % 50) + "</publisher>\n"
+              "   <pub_year>" + QByteArray::number(1900 + i % 120) + "</pub_year>\n"
+              "   <genres><genre>Fiction</genre></genres>\n"
+              "   <read>true</read>\n"
+              "  </entry>\n";
+    }
+    data += " </collection>\n</tellico>\n";
+    return data;
+  }
+
+  // QDom writes attributes in hash order, so compare everything else token by token,
+  // including all the whitespace, with sorted attributes
+  QStringList xmlTokens(const QByteArray& data) {
+    QStringList tokens;
+    QXmlStreamReader xml(data);
+    while(!xml.atEnd()) {
+      xml.readNext();
+      QString token = xml.tokenString() + QLatin1Char(':') + xml.name().toString() + xml.text().toString();
+      if(xml.isStartElement()) {
+        QStringList attributes;
+        foreach(const QXmlStreamAttribute& attribute, xml.attributes()) {
+          attributes += attribute.name().toString() + QLatin1Char('=') + attribute.value().toString();
+        }
+        attributes.sort();
+        token += QLatin1Char(' ') + attributes.join(QLatin1Char(' '));
+      }
+      tokens += token;
+    }
+    return tokens;
+  }
+
+#ifdef Q_OS_LINUX
+  // reads a memory value from the process status, in kB
+  qint64 processMemory(const QByteArray& key) {
+    QFile f(QLatin1String("/proc/self/status"));
+    if(!f.open(QIODevice::ReadOnly)) {
+      return -1;
+    }
+    foreach(const QByteArray& line, f.readAll().split('\n')) {
+      if(line.startsWith(key + ':')) {
+        return line.mid(key.length() + 1).trimmed().split(' ').first().toLongLong();
+      }
+    }
+    return -1;
+  }
+#endif
+}
+
 void TellicoReadTest::initTestCase() {
   // need to register this first
   Tellico::RegisterCollection<Tellico::Data::BookCollection> registerBook(Tellico::Data::Collection::Book, "book");
@@ -206,6 +278,44 @@ void TellicoReadTest::testDuplicateLoans() {
   QCOMPARE(bor->loans().count(), 1);
 }
 
+void TellicoReadTest::testBackgroundReading() {
+  QUrl url = QUrl::fromLocalFile(QFINDTESTDATA("/data/duplicate_loan.xml"));
+
+  Tellico::Import::TellicoImporter importer(url, false);
+  importer.setReadInBackground(true);
+  QSignalSpy finishedSpy(&importer, SIGNAL(signalReadFinished(bool)));
+  Tellico::Data::CollPtr coll = importer.collection();
+
+  QVERIFY(coll);
+  QVERIFY(coll->hasField(QL1("title")));
+  // the loans come at the end of the file, so they are only added once everything is read
+  QTRY_COMPARE(finishedSpy.count(), 1);
+  QVERIFY(finishedSpy.first().at(0).toBool());
+  QVERIFY(!importer.isReading());
+
+  QCOMPARE(coll->entryCount(), 4);
+  QCOMPARE(coll->borrowers().count(), 1);
+  QCOMPARE(coll->borrowers().first()->loans().count(), 1);
+  // the entries keep their ids from the file
+  Tellico::Data::EntryPtr loanedEntry = coll->borrowers().first()->loans().first()->entry();
+  QCOMPARE(loanedEntry->id(), Tellico::Data::ID(1));
+  QCOMPARE(coll->entryById(1), loanedEntry);
+  QCOMPARE(loanedEntry->collection(), coll);
+  QCOMPARE(loanedEntry->field(QL1("title")), QL1("book1"));
+
+  // without returning to the event loop, the rest of the file is read before finishReading() returns
+  Tellico::Import::TellicoImporter importer2(url, false);
+  importer2.setReadInBackground(true);
+  QSignalSpy finishedSpy2(&importer2, SIGNAL(signalReadFinished(bool)));
+  Tellico::Data::CollPtr coll2 = importer2.collection();
+  QVERIFY(coll2);
+  importer2.finishReading();
+  QCOMPARE(finishedSpy2.count(), 1);
+  QCOMPARE(coll2->entryCount(), 4);
+  QCOMPARE(coll2->borrowers().count(), 1);
+  QCOMPARE(coll2->entryById(4)->field(QL1("title")), QL1("book4"));
+}
+
 void TellicoReadTest::testDuplicateBorrowers() {
   QUrl url = QUrl::fromLocalFile(QFINDTESTDATA("/data/duplicate_borrower.xml"));
 
@@ -224,7 +334,7 @@ void TellicoReadTest::testDuplicateBorrowers() {
 
 void TellicoReadTest::testLocalImage() {
   // this is the md5 hash of the tellico.png icon, used as an image id
-  const QString imageId(QL1("dde5bf2cbd90fad8635a26dfb362e0ff.png"));
+  const QString imageId(QL1("238facd056a59ca8458ebca76edd3493.png"));
   // not yet loaded
   QVERIFY(!Tellico::ImageFactory::self()->hasImageInMemory(imageId));
   QVERIFY(!Tellico::ImageFactory::self()->hasImageInfo(imageId));
@@ -258,8 +368,13 @@ void TellicoReadTest::testLocalImage() {
 }
 
 void TellicoReadTest::testRemoteImage() {
-  // this is the md5 hash of the logo.png icon, used as an image id
-  const QString imageId(QL1("757322046f4aa54290a3d92b05b71ca1.png"));
+  const QUrl imageUrl(QL1("http://tellico-project.org/sites/default/files/logo.png"));
+  const QByteArray imageData = Tellico::FileHandler::readDataFile(imageUrl, true /* quiet */);
+  if(imageData.isEmpty()) {
+    QSKIP("This test requires network access", SkipSingle);
+  }
+  // the md5 hash of the logo.png icon, as it was downloaded, is used as an image id
+  const QString imageId = QL1(QCryptographicHash::hash(imageData, QCryptographicHash::Md5).toHex()) + QL1(".png");
   // not yet loaded
   QVERIFY(!Tellico::ImageFactory::self()->hasImageInMemory(imageId));
   QVERIFY(!Tellico::ImageFactory::self()->hasImageInfo(imageId));
@@ -272,8 +387,7 @@ void TellicoReadTest::testRemoteImage() {
   QTextStream in(&f);
   QString fileText = in.readAll();
   // replace %COVER% with image file location
-  fileText.replace(QL1("%COVER%"),
-                   QL1("http://tellico-project.org/sites/default/files/logo.png"));
+  fileText.replace(QL1("%COVER%"), imageUrl.url());
 
   Tellico::Import::TellicoImporter importer(fileText);
   Tellico::Data::CollPtr coll = importer.collection();
@@ -290,6 +404,7 @@ void TellicoReadTest::testRemoteImage() {
 
   const Tellico::Data::Image& img = Tellico::ImageFactory::imageById(imageId);
   QVERIFY(!img.isNull());
+  QCOMPARE(img.byteArray(), imageData);
 }
 
 void TellicoReadTest::testXMLHandler() {
@@ -313,3 +428,184 @@ void TellicoReadTest::testXMLHandler_data() {
   QTest::newRow("latin1") << QByteArray("<?xml encoding=\"latin1\"?>\n<x>value</x>")
                           << QString::fromUtf8("<?xml encoding=\"utf-8\"?>\n<x>value</x>") << true;
 }
+
+void TellicoReadTest::testXMLReader() {
+  const QByteArray data = bookData(10);
+
+  Tellico::Import::TellicoXMLReader reader(data);
+  // read in small steps, the same as the importer does
+  qint64 pos = 0;
+  while(!reader.atEnd()) {
+    pos += data.size()/10;
+    QVERIFY(reader.readUntil(pos));
+    QVERIFY(reader.offset() <= data.size());
+  }
+  Tellico::Data::CollPtr coll = reader.collection();
+  QVERIFY(coll);
+  QCOMPARE(coll->type(), Tellico::Data::Collection::Book);
+  QCOMPARE(coll->title(), QLatin1String("Books"));
+  QCOMPARE(coll->entryCount(), 10);
+
+  Tellico::Data::EntryPtr entry = coll->entryById(4);
+  QVERIFY(entry);
+  QCOMPARE(entry->field(QLatin1String("title")), QLatin1String("Title 3"));
+  QCOMPARE(entry->field(QLatin1String("author")), QLatin1String("Author 3; Editor 3"));
+  QCOMPARE(entry->field(QLatin1String("pub_year")), QLatin1String("1903"));
+  QCOMPARE(entry->field(QLatin1String("read")), QLatin1String("true"));
+
+  // malformed data is an error
+  Tellico::Import::TellicoXMLReader badReader(data.left(data.size()/2) + "</tellico>");
+  QVERIFY(!badReader.read());
+  QVERIFY(!badReader.errorString().isEmpty());
+}
+
+void TellicoReadTest::testLoadBenchmark() {
+  QFETCH(int, count);
+  QFETCH(bool, streaming);
+
+  const QByteArray data = bookData(count);
+  Tellico::Data::CollPtr coll;
+  QBENCHMARK_ONCE {
+    if(streaming) {
+      Tellico::Import::TellicoXMLReader reader(data);
+      QVERIFY(reader.read());
+      coll = reader.collection();
+    } else {
+      Tellico::Import::TellicoXMLHandler handler;
+      QXmlSimpleReader reader;
+      reader.setContentHandler(&handler);
+      QXmlInputSource source;
+      source.setData(data);
+      QVERIFY(reader.parse(&source));
+      coll = handler.collection();
+    }
+  }
+  QVERIFY(coll);
+  QCOMPARE(coll->entryCount(), count);
+}
+
+void TellicoReadTest::testLoadBenchmark_data() {
+  QTest::addColumn<int>("count");
+  QTest::addColumn<bool>("streaming");
+
+  QList<int> counts;
+  counts << 10000 << 100000;
+  // the largest data set takes a lot of time and memory, so only run it on request
+  if(qEnvironmentVariableIsSet("TELLICO_BENCHMARK_LARGE")) {
+    counts << 1000000;
+  }
+  foreach(int count, counts) {
+    QTest::newRow(QByteArray("sax " + QByteArray::number(count)).constData()) << count << false;
+    QTest::newRow(QByteArray("stream " + QByteArray::number(count)).constData()) << count << true;
+  }
+}
+
+void TellicoReadTest::testXMLWriter() {
+  QFETCH(QString, fileName);
+
+  Tellico::Import::TellicoImporter importer(QUrl::fromLocalFile(QFINDTESTDATA(fileName)));
+  Tellico::Data::CollPtr coll = importer.collection();
+  QVERIFY(coll);
+
+  // add some text that needs escaping, in both attributes and elements
+  Tellico::Data::FieldPtr field(new Tellico::Data::Field(QL1("escaped"), QL1("Escaped \"Title\"")));
+  field->setDescription(QL1("Tab\tnewline\nreturn\r<less> & 'apos'"));
+  coll->addField(field);
+  Tellico::Data::EntryPtr entry(new Tellico::Data::Entry(coll));
+  entry->setField(QL1("title"), QString::fromUtf8("<Title> & ]]> \"quotes\" \u00e9\u4e2d"));
+  entry->setField(field, QL1("carriage\rreturn"));
+  coll->addEntries(entry);
+
+  Tellico::Export::TellicoXMLExporter exporter(coll);
+  exporter.setEntries(coll->entries());
+  exporter.setOptions(exporter.options() | Tellico::Export::ExportUTF8 | Tellico::Export::ExportComplete);
+
+  const QByteArray domData = exporter.exportXML().toByteArray();
+  QVERIFY(!domData.isEmpty());
+
+  QByteArray streamData;
+  QBuffer buffer(&streamData);
+  QVERIFY(buffer.open(QIODevice::WriteOnly));
+  QVERIFY(exporter.exportXML(&buffer));
+  buffer.close();
+
+  QCOMPARE(streamData.size(), domData.size());
+  QCOMPARE(xmlTokens(streamData), xmlTokens(domData));
+
+  // and the streamed file can be read back in
+  Tellico::Import::TellicoImporter importer2(QString::fromUtf8(streamData));
+  Tellico::Data::CollPtr coll2 = importer2.collection();
+  QVERIFY(coll2);
+  QCOMPARE(coll2->entryCount(), coll->entryCount());
+  QCOMPARE(coll2->entryById(entry->id())->title(), entry->title());
+}
+
+void TellicoReadTest::testXMLWriter_data() {
+  QTest::addColumn<QString>("fileName");
+
+  QTest::newRow("books") << QL1("data/books-format9.bc");
+  QTest::newRow("coins") << QL1("data/coins-format9.tc");
+  QTest::newRow("table") << QL1("data/tabletest.tc");
+  QTest::newRow("loans") << QL1("data/duplicate_loan.xml");
+}
+
+void TellicoReadTest::testSaveBenchmark() {
+  QFETCH(int, count);
+  QFETCH(bool, streaming);
+
+  Tellico::Import::TellicoXMLReader reader(bookData(count));
+  QVERIFY(reader.read());
+  Tellico::Data::CollPtr coll = reader.collection();
+  QVERIFY(coll);
+
+  Tellico::Export::TellicoXMLExporter exporter(coll);
+  exporter.setEntries(coll->entries());
+  exporter.setOptions(exporter.options() | Tellico::Export::ExportUTF8 | Tellico::Export::ExportComplete);
+
+  QTemporaryFile file;
+  QVERIFY(file.open());
+
+#ifdef Q_OS_LINUX
+  // reset the peak memory, so that it only covers the save
+  QFile clearRefs(QLatin1String("/proc/self/clear_refs"));
+  if(clearRefs.open(QIODevice::WriteOnly)) {
+    clearRefs.write("5");
+    clearRefs.close();
+  }
+  const qint64 startMemory = processMemory("VmRSS");
+#endif
+
+  QBENCHMARK_ONCE {
+    if(streaming) {
+      QVERIFY(exporter.exportXML(&file));
+    } else {
+      QVERIFY(file.write(exporter.exportXML().toByteArray()) > 0);
+    }
+  }
+
+  QVERIFY(file.size() > count * 100);
+#ifdef Q_OS_LINUX
+  // the streamed file is never held in memory as a whole, unlike the document and its text
+  const qint64 peakMemory = processMemory("VmHWM");
+  if(streaming && startMemory > 0 && peakMemory > 0) {
+    QVERIFY2((peakMemory - startMemory) * 1024 < file.size(),
+             qPrintable(QString::fromLatin1("peak memory increase of %1 kB").arg(peakMemory - startMemory)));
+  }
+#endif
+}
+
+void TellicoReadTest::testSaveBenchmark_data() {
+  QTest::addColumn<int>("count");
+  QTest::addColumn<bool>("streaming");
+
+  QList<int> counts;
+  counts << 10000 << 100000;
+  // the largest data set takes a lot of time and memory, so only run it on request
+  if(qEnvironmentVariableIsSet("TELLICO_BENCHMARK_LARGE")) {
+    counts << 200000;
+  }
+  foreach(int count, counts) {
+    QTest::newRow(QByteArray("dom " + QByteArray::number(count)).constData()) << count << false;
+    QTest::newRow(QByteArray("stream " + QByteArray::number(count)).constData()) << count << true;
+  }
+}
@@ -43,11 +43,19 @@ private Q_SLOTS:
   void testCoinCollection();
   void testTableData();
   void testDuplicateLoans();
+  void testBackgroundReading();
   void testDuplicateBorrowers();
   void testLocalImage();
   void testRemoteImage();
   void testXMLHandler();
   void testXMLHandler_data();
+  void testXMLReader();
+  void testLoadBenchmark();
+  void testLoadBenchmark_data();
+  void testXMLWriter();
+  void testXMLWriter_data();
+  void testSaveBenchmark();
+  void testSaveBenchmark_data();
 
 private:
   QList<Tellico::Data::CollPtr> m_collections;
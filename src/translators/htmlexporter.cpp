@@ -60,6 +60,11 @@
 #include <QFileInfo>
 #include <QApplication>
 #include <QLocale>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSaveFile>
+#include <QTextCodec>
 
 extern "C" {
 #include <libxml/HTMLparser.h>
@@ -68,6 +73,63 @@ extern "C" {
 
 using Tellico::Export::HTMLExporter;
 
+namespace {
+  // how many entry files may be waiting to be written, for each thread
+  static const int HTML_EXPORT_PENDING_FILES_PER_THREAD = 4;
+
+// transforms the XML for a single entry and writes the file, in a worker thread
+// the stylesheet is shared by every job, and is only read
+class EntryFileJob : public QRunnable {
+public:
+  EntryFileJob(const Tellico::XSLTHandler* handler_, const QHash<QByteArray, QByteArray>& params_,
+               xmlDocPtr doc_, const QString& fileName_, bool utf8_,
+               QSemaphore* slots_, QAtomicInt* failures_)
+      : QRunnable(), m_handler(handler_), m_params(params_), m_doc(doc_), m_fileName(fileName_)
+      , m_utf8(utf8_), m_slots(slots_), m_failures(failures_) {}
+  // the document is still owned by a job that was never run
+  ~EntryFileJob() {
+    if(m_doc) {
+      xmlFreeDoc(m_doc);
+    }
+  }
+
+  void run() Q_DECL_OVERRIDE {
+    bool success = false;
+    // the handler frees the document
+    const QByteArray output = m_handler->applyStylesheet(m_doc, m_params);
+    m_doc = nullptr;
+    if(!output.isNull()) {
+      QSaveFile f(m_fileName);
+      if(f.open(QIODevice::WriteOnly)) {
+        // the stylesheet output is written as is, without adding a newline,
+        // so the file matches the one written by HTMLExporter::exec()
+        if(m_utf8) {
+          f.write(output);
+        } else {
+          f.write(QTextCodec::codecForLocale()->fromUnicode(QString::fromUtf8(output)));
+        }
+        success = f.commit();
+      }
+    }
+    if(!success) {
+      myWarning() << "unable to write entry file:" << m_fileName;
+      m_failures->ref();
+    }
+    m_slots->release();
+  }
+
+private:
+  const Tellico::XSLTHandler* m_handler;
+  QHash<QByteArray, QByteArray> m_params;
+  xmlDocPtr m_doc;
+  QString m_fileName;
+  bool m_utf8;
+  QSemaphore* m_slots;
+  QAtomicInt* m_failures;
+};
+
+}
+
 HTMLExporter::HTMLExporter(Tellico::Data::CollPtr coll_) : Tellico::Export::Exporter(coll_),
     m_handler(nullptr),
     m_printHeaders(true),
@@ -133,7 +195,14 @@ bool HTMLExporter::exec() {
   ProgressItem::Done done(this);
   ProgressManager::self()->setProgress(this, 20);
 
-  bool success = FileHandler::writeTextURL(url(), text(), options() & Export::ExportUTF8, force);
+  bool success = false;
+  if(options() & Export::ExportUTF8) {
+    // the stylesheet output is already utf-8, so write it without going through a string
+    const QByteArray data = utf8Text();
+    success = !data.isNull() && FileHandler::writeDataURL(url(), data, force);
+  } else {
+    success = FileHandler::writeTextURL(url(), text(), false, force);
+  }
   if(m_parseDOM && !m_cancelled) {
     success &= copyFiles() && (!m_exportEntryFiles || writeEntryFiles());
   }
@@ -214,33 +283,15 @@ bool HTMLExporter::loadXSLTFile() {
 }
 
 QString HTMLExporter::text() {
-  if((!m_handler || !m_handler->isValid()) && !loadXSLTFile()) {
-    myWarning() << "error loading xslt file:" << m_xsltFile;
-    return QString();
-  }
-
-  Data::CollPtr coll = collection();
-  if(!coll) {
-    myDebug() << "no collection pointer!";
-    return QString();
-  }
-
-  if(m_groupBy.isEmpty()) {
-    m_printGrouped = false; // can't group if no groups exist
-  }
+  return QString::fromUtf8(utf8Text());
+}
 
+QByteArray HTMLExporter::utf8Text() {
   GUI::CursorSaver cs;
-  writeImages(coll);
-
-  // now grab the XML
-  TellicoXMLExporter exporter(coll);
-  exporter.setURL(url());
-  exporter.setEntries(entries());
-  exporter.setFields(fields());
-  exporter.setIncludeGroups(m_printGrouped);
-// yes, this should be in utf8, always
-  exporter.setOptions(options() | Export::ExportUTF8 | Export::ExportImages);
-  QDomDocument output = exporter.exportXML();
+  const QDomDocument output = exportXML();
+  if(output.isNull()) {
+    return QByteArray();
+  }
 #if 0
   QFile f(QLatin1String("/tmp/test.xml"));
   if(f.open(QIODevice::WriteOnly)) {
@@ -250,15 +301,16 @@ QString HTMLExporter::text() {
   f.close();
 #endif
 
-  const QString outputText = m_handler->applyStylesheet(output.toString());
+  // the DOM is handed to libxml2 directly, rather than written out and parsed again
+  QByteArray outputText = m_handler->applyStylesheet(XSLTHandler::xmlDocument(output), m_handler->params());
+  if(outputText.isNull()) {
+    return outputText;
+  }
 #if 0
   myDebug() << "Remove debug2 from htmlexporter.cpp";
   QFile f2(QLatin1String("/tmp/test.html"));
   if(f2.open(QIODevice::WriteOnly)) {
-    QTextStream t(&f2);
-    t << outputText;
-//    t << "\n\n-------------------------------------------------------\n\n";
-//    t << Tellico::i18nReplace(outputText);
+    f2.write(outputText);
   }
   f2.close();
 #endif
@@ -267,7 +319,7 @@ QString HTMLExporter::text() {
     return outputText;
   }
 
-  htmlDocPtr htmlDoc = htmlParseDoc(reinterpret_cast<xmlChar*>(outputText.toUtf8().data()), nullptr);
+  htmlDocPtr htmlDoc = htmlParseDoc(reinterpret_cast<xmlChar*>(outputText.data()), nullptr);
   xmlNodePtr root = xmlDocGetRootElement(htmlDoc);
   if(root == nullptr) {
     myDebug() << "no root";
@@ -278,14 +330,43 @@ QString HTMLExporter::text() {
   xmlChar* c;
   int bytes;
   htmlDocDumpMemory(htmlDoc, &c, &bytes);
-  QString allText;
+  QByteArray allText;
   if(bytes > 0) {
-    allText = QString::fromUtf8(reinterpret_cast<const char*>(c), bytes);
+    allText = QByteArray(reinterpret_cast<const char*>(c), bytes);
     xmlFree(c);
   }
   return allText;
 }
 
+QDomDocument HTMLExporter::exportXML() {
+  if((!m_handler || !m_handler->isValid()) && !loadXSLTFile()) {
+    myWarning() << "error loading xslt file:" << m_xsltFile;
+    return QDomDocument();
+  }
+
+  Data::CollPtr coll = collection();
+  if(!coll) {
+    myDebug() << "no collection pointer!";
+    return QDomDocument();
+  }
+
+  if(m_groupBy.isEmpty()) {
+    m_printGrouped = false; // can't group if no groups exist
+  }
+
+  writeImages(coll);
+
+  // now grab the XML
+  TellicoXMLExporter exporter(coll);
+  exporter.setURL(url());
+  exporter.setEntries(entries());
+  exporter.setFields(fields());
+  exporter.setIncludeGroups(m_printGrouped);
+// yes, this should be in utf8, always
+  exporter.setOptions(options() | Export::ExportUTF8 | Export::ExportImages);
+  return exporter.exportXML();
+}
+
 void HTMLExporter::setFormattingOptions(Tellico::Data::CollPtr coll) {
   QString file = Data::Document::self()->URL().fileName();
   if(file != i18n(Tellico::untitledFilename)) {
@@ -450,6 +531,10 @@ void HTMLExporter::writeImages(Tellico::Data::CollPtr coll_) {
   int count = 0;
   const int processCount = 100; // process after every 100 events
 
+  // without entry files, the images are never shown larger than the max image size
+  // but the temp dir is the image cache itself, so those are never replaced
+  const bool scaleImages = !useTemp && !m_exportEntryFiles && m_imageWidth > 0 && m_imageHeight > 0;
+
   StringSet imageSet; // track which images are written
   foreach(const QString& imageField, imageFields) {
     foreach(Data::EntryPtr entryIt, entries()) {
@@ -464,6 +549,14 @@ void HTMLExporter::writeImages(Tellico::Data::CollPtr coll_) {
       if(useTemp) {
         // for link-only images, no need to write it out
         success = ImageFactory::imageInfo(id).linkOnly || ImageFactory::writeCachedImage(id, ImageFactory::TempDir);
+      } else if(scaleImages) {
+        // the images are only shown at the limited size, so write the smaller thumbnail
+        const QImage img = ImageFactory::scaledImage(id, m_imageWidth, m_imageHeight);
+        const QByteArray format = Data::Image::outputFormat(ImageFactory::imageInfo(id).format);
+        QUrl target = imgDir;
+        target = target.adjusted(QUrl::StripTrailingSlash);
+        target.setPath(target.path() + QLatin1Char('/') + (id));
+        success = !img.isNull() && FileHandler::writeDataURL(target, Data::Image::byteArray(img, format), true);
       } else {
         const Data::Image& img = ImageFactory::imageById(id);
         QUrl target = imgDir;
@@ -758,6 +851,15 @@ bool HTMLExporter::writeEntryFiles() {
   exporter.setCollectionURL(url());
   bool parseDOM = true;
 
+  // after the first entry, the stylesheet is applied and the file written in a thread pool
+  // the XML is still created here, since the entries and the image factory are not thread-safe
+  // the pool is declared after the exporter, so it waits for every job before the stylesheet is deleted
+  const bool parallel = outputFile.isLocalFile();
+  const bool utf8 = options() & Export::ExportUTF8;
+  QThreadPool pool;
+  QSemaphore freeSlots(HTML_EXPORT_PENDING_FILES_PER_THREAD * pool.maxThreadCount());
+  QAtomicInt failures;
+
   const QString title = QLatin1String("title");
   const QString html = QLatin1String(".html");
   bool multipleTitles = collection()->fieldByName(title)->hasFlag(Data::Field::AllowMultiple);
@@ -776,7 +878,22 @@ bool HTMLExporter::writeEntryFiles() {
 
     exporter.setEntries(Data::EntryList() << entryIt);
     exporter.setURL(outputFile);
-    exporter.exec();
+    if(parallel && !parseDOM) {
+      xmlDocPtr doc = XSLTHandler::xmlDocument(exporter.exportXML());
+      if(!doc || !exporter.m_handler) {
+        xmlFreeDoc(doc);
+        failures.ref();
+      } else {
+        // don't let the pending files pile up in memory
+        while(!freeSlots.tryAcquire(1, 100)) {
+          qApp->processEvents();
+        }
+        pool.start(new EntryFileJob(exporter.m_handler, exporter.m_handler->params(), doc,
+                                    outputFile.toLocalFile(), utf8, &freeSlots, &failures));
+      }
+    } else {
+      exporter.exec();
+    }
 
     // no longer need to parse DOM
     if(parseDOM) {
@@ -796,7 +913,18 @@ bool HTMLExporter::writeEntryFiles() {
       qApp->processEvents();
     }
     ++j;
+    if(m_cancelled) {
+      pool.clear();
+      break;
+    }
+  }
+  while(!pool.waitForDone(100)) {
+    qApp->processEvents();
   }
+  if(failures.load() > 0) {
+    myWarning() << failures.load() << "entry files were not written";
+  }
+
   // the images in "pics/" are special data images, copy them always
   // since the entry files may refer to them, but we don't know that
   QStringList dataImages;
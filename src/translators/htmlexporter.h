@@ -34,6 +34,7 @@
 #include <libxml/xmlstring.h>
 
 class QCheckBox;
+class QDomDocument;
 
 extern "C" {
   struct _xmlNode;
@@ -89,6 +90,8 @@ public Q_SLOTS:
   void slotCancel();
 
 private:
+  QDomDocument exportXML();
+  QByteArray utf8Text();
   void setFormattingOptions(Data::CollPtr coll);
   void writeImages(Data::CollPtr coll);
   bool writeEntryFiles();
@@ -165,7 +165,7 @@ QString ONIXExporter::text() {
   }
   f.close();
 #endif
-  return m_handler->applyStylesheet(output.toString());
+  return m_handler->applyStylesheet(output);
 }
 
 QWidget* ONIXExporter::widget(QWidget* parent_) {
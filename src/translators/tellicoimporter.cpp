@@ -23,7 +23,8 @@
  ***************************************************************************/
 
 #include "tellicoimporter.h"
-#include "tellicoxmlhandler.h"
+#include "tellicoxmlreader.h"
+#include "tellicoxmlthread.h"
 #include "tellico_xml.h"
 #include "../collectionfactory.h"
 #include "../entry.h"
@@ -49,15 +50,23 @@ using Tellico::Import::TellicoImporter;
 
 TellicoImporter::TellicoImporter(const QUrl& url_, bool loadAllImages_) : DataImporter(url_),
     m_loadAllImages(loadAllImages_), m_format(Unknown), m_modified(false),
-    m_cancelled(false), m_hasImages(false), m_buffer(nullptr), m_zip(nullptr), m_imgDir(nullptr) {
+    m_cancelled(false), m_hasImages(false), m_background(false), m_reader(nullptr), m_thread(nullptr),
+    m_xmlZip(nullptr), m_xmlDevice(nullptr), m_buffer(nullptr), m_zip(nullptr), m_imgDir(nullptr) {
 }
 
 TellicoImporter::TellicoImporter(const QString& text_) : DataImporter(text_),
     m_loadAllImages(true), m_format(Unknown), m_modified(false),
-    m_cancelled(false), m_hasImages(false), m_buffer(nullptr), m_zip(nullptr), m_imgDir(nullptr) {
+    m_cancelled(false), m_hasImages(false), m_background(false), m_reader(nullptr), m_thread(nullptr),
+    m_xmlZip(nullptr), m_xmlDevice(nullptr), m_buffer(nullptr), m_zip(nullptr), m_imgDir(nullptr) {
 }
 
 TellicoImporter::~TellicoImporter() {
+  // the reader can't be deleted until the thread is done with it
+  if(m_thread) {
+    m_thread->slotCancel();
+    m_thread->wait();
+  }
+  deleteReader();
   delete m_zip;
   m_zip = nullptr;
   delete m_buffer;
@@ -89,6 +98,8 @@ Tellico::Data::CollPtr TellicoImporter::collection() {
     }
     s = QByteArray(data().constData(), 6);
   }
+  // only a file is read in the background, and loading all the images processes events
+  m_background = m_background && source() == URL && !m_loadAllImages;
 
   // hack for processEvents and deletion
   QPointer<TellicoImporter> thisPtr(this);
@@ -97,7 +108,16 @@ Tellico::Data::CollPtr TellicoImporter::collection() {
   // if the first 5 characters are <?xml then treat it like text
   if(s[0] == '<' && s[1] == '?' && s[2] == 'x' && s[3] == 'm' && s[4] == 'l') {
     m_format = XML;
-    loadXMLData(source() == URL ? fileRef().file()->readAll() : data(), true);
+    if(source() == URL) {
+      // read straight from the file, rather than loading it all into memory first
+      QIODevice* f = fileRef().file();
+      loadXMLData(f, f->size(), true);
+    } else {
+      QBuffer buffer;
+      buffer.setData(data());
+      buffer.open(QIODevice::ReadOnly);
+      loadXMLData(&buffer, buffer.size(), true);
+    }
   } else {
     m_format = Zip;
     loadZipData();
@@ -105,57 +125,147 @@ Tellico::Data::CollPtr TellicoImporter::collection() {
   return thisPtr ? m_coll : Data::CollPtr();
 }
 
-void TellicoImporter::loadXMLData(const QByteArray& data_, bool loadImages_) {
+void TellicoImporter::loadXMLData(QIODevice* device_, qint64 size_, bool loadImages_) {
   const bool showProgress = options() & ImportProgress;
 
-  TellicoXMLHandler handler;
-  handler.setLoadImages(loadImages_);
-  handler.setShowImageLoadErrors(options() & ImportShowImageErrors);
-
-  QXmlSimpleReader reader;
-  reader.setContentHandler(&handler);
-
-  QXmlInputSource source;
-  source.setData(QByteArray()); // necessary
-  bool success = reader.parse(&source, true);
-
-  const int blockSize = data_.size()/100 + 1;
-  int pos = 0;
-  emit signalTotalSteps(this, data_.size());
+  m_reader = new TellicoXMLReader(device_);
+  m_reader->setLoadImages(loadImages_);
+  m_reader->setShowImageLoadErrors(options() & ImportShowImageErrors);
+  emit signalTotalSteps(this, size_);
+
+  if(m_background) {
+    // the image factory and the collection can only be used in this thread
+    m_reader->setDeferImages(true);
+    m_reader->setDeferEntries(true);
+    m_thread = new TellicoXMLThread(m_reader, size_, this);
+    if(showProgress) {
+      connect(m_thread, SIGNAL(signalProgress(qint64)), SLOT(slotReadProgress(qint64)));
+    }
+    connect(m_thread, SIGNAL(signalEntriesRead()), SLOT(slotThreadEntriesRead()));
+    connect(m_thread, SIGNAL(finished()), SLOT(slotThreadFinished()));
+    if(m_cancelled) {
+      m_thread->slotCancel();
+    }
+    m_thread->start();
+    // only blocks until the fields are read, the entries are added from the event loop later
+    m_coll = m_thread->waitForCollection();
+    if(!m_coll) {
+      m_thread->wait();
+      if(!m_thread->success()) {
+        setReadError(m_reader->errorString());
+      }
+      deleteReader();
+    }
+    return;
+  }
 
-  // hack to allow processEvents
-  QPointer<TellicoImporter> thisPtr(this);
-  while(thisPtr && success && !m_cancelled && pos < data_.size()) {
-    uint size = qMin(blockSize, data_.size() - pos);
-    QByteArray block = QByteArray::fromRawData(data_.data() + pos, size);
-    source.setData(block);
-    success = reader.parseContinue();
+  const qint64 blockSize = size_/100 + 1;
+  qint64 pos = 0;
+  bool success = true;
+  while(success && !m_reader->atEnd()) {
     pos += blockSize;
-    if(thisPtr && showProgress) {
-      emit signalProgress(this, pos);
-      qApp->processEvents();
+    success = m_reader->readUntil(pos);
+    if(showProgress) {
+      emit signalProgress(this, qMin(m_reader->offset(), size_));
     }
   }
-  if(!thisPtr) {
+
+  if(success) {
+    m_hasImages = m_reader->hasImages();
+    m_coll = m_reader->collection();
+  } else {
+    setReadError(m_reader->errorString());
+  }
+  deleteReader();
+}
+
+void TellicoImporter::setReadError(const QString& error_) {
+  m_format = Error;
+  QString error;
+  if(!url().isEmpty()) {
+    error = i18n(errorLoad).arg(url().fileName()) + QLatin1Char('\n');
+  }
+  error += error_;
+  myDebug() << error;
+  setStatusMessage(error);
+}
+
+void TellicoImporter::deleteReader() {
+  delete m_thread;
+  m_thread = nullptr;
+  delete m_reader;
+  m_reader = nullptr;
+  delete m_xmlDevice;
+  m_xmlDevice = nullptr;
+  delete m_xmlZip;
+  m_xmlZip = nullptr;
+}
+
+void TellicoImporter::finishReading() {
+  if(!m_thread) {
     return;
   }
+  m_thread->wait();
+  slotThreadFinished();
+}
 
-  if(!success) {
-    m_format = Error;
-    QString error;
-    if(!url().isEmpty()) {
-      error = i18n(errorLoad).arg(url().fileName()) + QLatin1Char('\n');
-    }
-    error += handler.errorString();
-    myDebug() << error;
-    setStatusMessage(error);
+void TellicoImporter::slotThreadEntriesRead() {
+  // a batch might still be queued after reading is done
+  if(!m_thread || !m_coll) {
     return;
   }
+  const Data::EntryList entries = m_thread->takeEntries();
+  if(entries.isEmpty()) {
+    return;
+  }
+  foreach(Data::EntryPtr entry, entries) {
+    // the ids from the file are kept, the loans refer to them
+    const Data::ID id = entry->id();
+    entry->setCollection(m_coll);
+    entry->setId(id);
+  }
+  m_coll->addEntries(entries);
+  emit signalEntriesRead(entries);
+}
 
-  if(!m_cancelled) {
-    m_hasImages = handler.hasImages();
-    m_coll = handler.collection();
+void TellicoImporter::slotThreadFinished() {
+  // finished() is still queued when the reading was already finished by finishReading()
+  if(!m_thread) {
+    return;
   }
+  m_thread->wait();
+  slotThreadEntriesRead();
+
+  const bool success = m_thread->success() && !m_cancelled;
+  if(!m_thread->success()) {
+    setReadError(m_reader->errorString());
+  } else if(success) {
+    // the entries are already in the collection and maybe in the views, too
+    const Data::EntryList modified = m_reader->addDeferredImages();
+    if(!modified.isEmpty()) {
+      QStringList imageFields;
+      foreach(Data::FieldPtr field, m_coll->imageFields()) {
+        imageFields << field->name();
+      }
+      m_coll->updateDicts(modified, imageFields);
+      emit signalEntriesModified(modified);
+    }
+    if(m_format == XML) {
+      m_hasImages = m_reader->hasImages();
+    }
+    // the filters and loans come after the entries in the file
+    Data::CollPtr coll = m_reader->collection();
+    if(coll) {
+      foreach(FilterPtr filter, coll->filters()) {
+        m_coll->addFilter(filter);
+      }
+      foreach(Data::BorrowerPtr borrower, coll->borrowers()) {
+        m_coll->addBorrower(borrower);
+      }
+    }
+  }
+  deleteReader();
+  emit signalReadFinished(success);
 }
 
 void TellicoImporter::loadZipData() {
@@ -165,8 +275,9 @@ void TellicoImporter::loadZipData() {
     m_buffer = nullptr;
     m_zip = new KZip(fileRef().fileName());
   } else {
-    QByteArray allData = data();
-    m_buffer = new QBuffer(&allData);
+    // the buffer holds a shallow copy of the data, which lives as long as the zip
+    m_buffer = new QBuffer();
+    m_buffer->setData(data());
     m_zip = new KZip(m_buffer);
   }
   if(!m_zip->open(QIODevice::ReadOnly)) {
@@ -209,15 +320,40 @@ void TellicoImporter::loadZipData() {
     return;
   }
 
-  const QByteArray xmlData = static_cast<const KArchiveFile*>(entry)->data();
-  // hack to account for processEvents and deletion
-  QPointer<TellicoImporter> thisPtr(this);
-  loadXMLData(xmlData, false);
-  if(!thisPtr) {
-    return;
+  // the images are available while the xml is still being read in the background
+  const KArchiveEntry* imgDirEntry = dir->entry(QLatin1String("images"));
+  if(imgDirEntry && imgDirEntry->isDirectory()) {
+    m_imgDir = static_cast<const KArchiveDirectory*>(imgDirEntry);
+    m_images.clear();
+    m_images.add(m_imgDir->entries());
+    m_hasImages = !m_images.isEmpty();
+  }
+
+  // decompress the xml data as it is parsed, rather than extracting the whole file first
+  const KArchiveFile* xmlFile = static_cast<const KArchiveFile*>(entry);
+  if(m_background) {
+    // the reading thread gets its own archive, the other one is used for the images
+    m_xmlZip = new KZip(fileRef().fileName());
+    if(m_xmlZip->open(QIODevice::ReadOnly) && m_xmlZip->directory()) {
+      const KArchiveEntry* xmlEntry = m_xmlZip->directory()->entry(entry->name());
+      if(xmlEntry && xmlEntry->isFile()) {
+        xmlFile = static_cast<const KArchiveFile*>(xmlEntry);
+        m_xmlDevice = xmlFile->createDevice();
+      }
+    }
+  } else {
+    m_xmlDevice = xmlFile->createDevice();
+  }
+  if(m_xmlDevice) {
+    // the device is deleted along with the reader
+    loadXMLData(m_xmlDevice, xmlFile->size(), false);
+  } else {
+    setStatusMessage(i18n(errorLoad, url().fileName()));
+    deleteReader();
   }
   if(!m_coll) {
     m_format = Error;
+    m_imgDir = nullptr;
     delete m_zip;
     m_zip = nullptr;
     delete m_buffer;
@@ -226,6 +362,7 @@ void TellicoImporter::loadZipData() {
   }
 
   if(m_cancelled) {
+    m_imgDir = nullptr;
     delete m_zip;
     m_zip = nullptr;
     delete m_buffer;
@@ -233,18 +370,13 @@ void TellicoImporter::loadZipData() {
     return;
   }
 
-  const KArchiveEntry* imgDirEntry = dir->entry(QLatin1String("images"));
-  if(!imgDirEntry || !imgDirEntry->isDirectory()) {
+  if(!m_imgDir) {
     delete m_zip;
     m_zip = nullptr;
     delete m_buffer;
     m_buffer = nullptr;
     return;
   }
-  m_imgDir = static_cast<const KArchiveDirectory*>(imgDirEntry);
-  m_images.clear();
-  m_images.add(m_imgDir->entries());
-  m_hasImages = !m_images.isEmpty();
 
   // if all the images are not to be loaded, then we're done
   if(!m_loadAllImages) {
@@ -252,6 +384,8 @@ void TellicoImporter::loadZipData() {
     return;
   }
 
+  // hack to account for processEvents and deletion
+  QPointer<TellicoImporter> thisPtr(this);
   const QStringList images = m_imgDir->entries();
   const uint stepSize = qMax(s_stepSize, static_cast<uint>(images.count())/100);
 
@@ -290,7 +424,8 @@ bool TellicoImporter::loadImage(const QString& id_) {
   QString newID = ImageFactory::addImage(static_cast<const KArchiveFile*>(file)->data(),
                                          id_.section(QLatin1Char('.'), -1).toUpper(), id_);
   m_images.remove(id_);
-  if(m_images.isEmpty()) {
+  // the reading thread might still be using the importer
+  if(m_images.isEmpty() && !m_thread) {
     // give it some time
     QTimer::singleShot(3000, this, SLOT(deleteLater()));
   }
@@ -298,6 +433,10 @@ bool TellicoImporter::loadImage(const QString& id_) {
 }
 
 KZip* TellicoImporter::takeImages() {
+  // a zip read from a buffer depends on the importer's data, so it can't be handed off
+  if(m_buffer) {
+    return nullptr;
+  }
   KZip* zip = m_zip;
   m_zip = nullptr;
   return zip;
@@ -306,6 +445,13 @@ KZip* TellicoImporter::takeImages() {
 void TellicoImporter::slotCancel() {
   m_cancelled = true;
   m_format = Cancel;
+  if(m_thread) {
+    m_thread->slotCancel();
+  }
+}
+
+void TellicoImporter::slotReadProgress(qint64 offset_) {
+  emit signalProgress(this, offset_);
 }
 
 // static
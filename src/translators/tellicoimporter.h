@@ -30,11 +30,14 @@
 #include "../utils/stringset.h"
 
 class QBuffer;
+class QIODevice;
 class KZip;
 class KArchiveDirectory;
 
 namespace Tellico {
   namespace Import {
+    class TellicoXMLReader;
+    class TellicoXMLThread;
 
 /**
  * @author Robby Stephenson
@@ -73,14 +76,48 @@ public:
   // take ownership of zip object with images
   KZip* takeImages();
 
+  /**
+   * When set, a file is read in a background thread. @ref collection returns as soon as the
+   * fields have been read, without any entries. The entries are added to the collection
+   * as they are read, and @ref signalEntriesRead is emitted for every batch. The filters,
+   * loans and image values follow at the end, before @ref signalReadFinished.
+   * Only files from a URL which do not load all the images are read in the background.
+   */
+  void setReadInBackground(bool background) { m_background = background; }
+  bool isReading() const { return m_thread != nullptr; }
+  /**
+   * Blocks until the background reading is done, without processing any events.
+   * The remaining signals are emitted before returning.
+   */
+  void finishReading();
+
   static bool loadAllImages(const QUrl& url);
 
 public Q_SLOTS:
   void slotCancel();
 
+Q_SIGNALS:
+  /**
+   * Emitted when reading in the background, after the entries have been added to the collection.
+   */
+  void signalEntriesRead(Tellico::Data::EntryList entries);
+  /**
+   * Emitted when reading in the background, after image values of entries which were
+   * already read have been changed.
+   */
+  void signalEntriesModified(Tellico::Data::EntryList entries);
+  void signalReadFinished(bool success);
+
+private Q_SLOTS:
+  void slotReadProgress(qint64 offset);
+  void slotThreadEntriesRead();
+  void slotThreadFinished();
+
 private:
-  void loadXMLData(const QByteArray& data, bool loadImages);
+  void loadXMLData(QIODevice* device, qint64 size, bool loadImages);
   void loadZipData();
+  void setReadError(const QString& error);
+  void deleteReader();
 
   Data::CollPtr m_coll;
   bool m_loadAllImages;
@@ -90,6 +127,12 @@ private:
   bool m_cancelled;
   bool m_hasImages;
   StringSet m_images;
+  bool m_background;
+  TellicoXMLReader* m_reader;
+  TellicoXMLThread* m_thread;
+  // the xml data of a zip file is read from a separate archive, since KZip is not thread-safe
+  KZip* m_xmlZip;
+  QIODevice* m_xmlDevice;
 
   QBuffer* m_buffer;
   KZip* m_zip;
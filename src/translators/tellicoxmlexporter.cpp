@@ -24,6 +24,7 @@
 
 #include "tellicoxmlexporter.h"
 #include "tellico_xml.h"
+#include "xmlwriter.h"
 #include "../utils/bibtexhandler.h" // needed for cleaning text
 #include "../entrygroup.h"
 #include "../collections/bibtexcollection.h"
@@ -49,6 +50,7 @@
 #include <QDomDocument>
 #include <QTextCodec>
 #include <QVBoxLayout>
+#include <QSaveFile>
 
 #include <algorithm>
 
@@ -72,13 +74,26 @@ QString TellicoXMLExporter::fileFilter() const {
 }
 
 bool TellicoXMLExporter::exec() {
-  QDomDocument doc = exportXML();
-  if(doc.isNull()) {
+  // remote files still go through the text
+  if(!url().isLocalFile()) {
+    QDomDocument doc = exportXML();
+    if(doc.isNull()) {
+      return false;
+    }
+    return FileHandler::writeTextURL(url(), doc.toString(),
+                                     options() & ExportUTF8,
+                                     options() & Export::ExportForce);
+  }
+
+  if(!(options() & Export::ExportForce) && !FileHandler::queryExists(url())) {
     return false;
   }
-  return FileHandler::writeTextURL(url(), doc.toString(),
-                                   options() & ExportUTF8,
-                                   options() & Export::ExportForce);
+  QSaveFile f(url().toLocalFile());
+  if(!f.open(QIODevice::WriteOnly)) {
+    myWarning() << "unable to write" << f.fileName() << f.errorString();
+    return false;
+  }
+  return exportXML(&f) && f.commit();
 }
 
 QString TellicoXMLExporter::text() const {
@@ -86,16 +101,12 @@ QString TellicoXMLExporter::text() const {
 }
 
 QDomDocument TellicoXMLExporter::exportXML() const {
-  int exportVersion = XML::syntaxVersion;
-
-  if(exportVersion == 12 && !version12Needed()) {
-    exportVersion = 11;
-  }
+  const int version = exportVersion();
 
   QDomImplementation impl;
   QDomDocumentType doctype = impl.createDocumentType(QLatin1String("tellico"),
-                                                     XML::pubTellico(exportVersion),
-                                                     XML::dtdTellico(exportVersion));
+                                                     XML::pubTellico(version),
+                                                     XML::dtdTellico(version));
   //default namespace
   const QString& ns = XML::nsTellico;
 
@@ -104,24 +115,17 @@ QDomDocument TellicoXMLExporter::exportXML() const {
   // root tellico element
   QDomElement root = dom.documentElement();
 
-  QString encodeStr = QLatin1String("version=\"1.0\" encoding=\"");
-  if(options() & Export::ExportUTF8) {
-    encodeStr += QLatin1String("UTF-8");
-  } else {
-    encodeStr += QLatin1String(QTextCodec::codecForLocale()->name());
-  }
-  encodeStr += QLatin1Char('"');
-
   // createDocument creates a root node, insert the processing instruction before it
-  dom.insertBefore(dom.createProcessingInstruction(QLatin1String("xml"), encodeStr), root);
+  dom.insertBefore(dom.createProcessingInstruction(QLatin1String("xml"), xmlDeclaration()), root);
 
-  root.setAttribute(QLatin1String("syntaxVersion"), exportVersion);
+  root.setAttribute(QLatin1String("syntaxVersion"), version);
 
   FieldFormat::Request format = (options() & Export::ExportFormatted ?
                                                 FieldFormat::ForceFormat :
                                                 FieldFormat::AsIsFormat);
 
-  exportCollectionXML(dom, root, format);
+  DomXMLWriter writer(dom, root);
+  exportCollectionXML(writer, format);
 
   // clear image list
   m_images.clear();
@@ -129,123 +133,177 @@ QDomDocument TellicoXMLExporter::exportXML() const {
   return dom;
 }
 
-void TellicoXMLExporter::exportCollectionXML(QDomDocument& dom_, QDomElement& parent_, int format_) const {
+bool TellicoXMLExporter::exportXML(QIODevice* device_) const {
+  const int version = exportVersion();
+
+  QTextCodec* codec = (options() & Export::ExportUTF8) ? QTextCodec::codecForName("UTF-8")
+                                                       : QTextCodec::codecForLocale();
+  StreamXMLWriter writer(device_, codec);
+  writer.writeProcessingInstruction(QLatin1String("xml"), xmlDeclaration());
+  writer.writeDocType(QLatin1String("tellico"), XML::pubTellico(version), XML::dtdTellico(version));
+  writer.writeStartElement(QLatin1String("tellico"), XML::nsTellico);
+  writer.writeAttribute(QLatin1String("syntaxVersion"), version);
+
+  FieldFormat::Request format = (options() & Export::ExportFormatted ?
+                                                FieldFormat::ForceFormat :
+                                                FieldFormat::AsIsFormat);
+
+  exportCollectionXML(writer, format);
+  writer.writeEndElement();
+
+  // clear image list
+  m_images.clear();
+
+  return writer.finish();
+}
+
+int TellicoXMLExporter::exportVersion() const {
+  int version = XML::syntaxVersion;
+  if(version == 12 && !version12Needed()) {
+    version = 11;
+  }
+  return version;
+}
+
+QString TellicoXMLExporter::xmlDeclaration() const {
+  QString encodeStr = QLatin1String("version=\"1.0\" encoding=\"");
+  if(options() & Export::ExportUTF8) {
+    encodeStr += QLatin1String("UTF-8");
+  } else {
+    encodeStr += QLatin1String(QTextCodec::codecForLocale()->name());
+  }
+  encodeStr += QLatin1Char('"');
+  return encodeStr;
+}
+
+// the writer may be streaming, so an element that is only added when it has children
+// has to be started along with its first child
+void TellicoXMLExporter::exportCollectionXML(Tellico::XMLWriter& writer_, int format_) const {
   Data::CollPtr coll = collection();
   if(!coll) {
     myWarning() << "no collection pointer!";
     return;
   }
 
-  QDomElement collElem = dom_.createElement(QLatin1String("collection"));
-  collElem.setAttribute(QLatin1String("type"), coll->type());
-  collElem.setAttribute(QLatin1String("title"), coll->title());
-
-  QDomElement fieldsElem = dom_.createElement(QLatin1String("fields"));
-  collElem.appendChild(fieldsElem);
+  writer_.writeStartElement(QLatin1String("collection"));
+  writer_.writeAttribute(QLatin1String("type"), coll->type());
+  writer_.writeAttribute(QLatin1String("title"), coll->title());
 
+  writer_.writeStartElement(QLatin1String("fields"));
   foreach(Data::FieldPtr field, fields()) {
-    exportFieldXML(dom_, fieldsElem, field);
+    exportFieldXML(writer_, field);
   }
+  writer_.writeEndElement();
 
   if(coll->type() == Data::Collection::Bibtex) {
     const Data::BibtexCollection* c = static_cast<const Data::BibtexCollection*>(coll.data());
     if(!c->preamble().isEmpty()) {
-      QDomElement preElem = dom_.createElement(QLatin1String("bibtex-preamble"));
-      preElem.appendChild(dom_.createTextNode(c->preamble()));
-      collElem.appendChild(preElem);
+      writer_.writeStartElement(QLatin1String("bibtex-preamble"));
+      writer_.writeText(c->preamble());
+      writer_.writeEndElement();
     }
 
-    QDomElement macrosElem = dom_.createElement(QLatin1String("macros"));
+    bool macrosStarted = false;
     for(StringMap::ConstIterator macroIt = c->macroList().constBegin(); macroIt != c->macroList().constEnd(); ++macroIt) {
       if(!macroIt.value().isEmpty()) {
-        QDomElement macroElem = dom_.createElement(QLatin1String("macro"));
-        macroElem.setAttribute(QLatin1String("name"), macroIt.key());
-        macroElem.appendChild(dom_.createTextNode(macroIt.value()));
-        macrosElem.appendChild(macroElem);
+        if(!macrosStarted) {
+          writer_.writeStartElement(QLatin1String("macros"));
+          macrosStarted = true;
+        }
+        writer_.writeStartElement(QLatin1String("macro"));
+        writer_.writeAttribute(QLatin1String("name"), macroIt.key());
+        writer_.writeText(macroIt.value());
+        writer_.writeEndElement();
       }
     }
-    if(macrosElem.childNodes().count() > 0) {
-      collElem.appendChild(macrosElem);
+    if(macrosStarted) {
+      writer_.writeEndElement();
     }
   }
 
   foreach(Data::EntryPtr entry, entries()) {
-    exportEntryXML(dom_, collElem, entry, format_);
+    exportEntryXML(writer_, entry, format_);
   }
 
   if(!m_images.isEmpty() && (options() & Export::ExportImages)) {
-    QDomElement imgsElem = dom_.createElement(QLatin1String("images"));
-    const QStringList imageIds = m_images.toList();
+    bool imagesStarted = false;
     foreach(const QString& id, m_images) {
-      exportImageXML(dom_, imgsElem, id);
+      exportImageXML(writer_, id, imagesStarted);
     }
-    if(imgsElem.hasChildNodes()) {
-      collElem.appendChild(imgsElem);
+    if(imagesStarted) {
+      writer_.writeEndElement();
     }
   }
 
   if(m_includeGroups) {
-    exportGroupXML(dom_, collElem);
+    exportGroupXML(writer_);
   }
 
-  parent_.appendChild(collElem);
+  writer_.writeEndElement(); // collection
 
   // the borrowers and filters are in the tellico object, not the collection
   if(options() & Export::ExportComplete) {
-    QDomElement bElem = dom_.createElement(QLatin1String("borrowers"));
+    bool borrowersStarted = false;
     foreach(Data::BorrowerPtr borrower, coll->borrowers()) {
-      exportBorrowerXML(dom_, bElem, borrower);
+      if(borrower->isEmpty()) {
+        continue;
+      }
+      if(!borrowersStarted) {
+        writer_.writeStartElement(QLatin1String("borrowers"));
+        borrowersStarted = true;
+      }
+      exportBorrowerXML(writer_, borrower);
     }
-    if(bElem.hasChildNodes()) {
-      parent_.appendChild(bElem);
+    if(borrowersStarted) {
+      writer_.writeEndElement();
     }
 
-    QDomElement fElem = dom_.createElement(QLatin1String("filters"));
-    foreach(FilterPtr filter, coll->filters()) {
-      exportFilterXML(dom_, fElem, filter);
-    }
-    if(fElem.hasChildNodes()) {
-      parent_.appendChild(fElem);
+    if(!coll->filters().isEmpty()) {
+      writer_.writeStartElement(QLatin1String("filters"));
+      foreach(FilterPtr filter, coll->filters()) {
+        exportFilterXML(writer_, filter);
+      }
+      writer_.writeEndElement();
     }
   }
 }
 
-void TellicoXMLExporter::exportFieldXML(QDomDocument& dom_, QDomElement& parent_, Tellico::Data::FieldPtr field_) const {
-  QDomElement elem = dom_.createElement(QLatin1String("field"));
+void TellicoXMLExporter::exportFieldXML(Tellico::XMLWriter& writer_, Tellico::Data::FieldPtr field_) const {
+  writer_.writeStartElement(QLatin1String("field"));
 
-  elem.setAttribute(QLatin1String("name"),     field_->name());
-  elem.setAttribute(QLatin1String("title"),    field_->title());
-  elem.setAttribute(QLatin1String("category"), field_->category());
-  elem.setAttribute(QLatin1String("type"),     field_->type());
-  elem.setAttribute(QLatin1String("flags"),    field_->flags());
-  elem.setAttribute(QLatin1String("format"),   field_->formatType());
+  writer_.writeAttribute(QLatin1String("name"),     field_->name());
+  writer_.writeAttribute(QLatin1String("title"),    field_->title());
+  writer_.writeAttribute(QLatin1String("category"), field_->category());
+  writer_.writeAttribute(QLatin1String("type"),     field_->type());
+  writer_.writeAttribute(QLatin1String("flags"),    field_->flags());
+  writer_.writeAttribute(QLatin1String("format"),   field_->formatType());
 
   if(field_->type() == Data::Field::Choice) {
-    elem.setAttribute(QLatin1String("allowed"), field_->allowed().join(QLatin1String(";")));
+    writer_.writeAttribute(QLatin1String("allowed"), field_->allowed().join(QLatin1String(";")));
   }
 
   // only save description if it's not equal to title, which is the default
   // title is never empty, so this indirectly checks for empty descriptions
   if(field_->description() != field_->title()) {
-    elem.setAttribute(QLatin1String("description"), field_->description());
+    writer_.writeAttribute(QLatin1String("description"), field_->description());
   }
 
   for(StringMap::ConstIterator it = field_->propertyList().begin(); it != field_->propertyList().end(); ++it) {
     if(it.value().isEmpty()) {
       continue;
     }
-    QDomElement e = dom_.createElement(QLatin1String("prop"));
-    e.setAttribute(QLatin1String("name"), it.key());
-    e.appendChild(dom_.createTextNode(it.value()));
-    elem.appendChild(e);
+    writer_.writeStartElement(QLatin1String("prop"));
+    writer_.writeAttribute(QLatin1String("name"), it.key());
+    writer_.writeText(it.value());
+    writer_.writeEndElement();
   }
 
-  parent_.appendChild(elem);
+  writer_.writeEndElement();
 }
 
-void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_, Tellico::Data::EntryPtr entry_, int format_) const {
-  QDomElement entryElem = dom_.createElement(QLatin1String("entry"));
-  entryElem.setAttribute(QLatin1String("id"), QString::number(entry_->id()));
+void TellicoXMLExporter::exportEntryXML(Tellico::XMLWriter& writer_, Tellico::Data::EntryPtr entry_, int format_) const {
+  writer_.writeStartElement(QLatin1String("entry"));
+  writer_.writeAttribute(QLatin1String("id"), QString::number(entry_->id()));
 
   // iterate through every field for the entry
   foreach(Data::FieldPtr fIt, fields()) {
@@ -275,8 +333,7 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
 
     if(fIt->type() == Data::Field::Table) {
       // who cares about grammar, just add an 's' to the name
-      QDomElement parElem = dom_.createElement(fieldName + QLatin1Char('s'));
-      entryElem.appendChild(parElem);
+      writer_.writeStartElement(fieldName + QLatin1Char('s'));
 
       bool ok;
       int ncols = Tellico::toUInt(fIt->property(QLatin1String("columns")), &ok);
@@ -284,8 +341,7 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
         ncols = 1;
       }
       foreach(const QString& rowValue, FieldFormat::splitTable(fieldValue)) {
-        QDomElement fieldElem = dom_.createElement(fieldName);
-        parElem.appendChild(fieldElem);
+        writer_.writeStartElement(fieldName);
 
         QStringList columnValues = FieldFormat::splitRow(rowValue);
         if(ncols < columnValues.count()) {
@@ -295,11 +351,13 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
           columnValues.replace(ncols-1, lastValue);
         }
         for(int col = 0; col < columnValues.count(); ++col) {
-          QDomElement elem = dom_.createElement(QLatin1String("column"));
-          elem.appendChild(dom_.createTextNode(columnValues.at(col)));
-          fieldElem.appendChild(elem);
+          writer_.writeStartElement(QLatin1String("column"));
+          writer_.writeText(columnValues.at(col));
+          writer_.writeEndElement();
         }
+        writer_.writeEndElement();
       }
+      writer_.writeEndElement();
       continue;
     }
 
@@ -307,39 +365,38 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
       // if multiple versions are allowed, split them into separate elements
       // parent element if field contains multiple values, child of entryElem
       // who cares about grammar, just add an QLatin1Char('s') to the name
-      QDomElement parElem = dom_.createElement(fieldName + QLatin1Char('s'));
-      entryElem.appendChild(parElem);
+      writer_.writeStartElement(fieldName + QLatin1Char('s'));
 
       // the space after the semi-colon is enforced when the field is set for the entry
       QStringList fields = FieldFormat::splitValue(fieldValue);
       for(QStringList::ConstIterator it = fields.constBegin(); it != fields.constEnd(); ++it) {
         // element for field value, child of either entryElem or ParentElem
-        QDomElement fieldElem = dom_.createElement(fieldName);
-        fieldElem.appendChild(dom_.createTextNode(*it));
-        parElem.appendChild(fieldElem);
+        writer_.writeStartElement(fieldName);
+        writer_.writeText(*it);
+        writer_.writeEndElement();
       }
+      writer_.writeEndElement();
     } else {
-      QDomElement fieldElem = dom_.createElement(fieldName);
-      entryElem.appendChild(fieldElem);
+      writer_.writeStartElement(fieldName);
       // Date fields get special treatment
       if(fIt->type() == Data::Field::Date) {
         // as of Tellico in KF5 (3.0), just forget about the calendar attribute for the moment, always use gregorian
-        fieldElem.setAttribute(QLatin1String("calendar"), QLatin1String("gregorian"));
+        writer_.writeAttribute(QLatin1String("calendar"), QLatin1String("gregorian"));
         QStringList s = fieldValue.split(QLatin1Char('-'), QString::KeepEmptyParts);
         if(s.count() > 0 && !s[0].isEmpty()) {
-          QDomElement e = dom_.createElement(QLatin1String("year"));
-          fieldElem.appendChild(e);
-          e.appendChild(dom_.createTextNode(s[0]));
+          writer_.writeStartElement(QLatin1String("year"));
+          writer_.writeText(s[0]);
+          writer_.writeEndElement();
         }
         if(s.count() > 1 && !s[1].isEmpty()) {
-          QDomElement e = dom_.createElement(QLatin1String("month"));
-          fieldElem.appendChild(e);
-          e.appendChild(dom_.createTextNode(s[1]));
+          writer_.writeStartElement(QLatin1String("month"));
+          writer_.writeText(s[1]);
+          writer_.writeEndElement();
         }
         if(s.count() > 2 && !s[2].isEmpty()) {
-          QDomElement e = dom_.createElement(QLatin1String("day"));
-          fieldElem.appendChild(e);
-          e.appendChild(dom_.createTextNode(s[2]));
+          writer_.writeStartElement(QLatin1String("day"));
+          writer_.writeText(s[2]);
+          writer_.writeEndElement();
         }
       } else if(fIt->type() == Data::Field::URL &&
                 fIt->property(QLatin1String("relative")) == QLatin1String("true") &&
@@ -347,10 +404,11 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
         // if a relative URL and url() is not empty, change the value!
         QUrl old_url = Data::Document::self()->URL().resolved(QUrl(fieldValue));
         QString relPath = QDir(url().toLocalFile()).relativeFilePath(old_url.path());
-        fieldElem.appendChild(dom_.createTextNode(relPath));
+        writer_.writeText(relPath);
       } else {
-        fieldElem.appendChild(dom_.createTextNode(fieldValue));
+        writer_.writeText(fieldValue);
       }
+      writer_.writeEndElement();
     }
 
     if(fIt->type() == Data::Field::Image) {
@@ -360,50 +418,59 @@ void TellicoXMLExporter::exportEntryXML(QDomDocument& dom_, QDomElement& parent_
     }
   } // end field loop
 
-  parent_.appendChild(entryElem);
+  writer_.writeEndElement();
 }
 
-void TellicoXMLExporter::exportImageXML(QDomDocument& dom_, QDomElement& parent_, const QString& id_) const {
+void TellicoXMLExporter::exportImageXML(Tellico::XMLWriter& writer_, const QString& id_, bool& parentStarted_) const {
   if(id_.isEmpty()) {
     myDebug() << "empty image!";
     return;
   }
 //  myLog() << "id = " << id_;
 
-  QDomElement imgElem = dom_.createElement(QLatin1String("image"));
   if(m_includeImages) {
     const Data::Image& img = ImageFactory::imageById(id_);
     if(img.isNull()) {
       return;
     }
-    imgElem.setAttribute(QLatin1String("format"), QLatin1String(img.format()));
-    imgElem.setAttribute(QLatin1String("id"),     QString(img.id()));
-    imgElem.setAttribute(QLatin1String("width"),  img.width());
-    imgElem.setAttribute(QLatin1String("height"), img.height());
+    if(!parentStarted_) {
+      writer_.writeStartElement(QLatin1String("images"));
+      parentStarted_ = true;
+    }
+    writer_.writeStartElement(QLatin1String("image"));
+    writer_.writeAttribute(QLatin1String("format"), QLatin1String(img.format()));
+    writer_.writeAttribute(QLatin1String("id"),     QString(img.id()));
+    writer_.writeAttribute(QLatin1String("width"),  img.width());
+    writer_.writeAttribute(QLatin1String("height"), img.height());
     if(img.linkOnly()) {
-      imgElem.setAttribute(QLatin1String("link"), QLatin1String("true"));
+      writer_.writeAttribute(QLatin1String("link"), QLatin1String("true"));
     }
     QByteArray imgText = img.byteArray().toBase64();
-    imgElem.appendChild(dom_.createTextNode(QLatin1String(imgText)));
+    writer_.writeText(QLatin1String(imgText));
   } else {
     const Data::ImageInfo& info = ImageFactory::imageInfo(id_);
     if(info.isNull()) {
       return;
     }
-    imgElem.setAttribute(QLatin1String("format"), QLatin1String(info.format));
-    imgElem.setAttribute(QLatin1String("id"),     QString(info.id));
+    if(!parentStarted_) {
+      writer_.writeStartElement(QLatin1String("images"));
+      parentStarted_ = true;
+    }
+    writer_.writeStartElement(QLatin1String("image"));
+    writer_.writeAttribute(QLatin1String("format"), QLatin1String(info.format));
+    writer_.writeAttribute(QLatin1String("id"),     QString(info.id));
     // only load the images to read the size if necessary
     const bool loadImageIfNecessary = options() & Export::ExportImageSize;
-    imgElem.setAttribute(QLatin1String("width"),  info.width(loadImageIfNecessary));
-    imgElem.setAttribute(QLatin1String("height"), info.height(loadImageIfNecessary));
+    writer_.writeAttribute(QLatin1String("width"),  info.width(loadImageIfNecessary));
+    writer_.writeAttribute(QLatin1String("height"), info.height(loadImageIfNecessary));
     if(info.linkOnly) {
-      imgElem.setAttribute(QLatin1String("link"), QLatin1String("true"));
+      writer_.writeAttribute(QLatin1String("link"), QLatin1String("true"));
     }
   }
-  parent_.appendChild(imgElem);
+  writer_.writeEndElement();
 }
 
-void TellicoXMLExporter::exportGroupXML(QDomDocument& dom_, QDomElement& parent_) const {
+void TellicoXMLExporter::exportGroupXML(Tellico::XMLWriter& writer_) const {
   Data::EntryList vec = entries();
   bool exportAll = collection()->entries().count() == vec.count();
   // iterate over each group, which are the first children
@@ -411,100 +478,102 @@ void TellicoXMLExporter::exportGroupXML(QDomDocument& dom_, QDomElement& parent_
     if(gIt.group()->isEmpty()) {
       continue;
     }
-    QDomElement groupElem = dom_.createElement(QLatin1String("group"));
-    groupElem.setAttribute(QLatin1String("title"), gIt.group()->groupName());
+    bool groupStarted = false;
     // now iterate over all entry items in the group
     Data::EntryList sorted = sortEntries(*gIt.group());
     foreach(Data::EntryPtr eIt, sorted) {
       if(!exportAll && vec.indexOf(eIt) == -1) {
         continue;
       }
-      QDomElement entryRefElem = dom_.createElement(QLatin1String("entryRef"));
-      entryRefElem.setAttribute(QLatin1String("id"), QString::number(eIt->id()));
-      groupElem.appendChild(entryRefElem);
+      if(!groupStarted) {
+        writer_.writeStartElement(QLatin1String("group"));
+        writer_.writeAttribute(QLatin1String("title"), gIt.group()->groupName());
+        groupStarted = true;
+      }
+      writer_.writeStartElement(QLatin1String("entryRef"));
+      writer_.writeAttribute(QLatin1String("id"), QString::number(eIt->id()));
+      writer_.writeEndElement();
     }
-    if(groupElem.hasChildNodes()) {
-      parent_.appendChild(groupElem);
+    if(groupStarted) {
+      writer_.writeEndElement();
     }
   }
 }
 
-void TellicoXMLExporter::exportFilterXML(QDomDocument& dom_, QDomElement& parent_, Tellico::FilterPtr filter_) const {
-  QDomElement filterElem = dom_.createElement(QLatin1String("filter"));
-  filterElem.setAttribute(QLatin1String("name"), filter_->name());
+void TellicoXMLExporter::exportFilterXML(Tellico::XMLWriter& writer_, Tellico::FilterPtr filter_) const {
+  writer_.writeStartElement(QLatin1String("filter"));
+  writer_.writeAttribute(QLatin1String("name"), filter_->name());
 
   QString match = (filter_->op() == Filter::MatchAll) ? QLatin1String("all") : QLatin1String("any");
-  filterElem.setAttribute(QLatin1String("match"), match);
+  writer_.writeAttribute(QLatin1String("match"), match);
 
   foreach(FilterRule* rule, *filter_) {
-    QDomElement ruleElem = dom_.createElement(QLatin1String("rule"));
-    ruleElem.setAttribute(QLatin1String("field"), rule->fieldName());
-    ruleElem.setAttribute(QLatin1String("pattern"), rule->pattern());
+    writer_.writeStartElement(QLatin1String("rule"));
+    writer_.writeAttribute(QLatin1String("field"), rule->fieldName());
+    writer_.writeAttribute(QLatin1String("pattern"), rule->pattern());
     switch(rule->function()) {
       case FilterRule::FuncContains:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("contains"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("contains"));
         break;
       case FilterRule::FuncNotContains:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("notcontains"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("notcontains"));
         break;
       case FilterRule::FuncEquals:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("equals"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("equals"));
         break;
       case FilterRule::FuncNotEquals:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("notequals"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("notequals"));
         break;
       case FilterRule::FuncRegExp:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("regexp"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("regexp"));
         break;
       case FilterRule::FuncNotRegExp:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("notregexp"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("notregexp"));
         break;
       case FilterRule::FuncBefore:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("before"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("before"));
         break;
       case FilterRule::FuncAfter:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("after"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("after"));
         break;
       case FilterRule::FuncGreater:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("greaterthan"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("greaterthan"));
         break;
       case FilterRule::FuncLess:
-        ruleElem.setAttribute(QLatin1String("function"), QLatin1String("lessthan"));
+        writer_.writeAttribute(QLatin1String("function"), QLatin1String("lessthan"));
         break;
       /* If anything is updated here, be sure to update xmlstatehandler */
     }
-    filterElem.appendChild(ruleElem);
+    writer_.writeEndElement();
   }
 
-  parent_.appendChild(filterElem);
+  writer_.writeEndElement();
 }
 
-void TellicoXMLExporter::exportBorrowerXML(QDomDocument& dom_, QDomElement& parent_,
+void TellicoXMLExporter::exportBorrowerXML(Tellico::XMLWriter& writer_,
                                            Tellico::Data::BorrowerPtr borrower_) const {
   if(borrower_->isEmpty()) {
     return;
   }
 
-  QDomElement bElem = dom_.createElement(QLatin1String("borrower"));
-  parent_.appendChild(bElem);
-
-  bElem.setAttribute(QLatin1String("name"), borrower_->name());
-  bElem.setAttribute(QLatin1String("uid"), borrower_->uid());
+  writer_.writeStartElement(QLatin1String("borrower"));
+  writer_.writeAttribute(QLatin1String("name"), borrower_->name());
+  writer_.writeAttribute(QLatin1String("uid"), borrower_->uid());
 
   foreach(Data::LoanPtr it, borrower_->loans()) {
-    QDomElement lElem = dom_.createElement(QLatin1String("loan"));
-    bElem.appendChild(lElem);
-
-    lElem.setAttribute(QLatin1String("uid"), it->uid());
-    lElem.setAttribute(QLatin1String("entryRef"), QString::number(it->entry()->id()));
-    lElem.setAttribute(QLatin1String("loanDate"), it->loanDate().toString(Qt::ISODate));
-    lElem.setAttribute(QLatin1String("dueDate"), it->dueDate().toString(Qt::ISODate));
+    writer_.writeStartElement(QLatin1String("loan"));
+    writer_.writeAttribute(QLatin1String("uid"), it->uid());
+    writer_.writeAttribute(QLatin1String("entryRef"), QString::number(it->entry()->id()));
+    writer_.writeAttribute(QLatin1String("loanDate"), it->loanDate().toString(Qt::ISODate));
+    writer_.writeAttribute(QLatin1String("dueDate"), it->dueDate().toString(Qt::ISODate));
     if(it->inCalendar()) {
-      lElem.setAttribute(QLatin1String("calendar"), QLatin1String("true"));
+      writer_.writeAttribute(QLatin1String("calendar"), QLatin1String("true"));
     }
-
-    lElem.appendChild(dom_.createTextNode(it->note()));
+    writer_.writeText(it->note());
+    writer_.writeEndElement();
   }
+
+  writer_.writeEndElement();
 }
 
 QWidget* TellicoXMLExporter::widget(QWidget* parent_) {
@@ -30,11 +30,12 @@
 
 namespace Tellico {
   class Filter;
+  class XMLWriter;
 }
 
 class QDomDocument;
-class QDomElement;
 class QCheckBox;
+class QIODevice;
 
 namespace Tellico {
   namespace Export {
@@ -55,6 +56,14 @@ public:
 
   QString text() const;
   QDomDocument exportXML() const;
+  /**
+   * Writes the XML directly to a device, without creating a DOM document first. The output
+   * is the same as the text of exportXML(), encoded according to the options.
+   *
+   * @param device The output device, which must already be open
+   * @return false if writing failed
+   */
+  bool exportXML(QIODevice* device) const;
 
   void setIncludeImages(bool b) { m_includeImages = b; }
   void setIncludeGroups(bool b) { m_includeGroups = b; }
@@ -69,13 +78,15 @@ public:
   static const unsigned syntaxVersion;
 
 private:
-  void exportCollectionXML(QDomDocument& doc, QDomElement& parent, int format) const;
-  void exportFieldXML(QDomDocument& doc, QDomElement& parent, Data::FieldPtr field) const;
-  void exportEntryXML(QDomDocument& doc, QDomElement& parent, Data::EntryPtr entry, int format) const;
-  void exportImageXML(QDomDocument& doc, QDomElement& parent, const QString& imageID) const;
-  void exportGroupXML(QDomDocument& doc, QDomElement& parent) const;
-  void exportFilterXML(QDomDocument& doc, QDomElement& parent, FilterPtr filter) const;
-  void exportBorrowerXML(QDomDocument& doc, QDomElement& parent, Data::BorrowerPtr borrower) const;
+  int exportVersion() const;
+  QString xmlDeclaration() const;
+  void exportCollectionXML(XMLWriter& writer, int format) const;
+  void exportFieldXML(XMLWriter& writer, Data::FieldPtr field) const;
+  void exportEntryXML(XMLWriter& writer, Data::EntryPtr entry, int format) const;
+  void exportImageXML(XMLWriter& writer, const QString& imageID, bool& parentStarted) const;
+  void exportGroupXML(XMLWriter& writer) const;
+  void exportFilterXML(XMLWriter& writer, FilterPtr filter) const;
+  void exportBorrowerXML(XMLWriter& writer, Data::BorrowerPtr borrower) const;
 
   Data::EntryList sortEntries(const Data::EntryList& entries) const;
   bool version12Needed() const;
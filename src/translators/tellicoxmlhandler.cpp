@@ -24,23 +24,40 @@
 
 #include "tellicoxmlhandler.h"
 #include "../collection.h"
+#include "../collectionfactory.h"
+#include "../collections/bibtexcollection.h"
 #include "../tellico_debug.h"
 
 using Tellico::Import::TellicoXMLHandler;
 
-TellicoXMLHandler::TellicoXMLHandler() : QXmlDefaultHandler(), m_data(new SAX::StateData) {
-  m_handlers.push(new SAX::RootHandler(m_data));
+TellicoXMLHandler::TellicoXMLHandler() : QXmlDefaultHandler(), m_data(new SAX::StateData)
+    , m_rootHandler(new SAX::RootHandler(m_data)), m_takenEntries(0) {
+  m_data->nullHandler = new SAX::NullHandler(m_data);
+  m_handlers.push(m_rootHandler);
 }
 
 TellicoXMLHandler::~TellicoXMLHandler() {
+  // the handlers are owned by the root handler
+  m_handlers.clear();
+  delete m_rootHandler;
+  m_rootHandler = nullptr;
+  delete m_data->nullHandler;
   delete m_data;
   m_data = nullptr;
-  qDeleteAll(m_handlers);
-  m_handlers.clear();
 }
 
 bool TellicoXMLHandler::startElement(const QString& nsURI_, const QString& localName_,
                                      const QString& qName_, const QXmlAttributes& atts_) {
+  QXmlStreamAttributes atts;
+  atts.reserve(atts_.count());
+  for(int i = 0; i < atts_.count(); ++i) {
+    atts.append(atts_.qName(i), atts_.value(i));
+  }
+  return startElement(nsURI_, localName_, qName_, atts);
+}
+
+bool TellicoXMLHandler::startElement(const QString& nsURI_, const QString& localName_,
+                                     const QString& qName_, const QXmlStreamAttributes& atts_) {
   SAX::StateHandler* handler = m_handlers.top()->nextHandler(nsURI_, localName_, qName_);
   Q_ASSERT(handler);
   m_handlers.push(handler);
@@ -60,7 +77,6 @@ bool TellicoXMLHandler::endElement(const QString& nsURI_, const QString& localNa
   bool res = handler->end(nsURI_, localName_, qName_);
   // need to reset character data, too
   m_data->text.clear();
-  delete handler;
   return res;
 }
 
@@ -88,3 +104,55 @@ void TellicoXMLHandler::setLoadImages(bool loadImages_) {
 void TellicoXMLHandler::setShowImageLoadErrors(bool showImageErrors_) {
   m_data->showImageLoadErrors = showImageErrors_;
 }
+
+void TellicoXMLHandler::setDeferImages(bool deferImages_) {
+  m_data->deferImages = deferImages_;
+}
+
+Tellico::Data::EntryList TellicoXMLHandler::addDeferredImages() {
+  foreach(const SAX::ImageData& image, m_data->images) {
+    SAX::ImageHandler::addImage(image);
+  }
+  m_data->images.clear();
+  if(!m_data->coll) {
+    return Data::EntryList();
+  }
+  return SAX::CollectionHandler::checkImageValues(m_data);
+}
+
+void TellicoXMLHandler::setDeferEntries(bool deferEntries_) {
+  m_data->deferEntries = deferEntries_;
+}
+
+int TellicoXMLHandler::entryCount() const {
+  return m_data->entries.count();
+}
+
+Tellico::Data::EntryList TellicoXMLHandler::takeFinishedEntries() {
+  const Data::EntryList entries = m_data->entries.mid(m_takenEntries, m_data->finishedEntries - m_takenEntries);
+  m_takenEntries = m_data->finishedEntries;
+  return entries;
+}
+
+Tellico::Data::CollPtr TellicoXMLHandler::copyCollection() const {
+  Data::CollPtr coll = m_data->coll;
+  if(!coll) {
+    return Data::CollPtr();
+  }
+  Data::CollPtr newColl = CollectionFactory::collection(coll->type(), false);
+  newColl->setTitle(coll->title());
+  // reserve the slots in the same order before adding the fields
+  foreach(const QString& name, coll->fieldSlotNames()) {
+    newColl->ensureFieldSlot(name);
+  }
+  foreach(Data::FieldPtr field, coll->fields()) {
+    newColl->addField(Data::FieldPtr(new Data::Field(*field)));
+  }
+  if(coll->type() == Data::Collection::Bibtex) {
+    const Data::BibtexCollection* c = static_cast<Data::BibtexCollection*>(coll.data());
+    Data::BibtexCollection* newC = static_cast<Data::BibtexCollection*>(newColl.data());
+    newC->setPreamble(c->preamble());
+    newC->setMacroList(c->macroList());
+  }
+  return newColl;
+}
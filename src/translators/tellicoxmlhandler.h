@@ -27,6 +27,7 @@
 
 #include "xmlstatehandler.h"
 
+#include <QXmlDefaultHandler>
 #include <QStack>
 
 namespace Tellico {
@@ -39,6 +40,11 @@ public:
 
   virtual bool startElement(const QString& namespaceURI, const QString& localName,
                             const QString& qName, const QXmlAttributes& atts) Q_DECL_OVERRIDE;
+  /**
+   * Starts an element with the attributes from a stream reader, which avoids copying them.
+   */
+  bool startElement(const QString& namespaceURI, const QString& localName,
+                    const QString& qName, const QXmlStreamAttributes& atts);
   virtual bool endElement(const QString& namespaceURI, const QString& localName,
                           const QString& qName) Q_DECL_OVERRIDE;
   virtual bool characters(const QString& ch) Q_DECL_OVERRIDE;
@@ -51,9 +57,38 @@ public:
   void setLoadImages(bool loadImages);
   void setShowImageLoadErrors(bool showImageErrors);
 
+  /**
+   * Keeps the images to be added to the image factory by @ref addDeferredImages, so
+   * the data can be read in a thread other than the main one.
+   */
+  void setDeferImages(bool deferImages);
+  /**
+   * Adds the kept images and checks the image values of the entries.
+   *
+   * @return The entries with a changed image value
+   */
+  Data::EntryList addDeferredImages();
+  /**
+   * Keeps the entries out of the collection, so they can be added later.
+   */
+  void setDeferEntries(bool deferEntries);
+  int entryCount() const;
+  /**
+   * Returns the entries which have been read completely since the last call.
+   */
+  Data::EntryList takeFinishedEntries();
+  /**
+   * Returns a new collection with a copy of the fields, using the same value slots
+   * so that the entries can be moved to it without moving their values.
+   */
+  Data::CollPtr copyCollection() const;
+
 private:
   QStack<SAX::StateHandler*> m_handlers;
   SAX::StateData* m_data;
+  // owns all the other handlers
+  SAX::StateHandler* m_rootHandler;
+  int m_takenEntries;
 };
 
   }
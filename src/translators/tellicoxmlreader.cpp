@@ -0,0 +1,171 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "tellicoxmlreader.h"
+#include "../collection.h"
+#include "../tellico_debug.h"
+
+using Tellico::Import::TellicoXMLReader;
+
+TellicoXMLReader::TellicoXMLReader(const QByteArray& data_) : m_startPos(0), m_success(true) {
+  // QBuffer::setData() only makes a shallow copy of the data
+  m_buffer.setData(data_);
+  m_buffer.open(QIODevice::ReadOnly);
+  m_reader.setDevice(&m_buffer);
+}
+
+TellicoXMLReader::TellicoXMLReader(QIODevice* device_) : m_startPos(0), m_success(true) {
+  Q_ASSERT(device_);
+  if(!device_->isSequential()) {
+    m_startPos = device_->pos();
+  }
+  m_reader.setDevice(device_);
+}
+
+TellicoXMLReader::~TellicoXMLReader() {
+}
+
+bool TellicoXMLReader::read() {
+  while(m_success && !m_reader.atEnd()) {
+    m_success = readToken();
+  }
+  return m_success;
+}
+
+bool TellicoXMLReader::readUntil(qint64 offset_) {
+  while(m_success && !m_reader.atEnd() && offset() < offset_) {
+    m_success = readToken();
+  }
+  return m_success;
+}
+
+bool TellicoXMLReader::atEnd() const {
+  return !m_success || m_reader.atEnd();
+}
+
+qint64 TellicoXMLReader::offset() const {
+  QIODevice* device = m_reader.device();
+  // a sequential device has no position, so fall back to the parser offset
+  return device->isSequential() ? m_reader.characterOffset() : device->pos() - m_startPos;
+}
+
+bool TellicoXMLReader::readToken() {
+  switch(m_reader.readNext()) {
+    case QXmlStreamReader::StartElement:
+      {
+        const QString& localName = sharedName(m_reader.name());
+        // without a prefix, the qualified name is the same as the local name
+        const QString& qName = m_reader.prefix().isEmpty() ? localName : sharedName(m_reader.qualifiedName());
+        // the attributes are passed straight to the state handlers, which look them up by name
+        if(!m_handler.startElement(m_reader.namespaceUri().toString(), localName, qName, m_reader.attributes())) {
+          m_reader.raiseError(m_handler.errorString());
+        }
+      }
+      break;
+
+    case QXmlStreamReader::EndElement:
+      {
+        const QString& localName = sharedName(m_reader.name());
+        const QString& qName = m_reader.prefix().isEmpty() ? localName : sharedName(m_reader.qualifiedName());
+        if(!m_handler.endElement(m_reader.namespaceUri().toString(), localName, qName)) {
+          m_reader.raiseError(m_handler.errorString());
+        }
+      }
+      break;
+
+    case QXmlStreamReader::Characters:
+      if(!m_handler.characters(m_reader.text().toString())) {
+        m_reader.raiseError(m_handler.errorString());
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if(m_reader.hasError()) {
+    myDebug() << "XML error:" << m_reader.errorString()
+              << "at line" << m_reader.lineNumber() << ", column" << m_reader.columnNumber();
+    return false;
+  }
+  return true;
+}
+
+QString TellicoXMLReader::errorString() const {
+  const QString error = m_handler.errorString();
+  return error.isEmpty() ? m_reader.errorString() : error;
+}
+
+Tellico::Data::CollPtr TellicoXMLReader::collection() const {
+  return m_handler.collection();
+}
+
+bool TellicoXMLReader::hasImages() const {
+  return m_handler.hasImages();
+}
+
+void TellicoXMLReader::setLoadImages(bool loadImages_) {
+  m_handler.setLoadImages(loadImages_);
+}
+
+void TellicoXMLReader::setShowImageLoadErrors(bool showImageErrors_) {
+  m_handler.setShowImageLoadErrors(showImageErrors_);
+}
+
+void TellicoXMLReader::setDeferImages(bool deferImages_) {
+  m_handler.setDeferImages(deferImages_);
+}
+
+Tellico::Data::EntryList TellicoXMLReader::addDeferredImages() {
+  return m_handler.addDeferredImages();
+}
+
+void TellicoXMLReader::setDeferEntries(bool deferEntries_) {
+  m_handler.setDeferEntries(deferEntries_);
+}
+
+int TellicoXMLReader::entryCount() const {
+  return m_handler.entryCount();
+}
+
+Tellico::Data::EntryList TellicoXMLReader::takeFinishedEntries() {
+  return m_handler.takeFinishedEntries();
+}
+
+Tellico::Data::CollPtr TellicoXMLReader::copyCollection() const {
+  return m_handler.copyCollection();
+}
+
+// the number of distinct element and attribute names is small, so every name
+// is only allocated once and then shared by all the entries
+const QString& TellicoXMLReader::sharedName(const QStringRef& name_) {
+  const uint hash = qHash(name_);
+  QMultiHash<uint, QString>::const_iterator it = m_names.constFind(hash);
+  for( ; it != m_names.constEnd() && it.key() == hash; ++it) {
+    if(it.value() == name_) {
+      return it.value();
+    }
+  }
+  return m_names.insert(hash, name_.toString()).value();
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_IMPORT_TELLICOXMLREADER_H
+#define TELLICO_IMPORT_TELLICOXMLREADER_H
+
+#include "tellicoxmlhandler.h"
+
+#include <QXmlStreamReader>
+#include <QBuffer>
+#include <QMultiHash>
+
+namespace Tellico {
+  namespace Import {
+
+/**
+ * Reads Tellico XML data with a pull parser, driving the same state handlers
+ * as the SAX-based @ref TellicoXMLHandler.
+ *
+ * The data is read in steps, so the caller can report progress by the byte offset
+ * without having to re-enter the event loop. Element names are shared between all
+ * the entries, rather than allocating a new string for every field value, and the
+ * attributes are handed to the state handlers without being copied.
+ */
+class TellicoXMLReader {
+public:
+  /**
+   * @param data The XML data, which must remain valid while reading
+   */
+  explicit TellicoXMLReader(const QByteArray& data);
+  /**
+   * Reads the data from a device, such as a decompressing device for an archive member,
+   * so the data does not need to be loaded into memory all at once.
+   *
+   * @param device The open device, which is not owned by the reader
+   */
+  explicit TellicoXMLReader(QIODevice* device);
+  ~TellicoXMLReader();
+
+  /**
+   * Reads the complete data.
+   *
+   * @return false if there was an error
+   */
+  bool read();
+  /**
+   * Reads until at least @p offset bytes of the data have been consumed or the end is reached.
+   * The offset is relative to the position of the device when reading started.
+   *
+   * @return false if there was an error
+   */
+  bool readUntil(qint64 offset);
+  bool atEnd() const;
+  /**
+   * Returns the number of bytes of the data that have been consumed by the parser.
+   * For a sequential device, the character offset is used instead.
+   */
+  qint64 offset() const;
+
+  QString errorString() const;
+  Data::CollPtr collection() const;
+  bool hasImages() const;
+
+  void setLoadImages(bool loadImages);
+  void setShowImageLoadErrors(bool showImageErrors);
+
+  /**
+   * @see TellicoXMLHandler::setDeferImages
+   */
+  void setDeferImages(bool deferImages);
+  Data::EntryList addDeferredImages();
+  void setDeferEntries(bool deferEntries);
+  int entryCount() const;
+  /**
+   * @see TellicoXMLHandler::takeFinishedEntries
+   */
+  Data::EntryList takeFinishedEntries();
+  /**
+   * @see TellicoXMLHandler::copyCollection
+   */
+  Data::CollPtr copyCollection() const;
+
+private:
+  Q_DISABLE_COPY(TellicoXMLReader)
+
+  bool readToken();
+  const QString& sharedName(const QStringRef& name);
+
+  QBuffer m_buffer;
+  QXmlStreamReader m_reader;
+  TellicoXMLHandler m_handler;
+  QMultiHash<uint, QString> m_names;
+  qint64 m_startPos;
+  bool m_success;
+};
+
+  }
+}
+#endif
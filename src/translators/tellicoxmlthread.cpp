@@ -0,0 +1,108 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "tellicoxmlthread.h"
+#include "tellicoxmlreader.h"
+#include "../collection.h"
+
+using Tellico::Import::TellicoXMLThread;
+
+TellicoXMLThread::TellicoXMLThread(TellicoXMLReader* reader_, qint64 size_, QObject* parent_)
+    : QThread(parent_), m_reader(reader_), m_size(size_), m_cancelled(0), m_success(false)
+    , m_collectionDone(false) {
+  Q_ASSERT(m_reader);
+}
+
+Tellico::Data::CollPtr TellicoXMLThread::waitForCollection() {
+  QMutexLocker locker(&m_mutex);
+  while(!m_collectionDone) {
+    m_collectionReady.wait(&m_mutex);
+  }
+  return m_coll;
+}
+
+Tellico::Data::EntryList TellicoXMLThread::takeEntries() {
+  QMutexLocker locker(&m_mutex);
+  Data::EntryList entries = m_entries;
+  m_entries.clear();
+  return entries;
+}
+
+void TellicoXMLThread::slotCancel() {
+  m_cancelled.storeRelease(1);
+}
+
+void TellicoXMLThread::run() {
+  const qint64 blockSize = m_size/100 + 1;
+  qint64 pos = 0;
+
+  m_success = true;
+  while(m_success && !m_cancelled.loadAcquire() && !m_reader->atEnd()) {
+    pos += blockSize;
+    m_success = m_reader->readUntil(pos);
+    emit signalProgress(qMin(m_reader->offset(), m_size));
+    if(m_success) {
+      handOver();
+    }
+  }
+
+  {
+    // if there is no collection by now, there won't be one
+    QMutexLocker locker(&m_mutex);
+    m_collectionDone = true;
+    m_collectionReady.wakeAll();
+  }
+
+  // the collection was created in this thread, but it gets used in the thread this object lives in
+  Data::CollPtr coll = m_reader->collection();
+  if(coll) {
+    coll->moveToThread(thread());
+  }
+}
+
+void TellicoXMLThread::handOver() {
+  // only this thread ever sets the collection, so it can be checked without locking
+  if(!m_coll) {
+    // the fields are complete once the first entry has started, or at the end of the data
+    if(!m_reader->collection() || (m_reader->entryCount() == 0 && !m_reader->atEnd())) {
+      return;
+    }
+    Data::CollPtr coll = m_reader->copyCollection();
+    coll->moveToThread(thread());
+    QMutexLocker locker(&m_mutex);
+    m_coll = coll;
+    m_collectionDone = true;
+    m_collectionReady.wakeAll();
+  }
+
+  const Data::EntryList entries = m_reader->takeFinishedEntries();
+  if(entries.isEmpty()) {
+    return;
+  }
+  {
+    QMutexLocker locker(&m_mutex);
+    m_entries += entries;
+  }
+  emit signalEntriesRead();
+}
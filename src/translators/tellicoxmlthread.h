@@ -0,0 +1,108 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_IMPORT_TELLICOXMLTHREAD_H
+#define TELLICO_IMPORT_TELLICOXMLTHREAD_H
+
+#include "../datavectors.h"
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace Tellico {
+  namespace Import {
+    class TellicoXMLReader;
+
+/**
+ * Runs a @ref TellicoXMLReader in a background thread.
+ *
+ * Once the fields have been read, a copy of the collection without any entries is handed
+ * over, and the entries follow in batches as they are read. The reader's own collection is
+ * moved to the thread of this object once reading is finished. Images and entries must be
+ * deferred by the reader, since the image factory and the collection can only be used
+ * from the main thread.
+ */
+class TellicoXMLThread : public QThread {
+Q_OBJECT
+
+public:
+  /**
+   * @param reader The reader, which is not owned by the thread
+   * @param size The size of the data, used to report the progress
+   */
+  TellicoXMLThread(TellicoXMLReader* reader, qint64 size, QObject* parent = nullptr);
+
+  /**
+   * Only valid after the thread has finished.
+   */
+  bool success() const { return m_success; }
+  /**
+   * Blocks until the fields have been read or reading has ended, without processing any events.
+   * The thread must have been started.
+   *
+   * @return The copy of the collection, or a null pointer if reading ended before the fields were read
+   */
+  Data::CollPtr waitForCollection();
+  /**
+   * Returns the entries read since the last call. They still belong to the reader's collection.
+   */
+  Data::EntryList takeEntries();
+
+public Q_SLOTS:
+  void slotCancel();
+
+Q_SIGNALS:
+  /**
+   * Emitted from the reading thread, after each percent of the data is read.
+   */
+  void signalProgress(qint64 offset);
+  /**
+   * Emitted from the reading thread when there are new entries for @ref takeEntries.
+   */
+  void signalEntriesRead();
+
+protected:
+  virtual void run() Q_DECL_OVERRIDE;
+
+private:
+  void handOver();
+
+  TellicoXMLReader* m_reader;
+  qint64 m_size;
+  QAtomicInt m_cancelled;
+  bool m_success;
+
+  // guards everything below, which is shared with the thread this object lives in
+  QMutex m_mutex;
+  QWaitCondition m_collectionReady;
+  bool m_collectionDone;
+  Data::CollPtr m_coll;
+  Data::EntryList m_entries;
+};
+
+  }
+}
+#endif
@@ -32,13 +32,19 @@
 #include "../utils/stringset.h"
 #include "../tellico_debug.h"
 #include "../progressmanager.h"
+#include "../core/tellico_strings.h"
+#include "../utils/guiproxy.h"
 
 #include <KLocalizedString>
 #include <KZip>
 
-#include <QDomDocument>
-#include <QBuffer>
 #include <QApplication>
+#include <QTemporaryFile>
+#include <QSaveFile>
+
+namespace {
+  static const int ZIP_EXPORT_CHUNK_SIZE = 64 * 1024;
+}
 
 using namespace Tellico;
 using Tellico::Export::TellicoZipExporter;
@@ -62,6 +68,10 @@ bool TellicoZipExporter::exec() {
     return false;
   }
 
+  if(!(options() & Export::ExportForce) && !FileHandler::queryExists(url())) {
+    return false;
+  }
+
   // TODO: maybe need label?
   ProgressItem& item = ProgressManager::self()->newProgressItem(this, QString(), true);
   item.setTotalSteps(100);
@@ -78,26 +88,45 @@ bool TellicoZipExporter::exec() {
   opt &= ~Export::ExportProgress; // don't show progress for xml export
   exp.setOptions(opt);
   exp.setIncludeImages(false); // do not include the images themselves in XML
-  QByteArray xml = exp.exportXML().toByteArray(); // encoded in utf-8
+  // stream the xml to a temporary file, rather than holding the whole document in memory
+  QTemporaryFile xmlFile;
+  if(!xmlFile.open() || !exp.exportXML(&xmlFile)) {
+    myWarning() << "unable to write temporary xml file:" << xmlFile.errorString();
+    return false;
+  }
   ProgressManager::self()->setProgress(this, 5);
 
-  QByteArray data;
-  QBuffer buf(&data);
-
   if(m_cancelled) {
     return true; // intentionally cancelled
   }
 
-  KZip zip(&buf);
-  zip.open(QIODevice::WriteOnly);
-  zip.writeFile(QLatin1String("tellico.xml"), xml);
+  // a remote file is written locally, then uploaded
+  QTemporaryFile tempZipFile;
+  QString zipFileName;
+  if(url().isLocalFile()) {
+    zipFileName = url().toLocalFile();
+  } else {
+    if(!tempZipFile.open()) {
+      myWarning() << "unable to open temporary file:" << tempZipFile.errorString();
+      return false;
+    }
+    zipFileName = tempZipFile.fileName();
+  }
+
+  // when given a file name, KZip writes through a QSaveFile, so the archive is streamed to a
+  // temporary file beside the target, which only replaces the old file once it is complete
+  KZip zip(zipFileName);
+  if(!zip.open(QIODevice::WriteOnly)) {
+    GUI::Proxy::sorry(i18n(errorWrite, url().fileName()));
+    return false;
+  }
+  bool success = writeZipFile(zip, QLatin1String("tellico.xml"), &xmlFile);
 
-  if(m_includeImages) {
+  if(success && m_includeImages) {
     ProgressManager::self()->setProgress(this, 10);
     // gonna be lazy and just increment progress every 3 images
     // it might be less, might be more
     int j = 0;
-    const QString imagesDir = QLatin1String("images/");
     StringSet imageSet;
     Data::FieldList imageFields = coll->imageFields();
     // take intersection with the fields to be exported
@@ -106,7 +135,7 @@ bool TellicoZipExporter::exec() {
     // already took 10%, only 90% left
     const int stepSize = qMax(1, (coll->entryCount() * imageFields.count()) / 90);
     foreach(Data::EntryPtr entry, entries()) {
-      if(m_cancelled) {
+      if(m_cancelled || !success) {
         break;
       }
       foreach(Data::FieldPtr imageField, imageFields) {
@@ -119,16 +148,17 @@ bool TellicoZipExporter::exec() {
           myLog() << "not copying linked image: " << id;
           continue;
         }
-        const Data::Image& img = ImageFactory::imageById(id);
-        // if no image, continue
-        if(img.isNull()) {
+        if(!writeImage(zip, id, info.format)) {
+          QFileDevice* zipDevice = qobject_cast<QFileDevice*>(zip.device());
+          if(zipDevice && zipDevice->error() != QFileDevice::NoError) {
+            myWarning() << "unable to write the image" << id;
+            success = false;
+            break;
+          }
           myWarning() << "no image found for " << imageField->title() << " field";
           myWarning() << "...for the entry titled " << entry->title();
           continue;
         }
-        QByteArray ba = img.byteArray();
-//        myDebug() << "adding image id = " << it->field(fIt);
-        zip.writeFile(imagesDir + id, ba);
         imageSet.add(id);
         if(j%stepSize == 0) {
           ProgressManager::self()->setProgress(this, qMin(10+j/stepSize, 99));
@@ -141,14 +171,77 @@ bool TellicoZipExporter::exec() {
     ProgressManager::self()->setProgress(this, 80);
   }
 
-  zip.close();
+  if(m_cancelled || !success) {
+    // leave any existing file alone
+    QSaveFile* saveFile = qobject_cast<QSaveFile*>(zip.device());
+    if(saveFile) {
+      saveFile->cancelWriting();
+    }
+  }
+  success = zip.close() && success;
   if(m_cancelled) {
     return true;
   }
+  if(!success) {
+    GUI::Proxy::sorry(i18n(errorWrite, url().fileName()));
+    return false;
+  }
+
+  if(!url().isLocalFile()) {
+    return FileHandler::uploadFile(zipFileName, url());
+  }
+  return true;
+}
 
-  return FileHandler::writeDataURL(url(), data, options() & Export::ExportForce);
+bool TellicoZipExporter::writeImage(KZip& zip_, const QString& id_, const QByteArray& format_) {
+  const QString name = QLatin1String("images/") + id_;
+  // jpeg and png images are already compressed, and deflating them again only takes time
+  QByteArray format = format_.toUpper();
+  if(format.isEmpty()) {
+    format = id_.section(QLatin1Char('.'), -1).toUpper().toLatin1();
+  }
+  const bool compressed = format == "JPEG" || format == "JPG" || format == "PNG";
+  zip_.setCompression(compressed ? KZip::NoCompression : KZip::DeflateCompression);
+
+  // the original image data is copied from the old archive or the image directory
+  // so the images aren't decoded and encoded again
+  bool success = false;
+  const QByteArray zipData = ImageFactory::zipImageData(id_);
+  if(!zipData.isEmpty()) {
+    success = zip_.writeFile(name, zipData);
+  } else {
+    const QString filePath = ImageFactory::imageFilePath(id_);
+    QFile file(filePath);
+    if(!filePath.isEmpty() && file.open(QIODevice::ReadOnly)) {
+      success = writeZipFile(zip_, name, &file);
+    } else {
+      const Data::Image& img = ImageFactory::imageById(id_);
+      if(!img.isNull()) {
+        success = zip_.writeFile(name, img.byteArray());
+      }
+    }
+  }
+  zip_.setCompression(KZip::DeflateCompression);
+  return success;
 }
 
 void TellicoZipExporter::slotCancel() {
   m_cancelled = true;
 }
+
+bool TellicoZipExporter::writeZipFile(KZip& zip_, const QString& name_, QIODevice* device_) {
+  const qint64 size = device_->size();
+  if(!device_->seek(0) || !zip_.prepareWriting(name_, QString(), QString(), size)) {
+    return false;
+  }
+  QByteArray chunk(ZIP_EXPORT_CHUNK_SIZE, Qt::Uninitialized);
+  qint64 written = 0;
+  while(written < size) {
+    const qint64 n = device_->read(chunk.data(), chunk.size());
+    if(n <= 0 || !zip_.writeData(chunk.constData(), n)) {
+      return false;
+    }
+    written += n;
+  }
+  return zip_.finishWriting(size);
+}
@@ -27,6 +27,9 @@
 
 #include "exporter.h"
 
+class KZip;
+class QIODevice;
+
 namespace Tellico {
   namespace Export {
 
@@ -52,6 +55,17 @@ public Q_SLOTS:
   void slotCancel();
 
 private:
+  /**
+   * Copies the device contents into the zip file in chunks
+   */
+  static bool writeZipFile(KZip& zip, const QString& name, QIODevice* device);
+  /**
+   * Adds an image to the zip file, using the original image data when possible
+   *
+   * @return false if there is no image data, or it could not be written
+   */
+  static bool writeImage(KZip& zip, const QString& id, const QByteArray& format);
+
   bool m_includeImages : 1;
   bool m_cancelled : 1;
 };
@@ -40,13 +40,13 @@
 namespace {
 
 inline
-QString attValue(const QXmlAttributes& atts, const char* name, const QString& defaultValue=QString()) {
-  int idx = atts.index(QLatin1String(name));
-  return idx < 0 ? defaultValue : atts.value(idx);
+QString attValue(const QXmlStreamAttributes& atts, const char* name, const QString& defaultValue=QString()) {
+  const QLatin1String attName(name);
+  return atts.hasAttribute(attName) ? atts.value(attName).toString() : defaultValue;
 }
 
 inline
-QString attValue(const QXmlAttributes& atts, const char* name, const char* defaultValue) {
+QString attValue(const QXmlStreamAttributes& atts, const char* name, const char* defaultValue) {
   Q_ASSERT(defaultValue);
   return attValue(atts, name, QLatin1String(defaultValue));
 }
@@ -88,12 +88,24 @@ using Tellico::Import::SAX::BorrowersHandler;
 using Tellico::Import::SAX::BorrowerHandler;
 using Tellico::Import::SAX::LoanHandler;
 
+StateHandler::~StateHandler() {
+  qDeleteAll(m_nextHandlers);
+}
+
 StateHandler* StateHandler::nextHandler(const QString& ns_, const QString& localName_, const QString& qName_) {
+  // every handler is kept for the next element with the same name, rather than allocating one per element
+  QHash<QString, StateHandler*>::const_iterator it = m_nextHandlers.constFind(localName_);
+  if(it != m_nextHandlers.constEnd()) {
+    return it.value();
+  }
   StateHandler* handler = nextHandlerImpl(ns_, localName_, qName_);
   if(!handler) {
     myWarning() << "no handler for" << localName_;
+    // unknown elements are not remembered, since the element might be valid later in the document
+    return d->nullHandler;
   }
-  return handler ? handler : new NullHandler(d);
+  m_nextHandlers.insert(localName_, handler);
+  return handler;
 }
 
 StateHandler* RootHandler::nextHandlerImpl(const QString&, const QString& localName_, const QString&) {
@@ -114,17 +126,17 @@ StateHandler* DocumentHandler::nextHandlerImpl(const QString&, const QString& lo
   return nullptr;
 }
 
-bool DocumentHandler::start(const QString&, const QString& localName_, const QString&, const QXmlAttributes& atts_) {
+bool DocumentHandler::start(const QString&, const QString& localName_, const QString&, const QXmlStreamAttributes& atts_) {
   // the syntax version field name changed from "version" to "syntaxVersion" in version 3
-  int idx = atts_.index(QLatin1String("syntaxVersion"));
-  if(idx < 0) {
-    idx = atts_.index(QLatin1String("version"));
+  QStringRef version = atts_.value(QLatin1String("syntaxVersion"));
+  if(version.isNull()) {
+    version = atts_.value(QLatin1String("version"));
   }
-  if(idx < 0) {
+  if(version.isNull()) {
     myWarning() << "no syntax version";
     return false;
   }
-  d->syntaxVersion = atts_.value(idx).toUInt();
+  d->syntaxVersion = version.toUInt();
   if(d->syntaxVersion > Tellico::XML::syntaxVersion) {
     d->error = i18n("It is from a future version of Tellico.");
     return false;
@@ -159,7 +171,7 @@ StateHandler* CollectionHandler::nextHandlerImpl(const QString&, const QString&
   return nullptr;
 }
 
-bool CollectionHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool CollectionHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   d->collTitle = attValue(atts_, "title");
   d->collType = attValue(atts_, "type").toInt();
   d->entryName = attValue(atts_, "unit");
@@ -175,8 +187,25 @@ bool CollectionHandler::end(const QString&, const QString&, const QString&) {
     myWarning() << "no collection created";
     return false;
   }
-  d->coll->addEntries(d->entries);
+  if(!d->deferEntries) {
+    d->coll->addEntries(d->entries);
+  }
+  // the image values can only be checked once the images are added
+  if(!d->deferImages) {
+    const Data::EntryList modified = checkImageValues(d);
+    if(!d->deferEntries) {
+      QStringList imageFields;
+      foreach(Data::FieldPtr field, d->coll->imageFields()) {
+        imageFields << field->name();
+      }
+      d->coll->updateDicts(modified, imageFields);
+    }
+  }
+  return true;
+}
 
+Tellico::Data::EntryList CollectionHandler::checkImageValues(StateData* d) {
+  Q_ASSERT(d->coll);
   // a little hidden capability was to just have a local path as an image file name
   // and on reading the xml file, Tellico would load the image file, too
   // here, we need to scan all the image values in all the entries and check
@@ -186,6 +215,7 @@ bool CollectionHandler::end(const QString&, const QString&, const QString&) {
   const int maxImageWarnings = 3;
   int imageWarnings = 0;
 
+  Data::EntryList modified;
   Data::FieldList fields = d->coll->imageFields();
   foreach(Data::EntryPtr entry, d->entries) {
     foreach(Data::FieldPtr field, fields) {
@@ -211,6 +241,12 @@ bool CollectionHandler::end(const QString&, const QString&, const QString&) {
         } else {
           value = Data::Image::idClean(value);
         }
+        if(value == entry->field(field)) {
+          continue;
+        }
+        if(modified.isEmpty() || modified.last() != entry) {
+          modified.append(entry);
+        }
         if(hasMDate) {
           // since the modified date gets reset, keep a copy
           const QString mdate = entry->field(QLatin1String("mdate"));
@@ -223,7 +259,7 @@ bool CollectionHandler::end(const QString&, const QString&, const QString&) {
       }
     }
   }
-  return true;
+  return modified;
 }
 
 StateHandler* FieldsHandler::nextHandlerImpl(const QString&, const QString& localName_, const QString&) {
@@ -234,7 +270,7 @@ StateHandler* FieldsHandler::nextHandlerImpl(const QString&, const QString& loca
   return nullptr;
 }
 
-bool FieldsHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool FieldsHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   d->defaultFields = false;
   return true;
 }
@@ -285,7 +321,7 @@ StateHandler* FieldHandler::nextHandlerImpl(const QString&, const QString& local
   return nullptr;
 }
 
-bool FieldHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool FieldHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   // special case: if the i18n attribute equals true, then translate the title, description, category, and allowed
   const bool isI18n = attValue(atts_, "i18n") == QLatin1String("true");
 
@@ -316,10 +352,9 @@ bool FieldHandler::start(const QString&, const QString&, const QString&, const Q
     field = new Data::Field(name, title, type);
   }
 
-  int idx = atts_.index(QLatin1String("category"));
-  if(idx > -1) {
+  if(atts_.hasAttribute(QLatin1String("category"))) {
     // at one point, the categories had keyboard accels
-    QString cat = atts_.value(idx);
+    QString cat = attValue(atts_, "category");
     if(d->syntaxVersion < 9) {
       cat.remove(QLatin1Char('&'));
     }
@@ -329,9 +364,8 @@ bool FieldHandler::start(const QString&, const QString&, const QString&, const Q
     field->setCategory(cat);
   }
 
-  idx = atts_.index(QLatin1String("flags"));
-  if(idx > -1) {
-    int flags = atts_.value(idx).toInt();
+  if(atts_.hasAttribute(QLatin1String("flags"))) {
+    int flags = atts_.value(QLatin1String("flags")).toInt();
     // I also changed the enum values for syntax 3, but the only custom field
     // would have been bibtex-id
     if(d->syntaxVersion < 3 && name == QLatin1String("bibtex-id")) {
@@ -353,16 +387,15 @@ bool FieldHandler::start(const QString&, const QString&, const QString&, const Q
   FieldFormat::Type formatType = static_cast<FieldFormat::Type>(formatStr.toInt());
   field->setFormatType(formatType);
 
-  idx = atts_.index(QLatin1String("description"));
-  if(idx > -1) {
-    QString desc = atts_.value(idx);
+  if(atts_.hasAttribute(QLatin1String("description"))) {
+    QString desc = attValue(atts_, "description");
     if(isI18n) {
       desc = i18n(desc.toUtf8().constData());
     }
     field->setDescription(desc);
   }
 
-  if(d->syntaxVersion < 5 && atts_.index(QLatin1String("bibtex-field")) > -1) {
+  if(d->syntaxVersion < 5 && atts_.hasAttribute(QLatin1String("bibtex-field"))) {
     field->setProperty(QLatin1String("bibtex"), attValue(atts_, "bibtex-field"));
   }
 
@@ -395,7 +428,7 @@ bool FieldHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool FieldPropertyHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool FieldPropertyHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   // there should be at least one field already so we can add properties to it
   Q_ASSERT(!d->fields.isEmpty());
   Data::FieldPtr field = d->fields.back();
@@ -426,7 +459,7 @@ bool FieldPropertyHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool BibtexPreambleHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool BibtexPreambleHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -446,7 +479,7 @@ StateHandler* BibtexMacrosHandler::nextHandlerImpl(const QString&, const QString
   return nullptr;
 }
 
-bool BibtexMacrosHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool BibtexMacrosHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -454,7 +487,7 @@ bool BibtexMacrosHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool BibtexMacroHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool BibtexMacroHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   m_macroName = attValue(atts_, "name");
   return true;
 }
@@ -474,7 +507,7 @@ StateHandler* EntryHandler::nextHandlerImpl(const QString&, const QString& local
   return new FieldValueContainerHandler(d);
 }
 
-bool EntryHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool EntryHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   // the entries must come after the fields
   if(!d->coll || d->coll->fields().isEmpty()) {
     // special case for very old versions which did not have user-editable fields
@@ -495,6 +528,10 @@ bool EntryHandler::start(const QString&, const QString&, const QString&, const Q
     entry = new Data::Entry(d->coll);
   }
   d->entries.append(entry);
+  // loans refer to entries by id, so they must be found before being added to the collection
+  if(d->deferEntries && ok && id > -1) {
+    d->entryById.insert(id, entry);
+  }
   return true;
 }
 
@@ -505,6 +542,7 @@ bool EntryHandler::end(const QString&, const QString&, const QString&) {
     entry->setField(QLatin1String("mdate"), d->modifiedDate);
     d->modifiedDate.clear();
   }
+  ++d->finishedEntries;
   return true;
 }
 
@@ -515,7 +553,7 @@ StateHandler* FieldValueContainerHandler::nextHandlerImpl(const QString&, const
   return new FieldValueContainerHandler(d);
 }
 
-bool FieldValueContainerHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool FieldValueContainerHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -534,7 +572,7 @@ StateHandler* FieldValueHandler::nextHandlerImpl(const QString&, const QString&
   return nullptr;
 }
 
-bool FieldValueHandler::start(const QString&, const QString&, const QString& localName_, const QXmlAttributes& atts_) {
+bool FieldValueHandler::start(const QString&, const QString&, const QString& localName_, const QXmlStreamAttributes& atts_) {
   d->currentField = d->coll->fieldByName(realFieldName(d->syntaxVersion, localName_));
   m_i18n = attValue(atts_, "i18n") == QLatin1String("true");
   m_validateISBN = (localName_ == QLatin1String("isbn")) &&
@@ -619,7 +657,7 @@ bool FieldValueHandler::end(const QString&, const QString& localName_, const QSt
   return true;
 }
 
-bool DateValueHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool DateValueHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -649,7 +687,7 @@ bool DateValueHandler::end(const QString&, const QString& localName_, const QStr
   return true;
 }
 
-bool TableColumnHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool TableColumnHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -678,7 +716,7 @@ StateHandler* ImagesHandler::nextHandlerImpl(const QString&, const QString& loca
   return nullptr;
 }
 
-bool ImagesHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool ImagesHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   // reset variable that gets updated in the image handler
   d->hasImages = false;
   return true;
@@ -688,7 +726,7 @@ bool ImagesHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool ImageHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool ImageHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   m_format = attValue(atts_, "format");
   m_link = attValue(atts_, "link") == QLatin1String("true");
   // idClean() already calls shareString()
@@ -700,24 +738,37 @@ bool ImageHandler::start(const QString&, const QString&, const QString&, const Q
 }
 
 bool ImageHandler::end(const QString&, const QString&, const QString&) {
-  bool needToAddInfo = true;
+  ImageData image;
+  image.id = m_imageId;
+  image.format = m_format;
+  image.link = m_link;
+  image.width = m_width;
+  image.height = m_height;
   if(d->loadImages && !d->text.isEmpty()) {
-    QByteArray ba = QByteArray::fromBase64(d->text.toLatin1());
-    if(!ba.isEmpty()) {
-      QString result = ImageFactory::addImage(ba, m_format, m_imageId);
-      if(result.isEmpty()) {
-        myDebug() << "null image for" << m_imageId;
-      }
+    image.data = QByteArray::fromBase64(d->text.toLatin1());
+    if(!image.data.isEmpty()) {
       d->hasImages = true;
-      needToAddInfo = false;
     }
   }
-  if(needToAddInfo) {
+  if(d->deferImages) {
+    d->images.append(image);
+  } else {
+    addImage(image);
+  }
+  return true;
+}
+
+void ImageHandler::addImage(const ImageData& image_) {
+  if(!image_.data.isEmpty()) {
+    QString result = ImageFactory::addImage(image_.data, image_.format, image_.id);
+    if(result.isEmpty()) {
+      myDebug() << "null image for" << image_.id;
+    }
+  } else {
     // a width or height of 0 is ok here
-    Data::ImageInfo info(m_imageId, m_format.toLatin1(), m_width, m_height, m_link);
+    Data::ImageInfo info(image_.id, image_.format.toLatin1(), image_.width, image_.height, image_.link);
     ImageFactory::cacheImageInfo(info);
   }
-  return true;
 }
 
 StateHandler* FiltersHandler::nextHandlerImpl(const QString&, const QString& localName_, const QString&) {
@@ -727,7 +778,7 @@ StateHandler* FiltersHandler::nextHandlerImpl(const QString&, const QString& loc
   return nullptr;
 }
 
-bool FiltersHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool FiltersHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -742,7 +793,7 @@ StateHandler* FilterHandler::nextHandlerImpl(const QString&, const QString& loca
   return nullptr;
 }
 
-bool FilterHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool FilterHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   d->filter = new Filter(Filter::MatchAny);
   d->filter->setName(attValue(atts_, "name"));
 
@@ -760,7 +811,7 @@ bool FilterHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool FilterRuleHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool FilterRuleHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   QString field = attValue(atts_, "field");
   // empty field means match any of them
   QString pattern = attValue(atts_, "pattern");
@@ -811,7 +862,7 @@ StateHandler* BorrowersHandler::nextHandlerImpl(const QString&, const QString& l
   return nullptr;
 }
 
-bool BorrowersHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes&) {
+bool BorrowersHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) {
   return true;
 }
 
@@ -826,7 +877,7 @@ StateHandler* BorrowerHandler::nextHandlerImpl(const QString&, const QString& lo
   return nullptr;
 }
 
-bool BorrowerHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool BorrowerHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   QString name = attValue(atts_, "name");
   QString uid = attValue(atts_, "uid");
   d->borrower = new Data::Borrower(name, uid);
@@ -842,7 +893,7 @@ bool BorrowerHandler::end(const QString&, const QString&, const QString&) {
   return true;
 }
 
-bool LoanHandler::start(const QString&, const QString&, const QString&, const QXmlAttributes& atts_) {
+bool LoanHandler::start(const QString&, const QString&, const QString&, const QXmlStreamAttributes& atts_) {
   m_id = attValue(atts_, "entryRef").toInt();
   m_uid = attValue(atts_, "uid");
   m_loanDate = attValue(atts_, "loanDate");
@@ -853,6 +904,9 @@ bool LoanHandler::start(const QString&, const QString&, const QString&, const QX
 
 bool LoanHandler::end(const QString&, const QString&, const QString&) {
   Data::EntryPtr entry = d->coll->entryById(m_id);
+  if(!entry && d->deferEntries) {
+    entry = d->entryById.value(m_id);
+  }
   if(!entry) {
     myWarning() << "no entry with id = " << m_id;
     return true;
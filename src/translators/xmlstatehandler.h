@@ -25,7 +25,8 @@
 #ifndef TELLICO_IMPORT_XMLSTATEHANDLER_H
 #define TELLICO_IMPORT_XMLSTATEHANDLER_H
 
-#include <QXmlAttributes>
+#include <QXmlStreamAttributes>
+#include <QHash>
 
 #include "../datavectors.h"
 
@@ -33,9 +34,28 @@ namespace Tellico {
   namespace Import {
     namespace SAX {
 
+/**
+ * An image read from the XML data, which has not been added to the image factory yet
+ */
+class ImageData {
+public:
+  ImageData() : link(false), width(0), height(0) {}
+  QString id;
+  QString format;
+  QByteArray data;
+  bool link;
+  int width;
+  int height;
+};
+
+class StateHandler;
+
 class StateData {
 public:
-  StateData() : syntaxVersion(0), collType(0), defaultFields(false), loadImages(false), hasImages(false), showImageLoadErrors(true) {}
+  StateData() : nullHandler(nullptr), syntaxVersion(0), collType(0), defaultFields(false), loadImages(false), hasImages(false), showImageLoadErrors(true)
+    , deferImages(false), deferEntries(false), finishedEntries(0) {}
+  // shared by every element which has no handler
+  StateHandler* nullHandler;
   QString text;
   QString error;
   QString ns; // namespace
@@ -55,21 +75,37 @@ public:
   bool loadImages;
   bool hasImages;
   bool showImageLoadErrors;
+  // the image factory can only be used from the main thread, so images get added later
+  bool deferImages;
+  QList<ImageData> images;
+  // entries are not added to the collection, so the caller can add them in chunks
+  bool deferEntries;
+  QHash<Data::ID, Data::EntryPtr> entryById;
+  // the number of entries which have been read completely
+  int finishedEntries;
 };
 
+/**
+ * A handler is created once for each element name under its parent and is then reused for
+ * every element with that name, so the handler must reset any state in @ref start. The handlers
+ * returned by @ref nextHandler are owned by the parent handler.
+ */
 class StateHandler {
 public:
   StateHandler(StateData* data) : d(data) {}
-  virtual ~StateHandler() {}
+  virtual ~StateHandler();
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) = 0;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) = 0;
   virtual bool   end(const QString&, const QString&, const QString&) = 0;
 
   StateHandler* nextHandler(const QString&, const QString&, const QString&);
 protected:
   StateData* d;
 private:
+  Q_DISABLE_COPY(StateHandler)
   virtual StateHandler* nextHandlerImpl(const QString&, const QString&, const QString&)  { return nullptr; }
+
+  QHash<QString, StateHandler*> m_nextHandlers;
 };
 
 class NullHandler : public StateHandler {
@@ -77,7 +113,7 @@ public:
   NullHandler(StateData* data) : StateHandler(data) {}
   virtual ~NullHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE { return true; }
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE { return true; }
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE { return true; }
 };
 
@@ -86,7 +122,7 @@ public:
   RootHandler(StateData* data) : StateHandler(data) {}
   virtual ~RootHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE { return true; }
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE { return true; }
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE { return true; }
 
 private:
@@ -98,7 +134,7 @@ public:
   DocumentHandler(StateData* data) : StateHandler(data) {}
   virtual ~DocumentHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -110,9 +146,17 @@ public:
   CollectionHandler(StateData* data) : StateHandler(data) {}
   virtual ~CollectionHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
+  /**
+   * Checks image field values which do not match any image in the data, and
+   * loads them as local files or urls.
+   *
+   * @return The entries with a changed image value, the collection's dicts are not updated
+   */
+  static Data::EntryList checkImageValues(StateData* data);
+
 private:
   virtual StateHandler* nextHandlerImpl(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 };
@@ -122,7 +166,7 @@ public:
   FieldsHandler(StateData* data) : StateHandler(data) {}
   virtual ~FieldsHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -134,7 +178,7 @@ public:
   FieldHandler(StateData* data) : StateHandler(data) {}
   virtual ~FieldHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -146,7 +190,7 @@ public:
   FieldPropertyHandler(StateData* data) : StateHandler(data) {}
   virtual ~FieldPropertyHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -158,7 +202,7 @@ public:
   BibtexPreambleHandler(StateData* data) : StateHandler(data) {}
   virtual ~BibtexPreambleHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 };
 
@@ -167,7 +211,7 @@ public:
   BibtexMacrosHandler(StateData* data) : StateHandler(data) {}
   virtual ~BibtexMacrosHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -179,7 +223,7 @@ public:
   BibtexMacroHandler(StateData* data) : StateHandler(data) {}
   virtual ~BibtexMacroHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -191,7 +235,7 @@ public:
   EntryHandler(StateData* data) : StateHandler(data) {}
   virtual ~EntryHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -203,7 +247,7 @@ public:
   FieldValueContainerHandler(StateData* data) : StateHandler(data) {}
   virtual ~FieldValueContainerHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -216,7 +260,7 @@ public:
     , m_i18n(false), m_validateISBN(false) {}
   virtual ~FieldValueHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -230,7 +274,7 @@ public:
   DateValueHandler(StateData* data) : StateHandler(data) {}
   virtual ~DateValueHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 };
 
@@ -239,7 +283,7 @@ public:
   TableColumnHandler(StateData* data) : StateHandler(data) {}
   virtual ~TableColumnHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 };
 
@@ -248,7 +292,7 @@ public:
   ImagesHandler(StateData* data) : StateHandler(data) {}
   virtual ~ImagesHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -261,9 +305,11 @@ public:
     , m_link(false), m_width(0), m_height(0) {}
   virtual ~ImageHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
+  static void addImage(const ImageData& image);
+
 private:
   QString m_format;
   bool m_link;
@@ -277,7 +323,7 @@ public:
   FiltersHandler(StateData* data) : StateHandler(data) {}
   virtual ~FiltersHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -289,7 +335,7 @@ public:
   FilterHandler(StateData* data) : StateHandler(data) {}
   virtual ~FilterHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -301,7 +347,7 @@ public:
   FilterRuleHandler(StateData* data) : StateHandler(data) {}
   virtual ~FilterRuleHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 };
 
@@ -310,7 +356,7 @@ public:
   BorrowersHandler(StateData* data) : StateHandler(data) {}
   virtual ~BorrowersHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -322,7 +368,7 @@ public:
   BorrowerHandler(StateData* data) : StateHandler(data) {}
   virtual ~BorrowerHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
@@ -335,7 +381,7 @@ public:
     , m_id(-1), m_inCalendar(false) {}
   virtual ~LoanHandler() {}
 
-  virtual bool start(const QString&, const QString&, const QString&, const QXmlAttributes&) Q_DECL_OVERRIDE;
+  virtual bool start(const QString&, const QString&, const QString&, const QXmlStreamAttributes&) Q_DECL_OVERRIDE;
   virtual bool   end(const QString&, const QString&, const QString&) Q_DECL_OVERRIDE;
 
 private:
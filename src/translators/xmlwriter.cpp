@@ -0,0 +1,242 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "xmlwriter.h"
+#include "../tellico_debug.h"
+
+#include <QIODevice>
+#include <QTextCodec>
+
+using Tellico::XMLWriter;
+using Tellico::DomXMLWriter;
+using Tellico::StreamXMLWriter;
+
+DomXMLWriter::DomXMLWriter(QDomDocument& doc_, const QDomElement& parent_) : XMLWriter(), m_doc(doc_) {
+  m_elements.append(parent_);
+}
+
+void DomXMLWriter::writeStartElement(const QString& name_) {
+  QDomElement elem = m_doc.createElement(name_);
+  m_elements.last().appendChild(elem);
+  m_elements.append(elem);
+}
+
+void DomXMLWriter::writeAttribute(const QString& name_, const QString& value_) {
+  m_elements.last().setAttribute(name_, value_);
+}
+
+void DomXMLWriter::writeText(const QString& text_) {
+  m_elements.last().appendChild(m_doc.createTextNode(text_));
+}
+
+void DomXMLWriter::writeEndElement() {
+  // never remove the parent element
+  Q_ASSERT(m_elements.size() > 1);
+  if(m_elements.size() > 1) {
+    m_elements.removeLast();
+  }
+}
+
+StreamXMLWriter::StreamXMLWriter(QIODevice* device_, QTextCodec* codec_) : XMLWriter(),
+    m_stream(device_), m_codec(codec_), m_utf8(false), m_startTagOpen(false), m_newlinePending(false) {
+  Q_ASSERT(m_codec);
+  m_stream.setCodec(m_codec);
+  // 106 is the MIB enum for UTF-8
+  m_utf8 = m_codec->mibEnum() == 106;
+}
+
+void StreamXMLWriter::writeProcessingInstruction(const QString& target_, const QString& data_) {
+  m_stream << "<?" << target_ << ' ' << data_ << "?>\n";
+}
+
+void StreamXMLWriter::writeDocType(const QString& name_, const QString& publicId_, const QString& systemId_) {
+  m_stream << "<!DOCTYPE " << name_;
+  if(!publicId_.isNull()) {
+    m_stream << " PUBLIC " << quotedValue(publicId_);
+    if(!systemId_.isNull()) {
+      m_stream << ' ' << quotedValue(systemId_);
+    }
+  } else if(!systemId_.isNull()) {
+    m_stream << " SYSTEM " << quotedValue(systemId_);
+  }
+  m_stream << ">\n";
+}
+
+void StreamXMLWriter::writeStartElement(const QString& name_) {
+  writeStartElement(name_, QString());
+}
+
+void StreamXMLWriter::writeStartElement(const QString& name_, const QString& namespaceUri_) {
+  closeStartTag(false);
+  if(m_newlinePending) {
+    m_stream << '\n';
+    m_newlinePending = false;
+  }
+  // QDom only indents if the previous sibling is not text
+  if(m_elements.isEmpty() || !m_elements.last().lastIsText) {
+    m_stream << QString(m_elements.size(), QLatin1Char(' '));
+  }
+  if(!m_elements.isEmpty()) {
+    m_elements.last().lastIsText = false;
+  }
+  m_stream << '<' << name_;
+  if(!namespaceUri_.isNull()) {
+    m_stream << " xmlns=\"" << encodeText(namespaceUri_, true, false, false) << '"';
+  }
+  Element elem;
+  elem.name = name_;
+  elem.lastIsText = false;
+  m_elements.append(elem);
+  m_startTagOpen = true;
+}
+
+void StreamXMLWriter::writeAttribute(const QString& name_, const QString& value_) {
+  Q_ASSERT(m_startTagOpen);
+  if(!m_startTagOpen) {
+    myWarning() << "attribute written after the start tag:" << name_;
+    return;
+  }
+  m_stream << ' ' << name_ << "=\"" << encodeText(value_, true, true, false) << '"';
+}
+
+void StreamXMLWriter::writeText(const QString& text_) {
+  Q_ASSERT(!m_elements.isEmpty());
+  if(m_elements.isEmpty()) {
+    return;
+  }
+  closeStartTag(true);
+  // no newline between an element and following text
+  m_newlinePending = false;
+  m_stream << encodeText(text_, false, false, true);
+  m_elements.last().lastIsText = true;
+}
+
+void StreamXMLWriter::writeEndElement() {
+  Q_ASSERT(!m_elements.isEmpty());
+  if(m_elements.isEmpty()) {
+    return;
+  }
+  const Element elem = m_elements.takeLast();
+  if(m_startTagOpen) {
+    // no child nodes
+    m_stream << "/>";
+    m_startTagOpen = false;
+  } else {
+    if(m_newlinePending) {
+      m_stream << '\n';
+      m_newlinePending = false;
+    }
+    if(!elem.lastIsText) {
+      m_stream << QString(m_elements.size(), QLatin1Char(' '));
+    }
+    m_stream << "</" << elem.name << '>';
+  }
+  m_newlinePending = true;
+}
+
+bool StreamXMLWriter::finish() {
+  closeStartTag(false);
+  if(m_newlinePending) {
+    m_stream << '\n';
+    m_newlinePending = false;
+  }
+  m_stream.flush();
+  return m_stream.status() == QTextStream::Ok;
+}
+
+void StreamXMLWriter::closeStartTag(bool textFollows_) {
+  if(!m_startTagOpen) {
+    return;
+  }
+  m_stream << '>';
+  // the first child is on a new line, unless it is text
+  if(!textFollows_) {
+    m_stream << '\n';
+  }
+  m_startTagOpen = false;
+}
+
+// this is the same as the encoding in QDom, which only escapes '>' after "]]"
+// and uses character references for anything the codec can't encode
+QString StreamXMLWriter::encodeText(const QString& text_, bool encodeQuotes_, bool performAVN_, bool encodeEOLs_) const {
+  const int len = text_.length();
+  QString result;
+  // most text needs no escaping at all, so it's only copied once something is replaced
+  bool replaced = false;
+  for(int i = 0; i < len; ++i) {
+    const QChar c = text_.at(i);
+    QString replacement;
+    if(c == QLatin1Char('<')) {
+      replacement = QLatin1String("&lt;");
+    } else if(encodeQuotes_ && c == QLatin1Char('"')) {
+      replacement = QLatin1String("&quot;");
+    } else if(c == QLatin1Char('&')) {
+      replacement = QLatin1String("&amp;");
+    } else if(c == QLatin1Char('>') && i >= 2 && text_.at(i-1) == QLatin1Char(']') && text_.at(i-2) == QLatin1Char(']')) {
+      replacement = QLatin1String("&gt;");
+    } else if(performAVN_ && (c == QChar(0xA) || c == QChar(0xD) || c == QChar(0x9))) {
+      replacement = QLatin1String("&#x") + QString::number(c.unicode(), 16) + QLatin1Char(';');
+    } else if(encodeEOLs_ && c == QChar(0xD)) {
+      replacement = QLatin1String("&#xd;");
+    } else if(!canEncode(text_, i)) {
+      replacement = QLatin1String("&#x") + QString::number(c.unicode(), 16) + QLatin1Char(';');
+    } else {
+      if(replaced) {
+        result += c;
+      }
+      continue;
+    }
+    if(!replaced) {
+      result = text_.left(i);
+      result.reserve(len + 16);
+      replaced = true;
+    }
+    result += replacement;
+  }
+  return replaced ? result : text_;
+}
+
+bool StreamXMLWriter::canEncode(const QString& text_, int pos_) const {
+  const QChar c = text_.at(pos_);
+  if(c.unicode() < 0x80) {
+    return true;
+  }
+  if(!m_utf8) {
+    return m_codec->canEncode(c);
+  }
+  // utf-8 can encode everything but broken surrogate pairs
+  if(c.isHighSurrogate()) {
+    return pos_+1 < text_.length() && text_.at(pos_+1).isLowSurrogate();
+  }
+  if(c.isLowSurrogate()) {
+    return pos_ > 0 && text_.at(pos_-1).isHighSurrogate();
+  }
+  return true;
+}
+
+// QDom prefers single quotes
+QString StreamXMLWriter::quotedValue(const QString& value_) {
+  const QChar quote = value_.contains(QLatin1Char('\'')) ? QLatin1Char('"') : QLatin1Char('\'');
+  return quote + value_ + quote;
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+    Copyright (C) 2026 Robby Stephenson <robby@periapsis.org>
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU General Public License as        *
+ *   published by the Free Software Foundation; either version 2 of        *
+ *   the License or (at your option) version 3 or any later version        *
+ *   accepted by the membership of KDE e.V. (or its successor approved     *
+ *   by the membership of KDE e.V.), which shall act as a proxy            *
+ *   defined in Section 14 of version 3 of the license.                    *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TELLICO_XMLWRITER_H
+#define TELLICO_XMLWRITER_H
+
+#include <QString>
+#include <QVector>
+#include <QDomElement>
+#include <QTextStream>
+
+class QIODevice;
+class QTextCodec;
+
+namespace Tellico {
+
+/**
+ * The XMLWriter is a minimal interface for writing an element tree, so the same export code
+ * can either build a DOM document or stream the XML directly to a file.
+ *
+ * Every attribute must be written before any child element or text of the same element.
+ *
+ * @author Robby Stephenson
+ */
+class XMLWriter {
+public:
+  XMLWriter() {}
+  virtual ~XMLWriter() {}
+
+  virtual void writeStartElement(const QString& name) = 0;
+  virtual void writeAttribute(const QString& name, const QString& value) = 0;
+  void writeAttribute(const QString& name, int value) { writeAttribute(name, QString::number(value)); }
+  virtual void writeText(const QString& text) = 0;
+  virtual void writeEndElement() = 0;
+
+private:
+  Q_DISABLE_COPY(XMLWriter)
+};
+
+/**
+ * Adds the elements as children of an existing DOM element
+ */
+class DomXMLWriter : public XMLWriter {
+public:
+  DomXMLWriter(QDomDocument& doc, const QDomElement& parent);
+
+  using XMLWriter::writeAttribute;
+  virtual void writeStartElement(const QString& name) Q_DECL_OVERRIDE;
+  virtual void writeAttribute(const QString& name, const QString& value) Q_DECL_OVERRIDE;
+  virtual void writeText(const QString& text) Q_DECL_OVERRIDE;
+  virtual void writeEndElement() Q_DECL_OVERRIDE;
+
+private:
+  QDomDocument& m_doc;
+  QVector<QDomElement> m_elements;
+};
+
+/**
+ * Writes the XML to a device, formatted exactly the same as QDomDocument::toString(1).
+ * QXmlStreamWriter escapes and indents differently, so it can't be used for output that has
+ * to match the DOM. The only difference is that attributes are written in the order they are
+ * given, while QDom writes them in hash order.
+ */
+class StreamXMLWriter : public XMLWriter {
+public:
+  /**
+   * @param device The output device, which must already be open
+   * @param codec The output encoding, which should match the XML declaration
+   */
+  StreamXMLWriter(QIODevice* device, QTextCodec* codec);
+
+  void writeProcessingInstruction(const QString& target, const QString& data);
+  void writeDocType(const QString& name, const QString& publicId, const QString& systemId);
+  /**
+   * Writes an element with a default namespace declaration, usually the document element
+   */
+  void writeStartElement(const QString& name, const QString& namespaceUri);
+
+  using XMLWriter::writeAttribute;
+  virtual void writeStartElement(const QString& name) Q_DECL_OVERRIDE;
+  virtual void writeAttribute(const QString& name, const QString& value) Q_DECL_OVERRIDE;
+  virtual void writeText(const QString& text) Q_DECL_OVERRIDE;
+  virtual void writeEndElement() Q_DECL_OVERRIDE;
+
+  /**
+   * Writes any pending output and flushes the device
+   *
+   * @return false if writing failed
+   */
+  bool finish();
+
+private:
+  struct Element {
+    QString name;
+    bool lastIsText;
+  };
+  void closeStartTag(bool textFollows);
+  QString encodeText(const QString& text, bool encodeQuotes, bool performAVN, bool encodeEOLs) const;
+  bool canEncode(const QString& text, int pos) const;
+  static QString quotedValue(const QString& value);
+
+  QTextStream m_stream;
+  QTextCodec* m_codec;
+  bool m_utf8;
+  QVector<Element> m_elements;
+  // the start tag is still open for attributes
+  bool m_startTagOpen;
+  // the newline after an end tag is skipped if text follows
+  bool m_newlinePending;
+};
+
+} // end namespace
+#endif
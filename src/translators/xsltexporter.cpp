@@ -70,7 +70,7 @@ bool XSLTExporter::exec() {
   exporter.setFields(fields());
   exporter.setOptions(options());
   QDomDocument dom = exporter.exportXML();
-  return FileHandler::writeTextURL(url(), handler.applyStylesheet(dom.toString()),
+  return FileHandler::writeTextURL(url(), handler.applyStylesheet(dom),
                                    options() & ExportUTF8, options() & Export::ExportForce);
 }
 
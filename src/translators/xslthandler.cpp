@@ -45,6 +45,94 @@ extern "C" {
 static const int xml_options = XML_PARSE_NOENT | XML_PARSE_NONET | XML_PARSE_NOCDATA;
 static const int xslt_options = xml_options;
 
+namespace {
+
+bool isTextNode(const QDomNode& node_) {
+  // CDATA sections are text nodes too
+  return !node_.isNull() && node_.isText();
+}
+
+void addTextNode(xmlDocPtr doc_, xmlNodePtr parent_, const QString& text_) {
+  if(text_.isEmpty()) {
+    return;
+  }
+  const QByteArray text = text_.toUtf8();
+  // xmlAddChild merges adjacent text nodes, same as the parser would
+  xmlAddChild(parent_, xmlNewDocTextLen(doc_, reinterpret_cast<const xmlChar*>(text.constData()), text.size()));
+}
+
+xmlNsPtr findNamespace(xmlDocPtr doc_, xmlNodePtr node_, const QString& href_, const QString& prefix_) {
+  const QByteArray href = href_.toUtf8();
+  xmlNsPtr ns = xmlSearchNsByHref(doc_, node_, reinterpret_cast<const xmlChar*>(href.constData()));
+  if(!ns) {
+    const QByteArray prefix = prefix_.toUtf8();
+    ns = xmlNewNs(node_, reinterpret_cast<const xmlChar*>(href.constData()),
+                  prefix.isEmpty() ? nullptr : reinterpret_cast<const xmlChar*>(prefix.constData()));
+  }
+  return ns;
+}
+
+// the indentation follows QDomElementPrivate::save() with the default indent of 1
+void addElement(xmlDocPtr doc_, xmlNodePtr parent_, const QDomElement& elem_, int depth_) {
+  const bool hasNamespace = !elem_.namespaceURI().isEmpty();
+  const QByteArray name = (hasNamespace ? elem_.localName() : elem_.tagName()).toUtf8();
+  xmlNodePtr node = xmlNewDocNode(doc_, nullptr, reinterpret_cast<const xmlChar*>(name.constData()), nullptr);
+  if(parent_) {
+    xmlAddChild(parent_, node);
+  } else {
+    xmlDocSetRootElement(doc_, node);
+  }
+  if(hasNamespace) {
+    xmlSetNs(node, findNamespace(doc_, node, elem_.namespaceURI(), elem_.prefix()));
+  } else {
+    // elements without a namespace are written without a prefix, so they end up in the default namespace
+    xmlSetNs(node, xmlSearchNs(doc_, node, nullptr));
+  }
+
+  const QDomNamedNodeMap attributes = elem_.attributes();
+  for(int i = 0; i < attributes.count(); ++i) {
+    const QDomAttr attr = attributes.item(i).toAttr();
+    const QByteArray value = attr.value().toUtf8();
+    if(attr.namespaceURI().isEmpty()) {
+      const QByteArray attrName = attr.name().toUtf8();
+      xmlNewProp(node, reinterpret_cast<const xmlChar*>(attrName.constData()),
+                 reinterpret_cast<const xmlChar*>(value.constData()));
+    } else {
+      const QByteArray attrName = attr.localName().toUtf8();
+      xmlNewNsProp(node, findNamespace(doc_, node, attr.namespaceURI(), attr.prefix()),
+                   reinterpret_cast<const xmlChar*>(attrName.constData()),
+                   reinterpret_cast<const xmlChar*>(value.constData()));
+    }
+  }
+
+  QDomNode child = elem_.firstChild();
+  if(child.isNull()) {
+    return;
+  }
+  if(!isTextNode(child)) {
+    addTextNode(doc_, node, QLatin1String("\n"));
+  }
+  const QString childIndent(depth_ + 1, QLatin1Char(' '));
+  for( ; !child.isNull(); child = child.nextSibling()) {
+    if(child.isElement()) {
+      if(!isTextNode(child.previousSibling())) {
+        addTextNode(doc_, node, childIndent);
+      }
+      addElement(doc_, node, child.toElement(), depth_ + 1);
+      if(!isTextNode(child.nextSibling())) {
+        addTextNode(doc_, node, QLatin1String("\n"));
+      }
+    } else if(isTextNode(child)) {
+      addTextNode(doc_, node, child.nodeValue());
+    }
+  }
+  if(!isTextNode(elem_.lastChild())) {
+    addTextNode(doc_, node, QString(depth_, QLatin1Char(' ')));
+  }
+}
+
+}
+
 /* some functions to pass to the XSLT libs */
 static int writeToQString(void* context, const char* buffer, int len) {
   QString* t = static_cast<QString*>(context);
@@ -52,6 +140,12 @@ static int writeToQString(void* context, const char* buffer, int len) {
   return len;
 }
 
+static int writeToQByteArray(void* context, const char* buffer, int len) {
+  QByteArray* t = static_cast<QByteArray*>(context);
+  t->append(buffer, len);
+  return len;
+}
+
 static void closeQString(void* context) {
   QString* t = static_cast<QString*>(context);
   *t += QLatin1String("\n");
@@ -233,32 +327,73 @@ QString XSLTHandler::applyStylesheet(const QString& text_) {
   return process(docIn);
 }
 
-QString XSLTHandler::process(xmlDocPtr docIn) {
-  if(!docIn) {
+QByteArray XSLTHandler::applyStylesheet(const QByteArray& text_, const QHash<QByteArray, QByteArray>& params_) const {
+  if(!m_stylesheet) {
+    myDebug() << "null stylesheet pointer!";
+    return QByteArray();
+  }
+  if(text_.isEmpty()) {
+    myDebug() << "empty input";
+    return QByteArray();
+  }
+
+  return applyStylesheet(xmlReadMemory(text_.constData(), text_.size(), nullptr, nullptr, xml_options), params_);
+}
+
+QByteArray XSLTHandler::applyStylesheet(xmlDocPtr docIn_, const QHash<QByteArray, QByteArray>& params_) const {
+  if(!docIn_) {
     myDebug() << "error parsing input string!";
-    return QString();
+    return QByteArray();
+  }
+  if(!m_stylesheet) {
+    myDebug() << "null stylesheet pointer!";
+    xmlFreeDoc(docIn_);
+    return QByteArray();
   }
 
-  QVector<const char*> params(2*m_params.count() + 1);
-  params[0] = nullptr;
-  QHash<QByteArray, QByteArray>::ConstIterator it = m_params.constBegin();
-  QHash<QByteArray, QByteArray>::ConstIterator end = m_params.constEnd();
-  for(int i = 0; it != end; ++it) {
-    params[i  ] = qstrdup(it.key().constData());
-    params[i+1] = qstrdup(it.value().constData());
-    params[i+2] = nullptr;
-    i += 2;
+  xmlDocPtr docOut = transform(docIn_, params_);
+  if(!docOut) {
+    myDebug() << "error applying stylesheet!";
+    return QByteArray();
   }
-  // returns NULL on error
-  xmlDocPtr docOut;
-  docOut = xsltApplyStylesheet(m_stylesheet, docIn, params.data());
-  for(int i = 0; i < 2*m_params.count(); ++i) {
-    delete[] params[i];
+
+  // start with a non-null array, so that empty output is not mistaken for an error
+  QByteArray result("");
+  xmlOutputBufferPtr output = xmlOutputBufferCreateIO((xmlOutputWriteCallback)writeToQByteArray,
+                                                      nullptr, &result, nullptr);
+  if(output) {
+    if(xsltSaveResultTo(output, docOut, m_stylesheet) == -1) {
+      myDebug() << "error saving output buffer!";
+    }
+    xmlOutputBufferClose(output); // also flushes
+  } else {
+    myWarning() << "error writing output buffer!";
   }
 
-  xmlFreeDoc(docIn);
-  docIn = nullptr;
+  xmlFreeDoc(docOut);
+  return result;
+}
+
+QString XSLTHandler::applyStylesheet(const QDomDocument& dom_) {
+  if(!m_stylesheet) {
+    myDebug() << "null stylesheet pointer!";
+    return QString();
+  }
+  if(dom_.isNull()) {
+    myDebug() << "empty input";
+    return QString();
+  }
+
+  return process(xmlDocument(dom_));
+}
 
+QString XSLTHandler::process(xmlDocPtr docIn) {
+  if(!docIn) {
+    myDebug() << "error parsing input string!";
+    return QString();
+  }
+
+  xmlDocPtr docOut = transform(docIn, m_params);
   if(!docOut) {
     myDebug() << "error applying stylesheet!";
     return QString();
@@ -278,6 +413,50 @@ QString XSLTHandler::process(xmlDocPtr docIn) {
   return output.result();
 }
 
+// the input document is freed, and the output document is returned, null on error
+// xsltApplyStylesheet creates a new transform context for every call, so the stylesheet itself is shared
+xmlDocPtr XSLTHandler::transform(xmlDocPtr docIn_, const QHash<QByteArray, QByteArray>& params_) const {
+  QVector<const char*> params(2*params_.count() + 1);
+  params[0] = nullptr;
+  QHash<QByteArray, QByteArray>::ConstIterator it = params_.constBegin();
+  QHash<QByteArray, QByteArray>::ConstIterator end = params_.constEnd();
+  for(int i = 0; it != end; ++it) {
+    params[i  ] = qstrdup(it.key().constData());
+    params[i+1] = qstrdup(it.value().constData());
+    params[i+2] = nullptr;
+    i += 2;
+  }
+  // returns NULL on error
+  xmlDocPtr docOut = xsltApplyStylesheet(m_stylesheet, docIn_, params.data());
+  for(int i = 0; i < 2*params_.count(); ++i) {
+    delete[] params[i];
+  }
+
+  xmlFreeDoc(docIn_);
+  return docOut;
+}
+
+//static
+xmlDocPtr XSLTHandler::xmlDocument(const QDomDocument& dom_) {
+  const QDomElement root = dom_.documentElement();
+  if(root.isNull()) {
+    return nullptr;
+  }
+  // the strings are all utf-8 in memory, so the encoding in the xml declaration doesn't matter
+  xmlDocPtr doc = xmlNewDoc(reinterpret_cast<const xmlChar*>("1.0"));
+  const QDomDocumentType doctype = dom_.doctype();
+  if(!doctype.isNull() && !doctype.name().isEmpty()) {
+    const QByteArray name = doctype.name().toUtf8();
+    const QByteArray publicId = doctype.publicId().toUtf8();
+    const QByteArray systemId = doctype.systemId().toUtf8();
+    xmlCreateIntSubset(doc, reinterpret_cast<const xmlChar*>(name.constData()),
+                       publicId.isEmpty() ? nullptr : reinterpret_cast<const xmlChar*>(publicId.constData()),
+                       systemId.isEmpty() ? nullptr : reinterpret_cast<const xmlChar*>(systemId.constData()));
+  }
+  addElement(doc, nullptr, root, 0);
+  return doc;
+}
+
 //static
 QDomDocument& XSLTHandler::setLocaleEncoding(QDomDocument& dom_) {
   const QDomNodeList children = dom_.documentElement().childNodes();
@@ -105,12 +105,52 @@ public:
    * @return The transformed text
    */
   QString applyStylesheet(const QString& text);
+  /**
+   * Processes UTF-8 text through the XSLT transformation. The parsed stylesheet is only read,
+   * so this may be called from several threads at once, as long as the stylesheet is not changed
+   * or deleted meanwhile. For the same reason, the params are passed in rather than read from
+   * the handler.
+   *
+   * @param text The UTF-8 text to be transformed
+   * @param params The stylesheet params, usually a copy of params()
+   * @return The transformed text, in the output encoding of the stylesheet. Null on error.
+   */
+  QByteArray applyStylesheet(const QByteArray& text, const QHash<QByteArray, QByteArray>& params) const;
+  /**
+   * Processes a libxml2 document through the XSLT transformation. Like the UTF-8 version,
+   * this may be called from several threads at once.
+   *
+   * @param doc The document to be transformed, which is freed afterwards
+   * @param params The stylesheet params, usually a copy of params()
+   * @return The transformed text, in the output encoding of the stylesheet. Null on error.
+   */
+  QByteArray applyStylesheet(xmlDocPtr doc, const QHash<QByteArray, QByteArray>& params) const;
+  /**
+   * Processes a DOM document through the XSLT transformation, without writing it out as text
+   * and parsing it again.
+   *
+   * @param dom The DOM document to be transformed
+   * @return The transformed text
+   */
+  QString applyStylesheet(const QDomDocument& dom);
+  QHash<QByteArray, QByteArray> params() const { return m_params; }
+
+  /**
+   * Creates a libxml2 document with the same content as the DOM document, including the
+   * whitespace that QDomDocument::toString() would add for indentation. That way, the
+   * transformation gives the same result as it would for the DOM text.
+   *
+   * @param dom The DOM document
+   * @return The new document, which the caller owns. Null if the DOM document is null.
+   */
+  static xmlDocPtr xmlDocument(const QDomDocument& dom);
 
   static QDomDocument& setLocaleEncoding(QDomDocument& dom);
 
 private:
   void init();
   QString process(xmlDocPtr docIn);
+  xmlDocPtr transform(xmlDocPtr docIn, const QHash<QByteArray, QByteArray>& params) const;
 
   xsltStylesheetPtr m_stylesheet;
 
@@ -33,9 +33,22 @@
 #include <QTextCodec>
 #include <QVariant>
 #include <QCache>
+#include <QMutex>
 
 namespace {
   static const int STRING_STORE_SIZE = 4999; // too big, too small?
+
+  QRegularExpression combiningMarksRegExp() {
+    QString pattern(QLatin1String("(?:"));
+    for(int i = 0x0300; i <= 0x036F; ++i) {
+      pattern += QChar(i) + QLatin1Char('|');
+    }
+    pattern.chop(1);
+    pattern += QLatin1Char(')');
+    QRegularExpression rx(pattern);
+    rx.optimize();
+    return rx;
+  }
 }
 
 QString Tellico::decodeHTML(const QByteArray& data_) {
@@ -108,8 +121,11 @@ int Tellico::stringHash(const QString& str) {
 
 QString Tellico::shareString(const QString& str) {
   static QString stringStore[STRING_STORE_SIZE];
+  // entries might be loaded in a background thread
+  static QMutex mutex;
 
   const int hash = stringHash(str) % STRING_STORE_SIZE;
+  QMutexLocker locker(&mutex);
   if(stringStore[hash] != str) {
     stringStore[hash] = str;
   }
@@ -130,22 +146,19 @@ QString Tellico::fromHtmlData(const QByteArray& data_, const char* codecName) {
 
 QString Tellico::removeAccents(const QString& value_) {
   static QCache<QString, QString> stringCache(STRING_STORE_SIZE);
-  if(stringCache.contains(value_)) {
-    return *stringCache.object(value_);
-  }
-  static QRegularExpression rx;
-  if(rx.pattern().isEmpty()) {
-    QString pattern(QLatin1String("(?:"));
-    for(int i = 0x0300; i <= 0x036F; ++i) {
-      pattern += QChar(i) + QLatin1Char('|');
+  // filters match entries in several threads at once
+  static QMutex mutex;
+  {
+    QMutexLocker locker(&mutex);
+    const QString* cached = stringCache.object(value_);
+    if(cached) {
+      return *cached;
     }
-    pattern.chop(1);
-    pattern += QLatin1Char(')');
-    rx.setPattern(pattern);
-    rx.optimize();
   }
   // remove accents from table "Combining Diacritical Marks"
+  static const QRegularExpression rx = combiningMarksRegExp();
   const QString value2 = value_.normalized(QString::NormalizationForm_D).remove(rx);
+  QMutexLocker locker(&mutex);
   stringCache.insert(value_, new QString(value2));
   return value2;
 }